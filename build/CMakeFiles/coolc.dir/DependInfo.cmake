@@ -0,0 +1,52 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/ASTPrinter.cpp" "CMakeFiles/coolc.dir/src/ASTPrinter.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/ASTPrinter.cpp.o.d"
+  "/root/repo/src/ast.cpp" "CMakeFiles/coolc.dir/src/ast.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/ast.cpp.o.d"
+  "/root/repo/src/bcimage.cpp" "CMakeFiles/coolc.dir/src/bcimage.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/bcimage.cpp.o.d"
+  "/root/repo/src/bclower.cpp" "CMakeFiles/coolc.dir/src/bclower.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/bclower.cpp.o.d"
+  "/root/repo/src/bytecode.cpp" "CMakeFiles/coolc.dir/src/bytecode.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/bytecode.cpp.o.d"
+  "/root/repo/src/cgen.cpp" "CMakeFiles/coolc.dir/src/cgen.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/cgen.cpp.o.d"
+  "/root/repo/src/cha.cpp" "CMakeFiles/coolc.dir/src/cha.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/cha.cpp.o.d"
+  "/root/repo/src/clower.cpp" "CMakeFiles/coolc.dir/src/clower.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/clower.cpp.o.d"
+  "/root/repo/src/environment.cpp" "CMakeFiles/coolc.dir/src/environment.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/environment.cpp.o.d"
+  "/root/repo/src/escape.cpp" "CMakeFiles/coolc.dir/src/escape.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/escape.cpp.o.d"
+  "/root/repo/src/folder.cpp" "CMakeFiles/coolc.dir/src/folder.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/folder.cpp.o.d"
+  "/root/repo/src/hoister.cpp" "CMakeFiles/coolc.dir/src/hoister.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/hoister.cpp.o.d"
+  "/root/repo/src/inliner.cpp" "CMakeFiles/coolc.dir/src/inliner.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/inliner.cpp.o.d"
+  "/root/repo/src/ir.cpp" "CMakeFiles/coolc.dir/src/ir.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/ir.cpp.o.d"
+  "/root/repo/src/irbuilder.cpp" "CMakeFiles/coolc.dir/src/irbuilder.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/irbuilder.cpp.o.d"
+  "/root/repo/src/irlower.cpp" "CMakeFiles/coolc.dir/src/irlower.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/irlower.cpp.o.d"
+  "/root/repo/src/irpasses.cpp" "CMakeFiles/coolc.dir/src/irpasses.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/irpasses.cpp.o.d"
+  "/root/repo/src/jit.cpp" "CMakeFiles/coolc.dir/src/jit.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/jit.cpp.o.d"
+  "/root/repo/src/main.cpp" "CMakeFiles/coolc.dir/src/main.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/main.cpp.o.d"
+  "/root/repo/src/nullness.cpp" "CMakeFiles/coolc.dir/src/nullness.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/nullness.cpp.o.d"
+  "/root/repo/src/object.cpp" "CMakeFiles/coolc.dir/src/object.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/object.cpp.o.d"
+  "/root/repo/src/parser.cpp" "CMakeFiles/coolc.dir/src/parser.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/parser.cpp.o.d"
+  "/root/repo/src/reachability.cpp" "CMakeFiles/coolc.dir/src/reachability.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/reachability.cpp.o.d"
+  "/root/repo/src/regalloc.cpp" "CMakeFiles/coolc.dir/src/regalloc.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/regalloc.cpp.o.d"
+  "/root/repo/src/resolver.cpp" "CMakeFiles/coolc.dir/src/resolver.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/resolver.cpp.o.d"
+  "/root/repo/src/scanner.cpp" "CMakeFiles/coolc.dir/src/scanner.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/scanner.cpp.o.d"
+  "/root/repo/src/semant.cpp" "CMakeFiles/coolc.dir/src/semant.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/semant.cpp.o.d"
+  "/root/repo/src/token.cpp" "CMakeFiles/coolc.dir/src/token.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/token.cpp.o.d"
+  "/root/repo/src/tokentable.cpp" "CMakeFiles/coolc.dir/src/tokentable.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/tokentable.cpp.o.d"
+  "/root/repo/src/utilities.cpp" "CMakeFiles/coolc.dir/src/utilities.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/utilities.cpp.o.d"
+  "/root/repo/src/vm.cpp" "CMakeFiles/coolc.dir/src/vm.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/vm.cpp.o.d"
+  "/root/repo/src/x86asm.cpp" "CMakeFiles/coolc.dir/src/x86asm.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/x86asm.cpp.o.d"
+  "/root/repo/src/x86lower.cpp" "CMakeFiles/coolc.dir/src/x86lower.cpp.o" "gcc" "CMakeFiles/coolc.dir/src/x86lower.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/build/CMakeFiles/coolrt.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,75 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/coolc.dir/src/ASTPrinter.cpp.o"
+  "CMakeFiles/coolc.dir/src/ASTPrinter.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/ast.cpp.o"
+  "CMakeFiles/coolc.dir/src/ast.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/bcimage.cpp.o"
+  "CMakeFiles/coolc.dir/src/bcimage.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/bclower.cpp.o"
+  "CMakeFiles/coolc.dir/src/bclower.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/bytecode.cpp.o"
+  "CMakeFiles/coolc.dir/src/bytecode.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/cgen.cpp.o"
+  "CMakeFiles/coolc.dir/src/cgen.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/cha.cpp.o"
+  "CMakeFiles/coolc.dir/src/cha.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/clower.cpp.o"
+  "CMakeFiles/coolc.dir/src/clower.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/environment.cpp.o"
+  "CMakeFiles/coolc.dir/src/environment.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/escape.cpp.o"
+  "CMakeFiles/coolc.dir/src/escape.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/folder.cpp.o"
+  "CMakeFiles/coolc.dir/src/folder.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/hoister.cpp.o"
+  "CMakeFiles/coolc.dir/src/hoister.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/inliner.cpp.o"
+  "CMakeFiles/coolc.dir/src/inliner.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/ir.cpp.o"
+  "CMakeFiles/coolc.dir/src/ir.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/irbuilder.cpp.o"
+  "CMakeFiles/coolc.dir/src/irbuilder.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/irlower.cpp.o"
+  "CMakeFiles/coolc.dir/src/irlower.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/irpasses.cpp.o"
+  "CMakeFiles/coolc.dir/src/irpasses.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/jit.cpp.o"
+  "CMakeFiles/coolc.dir/src/jit.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/main.cpp.o"
+  "CMakeFiles/coolc.dir/src/main.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/nullness.cpp.o"
+  "CMakeFiles/coolc.dir/src/nullness.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/object.cpp.o"
+  "CMakeFiles/coolc.dir/src/object.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/parser.cpp.o"
+  "CMakeFiles/coolc.dir/src/parser.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/reachability.cpp.o"
+  "CMakeFiles/coolc.dir/src/reachability.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/regalloc.cpp.o"
+  "CMakeFiles/coolc.dir/src/regalloc.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/resolver.cpp.o"
+  "CMakeFiles/coolc.dir/src/resolver.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/scanner.cpp.o"
+  "CMakeFiles/coolc.dir/src/scanner.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/semant.cpp.o"
+  "CMakeFiles/coolc.dir/src/semant.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/token.cpp.o"
+  "CMakeFiles/coolc.dir/src/token.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/tokentable.cpp.o"
+  "CMakeFiles/coolc.dir/src/tokentable.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/utilities.cpp.o"
+  "CMakeFiles/coolc.dir/src/utilities.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/vm.cpp.o"
+  "CMakeFiles/coolc.dir/src/vm.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/x86asm.cpp.o"
+  "CMakeFiles/coolc.dir/src/x86asm.cpp.o.d"
+  "CMakeFiles/coolc.dir/src/x86lower.cpp.o"
+  "CMakeFiles/coolc.dir/src/x86lower.cpp.o.d"
+  "coolc"
+  "coolc.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/coolc.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,22 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/lib/runtime/capi.cpp" "CMakeFiles/coolrt.dir/lib/runtime/capi.cpp.o" "gcc" "CMakeFiles/coolrt.dir/lib/runtime/capi.cpp.o.d"
+  "/root/repo/lib/runtime/gc.cpp" "CMakeFiles/coolrt.dir/lib/runtime/gc.cpp.o" "gcc" "CMakeFiles/coolrt.dir/lib/runtime/gc.cpp.o.d"
+  "/root/repo/lib/runtime/runtime.cpp" "CMakeFiles/coolrt.dir/lib/runtime/runtime.cpp.o" "gcc" "CMakeFiles/coolrt.dir/lib/runtime/runtime.cpp.o.d"
+  "/root/repo/lib/runtime/start.cpp" "CMakeFiles/coolrt.dir/lib/runtime/start.cpp.o" "gcc" "CMakeFiles/coolrt.dir/lib/runtime/start.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
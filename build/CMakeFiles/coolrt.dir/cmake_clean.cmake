@@ -0,0 +1,17 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/coolrt.dir/lib/runtime/capi.cpp.o"
+  "CMakeFiles/coolrt.dir/lib/runtime/capi.cpp.o.d"
+  "CMakeFiles/coolrt.dir/lib/runtime/gc.cpp.o"
+  "CMakeFiles/coolrt.dir/lib/runtime/gc.cpp.o.d"
+  "CMakeFiles/coolrt.dir/lib/runtime/runtime.cpp.o"
+  "CMakeFiles/coolrt.dir/lib/runtime/runtime.cpp.o.d"
+  "CMakeFiles/coolrt.dir/lib/runtime/start.cpp.o"
+  "CMakeFiles/coolrt.dir/lib/runtime/start.cpp.o.d"
+  "libcoolrt.a"
+  "libcoolrt.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/coolrt.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/coolsim.dir/tools/coolsim/main.cpp.o"
+  "CMakeFiles/coolsim.dir/tools/coolsim/main.cpp.o.d"
+  "CMakeFiles/coolsim.dir/tools/coolsim/simulator.cpp.o"
+  "CMakeFiles/coolsim.dir/tools/coolsim/simulator.cpp.o.d"
+  "coolsim"
+  "coolsim.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/coolsim.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,46 @@
+(*
+ *  Builds a list of 200000 integers with a loop, then walks it with
+ *  recursive methods which are not tail calls, so every target has to give
+ *  the program a stack deep enough for them.
+ *)
+
+class Node {
+   item : Int;
+   next : Node;
+
+   init(i : Int, n : Node) : Node {
+      {
+         item <- i;
+         next <- n;
+         self;
+      }
+   };
+
+   length() : Int {
+      if isvoid next then 1 else 1 + next.length() fi
+   };
+
+   sum() : Int {
+      if isvoid next then item else item + next.sum() fi
+   };
+};
+
+class Main inherits IO {
+   list : Node;
+
+   main() : Object {
+      {
+         let i : Int <- 0 in
+            while i < 200000 loop
+               {
+                  list <- (new Node).init(i - (i / 1000) * 1000, list);
+                  i <- i + 1;
+               }
+            pool;
+         out_int(list.length());
+         out_string(" items, ");
+         out_int(list.sum());
+         out_string(" in total\n");
+      }
+   };
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ast.hpp"
+#include <set>
+#include <string>
+
+namespace cool {
+
+// Collects the names assigned in an expression.
+class AssignedNames: public ExprVisitor {
+    public:
+        std::set<std::string> names;
+
+        void visitFeatureExpr(Feature* expr) { }
+        void visitFormalExpr(Formal* expr) { }
+        void visitAssignExpr(Assign* expr) { names.insert(expr->id.lexeme); expr->expr->accept(this); }
+        void visitIfExpr(If* expr) {
+            expr->cond->accept(this);
+            expr->thenBranch->accept(this);
+            expr->elseBranch->accept(this);
+        }
+        void visitWhileExpr(While* expr) { expr->cond->accept(this); expr->expr->accept(this); }
+        void visitBinaryExpr(Binary* expr) { expr->lhs->accept(this); expr->rhs->accept(this); }
+        void visitUnaryExpr(Unary* expr) { expr->expr->accept(this); }
+        void visitVariableExpr(Variable* expr) { }
+        void visitNewExpr(New* expr) { }
+        void visitBlockExpr(Block* expr) {
+            for (auto& e: expr->exprs)
+                e->accept(this);
+        }
+        void visitGroupingExpr(Grouping* expr) { expr->expr->accept(this); }
+        void visitStaticDispatchExpr(StaticDispatch* expr) {
+            for (auto& arg: expr->args)
+                arg->accept(this);
+            expr->expr->accept(this);
+        }
+        void visitDispatchExpr(Dispatch* expr) {
+            for (auto& arg: expr->args)
+                arg->accept(this);
+            expr->expr->accept(this);
+        }
+        void visitLiteralExpr(Literal* expr) { }
+        void visitLetExpr(Let* expr) {
+            for (auto& let: expr->vecAssigns) {
+                if (std::get<1>(let))
+                    std::get<1>(let)->accept(this);
+            }
+            expr->body->accept(this);
+        }
+        void visitCaseExpr(Case* expr) {
+            expr->expr->accept(this);
+            for (auto& match: expr->matches)
+                std::get<1>(match)->accept(this);
+        }
+};
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include <memory>
+#include <vector>
+
+namespace coolrt {
+struct Object;
+}
+
+namespace cool {
+
+// The data the native code of a program would have, built in memory from
+// its bytecode for the interpreter (vm.hpp) and the JIT (jit.hpp): the
+// prototypes, the dispatch tables, the constants and the names of the
+// classes, laid out as the runtime (lib/runtime) expects. Building it makes
+// it the program the runtime works for.
+// What the dispatch tables hold depends on who runs the code: the slots of
+// every function are given with set_entry.
+
+class BCImage {
+    public:
+        explicit BCImage(const BCProgram& program);
+
+        // make every slot of the dispatch tables holding `function` hold
+        // `entry`.
+        void set_entry(std::size_t function, void* entry);
+
+        int tag_of(const std::string& name) const;
+
+        // run a method of the basic classes, `args` holding self then its
+        // arguments.
+        static coolrt::Object* call_native(BCNative native, coolrt::Object** args);
+
+        const BCProgram& program;
+        std::vector<void**> dispatch_tables;
+        std::vector<coolrt::Object*> constants;
+        std::vector<coolrt::Object*> protos;
+        std::vector<coolrt::Object*> class_names;
+        coolrt::Object* bools[2]{};
+        coolrt::Object* filename{nullptr};
+
+    private:
+        // the slots of the dispatch tables holding every function.
+        std::vector<std::vector<void**>> slots;
+        // the memory of the dispatch tables and of the objects above.
+        std::vector<std::unique_ptr<int64_t[]>> storage;
+
+        int64_t* allocate_static(std::size_t words);
+        coolrt::Object* make_object(int tag, std::size_t words);
+        coolrt::Object* make_constant(const BCConstant& constant);
+};
+
+}
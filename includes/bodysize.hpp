@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ast.hpp"
+
+namespace cool {
+
+// Measures a method or loop body: its number of nodes and whether it declares
+// locals or contains a loop.
+class BodySize: public ExprVisitor {
+    public:
+        std::size_t size{0};
+        bool has_locals{false};
+        bool has_loop{false};
+
+        void visitFeatureExpr(Feature* expr) { }
+        void visitFormalExpr(Formal* expr) { }
+        void visitAssignExpr(Assign* expr) { size++; expr->expr->accept(this); }
+        void visitIfExpr(If* expr) {
+            size++;
+            expr->cond->accept(this);
+            expr->thenBranch->accept(this);
+            expr->elseBranch->accept(this);
+        }
+        void visitWhileExpr(While* expr) {
+            size++;
+            has_loop = true;
+            expr->cond->accept(this);
+            expr->expr->accept(this);
+        }
+        void visitBinaryExpr(Binary* expr) { size++; expr->lhs->accept(this); expr->rhs->accept(this); }
+        void visitUnaryExpr(Unary* expr) { size++; expr->expr->accept(this); }
+        void visitVariableExpr(Variable* expr) { size++; }
+        void visitNewExpr(New* expr) { size++; }
+        void visitBlockExpr(Block* expr) {
+            for (auto& e: expr->exprs)
+                e->accept(this);
+        }
+        void visitGroupingExpr(Grouping* expr) { expr->expr->accept(this); }
+        void visitStaticDispatchExpr(StaticDispatch* expr) {
+            size++;
+            for (auto& arg: expr->args)
+                arg->accept(this);
+            expr->expr->accept(this);
+        }
+        void visitDispatchExpr(Dispatch* expr) {
+            size++;
+            for (auto& arg: expr->args)
+                arg->accept(this);
+            expr->expr->accept(this);
+        }
+        void visitLiteralExpr(Literal* expr) { size++; }
+        void visitLetExpr(Let* expr) { size++; has_locals = true; }
+        void visitCaseExpr(Case* expr) { size++; has_locals = true; }
+};
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace cool {
+
+// Bytecode the interpreter of coolc runs (--run, see vm.hpp), compiled from
+// the IR (see bclower.cpp).
+// The code of a function is a sequence of 32 bits words: an opcode followed
+// by its operands, a fixed number of them or, for the calls and the case (-1
+// below), some followed by a count and the list. Its values live in two
+// files of registers, one for the objects (O), which the collector scans,
+// and one for the raw Int and Bool values (R). The parameters, self first, are the first object registers;
+// every other value of the IR has a register of its own. The branch targets
+// are indexes of words in the code of the function.
+// Some instructions do the work of common sequences of the IR
+// (superinstructions): Int addition of two boxed values, dispatch on self,
+// get and set of an attribute of self, comparison and branch.
+
+#define BC_OPCODES(X)                                                               \
+    X(LoadK, 2)         /* O[a] = constant b */                                     \
+    X(LoadVoid, 1)      /* O[a] = void */                                           \
+    X(LoadI, 2)         /* R[a] = b */                                              \
+    X(MovO, 2)          /* O[a] = O[b] */                                           \
+    X(MovR, 2)          /* R[a] = R[b] */                                           \
+    X(Add, 3)           /* R[a] = R[b] + R[c] */                                    \
+    X(AddI, 3)          /* R[a] = R[b] + c */                                       \
+    X(Sub, 3)                                                                       \
+    X(Mul, 3)                                                                       \
+    X(Div, 3)                                                                       \
+    X(Neg, 2)           /* R[a] = -R[b] */                                          \
+    X(Lt, 3)            /* R[a] = R[b] < R[c] */                                    \
+    X(Le, 3)                                                                        \
+    X(Eq, 3)                                                                        \
+    X(Not, 2)           /* R[a] = !R[b] */                                          \
+    X(BoxInt, 2)        /* O[a] = new Int holding R[b] */                           \
+    X(BoxBool, 2)       /* O[a] = Bool constant of R[b] */                          \
+    X(Unbox, 2)         /* R[a] = value of the Int or Bool O[b] */                  \
+    X(AddBoxed, 3)      /* O[a] = new Int holding O[b] + O[c] */                    \
+    X(AddIBoxed, 3)     /* O[a] = new Int holding O[b] + c */                       \
+    X(ObjEq, 3)         /* R[a] = O[b] = O[c] */                                    \
+    X(IsVoid, 2)        /* R[a] = isvoid O[b] */                                    \
+    X(New, 2)           /* O[a] = copy of the prototype of the class of tag b */    \
+    X(GetAttr, 3)       /* O[a] = attribute c (word index) of O[b] */               \
+    X(SetAttr, 3)       /* attribute b of O[a] = O[c] */                            \
+    X(GetAttrSelf, 2)   /* O[a] = attribute b of self */                            \
+    X(SetAttrSelf, 2)   /* attribute a of self = O[b] */                            \
+    X(Call, -1)         /* O[a] = function b of the c arguments O[...] */           \
+    X(Dispatch, -1)     /* O[a] = method of slot b of the table of O[...] */   \
+    X(DispatchSelf, -1) /* as Dispatch, self being passed before the c others */    \
+    X(TailCall, -1)     /* return function a of the b arguments O[...] */           \
+    X(TailDispatch, -1) /* return method of slot a of the b arguments O[...] */     \
+    X(CheckDispatch, 2) /* abort when O[a] is void, b being the line */             \
+    X(CheckCase, 2)                                                                 \
+    X(Jump, 1)          /* to a */                                                  \
+    X(Branch, 3)        /* to b if R[a], to c otherwise */                          \
+    X(BranchLt, 4)      /* to c if R[a] < R[b], to d otherwise */                   \
+    X(BranchLe, 4)                                                                  \
+    X(BranchEq, 4)                                                                  \
+    X(TypeCase, -1)     /* on the tag of O[a], b intervals (lo, hi, target) */      \
+    X(Return, 1)        /* O[a] */                                                  \
+    X(Halt, 0)          /* end of the program */
+
+enum class BCOp : uint32_t {
+#define BC_ENUM(name, operands) name,
+    BC_OPCODES(BC_ENUM)
+#undef BC_ENUM
+    Count
+};
+
+const char* bc_op_name(BCOp op);
+
+// number of words of the instruction at `code`, its opcode included.
+std::size_t bc_length(const uint32_t* code);
+
+// the methods of the basic classes, which the runtime implements.
+enum class BCNative {
+    None,
+    ObjectAbort, ObjectTypeName, ObjectCopy,
+    IOOutString, IOOutInt, IOInString, IOInInt,
+    StringLength, StringConcat, StringSubstr,
+};
+
+struct BCFunction {
+    std::string name;               // Class.method or Class_init.
+    BCNative native{BCNative::None};
+    std::size_t nparams{1};
+    std::size_t nobjects{0};        // registers of both files.
+    std::size_t nraws{0};
+    std::vector<uint32_t> code;
+};
+
+struct BCConstant {
+    enum class Kind { Int, Bool, String } kind;
+    int value{0};               // of an Int or a Bool, the length of a String.
+    std::string text;
+};
+
+struct BCClass {
+    std::string name;               // empty for the tags no class has.
+    std::size_t size{0};            // of the objects, in words.
+    // constant each attribute starts with, -1 for void.
+    std::vector<int> attributes;
+    // function of each slot of the dispatch table, -1 for the methods
+    // never called.
+    std::vector<int> methods;
+};
+
+struct BCProgram {
+    std::vector<BCFunction> functions;
+    std::vector<BCConstant> constants;
+    std::vector<BCClass> classes;   // by tag.
+    std::vector<int> class_names;   // constant of the name of the class of every tag.
+    int filename{-1};               // constant of the name of the source.
+    int start{-1};                  // function creating Main and calling main.
+
+    std::size_t code_words();
+};
+
+void print_bytecode(std::ostream& os, const BCProgram& program);
+
+}
@@ -2,25 +2,78 @@
 
 #include <iostream>
 #include <ostream>
+#include <sstream>
+#include <unordered_set>
 
 #include "token.hpp"
 #include "utilities.hpp"
 #include "localsizer.hpp"
+#include "regalloc.hpp"
+#include "cha.hpp"
+#include "resolver.hpp"
+#include "inliner.hpp"
+#include "nullness.hpp"
+#include "reachability.hpp"
+#include "escape.hpp"
+#include "ir.hpp"
+#include "irbuilder.hpp"
+#include "irpasses.hpp"
+#include "bytecode.hpp"
 #include "ast.hpp"
+#include "type.hpp"
 #include "environment.hpp"
 #include "constants.hpp"
 
 namespace cool {
 
+// Instruction sets the code can be generated for, the bytecode being run by
+// the interpreter of coolc (--run), and C.
+enum class Target { MIPS, X86_64, Bytecode, C };
+
+// Memory manager of the generated program: NoGC never collects, GenGC is
+// generational and ScnGC copies all the live objects at every collection.
+// The sizes and the share of the nursery left at 0 take the defaults of the
+// runtime.
+enum class Collector { NoGC, GenGC, ScnGC };
+
+struct GCOptions {
+    Collector collector{Collector::NoGC};
+    std::size_t heap_init{0};       // bytes.
+    std::size_t heap_max{0};        // bytes, 0 for no limit.
+    unsigned nursery_percent{0};    // of the heap, for the young objects.
+    bool stats{false};              // print the statistics of the collections at the end.
+    bool test{false};               // collect at every allocation (mips).
+};
+
+// Tags [lo, hi] sharing the same branch of a case (-1 if none).
+struct CaseInterval {
+    int lo;
+    int hi;
+    int branch;
+};
+
+// What the prologue of a method sets up, see cgen_method.
+struct FrameSummary {
+    std::string name;       // Class.method
+    std::size_t ar_size;    // words of the AR, its frame and the formals passed on the stack.
+    std::size_t saved_regs; // callee-saved registers holding locals.
+    bool calls;             // makes calls that return (not a leaf), RA is saved.
+    bool uses_fp;           // addresses slots of the AR through the fp.
+    bool uses_self;         // reads self or the attributes.
+};
+
+// Where a local variable lives: a slot of the AR or a register.
+struct VarLocation {
+    std::size_t offset;     // offset in words relative to the fp.
+    const char* reg;        // register holding the variable, nullptr if in the AR.
+};
+
 class Cgen: public StmtVisitor, public ExprVisitor {
 
     public:
         Cgen(InheritanceGraph* g_, SymbolTable<std::string, Class* >* ctable_ptr, std::ostream& out=std::cout): 
-            os{out}, class_table_ptr(ctable_ptr), g(g_), curr_attr_count{0}, ifcount{0}, while_count{0}, casecount{0}, dispatch_count{0} {
+            os{out}, class_table_ptr(ctable_ptr), g(g_), cha{g_, ctable_ptr}, resolver{cha}, inliner{cha, resolver, ctable_ptr}, nullness{cha, resolver}, reachability{cha, resolver, ctable_ptr}, escape{cha, resolver, ctable_ptr}, curr_attr_count{0}, ifcount{0}, while_count{0}, casecount{0}, dispatch_count{0} {
                 
-            classtag_map.insert({"Bool", BOOL_CLASS_TAG});
-            classtag_map.insert({"String", STRING_CLASS_TAG});
-            classtag_map.insert({"Int", INT_CLASS_TAG});
         }
 
         void cgen(std::unique_ptr<Expr>& expr) {
@@ -34,6 +87,72 @@ class Cgen: public StmtVisitor, public ExprVisitor {
         // emit code for string and integer constants
         void code_constants();
 
+        // number of dynamic and static dispatch sites and how many of them
+        // call their target directly.
+        std::size_t get_dispatch_sites() { return resolver.get_site_count(); }
+        std::size_t get_devirtualized_sites() { return resolver.get_resolved_count(); }
+
+        // maximum size of the method bodies expanded at their call sites
+        // and where to log the inlining decisions.
+        void set_inline_budget(std::size_t budget) { inliner.set_budget(budget); }
+        void set_inline_log(std::ostream* log) { inliner.set_log(log); }
+        std::size_t get_inlined_sites() { return inliner.get_inlined_count(); }
+
+        // dispatch-on-void checks removed in every method.
+        const std::vector<NullnessAnalysis::MethodChecks>& get_void_checks() { return nullness.get_method_checks(); }
+
+        // dispatches in tail position compiled to jumps, and among them the
+        // self-recursive ones compiled to loops.
+        std::size_t get_tail_calls() { return tail_call_count; }
+        std::size_t get_self_tail_calls() { return self_tail_call_count; }
+
+        // loops emitted with their test at the bottom and, among them, the
+        // counted ones whose body is emitted twice.
+        std::size_t get_rotated_loops() { return while_count; }
+        std::size_t get_unrolled_loops() { return unrolled_count; }
+
+        // frame of every method emitted.
+        const std::vector<FrameSummary>& get_frames() { return frames; }
+
+        // generate the code of the user classes from the IR optimized by the
+        // passes `passes` (see irpasses.hpp) rather than from the AST. The IR
+        // is printed to `dump` if not null once optimized.
+        void set_ir(const std::vector<std::string>& passes, std::ostream* dump) {
+            ir_mode = true;
+            ir_pass_names = passes;
+            ir_dump = dump;
+        }
+        bool get_ir_mode() { return ir_mode; }
+
+        // instruction set of the code generated. The x86-64 code, the
+        // bytecode and the C are generated from the IR (see x86lower.cpp,
+        // bclower.cpp and clower.cpp).
+        void set_target(Target target_) { target = target_; }
+
+        // memory manager the generated program runs with.
+        void set_gc(const GCOptions& options) { gc = options; }
+
+        // the bytecode generated for Target::Bytecode, and how many of its
+        // instructions are superinstructions.
+        BCProgram& get_bytecode() { return bc_program; }
+        std::size_t get_superinstructions() { return bc_superinstructions; }
+
+        // instructions of the IR built and left after the passes, and the
+        // number of functions each pass changed.
+        std::size_t get_ir_built_instructions() { return ir_built_instructions; }
+        std::size_t get_ir_instructions() { return ir_module.instruction_count(); }
+        const std::vector<std::pair<std::string, std::size_t>>& get_ir_changes() { return ir_changes; }
+
+        // user defined methods and classes and how many are emitted.
+        std::size_t get_method_count() { return reachability.get_method_count(); }
+        std::size_t get_emitted_method_count() { return reachability.get_reachable_method_count(); }
+        std::size_t get_class_count() { return reachability.get_class_count(); }
+        std::size_t get_emitted_class_count() { return reachability.get_live_class_count(); }
+
+        // number of `new` sites and how many allocate in the frame.
+        std::size_t get_new_sites() { return escape.get_site_count(); }
+        std::size_t get_stack_new_sites() { return escape.get_stack_site_count(); }
+
         void visitFeatureExpr(Feature* expr);
         void visitFormalExpr(Formal* expr);
         void visitAssignExpr(Assign* expr);
@@ -60,6 +179,23 @@ class Cgen: public StmtVisitor, public ExprVisitor {
         SymbolTable<std::string, Class* >* class_table_ptr;
         Class* curr_class;
 
+        Feature* curr_method{nullptr};
+
+        // used to resolve dispatches at compile time.
+        ClassHierarchy cha;
+        DispatchResolver resolver;
+        Inliner inliner;
+        NullnessAnalysis nullness;
+
+        // used to only emit the code and data reachable from Main.main.
+        Reachability reachability;
+
+        // finds the `new` objects built in the frame of their method.
+        EscapeAnalysis escape;
+
+        // set while the body of an inlined method is generated.
+        bool inlining{false};
+
         // contains mapping of [class_name][method_name] -> offset in 
         // dispatch table used to implement dispatch.
         std::map<std::string, std::map<std::string, int>> method_table;       
@@ -68,6 +204,13 @@ class Cgen: public StmtVisitor, public ExprVisitor {
         // that are in scope
         std::map<std::string, std::map<std::string, int>> attr_table;       
 
+        // words of the attributes in the prototype objects, the attributes
+        // whose constant initializer is stored there and the classes whose
+        // _init is left with nothing to do.
+        std::unordered_map<std::string, std::vector<std::string>> proto_attrs;
+        std::unordered_set<Feature*> baked_attrs;
+        std::unordered_set<std::string> noop_inits;
+
         // Used to keep track of current attributes counts for a specific
         // class when generating code for class_init methods.
         std::size_t curr_attr_count;
@@ -78,6 +221,11 @@ class Cgen: public StmtVisitor, public ExprVisitor {
         // Used to generate labels for whiles
         std::size_t while_count;
 
+        // counted loops unrolled, up to a body size of UNROLL_MAX_SIZE nodes,
+        // also the size of the largest condition duplicated at a loop entry.
+        std::size_t unrolled_count{0};
+        static constexpr std::size_t UNROLL_MAX_SIZE = 12;
+
         // Used to track frame pointer offset for local variables in functions.
         std::size_t fp_offset;
 
@@ -93,16 +241,111 @@ class Cgen: public StmtVisitor, public ExprVisitor {
         // Used to track dispatch labels
         std::size_t dispatch_count;
 
+        // Used to generate labels for the slow paths of the allocations.
+        std::size_t alloc_count{0};
+
+        // dispatches in tail position of the current method, the number of
+        // words it pushes for its frame and the label its self-recursive tail
+        // calls jump to.
+        std::unordered_set<Expr*> tail_calls;
+        std::size_t curr_frame_size{0};
+        std::string tail_loop_label;
+        std::size_t tail_call_count{0};
+        std::size_t self_tail_call_count{0};
+
+        // what the prologue of the current method saved, and of every method.
+        FrameSummary curr_frame{};
+        std::vector<FrameSummary> frames;
+
         std::unordered_map<std::string, int> classtag_map{};
 
+        // [lowest, highest] tags of the subtree rooted at a class.
+        std::unordered_map<std::string, std::pair<int, int>> class_tag_ranges{};
+
+        // a case with at least this many tag intervals is dispatched through
+        // a jump table rather than a binary search.
+        static constexpr std::size_t CASE_JUMP_TABLE_MIN_INTERVALS = 16;
+
+        // the jump tables are data, they are emitted once all the code is.
+        std::ostringstream case_tables;
+
+        Target target{Target::MIPS};
+        GCOptions gc;
+
+        // IR of the user classes when the code is generated from it.
+        bool ir_mode{false};
+        std::vector<std::string> ir_pass_names;
+        std::ostream* ir_dump{nullptr};
+        IRModule ir_module;
+        std::size_t ir_built_instructions{0};
+        std::vector<std::pair<std::string, std::size_t>> ir_changes;
+
+        // state of the IR function emitted: the AR slot of the values kept
+        // in the frame, the label of the blocks, the compares emitted with
+        // the branch using them and the value held by ACC.
+        std::unordered_map<IRInstr*, std::size_t> ir_slots;
+        std::unordered_map<IRBlock*, std::string> ir_labels;
+        std::unordered_set<IRInstr*> ir_fused;
+        // x86-64: calls whose result is only returned, emitted as jumps.
+        std::unordered_set<IRInstr*> ir_tail_calls;
+        // x86-64: the range of every function and the number of its slots
+        // holding objects, for the collector of the runtime.
+        struct X86Frame {
+            std::string start;
+            std::string end;
+            std::size_t roots;
+        };
+        std::vector<X86Frame> x86_frame_table;
+        // bytecode: the program, the index of every function by label, the
+        // registers of the values of the current function and what the
+        // superinstructions do instead of the IR instructions.
+        BCProgram bc_program;
+        std::unordered_map<std::string, int> bc_functions;
+        std::map<int, int> bc_ints;
+        std::unordered_map<std::string, int> bc_strings;
+        int bc_bools[2]{-1, -1};
+        std::unordered_map<IRInstr*, uint32_t> bc_regs;
+        std::size_t bc_objects{0};
+        std::size_t bc_raws{0};
+        std::unordered_set<IRInstr*> bc_skipped;
+        // start of the code of the blocks, and the branch targets to patch:
+        // word of the code, block.
+        std::unordered_map<IRBlock*, std::size_t> bc_blocks;
+        std::vector<std::pair<std::size_t, IRBlock*>> bc_patches;
+        std::size_t bc_superinstructions{0};
+        // C: every definition of the file by name, with the definitions it
+        // uses, in the order they are emitted, the C name of the functions
+        // by label and the names taken.
+        struct CDefinition {
+            std::string declaration;    // the prototype of a function.
+            std::string code;
+            std::vector<std::string> uses;
+        };
+        std::map<std::string, CDefinition> c_definitions;
+        std::vector<std::string> c_order;
+        std::unordered_map<std::string, std::string> c_names;
+        std::unordered_set<std::string> c_taken;
+        CDefinition* c_current{nullptr};
+        IRInstr* ir_acc{nullptr};
+        std::size_t ir_frame_size{0};
+        std::size_t ir_stack_params{0};
+        std::size_t ir_label_count{0};
+
         // The variable environment that maps variable names to offsets
         // in the current AR relative to the fp. this allows for easier
         // addressing. eg. the first parameter is in 4($fp), next is 8($fp)... n($fp)
-        SymbolTable<std::string, int> var_env;
+        // Locals given a register by the allocator keep their slot but aren't stored in it.
+        SymbolTable<std::string, VarLocation> var_env;
 
         // The localSizer is a pass that compute the size of locals in every function
         LocalSizer localsizer{};
 
+        // Assigns the callee-saved registers to the hottest locals of each method.
+        RegAllocator regalloc{};
+
+        // Used to pattern-match the shape of conditions (see cgen_branch).
+        typeIdentifier typeId{};
+
         /*
             Class tags for some basic classes
             Note that there are no pre-defined class tags for class Object
@@ -149,6 +392,7 @@ class Cgen: public StmtVisitor, public ExprVisitor {
         void emit_div(const char*, const char*, const char*);
         void emit_divu(const char*, const char*, const char*);
         void emit_mul(const char*, const char*, const char*);
+        void emit_sll(const char*, const char*, int);
         void emit_sub(const char*, const char*, const char*);
 
         // logical instructions
@@ -178,8 +422,12 @@ class Cgen: public StmtVisitor, public ExprVisitor {
 
         // branch and jump instructions
         void emit_b(const std::string&);
+        void emit_bgt(const char*, const char*, const std::string&);
         void emit_bgt(const char*, int, const std::string&);
+        void emit_blt(const char*, const char*, const std::string&);
         void emit_blt(const char*, int, const std::string&);
+        void emit_ble(const char*, const char*, const std::string&);
+        void emit_ble(const char*, int, const std::string&);
         void emit_beq(const char*, const char*, const std::string&);
         void emit_beq(const char*, int, const std::string&);
         void emit_bge(const char*, const char*, const std::string&);
@@ -230,16 +478,29 @@ class Cgen: public StmtVisitor, public ExprVisitor {
         // emit code for the prototype objects attributes
         void emit_obj_attributes(Class* );
 
+        // word of a prototype holding the default value of `type` or the
+        // constant `expr`.
+        std::string default_word(const Token& type);
+        std::string literal_word(Literal* expr);
+
         // debugging purposes
         void emit_comment(const std::string& );
 
-        // emit code for Garbage collector functions choice.
+        // emit the choice of the garbage collector and its settings.
         void code_select_gc();
+        // a collector of trap.handler.s runs: it scans every word of the
+        // stack, and needs the write barrier after the attribute stores.
+        bool mips_gc() const { return target == Target::MIPS && gc.collector != Collector::NoGC; }
+        void cgen_attribute_barrier(int offset);
 
         // emit code to start the .text segment and to 
         // declare the global names.
         void code_global_text();
 
+        // emit the case jump tables and the start of the heap which ends the
+        // static data.
+        void code_heap_start();
+
         // emit code to declare global names.
         void code_global_data();
 
@@ -247,10 +508,201 @@ class Cgen: public StmtVisitor, public ExprVisitor {
 
         void cgen_method(Feature* );
 
+        // build the IR of the reachable methods and the _init of the
+        // instantiated user classes, and run the passes on it.
+        void build_ir(Program* program);
+
+        // emit the code of an IR function (see irlower.cpp).
+        void cgen_ir_function(IRFunction& function);
+        void cgen_ir_instr(IRInstr* instr, IRBlock* next);
+        void cgen_ir_call(IRInstr* instr);
+        void cgen_ir_branch(IRInstr* instr, IRBlock* next);
+        void cgen_ir_phi_moves(IRBlock* from, IRBlock* to);
+        void cgen_ir_check(IRInstr* instr);
+
+        // whether the value of `instr` is emitted where it is used rather
+        // than kept in the frame.
+        bool ir_rematerialized(IRInstr* instr);
+
+        // whether the call `instr` is followed by the return of its result.
+        bool ir_is_tail_call(IRInstr* instr);
+
+        // whether the value of the instruction `index` of `block` can stay in
+        // ACC from where it is computed to its last use.
+        bool ir_in_acc(IRBlock* block, std::size_t index, const std::unordered_map<IRInstr*, std::vector<IRInstr*>>& users);
+
+        // load `value` into `dest`, or into the register returned, `scratch`
+        // if it isn't already in a register.
+        void ir_load(IRInstr* value, const char* dest);
+        const char* ir_reg(IRInstr* value, const char* scratch);
+
+        // `value` was computed into ACC, keep it in its slot if it has one.
+        void ir_store(IRInstr* value);
+
+        // directives and size of the words of the data for the target.
+        const char* word_directive();
+        const char* align_directive();
+        int word_bytes();
+
+        // emit the x86-64 code of the classes, after the data, from the IR
+        // (see x86lower.cpp).
+        void x86_code_text(Program* program);
+        void x86_class(Class* class_);
+        void x86_function(IRFunction& function);
+        bool x86_is_tail_call(IRInstr* instr);
+        void x86_instr(IRInstr* instr, IRBlock* next);
+        void x86_call(IRInstr* instr);
+        void x86_branch(IRInstr* instr, IRBlock* next);
+        void x86_phi_moves(IRBlock* from, IRBlock* to);
+        void x86_type_case(IRInstr* instr);
+
+        // load `value` in the 64 bits register `reg`, store rax in the slot
+        // of `value`.
+        void x86_load(IRInstr* value, const char* reg);
+        void x86_store(IRInstr* value);
+
+        // compile the IR to bytecode, with the classes and constants the
+        // interpreter builds its objects from (see bclower.cpp).
+        void bc_compile();
+        void bc_function(IRFunction& function, BCFunction& out);
+        void bc_instr(IRInstr* instr, IRBlock* next, BCFunction& out);
+        void bc_call(IRInstr* instr, BCFunction& out);
+        void bc_branch(IRInstr* instr, BCFunction& out);
+        void bc_phi_moves(IRBlock* from, IRBlock* to, BCFunction& out);
+
+        // index of the constant of an Int, a Bool or a String in the pool,
+        // or of the word of a prototype (-1 for void).
+        int bc_int(int value);
+        int bc_bool(bool value);
+        int bc_string(const std::string& text);
+        int bc_word(const std::string& word);
+
+        // register of an IR value, allocated on first use.
+        uint32_t bc_reg(IRInstr* value);
+
+        // emit the program as a C translation unit, built with the native
+        // runtime (see clower.cpp).
+        void c_code_text();
+        void c_data();
+        void c_function(IRFunction& function);
+        void c_instr(IRInstr* instr, IRBlock* next);
+        void c_call(IRInstr* instr);
+        void c_branch(IRInstr* instr, IRBlock* next);
+        void c_type_case(IRInstr* instr);
+        void c_phi_moves(IRBlock* from, IRBlock* to);
+
+        // the definition being generated uses `name`, returned.
+        const std::string& c_use(const std::string& name);
+        // the C expression of an IR value, of a word of the data.
+        std::string c_value(IRInstr* value);
+        std::string c_word(const std::string& word);
+        // the C function of the code at `label`.
+        std::string c_function_name(const std::string& label);
+
+        // emit the _init method of a class.
+        void cgen_class_init(Class* );
+
         void cgen_attribut(Feature* );
 
         void cgen_init_formal(Token& );
 
+        // number of words of the AR of the method `method_name` after its
+        // formals: its locals then the formals of the methods inlined in it.
+        std::size_t frame_locals(Feature* method);
+
+        // emit the dispatch of a case on the tag in T2 to the label of the
+        // branch of the interval it falls in.
+        void cgen_case_search(std::vector<CaseInterval>& intervals, std::size_t first, std::size_t last,
+                std::vector<std::string>& branch_labels, std::string& abort_label);
+        void cgen_case_jump_table(std::vector<CaseInterval>& intervals,
+                std::vector<std::string>& branch_labels, std::string& abort_label);
+
+        // the tags an object of static type `static_type` can have, by
+        // intervals going to the same branch among those matching the
+        // classes `branch_types`.
+        std::vector<CaseInterval> case_intervals(const std::string& static_type, const std::vector<std::string>& branch_types);
+
+        // emit the dispatch-on-void check of the receiver in ACC for the
+        // dispatch `expr` unless it is proven non-void.
+        void cgen_dispatch_check(Expr* expr);
+
+        // collect the dispatches in tail position of `expr`.
+        void collect_tail_calls(Expr* expr);
+
+        // emit the dispatch `expr` in tail position. The frame of the current
+        // method is popped and the callee returns directly to its caller.
+        // Returns false if the dispatch must be a regular call.
+        bool cgen_tail_dispatch(Expr* expr, Expr* receiver, std::vector<std::unique_ptr<Expr>>& args,
+                Token& callee_name, const std::string& target);
+
+        // find out what the code generated for `expr` needs from the frame of the
+        // current method. `locals` are the variables in scope and whether they
+        // are held in a register. The body of an inlined method has its own
+        // self and its formals in the frame. Conditions mirror cgen_branch.
+        // Calls to the aborts of the runtime don't return and aren't counted.
+        void scan_frame(Expr* expr, FrameSummary& frame, std::vector<std::pair<std::string, bool>>& locals, bool inlined);
+        void scan_frame_branch(Expr* cond, FrameSummary& frame, std::vector<std::pair<std::string, bool>>& locals, bool inlined);
+        void scan_frame_variable(const std::string& name, FrameSummary& frame, std::vector<std::pair<std::string, bool>>& locals, bool inlined);
+        void scan_frame_bind(Formal* formal, FrameSummary& frame, std::vector<std::pair<std::string, bool>>& locals, bool inlined);
+
+        // Int (or Bool) comparison that cgen_compare_branch turns into a branch.
+        bool is_compare_branch(Binary* cond);
+
+        // evaluate the arguments then the receiver (in ACC) of the call `expr`
+        // and check the receiver. The ARG_REGS first arguments are loaded in
+        // A1-A3 last, literals and variables directly from where they are when
+        // nothing evaluated after them could change them. The other arguments
+        // are left on the stack, the first of them on top. Returns their number.
+        std::size_t cgen_call_args(Expr* expr, Expr* receiver, std::vector<std::unique_ptr<Expr>>& args);
+
+        // allocate an object of `class_name` in the heap into ACC by bumping the
+        // allocation pointer, its attributes set as in the prototype or copied from
+        // the object in ACC if `copy_acc`. Object.copy (of the prototype or of ACC) is
+        // only called when the work area is full.
+        void cgen_alloc(const std::string& class_name, bool copy_acc);
+
+        // emit the literal or variable `expr` to `dest`.
+        void cgen_literal(Literal* expr, const char* dest);
+        void cgen_variable(Variable* expr, const char* dest);
+        void cgen_simple_operand(Expr* expr, const char* dest);
+
+        // emit the body of `site` in place of the call `site_expr` with `receiver` and `args`.
+        void cgen_inline(Expr* site_expr, Expr* receiver, std::vector<std::unique_ptr<Expr>>& args, const Inliner::InlineSite* site);
+
+        // bind the local declared by `formal` to the value in ACC, in its register
+        // if it got one or else in the AR slot `offset`.
+        void cgen_bind_local(Formal* formal, std::size_t offset);
+
+        // emit code that jumps to `label` when the condition `cond` evaluates
+        // to `jump_if` and falls through otherwise. `not`, literals, nested ifs
+        // and comparisons on Int (or Bool) operands are turned into direct
+        // branches on the unboxed values so no Bool object is materialized.
+        void cgen_branch(Expr* cond, bool jump_if, const std::string& label);
+        bool cgen_compare_branch(Binary* cond, bool jump_if, const std::string& label);
+
+        // emit the branch for `lhs op rhs` (op being <, <= or =) taken when
+        // the comparison equals `jump_if`.
+        void emit_compare_branch(TokenType op, bool jump_if, const char* lhs, const char* rhs, const std::string& label);
+        void emit_compare_branch(TokenType op, bool jump_if, const char* lhs, int rhs, const std::string& label);
+
+        // load the raw value of the Int (or Bool) `expr` in `dest`, straight from
+        // the object if it is held in a register.
+        void cgen_unboxed(Expr* expr, const char* dest);
+
+        // the register holding `expr` if it is a register allocated local.
+        const char* local_register(Expr* expr);
+
+        // an operand whose evaluation only touches ACC (variables and literals).
+        bool is_simple_operand(Expr* expr);
+
+        // value of an Int or Bool literal (through parentheses).
+        bool literal_value(Expr* expr, int& value);
+
+        // whether `expr` counts the Int local `counter` up by `step` > 0 to an
+        // Int literal (`counter < bound` or `counter <= bound`), its small body
+        // only changing the counter with a final `counter <- counter + step`.
+        bool counted_loop(While* expr, Variable*& counter, int& step);
+
         // this method will attribute to each class a tag 
         // which will be used to compare classes (case construct)
         // and also do some indexing (classNameTab)
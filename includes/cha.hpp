@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ast.hpp"
+#include "environment.hpp"
+#include "utilities.hpp"
+#include <map>
+#include <string>
+
+namespace cool {
+
+// Class hierarchy analysis.
+// Since the whole program is known at compile time, the set of methods a
+// dispatch can reach is the set of implementations of the method in the
+// subtree of the receiver's static type. When that set has a single element
+// the dispatch doesn't need to go through the dispatch table.
+
+class ClassHierarchy {
+    public:
+        ClassHierarchy(InheritanceGraph* g_, SymbolTable<std::string, Class*>* ctable_ptr):
+            g(g_), class_table_ptr(ctable_ptr) {}
+
+        // the class whose definition of `method` objects of class `class_name` use.
+        const std::string& implementation(const std::string& class_name, const std::string& method);
+
+        // the class defining the only implementation of `method` reachable from
+        // a receiver of static type `class_name` or an empty string if there are several.
+        const std::string& unique_implementation(const std::string& class_name, const std::string& method);
+
+        // the highest ancestor of `class_name` defining `method`: the definitions
+        // seen from its subclasses all override this one.
+        std::string introducing_class(const std::string& class_name, const std::string& method);
+
+        // definition of `method` as seen from the class `class_name`.
+        Feature* get_method(const std::string& class_name, const std::string& method);
+
+        // declared type of the attribute `attr` as seen from the class `class_name`.
+        std::string attribute_type(const std::string& class_name, const std::string& attr);
+
+    private:
+        InheritanceGraph* g;
+        SymbolTable<std::string, Class*>* class_table_ptr;
+
+        // caches [class_name][method_name] -> class.
+        std::map<std::string, std::map<std::string, std::string>> implementations;
+        std::map<std::string, std::map<std::string, std::string>> unique_implementations;
+};
+
+}
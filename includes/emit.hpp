@@ -13,12 +13,6 @@
 //
 ///////////////////////////////////////////////////////////////////////
 
-// Garbage collector management.
-#define cgen_Memmgr 0
-#define cgen_Memmgr_Test 0
-#define GC_TEST 1
-#define CGEN_DEBUG 1
-
 #define MAXINT  100000000    
 #define WORD_SIZE    4
 #define LOG_WORD_SIZE 2     // for logical shifts
@@ -59,6 +53,7 @@
 //
 #define DEFAULT_OBJFIELDS 3
 #define AR_BASE_SIZE 3
+#define ARG_REGS 3      // arguments passed in A1-A3, the others on the stack.
 #define TAG_OFFSET 0
 #define SIZE_OFFSET 1
 #define DISPTABLE_OFFSET 2
@@ -75,15 +70,40 @@
 #define SPACE        "\t.space\t"
 #define BYTE        "\t.byte\t"
 
+//
+// x86-64 (--target=x86_64): the objects have the same layout with 8 bytes
+// words. Methods follow the System V calling convention, self being the
+// first argument.
+//
+#define X86_WORD_SIZE 8
+#define X86_ARG_REGS  6     // self and the arguments in rdi, rsi, rdx, rcx, r8, r9.
+#define QUAD          "\t.quad\t"
+#define X86_ALIGN     "\t.balign\t8\n"
+
+// the bits of the collector follow the tag (see lib/runtime/runtime.hpp),
+// the write barrier is needed when GC_BARRIER is set.
+#define X86_GC_BITS      4
+#define X86_GC_BARRIER   2
+#define X86_FRAME_TABLE  "_cool_frame_table"
+#define X86_GC_CONFIG    "_cool_gc_config"
+
 //
 // register names
 //
 #define ZERO "zero"		// Zero register 
 #define ACC  "a0"		// Accumulator 
-#define A1   "a1"		// For arguments to prim funcs 
+#define A1   "a1"		// Arguments of the calls and prim funcs 
+#define A2   "a2"
+#define A3   "a3"
 #define SELF "s0"		// Ptr to self (callee saves) 
-#define S1   "s1"
+#define S1   "s1"		// $s1-$s6 hold register allocated locals (callee saves)
 #define S2   "s2"
+#define S3   "s3"
+#define S4   "s4"
+#define S5   "s5"
+#define S6   "s6"
+#define S7   "s7"		// Limit of the heap work area (runtime)
+#define GP   "gp"		// Heap allocation pointer (runtime)
 #define T1   "t1"		// Temporary 1 
 #define T2   "t2"		// Temporary 2 
 #define T3   "t3"		// Temporary 3 
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "ast.hpp"
+#include "type.hpp"
+#include "cha.hpp"
+#include "resolver.hpp"
+#include "environment.hpp"
+#include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <vector>
+#include <string>
+
+namespace cool {
+
+// Escape analysis finding the `new` objects that don't outlive the method
+// allocating them, so the code generator can build them in its frame instead
+// of copying the prototype into the heap.
+// Each method is walked tracking which of self, its formals and its `new`
+// sites the values may be; a let or case variable holds everything it is
+// ever bound or assigned to. A value escapes when it is assigned to an
+// attribute, returned, or passed (as receiver or argument) to a call the
+// value may escape from. Dispatches resolved to a single method use its
+// summary: whether self and each formal escape it, computed for all the
+// methods together until nothing changes. Unresolved dispatches and tail
+// calls (the frame is gone when the callee runs) let everything escape.
+// A `new` inside a loop is kept only when no variable declared outside the
+// loop can hold it since its slot is reused by the next iteration, and the
+// attribute initializers of the class must not let self escape either.
+// The frame allocated objects are not in the heap so the garbage collectors
+// skip pointers to them while their attributes, being on the stack, are
+// scanned as roots.
+
+class EscapeAnalysis: public StmtVisitor, public ExprVisitor {
+    public:
+        EscapeAnalysis(ClassHierarchy& cha_, DispatchResolver& resolver_, SymbolTable<std::string, Class*>* ctable_ptr):
+            cha(cha_), resolver(resolver_), class_table_ptr(ctable_ptr) {}
+
+        void run(Program* program);
+
+        // whether the object of `expr` is built in the frame of its method.
+        bool is_stack_allocated(New* expr) { return stack_offsets.count(expr); }
+
+        // offset in words of the object of `expr` in the area of the frame
+        // holding the objects of its method.
+        std::size_t get_stack_offset(New* expr) { return stack_offsets[expr]; }
+
+        // words of the frame of `method` holding objects.
+        std::size_t get_stack_words(Feature* method) {
+            auto words = stack_words.find(method);
+            return words != stack_words.end() ? words->second : 0;
+        }
+
+        // number of `new` sites and how many are allocated in the frame.
+        std::size_t get_site_count() { return sites.size(); }
+        std::size_t get_stack_site_count() { return stack_offsets.size(); }
+
+        void visitFeatureExpr(Feature* expr);
+        void visitFormalExpr(Formal* expr);
+        void visitAssignExpr(Assign* expr);
+        void visitIfExpr(If* expr);
+        void visitWhileExpr(While* expr);
+        void visitBinaryExpr(Binary* expr);
+        void visitUnaryExpr(Unary* expr);
+        void visitVariableExpr(Variable* expr);
+        void visitNewExpr(New* expr);
+        void visitBlockExpr(Block* expr);
+        void visitGroupingExpr(Grouping* expr);
+        void visitStaticDispatchExpr(StaticDispatch* expr);
+        void visitDispatchExpr(Dispatch* expr);
+        void visitLiteralExpr(Literal* expr);
+        void visitLetExpr(Let* expr);
+        void visitCaseExpr(Case* expr);
+        void visitProgramStmt(Program* stmt);
+        void visitClassStmt(Class* stmt);
+
+    private:
+        // values are self, the formals (SELF_SOURCE - 1 - i) and the
+        // indices of the `new` sites.
+        static constexpr int SELF_SOURCE = -1;
+
+        struct Site {
+            New* expr;
+            Feature* method;        // nullptr in an attribute initializer.
+            int loop_depth;
+            bool escapes;
+        };
+
+        void analyze(Class* class_);
+        void eval(Expr* expr, bool tail);
+        void declare(Formal* formal, const std::set<int>& sources);
+        void escape(const std::set<int>& sources);
+        void call(Expr* receiver, std::vector<std::unique_ptr<Expr>>& args, const std::string& target,
+                  const std::string& callee_name, bool tail);
+        bool keeps_object(const std::string& class_name);
+        std::size_t object_size(const std::string& class_name);
+
+        ClassHierarchy& cha;
+        DispatchResolver& resolver;
+        SymbolTable<std::string, Class*>* class_table_ptr;
+
+        // summaries: the methods self escapes from, the formals escaping
+        // and the classes whose attribute initializers let self escape.
+        std::unordered_set<Feature*> escaping_self;
+        std::unordered_map<Feature*, std::vector<bool>> escaping_formals;
+        std::unordered_set<std::string> escaping_init;
+        bool summaries_changed{false};
+
+        std::vector<Site> sites;
+        std::unordered_map<New*, int> site_index;
+
+        // state of the method walked.
+        Class* curr_class{nullptr};
+        Feature* curr_method{nullptr};
+        SymbolTable<std::string, Formal*> scope;
+        std::unordered_map<Formal*, std::set<int>> var_sources;
+        std::unordered_map<Formal*, int> var_depth;
+        bool vars_changed{false};
+        int loop_depth{0};
+        bool in_tail{false};
+
+        // values the expression visited may be.
+        std::set<int> value;
+
+        std::unordered_map<New*, std::size_t> stack_offsets;
+        std::unordered_map<Feature*, std::size_t> stack_words;
+};
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ast.hpp"
+#include "type.hpp"
+#include "environment.hpp"
+#include "object.hpp"
+#include <memory>
+#include <string>
+
+namespace cool {
+
+// Constant folding and propagation, run between the semantic analysis and the
+// code generation.
+// Int arithmetic and comparisons, `not`, `~`, `isvoid` and `=` on literals are
+// computed at compile time with the 32 bits wraparound of the generated code.
+// A division by zero is left to fail at runtime. The length of a string
+// literal is folded as well. An `if` on a constant only keeps the branch
+// taken and the body of a `while false` is dropped.
+// Let variables of type Int, Bool or String bound to a literal (or left to
+// their default value) and never assigned are replaced by that literal and
+// their binding removed.
+// Once done, the int table is rebuilt from the literals left in the program.
+
+class ConstantFolder: public StmtVisitor, public ExprVisitor {
+    public:
+        ConstantFolder() = default;
+
+        void fold(Program* program);
+
+        // number of expressions computed at compile time and of uses of let
+        // variables replaced by their value.
+        std::size_t get_folded_count() { return folded_count; }
+        std::size_t get_propagated_count() { return propagated_count; }
+
+        void visitFeatureExpr(Feature* expr);
+        void visitFormalExpr(Formal* expr);
+        void visitAssignExpr(Assign* expr);
+        void visitIfExpr(If* expr);
+        void visitWhileExpr(While* expr);
+        void visitBinaryExpr(Binary* expr);
+        void visitUnaryExpr(Unary* expr);
+        void visitVariableExpr(Variable* expr);
+        void visitNewExpr(New* expr);
+        void visitBlockExpr(Block* expr);
+        void visitGroupingExpr(Grouping* expr);
+        void visitStaticDispatchExpr(StaticDispatch* expr);
+        void visitDispatchExpr(Dispatch* expr);
+        void visitLiteralExpr(Literal* expr);
+        void visitLetExpr(Let* expr);
+        void visitCaseExpr(Case* expr);
+        void visitProgramStmt(Program* stmt);
+        void visitClassStmt(Class* stmt);
+
+    private:
+        // fold `expr` and replace it by its folded form if any.
+        void fold(std::unique_ptr<Expr>& expr);
+
+        // value of `expr` if it is a literal, nullptr otherwise.
+        const CoolObject* constant(Expr* expr);
+
+        std::unique_ptr<Expr> make_literal(CoolObject&& object);
+
+        // rebuild the int table with the ints still needed.
+        void shrink_inttable(Program* program);
+
+        typeIdentifier typeId{};
+
+        // set by a visit when the expression visited is to be replaced.
+        std::unique_ptr<Expr> folded;
+
+        // values of the let variables in scope, Void_t when not a constant.
+        SymbolTable<std::string, CoolObject> constants;
+
+        std::size_t folded_count{0};
+        std::size_t propagated_count{0};
+};
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "ast.hpp"
+#include "type.hpp"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace cool {
+
+// Loop invariant code motion, run after the constant folding.
+// The Int arithmetic (+, -, *, ~) of a `while` whose operands, literals,
+// locals and attributes, can't change while it runs is evaluated once, before
+// the loop, into let variables the loop uses instead. Divisions are left in
+// place since they could fail on a loop never entered.
+// An attribute can change when the loop assigns a variable of that name or
+// runs a method (of any class) with that name that may assign it, directly
+// or through the methods it calls and the initializers of the objects it
+// creates. A local can only change when the loop assigns it.
+// Loops are handled from the outermost in so an expression goes out of every
+// loop it is invariant in.
+
+class LoopHoister: public StmtVisitor, public ExprVisitor {
+    public:
+        LoopHoister() = default;
+
+        void run(Program* program);
+
+        // number of expressions moved out of loops and of loops they come from.
+        std::size_t get_hoisted_count() { return hoisted_count; }
+        std::size_t get_loop_count() { return loop_count; }
+
+        void visitFeatureExpr(Feature* expr);
+        void visitFormalExpr(Formal* expr);
+        void visitAssignExpr(Assign* expr);
+        void visitIfExpr(If* expr);
+        void visitWhileExpr(While* expr);
+        void visitBinaryExpr(Binary* expr);
+        void visitUnaryExpr(Unary* expr);
+        void visitVariableExpr(Variable* expr);
+        void visitNewExpr(New* expr);
+        void visitBlockExpr(Block* expr);
+        void visitGroupingExpr(Grouping* expr);
+        void visitStaticDispatchExpr(StaticDispatch* expr);
+        void visitDispatchExpr(Dispatch* expr);
+        void visitLiteralExpr(Literal* expr);
+        void visitLetExpr(Let* expr);
+        void visitCaseExpr(Case* expr);
+        void visitProgramStmt(Program* stmt);
+        void visitClassStmt(Class* stmt);
+
+        // what code may do: the names it assigns, the methods it calls and
+        // the classes it creates objects of.
+        struct Effects {
+            std::set<std::string> assigned;
+            std::set<std::string> called;
+            std::set<std::string> created;
+        };
+
+    private:
+        // walk `expr` and wrap it in the let binding its invariants if it
+        // is a loop.
+        void walk(std::unique_ptr<Expr>& expr);
+
+        // names of the attributes code with effects `effects` may assign.
+        std::set<std::string> killed_attributes(const Effects& effects);
+
+        // whether `expr` is invariant in the loop, its largest invariant
+        // parts being hoisted otherwise.
+        bool invariant(std::unique_ptr<Expr>& expr);
+        void hoist(std::unique_ptr<Expr>& expr);
+
+        typeIdentifier typeId{};
+
+        // effects of the methods by name and of the attribute initializers by
+        // class, and the superclass of every class.
+        std::map<std::string, Effects> method_effects;
+        std::map<std::string, Effects> init_effects;
+        std::map<std::string, std::string> parents;
+
+        // locals in scope of the code walked.
+        std::vector<std::string> scope;
+
+        // state of the loop whose invariants are hoisted: what it can change,
+        // the locals declared inside and the let variables holding the
+        // hoisted expressions.
+        std::set<std::string> loop_assigned;
+        std::set<std::string> loop_killed;
+        std::vector<std::string> inner_scope;
+        letAssigns hoisted;
+
+        // set by the visit of a loop to the let variables to wrap it in.
+        letAssigns wrapping;
+
+        std::size_t temp_count{0};
+        std::size_t hoisted_count{0};
+        std::size_t loop_count{0};
+};
+
+}
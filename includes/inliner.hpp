@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ast.hpp"
+#include "cha.hpp"
+#include "resolver.hpp"
+#include <unordered_map>
+#include <ostream>
+#include <string>
+
+namespace cool {
+
+// This pass decides which resolved call sites of the methods get the body of
+// their target expanded in place instead of a call.
+// Only small bodies (counted in AST nodes, up to the budget) without locals
+// nor loops are inlined and only one level deep: the call sites inside an
+// inlined body stay calls. The formals of an inlined method are kept in extra
+// slots at the end of the caller's AR, shared by all its inlined call sites.
+
+class Inliner: public StmtVisitor, public ExprVisitor {
+    public:
+        struct InlineSite {
+            Feature* method;    // the inlined method.
+            Class* class_;      // the class defining it.
+        };
+
+        Inliner(ClassHierarchy& cha_, DispatchResolver& resolver_, SymbolTable<std::string, Class*>* ctable_ptr):
+            cha(cha_), resolver(resolver_), class_table_ptr(ctable_ptr) {}
+
+        // maximum size of an inlined body, 0 disables inlining.
+        void set_budget(std::size_t budget_) { budget = budget_; }
+
+        // where to write the decision taken for every resolved call site.
+        void set_log(std::ostream* log_) { log = log_; }
+
+        void run(Program* program) {
+            program->accept(this);
+        }
+
+        // the method to inline at the call site `expr`, nullptr if it is a call.
+        const InlineSite* get_site(Expr* expr) {
+            auto site = sites.find(expr);
+            return site != sites.end() ? &site->second : nullptr;
+        }
+
+        // number of slots the AR of `method` reserves for the formals of the
+        // methods inlined in it.
+        std::size_t get_inline_slots(Feature* method) {
+            auto slots = inline_slots.find(method);
+            return slots != inline_slots.end() ? slots->second : 0;
+        }
+
+        std::size_t get_inlined_count() { return sites.size(); }
+
+        void visitFeatureExpr(Feature* expr);
+        void visitFormalExpr(Formal* expr);
+        void visitAssignExpr(Assign* expr);
+        void visitIfExpr(If* expr);
+        void visitWhileExpr(While* expr);
+        void visitBinaryExpr(Binary* expr);
+        void visitUnaryExpr(Unary* expr);
+        void visitVariableExpr(Variable* expr);
+        void visitNewExpr(New* expr);
+        void visitBlockExpr(Block* expr);
+        void visitGroupingExpr(Grouping* expr);
+        void visitStaticDispatchExpr(StaticDispatch* expr);
+        void visitDispatchExpr(Dispatch* expr);
+        void visitLiteralExpr(Literal* expr);
+        void visitLetExpr(Let* expr);
+        void visitCaseExpr(Case* expr);
+        void visitProgramStmt(Program* stmt);
+        void visitClassStmt(Class* stmt);
+
+    private:
+        // take the inlining decision for the call site `expr` of `callee_name`.
+        void decide(Expr* expr, Token& callee_name);
+
+        ClassHierarchy& cha;
+        DispatchResolver& resolver;
+        SymbolTable<std::string, Class*>* class_table_ptr;
+
+        std::size_t budget{10};
+        std::ostream* log{nullptr};
+
+        Class* curr_class{nullptr};
+        Feature* curr_method{nullptr};
+
+        std::unordered_map<Expr*, InlineSite> sites;
+        std::unordered_map<Feature*, std::size_t> inline_slots;
+};
+
+}
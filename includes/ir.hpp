@@ -0,0 +1,153 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cool {
+
+// Mid-level IR the code can be generated from instead of the AST.
+// A function is a control flow graph of basic blocks in SSA form: every
+// instruction defines at most one value, which later instructions and the
+// phis at the start of the successor blocks use. Values are objects (pointers,
+// possibly void) or the raw Int and Bool values objects box, Box and Unbox
+// going from one to the other. Allocations, dispatches and void checks are
+// instructions of their own so the passes (see irpasses.hpp) can move and
+// remove them. The layout of the objects and the calling convention are left
+// to the code generator: attributes and methods are referred to by name.
+
+enum class IRType { None, Obj, Int, Bool };
+
+enum class IROp {
+    Param,          // formal `value` of the function, 0 being self.
+    Const,          // raw Int or Bool `value`.
+    String,         // the String constant `name`.
+    Void,           // the void object.
+
+    Add, Sub, Mul, Div, Neg,    // Int arithmetic.
+    Lt, Le, Eq, Not,            // comparisons of raw values and Bool negation.
+
+    Box,            // object of class Int or Bool holding a raw value.
+    Unbox,          // raw value held by an Int or Bool object.
+    ObjEq,          // `=` on objects: same object, or Int, Bool or String of equal value.
+    IsVoid,
+
+    New,            // object of class `class_name` initialized by its _init.
+    GetAttr,        // attribute `name` of class `class_name` of an object.
+    SetAttr,
+    Dispatch,       // call of `name` through the dispatch table, `class_name` being the
+                    // static type of the receiver (operand 0) the arguments follow.
+    Call,           // call of the method `name` of class `class_name`.
+    CheckDispatch,  // abort when the operand is void, `value` being the source line.
+    CheckCase,
+
+    Phi,            // operand i is the value coming from predecessor i.
+
+    Jump,
+    Branch,         // to targets 0 when the operand is true, to target 1 otherwise.
+    TypeCase,       // to the target of the closest ancestor among `cases` of the
+                    // class of the object, abort if there is none. `class_name`
+                    // is the static type of the object.
+    Return,
+};
+
+struct IRBlock;
+
+struct IRInstr {
+    IROp op;
+    IRType type{IRType::None};
+    std::vector<IRInstr*> operands;
+    int value{0};
+    std::string name;
+    std::string class_name;
+    std::vector<IRBlock*> targets;
+    std::vector<std::string> cases;
+
+    IRBlock* block{nullptr};
+    std::size_t id{0};
+
+    bool is_terminator() const { return op == IROp::Jump || op == IROp::Branch || op == IROp::TypeCase || op == IROp::Return; }
+
+    // whether the instruction does more than compute its value: removing it
+    // changes what the program does even when the value is unused.
+    bool has_side_effects() const;
+};
+
+struct IRBlock {
+    std::size_t id{0};
+    std::vector<std::unique_ptr<IRInstr>> instrs;
+    std::vector<IRBlock*> preds;
+
+    IRInstr* terminator() { return instrs.empty() || !instrs.back()->is_terminator() ? nullptr : instrs.back().get(); }
+    std::vector<IRBlock*> successors();
+
+    // index of the first instruction that isn't a phi.
+    std::size_t first_non_phi();
+};
+
+struct IRFunction {
+    std::string name;           // label of the code: Class.method or Class_init.
+    std::string class_name;
+    std::size_t nparams{1};     // self and the formals.
+    std::vector<std::unique_ptr<IRBlock>> blocks;   // the entry block first.
+
+    IRBlock* new_block();
+
+    // create an instruction at the end of `block`, or before its instruction
+    // `index`.
+    IRInstr* append(IRBlock* block, IROp op, IRType type, std::vector<IRInstr*> operands = {});
+    IRInstr* insert(IRBlock* block, std::size_t index, IROp op, IRType type, std::vector<IRInstr*> operands = {});
+
+    // make the uses of `from` use `to` instead.
+    void replace_uses(IRInstr* from, IRInstr* to);
+
+    // remove the instructions of `remove` which must have no uses left.
+    void erase(const std::vector<IRInstr*>& remove);
+
+    // remove the edge from `pred` to `block`, with the operands of the phis
+    // of `block` coming from `pred`.
+    static void remove_pred(IRBlock* block, IRBlock* pred);
+
+    // number the blocks and values in order.
+    void renumber();
+
+    std::size_t instruction_count();
+
+    std::size_t next_value{0};
+    std::size_t next_block{0};
+};
+
+struct IRModule {
+    std::vector<std::unique_ptr<IRFunction>> functions;
+
+    IRFunction* get(const std::string& name);
+    std::size_t instruction_count();
+};
+
+// immediate dominators of the blocks reachable from the entry.
+struct IRDominators {
+    explicit IRDominators(IRFunction& function);
+
+    bool dominates(IRBlock* a, IRBlock* b);
+
+    std::vector<IRBlock*> rpo;      // reachable blocks in reverse postorder.
+    std::unordered_map<IRBlock*, IRBlock*> idom;
+    std::unordered_map<IRBlock*, std::vector<IRBlock*>> children;
+    std::unordered_map<IRBlock*, std::size_t> order;
+};
+
+const char* ir_type_name(IRType type);
+const char* ir_op_name(IROp op);
+
+void print_ir(std::ostream& os, IRFunction& function);
+void print_ir(std::ostream& os, IRModule& module);
+
+// the problems found in `function`, empty when it is well formed: blocks
+// ending with their only terminator, predecessors matching the edges, phis
+// first and with a value for each predecessor, typed operands and every
+// value defined before it is used on all paths.
+std::vector<std::string> verify_ir(IRFunction& function);
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "ast.hpp"
+#include "ir.hpp"
+#include "resolver.hpp"
+#include "environment.hpp"
+#include <unordered_map>
+#include <unordered_set>
+#include <string>
+#include <vector>
+
+namespace cool {
+
+// Lowers the checked AST of a method, or of the attribute initializers of a
+// class, to an IR function.
+// Every COOL value is an object: the Int and Bool operators unbox their
+// operands and box their result, and conditions unbox the Bool they test, the
+// passes being left to remove the round trips. Dispatches check their receiver
+// first and static dispatches become direct calls.
+// Locals and formals are put in SSA form while the code is built, following
+// Braun et al., "Simple and Efficient Construction of Static Single Assignment
+// Form": the value of a variable is looked up from the block it is read in
+// through its predecessors, the phis of a loop header being completed once the
+// loop body is built. Attributes are read and written in self.
+
+class IRBuilder: public ExprVisitor {
+    public:
+        IRBuilder(DispatchResolver& resolver_): resolver(resolver_) {}
+
+        // function Class.method of the method `method` of `class_`.
+        std::unique_ptr<IRFunction> build_method(Class* class_, Feature* method);
+
+        // function Class_init running the initializers of the attributes of
+        // `chain`, the classes from Object down to the class, except those
+        // in `skipped`, and returning self.
+        std::unique_ptr<IRFunction> build_init(const std::vector<Class*>& chain, const std::unordered_set<Feature*>& skipped);
+
+        void visitFeatureExpr(Feature* expr);
+        void visitFormalExpr(Formal* expr);
+        void visitAssignExpr(Assign* expr);
+        void visitIfExpr(If* expr);
+        void visitWhileExpr(While* expr);
+        void visitBinaryExpr(Binary* expr);
+        void visitUnaryExpr(Unary* expr);
+        void visitVariableExpr(Variable* expr);
+        void visitNewExpr(New* expr);
+        void visitBlockExpr(Block* expr);
+        void visitGroupingExpr(Grouping* expr);
+        void visitStaticDispatchExpr(StaticDispatch* expr);
+        void visitDispatchExpr(Dispatch* expr);
+        void visitLiteralExpr(Literal* expr);
+        void visitLetExpr(Let* expr);
+        void visitCaseExpr(Case* expr);
+
+    private:
+        // start a function of class `class_name`.
+        void begin(const std::string& name, const std::string& class_name, std::size_t nparams);
+
+        // the value of `expr`, built at the end of the current block.
+        IRInstr* build(Expr* expr);
+
+        IRInstr* emit(IROp op, IRType type, std::vector<IRInstr*> operands = {});
+        IRInstr* box(IRInstr* raw);
+        IRInstr* unbox(IRInstr* object, IRType type);
+        IRInstr* raw_const(IRType type, int value);
+
+        // end the current block with a jump or a branch, the targets getting
+        // it as a predecessor.
+        void jump(IRBlock* target);
+        void branch(IRInstr* cond, IRBlock* if_true, IRBlock* if_false);
+
+        // class of self in the code built, SELF_TYPE standing for it.
+        std::string class_of(const Token& type);
+
+        // SSA construction.
+        void write_variable(Formal* var, IRBlock* block, IRInstr* value);
+        IRInstr* read_variable(Formal* var, IRBlock* block);
+        IRInstr* read_variable_recursive(Formal* var, IRBlock* block);
+        IRInstr* new_phi(IRBlock* block);
+        IRInstr* add_phi_operands(Formal* var, IRInstr* phi);
+        IRInstr* try_remove_trivial_phi(IRInstr* phi);
+        void seal(IRBlock* block);
+
+        DispatchResolver& resolver;
+
+        std::unique_ptr<IRFunction> function;
+        IRBlock* block{nullptr};
+        IRInstr* self_value{nullptr};
+        IRInstr* result{nullptr};
+        Class* curr_class{nullptr};
+
+        // the declaration of the locals in scope by name.
+        SymbolTable<std::string, Formal*> scope;
+
+        std::unordered_map<Formal*, std::unordered_map<IRBlock*, IRInstr*>> current_def;
+        std::unordered_set<IRBlock*> sealed;
+        std::unordered_map<IRBlock*, std::vector<std::pair<Formal*, IRInstr*>>> incomplete_phis;
+        std::unordered_map<IRInstr*, Formal*> phi_variables;
+};
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ir.hpp"
+#include "cha.hpp"
+#include <string>
+#include <vector>
+
+namespace cool {
+
+// Optimizations over the IR, each a function run on one function at a time
+// returning whether it changed anything:
+//   fold            constant arithmetic and comparisons, Unbox of a Box,
+//                   isvoid of values known to be objects.
+//   simplify-cfg    branches on constants, unreachable blocks, blocks
+//                   jumping to their only successor or doing nothing else.
+//   dce             values computed for nothing.
+//   devirtualize    dispatches reaching one method (class hierarchy analysis,
+//                   or the exact class of new objects and boxed values)
+//                   become direct calls.
+//   void-checks     checks of values that can't be void: new objects, boxed
+//                   values, string constants, self, values already checked.
+//   unbox-phis      phis merging boxed Int or Bool values that are unboxed
+//                   merge the raw values instead.
+//   cse             pure computations already done on every path.
+//   inline          direct calls of small functions of the module.
+// The pass manager runs them on every function of a module, verifying the
+// function after each pass.
+
+struct IRPassContext {
+    ClassHierarchy& cha;
+    IRModule& module;
+    std::size_t inline_size;    // largest function inlined, in instructions.
+};
+
+using IRPass = bool (*)(IRFunction& function, IRPassContext& context);
+
+bool fold_pass(IRFunction& function, IRPassContext& context);
+bool simplify_cfg_pass(IRFunction& function, IRPassContext& context);
+bool dce_pass(IRFunction& function, IRPassContext& context);
+bool devirtualize_pass(IRFunction& function, IRPassContext& context);
+bool void_checks_pass(IRFunction& function, IRPassContext& context);
+bool unbox_phis_pass(IRFunction& function, IRPassContext& context);
+bool cse_pass(IRFunction& function, IRPassContext& context);
+bool inline_pass(IRFunction& function, IRPassContext& context);
+
+// put an empty block on every edge leaving a block with several successors
+// to a block with phis or several predecessors, so the moves of the phis can
+// be done at the end of the predecessors.
+void split_critical_edges(IRFunction& function);
+
+// exit with the problems found in `function` if it isn't well formed.
+void verify_or_die(IRFunction& function, const std::string& when);
+
+class PassManager {
+    public:
+        PassManager(ClassHierarchy& cha_): cha(cha_) {}
+
+        // names of the passes run at -O`level` (0 to 2).
+        static std::vector<std::string> pipeline(int level);
+
+        // whether there is a pass named `name`.
+        static bool exists(const std::string& name);
+
+        // run the pass `name` after the ones added so far, false if there
+        // is no such pass.
+        bool add(const std::string& name);
+
+        void set_inline_size(std::size_t size) { inline_size = size; }
+
+        void run(IRModule& module);
+
+        // number of functions each pass run changed, in order.
+        const std::vector<std::pair<std::string, std::size_t>>& get_changes() { return changes; }
+
+    private:
+        ClassHierarchy& cha;
+        std::vector<std::pair<std::string, IRPass>> passes;
+        std::vector<std::pair<std::string, std::size_t>> changes;
+        std::size_t inline_size{24};
+};
+
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "bcimage.hpp"
+#include "x86asm.hpp"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace cool {
+
+// Compiler of the bytecode (see bytecode.hpp) to x86-64 machine code in the
+// process, run by coolc --jit. The data of the program is built as for the
+// interpreter (see bcimage.hpp) and its code is compiled lazily: every
+// function starts as a stub, which the dispatch tables and the calls point
+// to, compiling the function when it is first called. The stub then jumps
+// to the code, and the dispatch tables are updated to point to it.
+// The registers of the bytecode stay in memory, in the stacks of the
+// interpreter: rbx points to the object registers of the frame, the
+// collector scanning the stack up to objects_top, and r12 to the raw ones.
+// A function is called with its registers in rdi and rsi, its arguments
+// stored in the first object registers, and returns its result in rax.
+// The methods of the basic classes run through call_native.
+// Every dynamic dispatch has an inline cache: the site calls a stub of its
+// own comparing the tag of the receiver to the classes it has seen, jumping
+// straight to their method. A class the stub doesn't know goes through
+// cache_miss, which adds it, up to max_cache_classes; the stub of a site
+// seeing more, megamorphic, loads the method from the dispatch table.
+
+class JIT {
+    public:
+        // `log`, when given, gets a line for every function compiled, and
+        // `cache_stats` the hit rates of the inline caches when the program
+        // ends.
+        JIT(const BCProgram& program, std::ostream* log = nullptr, std::ostream* cache_stats = nullptr);
+
+        // run the program, which exits the process when it ends.
+        [[noreturn]] void run();
+
+    private:
+        const BCProgram& program;
+        BCImage image;
+        std::ostream* log;
+
+        // where the code is emitted.
+        char* code_start{nullptr};
+        char* code_next{nullptr};
+        char* code_end{nullptr};
+        // the stub of every function, and what a call to it jumps to.
+        std::vector<char*> stubs;
+        std::vector<char*> entries;
+        char* compile_trampoline{nullptr};
+        char* enter{nullptr};
+        std::size_t compiled{0};
+
+        coolrt::Object** objects{nullptr};
+        coolrt::Object** objects_top{nullptr};
+        coolrt::Object** objects_end{nullptr};
+        int32_t* raws{nullptr};
+        int32_t* raws_end{nullptr};
+        std::size_t max_params{1};
+
+        static constexpr std::size_t max_cache_classes = 4;
+        struct InlineCache {
+            std::string function;
+            std::size_t pc;
+            uint32_t slot;
+            // the offset of the call (or jump) to the stub in the code of
+            // the function, then its target, which cache_miss patches.
+            std::size_t offset{0};
+            char* target{nullptr};
+            std::vector<std::pair<int32_t, char*>> classes;
+            bool megamorphic{false};
+            // counted with cache_stats: the calls through each class of
+            // the stub, and once megamorphic through the table.
+            uint64_t hits[max_cache_classes + 1]{};
+            uint64_t misses{0};
+        };
+        std::ostream* cache_stats;
+        std::vector<std::unique_ptr<InlineCache>> caches;
+        char* miss_trampoline{nullptr};
+
+        char* install(const X86Assembler& as);
+        void emit_runtime();
+
+        // called by the stubs: the code of `function`, compiled if needed.
+        static char* compile_stub(JIT* jit, uint32_t function);
+        char* compile(std::size_t function);
+        void compile_native(const BCFunction& function, X86Assembler& as);
+        void compile_function(const BCFunction& function, X86Assembler& as);
+        void compile_instr(const BCFunction& function, std::size_t pc, std::vector<X86Label>& labels,
+                           X86Assembler& as);
+        // store the arguments of a call in the registers of the callee, from
+        // its register `first`.
+        void store_arguments(const BCFunction& function, const uint32_t* args, uint32_t nargs, uint32_t first,
+                             X86Assembler& as);
+        void tail_arguments(const BCFunction& function, const uint32_t* args, uint32_t nargs, X86Assembler& as);
+        void box_int(X86Assembler& as);
+        // restore the registers of the caller, before returning or jumping.
+        void leave(X86Assembler& as);
+        void jump_to(std::size_t target, std::size_t next, std::vector<X86Label>& labels, X86Assembler& as);
+        // call (or jump to, for a tail call) the method in `slot` of the
+        // receiver, the first object register of the callee, through a new
+        // inline cache.
+        void dispatch(const BCFunction& function, std::size_t pc, uint32_t slot, bool tail, X86Assembler& as);
+
+        // called by the stubs of the caches: the method of the receiver,
+        // given the registers of the callee, once the cache of `site` has
+        // its class.
+        static char* cache_miss(JIT* jit, uint32_t site, coolrt::Object** registers);
+        void link_cache(InlineCache& cache);
+        void print_cache_stats() const;
+
+        static void* run_thread(void* jit);
+};
+
+}
@@ -7,7 +7,10 @@
 namespace cool {
 
 // This pass helps to collect the size of all local variables in every function.
-// which in the case of cool are just let var. This will ease function codegen.
+// which in the case of cool are let vars and case binders. This will ease function codegen.
+// A local only holds its slot while in scope so bindings whose scopes don't
+// overlap (sibling lets, the branches of a case...) share slots: the size is
+// the deepest nesting of bindings.
 
 class LocalSizer: public StmtVisitor, public ExprVisitor {
     public:
@@ -21,11 +24,11 @@ class LocalSizer: public StmtVisitor, public ExprVisitor {
             stmt->accept(this);
         }
 
-        size_t getFuncLocalSize(std::string& funcName) {
-            if (local_func_sizes.find(funcName) != local_func_sizes.end())
-                return local_func_sizes[funcName];
+        size_t getFuncLocalSize(Feature* func) {
+            if (local_func_sizes.find(func) != local_func_sizes.end())
+                return local_func_sizes[func];
             // !TODO better error handling
-            throw std::runtime_error("Unable to compute Local size for unknown function " + funcName);
+            throw std::runtime_error("Unable to compute Local size for unknown function " + func->id.lexeme);
         }
 
         size_t getClassLocalSize(std::string& className) {
@@ -38,8 +41,9 @@ class LocalSizer: public StmtVisitor, public ExprVisitor {
 
         
         void visitFeatureExpr(Feature* expr) {
+            depth = 0;
             if (expr->featuretype == FeatureType::METHOD) {
-                current_func = expr->id.lexeme;
+                current_func = expr;
                 local_func_sizes.insert({current_func, 0});
                 inside_func = true;
                 expr->expr->accept(this);
@@ -51,12 +55,15 @@ class LocalSizer: public StmtVisitor, public ExprVisitor {
         } 
 
         void visitLetExpr(Let* expr) {
-            if (inside_func) {
-                local_func_sizes[current_func] += expr->vecAssigns.size();               
-            } else { // count towards class size.
-                local_class_sizes[current_class] += expr->vecAssigns.size();
+            // a binding is in scope in the initializations that follow it.
+            size_t scope = depth;
+            for (auto& let: expr->vecAssigns) {
+                if (std::get<1>(let))
+                    std::get<1>(let)->accept(this);
+                bind();
             }
             expr->body->accept(this);
+            depth = scope;
         }
 
         void visitFormalExpr(Formal* expr)  { }
@@ -95,29 +102,27 @@ class LocalSizer: public StmtVisitor, public ExprVisitor {
 
         void visitGroupingExpr(Grouping* expr) { expr->expr->accept(this); }
 
-        void visitDispatchExpr(Dispatch* expr) { }
+        void visitDispatchExpr(Dispatch* expr) {
+            for (auto& arg: expr->args)
+                arg->accept(this);
+            expr->expr->accept(this);
+        }
 
-        void visitStaticDispatchExpr(StaticDispatch* expr) { }
+        void visitStaticDispatchExpr(StaticDispatch* expr) {
+            for (auto& arg: expr->args)
+                arg->accept(this);
+            expr->expr->accept(this);
+        }
         
         void visitLiteralExpr(Literal* expr) { }
 
         void visitCaseExpr(Case* expr) { 
-            if (inside_case)
-                curr_case_size += 1;
-            else 
-                curr_case_size = 1;
             expr->expr->accept(this);
             for (auto& case_: expr->matches) {
+                bind();
                 std::get<1>(case_).get()->accept(this);
+                depth--;
             }
-            if (inside_func) {
-                local_func_sizes[current_func] = local_func_sizes[current_func] > curr_case_size ?
-                        local_func_sizes[current_func] : curr_case_size;
-            } else {
-                local_class_sizes[current_class] = local_class_sizes[current_class] > curr_case_size ?
-                        local_class_sizes[current_class] : curr_case_size;
-            }
-            inside_case = false;
         }
 
         void visitProgramStmt(Program* stmt) { 
@@ -135,13 +140,21 @@ class LocalSizer: public StmtVisitor, public ExprVisitor {
         }
 
     private:
-        std::unordered_map<std::string, size_t> local_func_sizes{};
+        // a new local is in scope.
+        void bind() {
+            depth++;
+            size_t& size = inside_func ? local_func_sizes[current_func] : local_class_sizes[current_class];
+            if (depth > size)
+                size = depth;
+        }
+
+        // keyed by method since methods of different classes share names.
+        std::unordered_map<Feature*, size_t> local_func_sizes{};
         std::unordered_map<std::string, size_t> local_class_sizes{};
-        std::string current_func;
+        Feature* current_func{nullptr};
         std::string current_class;
-        bool inside_func;
-        size_t curr_case_size{0};
-        bool inside_case{false}; // to handle nested cases construction.
+        bool inside_func{false};
+        size_t depth{0};    // locals in scope.
 
 };
 
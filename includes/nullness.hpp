@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ast.hpp"
+#include "type.hpp"
+#include "cha.hpp"
+#include "resolver.hpp"
+#include "environment.hpp"
+#include <unordered_set>
+#include <set>
+#include <vector>
+#include <string>
+
+namespace cool {
+
+// Nullness analysis proving the receivers of dispatches non-void so their
+// dispatch-on-void check can be dropped.
+// The method bodies are walked in evaluation order while tracking the locals
+// and attributes known to hold an object. A value is non-void when it is
+// self, a new object, a literal, an Int/Bool/String local (these are never
+// void), a case binder or a variable that was assigned such a value or already
+// dispatched on. Facts about attributes are forgotten on every call or `new`
+// since the code run may assign them. At a merge (if, case) only the facts
+// holding on every path are kept and the locals assigned in a loop lose
+// theirs on entering it.
+
+class NullnessAnalysis: public StmtVisitor, public ExprVisitor {
+    public:
+        struct MethodChecks {
+            std::string name;       // Class.method (or Class_init for attributes).
+            std::size_t removed;
+            std::size_t total;
+        };
+
+        NullnessAnalysis(ClassHierarchy& cha_, DispatchResolver& resolver_): cha(cha_), resolver(resolver_) {}
+
+        void run(Program* program) {
+            program->accept(this);
+        }
+
+        // whether the receiver of the dispatch `expr` is proven non-void.
+        bool is_non_void_receiver(Expr* expr) {
+            return non_void_receivers.count(expr) != 0;
+        }
+
+        // dispatch-on-void checks removed in every method.
+        const std::vector<MethodChecks>& get_method_checks() { return method_checks; }
+
+        void visitFeatureExpr(Feature* expr);
+        void visitFormalExpr(Formal* expr);
+        void visitAssignExpr(Assign* expr);
+        void visitIfExpr(If* expr);
+        void visitWhileExpr(While* expr);
+        void visitBinaryExpr(Binary* expr);
+        void visitUnaryExpr(Unary* expr);
+        void visitVariableExpr(Variable* expr);
+        void visitNewExpr(New* expr);
+        void visitBlockExpr(Block* expr);
+        void visitGroupingExpr(Grouping* expr);
+        void visitStaticDispatchExpr(StaticDispatch* expr);
+        void visitDispatchExpr(Dispatch* expr);
+        void visitLiteralExpr(Literal* expr);
+        void visitLetExpr(Let* expr);
+        void visitCaseExpr(Case* expr);
+        void visitProgramStmt(Program* stmt);
+        void visitClassStmt(Class* stmt);
+
+    private:
+        // what is known at a point of a method.
+        struct State {
+            std::set<Formal*> locals;           // non-void locals.
+            std::set<std::string> attributes;   // non-void attributes.
+
+            void intersect(const State& other);
+        };
+
+        static bool never_void(const std::string& type);
+
+        // record the variable `name` as (non-)void.
+        void set_fact(const std::string& name, bool non_void_value);
+
+        // the variable tested by `cond` if it is of the form `isvoid x`
+        // (`negated` set for `not isvoid x`), nullptr otherwise.
+        Variable* voidness_test(Expr* cond, bool& negated);
+
+        // common part of the dynamic and static dispatches.
+        void dispatch(Expr* expr, Expr* receiver, std::vector<std::unique_ptr<Expr>>& args, Token& callee_name);
+
+        void start_method(const std::string& name);
+
+        ClassHierarchy& cha;
+        DispatchResolver& resolver;
+        typeIdentifier typeId{};
+        Class* curr_class{nullptr};
+
+        // locals in scope.
+        SymbolTable<std::string, Formal*> scope;
+
+        State state;
+
+        // whether the value of the last visited expression is non-void.
+        bool non_void{false};
+
+        std::unordered_set<Expr*> non_void_receivers;
+        std::vector<MethodChecks> method_checks;
+};
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ast.hpp"
+#include "cha.hpp"
+#include "resolver.hpp"
+#include "environment.hpp"
+#include <unordered_set>
+#include <set>
+#include <vector>
+#include <string>
+
+namespace cool {
+
+// Whole program reachability (rapid type analysis) from `Main.main`.
+// A class is instantiated when some reachable code does a `new` of it (Main,
+// Int, Bool and String always are). A method is reachable when it is the
+// target of a resolved or static dispatch in reachable code, or when it is
+// the implementation, in an instantiated class, of a method name dispatched
+// on at runtime. The attribute initializers of the instantiated classes and
+// of their ancestors are reachable as well since their `_init` run them.
+// The code generator only emits the prototype objects and dispatch tables of
+// instantiated classes, the `_init` of those and of their ancestors, the
+// reachable methods and the constants they use. Tags and dispatch table
+// offsets are left unchanged.
+
+class Reachability: public StmtVisitor, public ExprVisitor {
+    public:
+        Reachability(ClassHierarchy& cha_, DispatchResolver& resolver_, SymbolTable<std::string, Class*>* ctable_ptr):
+            cha(cha_), resolver(resolver_), class_table_ptr(ctable_ptr) {}
+
+        void run(Program* program);
+
+        // whether objects of the class can be created.
+        bool is_instantiated(const std::string& class_name) { return instantiated.count(class_name); }
+
+        // whether the `_init` of the class can run.
+        bool is_initialized(const std::string& class_name) { return initialized.count(class_name); }
+
+        bool is_reachable(Feature* method) { return reachable.count(method); }
+
+        // whether the string or int constant is used.
+        bool uses_string(const std::string& s) { return strings.count(s); }
+        bool uses_int(int value) { return ints.count(value); }
+
+        // number of user defined methods and classes and how many are kept.
+        std::size_t get_method_count() { return method_count; }
+        std::size_t get_reachable_method_count() { return reachable_method_count; }
+        std::size_t get_class_count() { return class_count; }
+        std::size_t get_live_class_count() { return live_class_count; }
+
+        void visitFeatureExpr(Feature* expr);
+        void visitFormalExpr(Formal* expr);
+        void visitAssignExpr(Assign* expr);
+        void visitIfExpr(If* expr);
+        void visitWhileExpr(While* expr);
+        void visitBinaryExpr(Binary* expr);
+        void visitUnaryExpr(Unary* expr);
+        void visitVariableExpr(Variable* expr);
+        void visitNewExpr(New* expr);
+        void visitBlockExpr(Block* expr);
+        void visitGroupingExpr(Grouping* expr);
+        void visitStaticDispatchExpr(StaticDispatch* expr);
+        void visitDispatchExpr(Dispatch* expr);
+        void visitLiteralExpr(Literal* expr);
+        void visitLetExpr(Let* expr);
+        void visitCaseExpr(Case* expr);
+        void visitProgramStmt(Program* stmt);
+        void visitClassStmt(Class* stmt);
+
+    private:
+        void instantiate(const std::string& class_name);
+        void call(const std::string& method_name);
+        void reach(Feature* feature);
+
+        ClassHierarchy& cha;
+        DispatchResolver& resolver;
+        SymbolTable<std::string, Class*>* class_table_ptr;
+
+        std::set<std::string> instantiated;
+        std::set<std::string> initialized;
+        std::set<std::string> called;
+        std::unordered_set<Feature*> reachable;
+        std::set<std::string> strings;
+        std::set<int> ints;
+
+        // reachable methods and attributes whose code wasn't scanned yet.
+        std::vector<Feature*> worklist;
+
+        std::size_t method_count{0};
+        std::size_t reachable_method_count{0};
+        std::size_t class_count{0};
+        std::size_t live_class_count{0};
+};
+
+}
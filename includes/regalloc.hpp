@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ast.hpp"
+#include "environment.hpp"
+#include <unordered_map>
+#include <vector>
+#include <string>
+
+namespace cool {
+
+// Linear-scan register allocation for the locals of a method (formals, let
+// variables and case binders).
+// Every local gets a live interval over a preorder numbering of the method body,
+// from its binding to its last use. A use inside a while loop keeps the variable
+// alive until the end of that loop since the next iteration reads it again.
+// Intervals are then scanned by increasing start and handed the callee-saved
+// registers $s1-$s6. When none is free, the interval with the lowest use count
+// (weighted by loop nesting) is spilled and keeps its usual slot in the frame.
+
+class RegAllocator: public StmtVisitor, public ExprVisitor {
+    public:
+        RegAllocator() = default;
+
+        // compute the register assignment of the locals of `method`.
+        void allocate(Feature* method);
+
+        // register holding the local declared by `formal` in the last allocated
+        // method, nullptr when the local lives in the frame.
+        const char* get_register(Formal* formal);
+
+        // registers used by the last allocated method, its prologue saves them.
+        const std::vector<const char*>& used_registers() { return used; }
+
+        void visitFeatureExpr(Feature* expr);
+        void visitFormalExpr(Formal* expr);
+        void visitAssignExpr(Assign* expr);
+        void visitIfExpr(If* expr);
+        void visitWhileExpr(While* expr);
+        void visitBinaryExpr(Binary* expr);
+        void visitUnaryExpr(Unary* expr);
+        void visitVariableExpr(Variable* expr);
+        void visitNewExpr(New* expr);
+        void visitBlockExpr(Block* expr);
+        void visitGroupingExpr(Grouping* expr);
+        void visitStaticDispatchExpr(StaticDispatch* expr);
+        void visitDispatchExpr(Dispatch* expr);
+        void visitLiteralExpr(Literal* expr);
+        void visitLetExpr(Let* expr);
+        void visitCaseExpr(Case* expr);
+        void visitProgramStmt(Program* stmt);
+        void visitClassStmt(Class* stmt);
+
+    private:
+        struct Interval {
+            Formal* formal;
+            std::size_t start;
+            std::size_t end;
+            std::size_t weight;
+        };
+
+        // a local is worth a register only if it is read or written at least
+        // this many times (uses inside loops count more).
+        static constexpr std::size_t MIN_WEIGHT = 2;
+
+        void define(Formal* formal);
+        void use(const std::string& name);
+        void linear_scan();
+
+        std::vector<Interval> intervals;
+
+        // maps a local name to its interval.
+        SymbolTable<std::string, std::size_t> scope;
+
+        // for every enclosing while: where it starts and the locals used inside.
+        std::vector<std::size_t> loop_starts;
+        std::vector<std::vector<std::size_t>> loop_uses;
+
+        std::unordered_map<Formal*, const char*> assignment;
+        std::vector<const char*> used;
+        std::size_t position{0};
+};
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ast.hpp"
+#include "type.hpp"
+#include "cha.hpp"
+#include "environment.hpp"
+#include <unordered_map>
+#include <string>
+
+namespace cool {
+
+// This pass resolves at compile time the dispatches that can only reach one
+// method, using the declared types of the receivers and the class hierarchy.
+// Static dispatches are always resolved.
+
+class DispatchResolver: public StmtVisitor, public ExprVisitor {
+    public:
+        DispatchResolver(ClassHierarchy& cha_): cha(cha_) {}
+
+        void resolve(Program* program) {
+            program->accept(this);
+        }
+
+        // class defining the method called by the dispatch `expr` or an
+        // empty string if it is only known at runtime.
+        const std::string& get_target(Expr* expr) {
+            auto target = targets.find(expr);
+            return target != targets.end() ? target->second : unresolved;
+        }
+
+        // a class the receiver of the dispatch `expr` conforms to: its
+        // declared type or, when unknown, the class introducing the method.
+        const std::string& get_receiver_type(Dispatch* expr) {
+            auto type = receiver_types.find(expr);
+            return type != receiver_types.end() ? type->second : unresolved;
+        }
+
+        // declared type of the expression a case is on, an empty string if
+        // unknown.
+        const std::string& get_case_type(Case* expr) {
+            auto type = case_types.find(expr);
+            return type != case_types.end() ? type->second : unresolved;
+        }
+
+        // number of dispatch sites in the program and how many were resolved.
+        std::size_t get_site_count() { return site_count; }
+        std::size_t get_resolved_count() { return targets.size(); }
+
+        void visitFeatureExpr(Feature* expr);
+        void visitFormalExpr(Formal* expr);
+        void visitAssignExpr(Assign* expr);
+        void visitIfExpr(If* expr);
+        void visitWhileExpr(While* expr);
+        void visitBinaryExpr(Binary* expr);
+        void visitUnaryExpr(Unary* expr);
+        void visitVariableExpr(Variable* expr);
+        void visitNewExpr(New* expr);
+        void visitBlockExpr(Block* expr);
+        void visitGroupingExpr(Grouping* expr);
+        void visitStaticDispatchExpr(StaticDispatch* expr);
+        void visitDispatchExpr(Dispatch* expr);
+        void visitLiteralExpr(Literal* expr);
+        void visitLetExpr(Let* expr);
+        void visitCaseExpr(Case* expr);
+        void visitProgramStmt(Program* stmt);
+        void visitClassStmt(Class* stmt);
+
+    private:
+        // a class every value of `expr` conforms to, computed from declared
+        // types only (empty when unknown). `exact` is set when the value is
+        // known to be of that very class.
+        std::string static_type(Expr* expr, bool& exact);
+
+        ClassHierarchy& cha;
+        typeIdentifier typeId{};
+        Class* curr_class{nullptr};
+
+        // declared types of the locals in scope.
+        SymbolTable<std::string, std::string> scope;
+
+        std::unordered_map<Expr*, std::string> targets;
+        std::unordered_map<Case*, std::string> case_types;
+        std::unordered_map<Dispatch*, std::string> receiver_types;
+        std::size_t site_count{0};
+        const std::string unresolved{};
+};
+
+}
@@ -24,12 +24,17 @@ class TokenTable {
         void insert(std::string id, Token token);
         int get_index(const std::string& id);
         std::map<std::string, Token>& get_elements();
+        void clear();   // remove every element, indexes start back from 0.
 };
 
 class IdTable : public TokenTable {};
 class StringTable : public TokenTable {};
 class IntTable : public TokenTable {};
 
+// the characters of a string constant: the string table keeps the text of
+// the source, with its escapes.
+std::string unescape(const std::string& text);
+
 inline IdTable& idtable() {
     static IdTable idtable;
     return idtable;
@@ -5,9 +5,24 @@
 namespace cool {
 
 enum class Type {
-    Variable, // to be completed
+    Feature,
+    Formal,
+    Assign,
+    If,
+    While,
+    Binary,
+    Unary,
+    Variable,
+    New,
+    Block,
+    Grouping,
     Dispatch,
     StaticDispatch,
+    Literal,
+    Let,
+    Case,
+    Program,
+    Class,
 };
 
 class typeIdentifier: public StmtVisitor, public ExprVisitor {
@@ -22,27 +37,31 @@ class typeIdentifier: public StmtVisitor, public ExprVisitor {
             stmt->accept(this);
             return type; 
         }
+        Type identify(Expr* expr) {
+            expr->accept(this);
+            return type;
+        }
 
-        void visitFeatureExpr(Feature* expr) {} 
-        void visitFormalExpr(Formal* expr)  {}
-        void visitAssignExpr(Assign* expr) {}
-        void visitIfExpr(If* expr) {}
-        void visitWhileExpr(While* expr) {}
-        void visitBinaryExpr(Binary* expr) {}
-        void visitUnaryExpr(Unary* expr) {}
+        void visitFeatureExpr(Feature* expr) { type = Type::Feature; } 
+        void visitFormalExpr(Formal* expr)  { type = Type::Formal; }
+        void visitAssignExpr(Assign* expr) { type = Type::Assign; }
+        void visitIfExpr(If* expr) { type = Type::If; }
+        void visitWhileExpr(While* expr) { type = Type::While; }
+        void visitBinaryExpr(Binary* expr) { type = Type::Binary; }
+        void visitUnaryExpr(Unary* expr) { type = Type::Unary; }
         void visitVariableExpr(Variable* expr) { type = Type::Variable; }
-        void visitNewExpr(New* expr) { }  
-        void visitBlockExpr(Block* expr) {}
-        void visitGroupingExpr(Grouping* expr) {}
+        void visitNewExpr(New* expr) { type = Type::New; }  
+        void visitBlockExpr(Block* expr) { type = Type::Block; }
+        void visitGroupingExpr(Grouping* expr) { type = Type::Grouping; }
         void visitDispatchExpr(Dispatch* expr) { type = Type::Dispatch; }
         void visitStaticDispatchExpr(StaticDispatch* expr) { type = Type::StaticDispatch; }
-        void visitLiteralExpr(Literal* expr) {}
-        void visitLetExpr(Let* expr) {}
-        void visitCaseExpr(Case* expr) {}
+        void visitLiteralExpr(Literal* expr) { type = Type::Literal; }
+        void visitLetExpr(Let* expr) { type = Type::Let; }
+        void visitCaseExpr(Case* expr) { type = Type::Case; }
 
 
-        void visitProgramStmt(Program* stmt) {}
-        void visitClassStmt(Class* smtt) {}
+        void visitProgramStmt(Program* stmt) { type = Type::Program; }
+        void visitClassStmt(Class* smtt) { type = Type::Class; }
 
     private:
         Type type;
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "bcimage.hpp"
+#include <vector>
+
+namespace cool {
+
+// Interpreter of the bytecode (see bytecode.hpp) run by coolc --run.
+// The objects have the layout of the native code and are managed by its
+// runtime (lib/runtime), which also implements the methods of the basic
+// classes: the interpreter builds the data the native code would have (see
+// bcimage.hpp), its dispatch tables pointing to the functions below, then
+// runs __start.
+// The instructions are threaded when loaded, their opcode replaced by the
+// offset of their handler which the dispatch jumps to (computed goto).
+// The registers of the frames live in two stacks, the one of the object
+// registers being scanned by the collector, and the calls push a record of
+// the caller on a stack of their own, so the interpreter doesn't recurse.
+
+class VM {
+    public:
+        explicit VM(const BCProgram& program);
+
+        // run the program, which exits the process when it ends.
+        [[noreturn]] void run();
+
+    private:
+        struct Function {
+            const uint32_t* code;
+            uint32_t nparams;
+            uint32_t nobjects;
+            uint32_t nraws;
+            BCNative native;
+        };
+
+        // the function a call returns to.
+        struct Frame {
+            const Function* function;
+            const uint32_t* pc;
+            coolrt::Object** objects;
+            int32_t* raws;
+            uint32_t result;        // register receiving the result.
+        };
+
+        const BCProgram& program;
+        BCImage image;
+        std::vector<Function> functions;
+        std::vector<std::vector<uint32_t>> code;
+
+        coolrt::Object** objects{nullptr};
+        coolrt::Object** objects_top{nullptr};
+        coolrt::Object** objects_end{nullptr};
+        int32_t* raws{nullptr};
+        int32_t* raws_end{nullptr};
+        std::vector<Frame> frames;
+        // the arguments of a tail call while the frame is overwritten.
+        std::vector<coolrt::Object*> arguments;
+
+        void thread(const int32_t* offsets);
+        [[noreturn]] void execute(const Function* start);
+};
+
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+namespace cool {
+
+// Encoder of the x86-64 instructions the JIT (jit.hpp) emits, into a
+// buffer of bytes which is copied where the code runs afterwards. The
+// instructions take registers, memory operands addressed by a base register
+// and a displacement, and immediates; the jumps go to labels bound in the
+// same buffer, or to an absolute address given the address the buffer will
+// be copied at (`base`). The names follow the Intel syntax, the destination
+// first; the 32 bits forms end with 32.
+
+enum class X86Reg : uint8_t {
+    rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi,
+    r8, r9, r10, r11, r12, r13, r14, r15,
+};
+
+enum class X86Cond : uint8_t {
+    o, no, b, ae, e, ne, be, a, s, ns, p, np, l, ge, le, g,
+};
+
+struct X86Mem {
+    X86Reg base;
+    int32_t disp;
+};
+
+class X86Label {
+    public:
+        bool bound() const { return position != npos; }
+
+    private:
+        friend class X86Assembler;
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+        std::size_t position{npos};
+        // the rel32 fields jumping to the label before it is bound.
+        std::vector<std::size_t> uses;
+};
+
+class X86Assembler {
+    public:
+        explicit X86Assembler(const char* base): base(base) {}
+
+        const std::vector<uint8_t>& code() const { return bytes; }
+        std::size_t size() const { return bytes.size(); }
+
+        void bind(X86Label& label);
+
+        void mov(X86Reg dst, X86Reg src);
+        void mov(X86Reg dst, X86Mem src);
+        void mov(X86Mem dst, X86Reg src);
+        void mov(X86Mem dst, int32_t imm);        // sign extended to 64 bits.
+        void mov(X86Reg dst, uint64_t imm);
+        void mov(X86Reg dst, const void* address) { mov(dst, reinterpret_cast<uint64_t>(address)); }
+        void mov32(X86Reg dst, X86Reg src);
+        void mov32(X86Reg dst, X86Mem src);
+        void mov32(X86Mem dst, X86Reg src);
+        void mov32(X86Mem dst, int32_t imm);
+        void mov32(X86Reg dst, int32_t imm);
+        void lea(X86Reg dst, X86Mem src);
+
+        void add(X86Reg dst, int32_t imm);
+        void add(X86Mem dst, int32_t imm);
+        void sub(X86Reg dst, int32_t imm);
+        void cmp(X86Reg a, X86Reg b);
+        void cmp(X86Reg a, X86Mem b);
+        void cmp(X86Mem a, int32_t imm);
+        void add32(X86Reg dst, X86Mem src);
+        void add32(X86Reg dst, int32_t imm);
+        void sub32(X86Reg dst, X86Mem src);
+        void sub32(X86Reg dst, int32_t imm);
+        void imul32(X86Reg dst, X86Mem src);
+        void cmp32(X86Reg a, X86Mem b);
+        void cmp32(X86Reg a, int32_t imm);
+        void cmp32(X86Mem a, int32_t imm);
+        void test32(X86Reg a, X86Reg b);
+        void test32(X86Mem a, int32_t imm);
+        void xor32(X86Reg dst, X86Reg src);
+        void neg32(X86Reg dst);
+        void cdq();
+        void idiv32(X86Mem divisor);
+        // dst (its low byte) = cond, zero extended to 32 bits.
+        void set32(X86Cond cond, X86Reg dst);
+        void cmov(X86Cond cond, X86Reg dst, X86Reg src);
+        void rep_stosq();
+
+        void push(X86Reg reg);
+        void pop(X86Reg reg);
+        void call(X86Reg target);
+        void call(X86Mem target);
+        void call(const void* target);
+        void jmp(X86Reg target);
+        void jmp(X86Mem target);
+        void jmp(const void* target);
+        void jmp(X86Label& label);
+        void jcc(X86Cond cond, const void* target);
+        void jcc(X86Cond cond, X86Label& label);
+        void ret();
+
+    private:
+        const char* base;
+        std::vector<uint8_t> bytes;
+
+        void byte(uint8_t b) { bytes.push_back(b); }
+        void imm32(int32_t imm);
+        void rex(bool w, unsigned reg, unsigned rm, bool force = false);
+        // an instruction whose ModRM operand is a register, or memory.
+        void op(bool w, std::initializer_list<uint8_t> opcode, unsigned reg, X86Reg rm);
+        void op(bool w, std::initializer_list<uint8_t> opcode, unsigned reg, X86Mem rm);
+        void rel32(const void* target);
+        void rel32(X86Label& label);
+};
+
+}
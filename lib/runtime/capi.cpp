@@ -0,0 +1,144 @@
+//
+// C interface of the native runtime (see coolrt.h), for the C code
+// generated by coolc (--target=c).
+//
+// The program runs on a thread of its own, whose stack is large enough for
+// the deep recursions the other targets allow. The shadow stack of the C
+// code is a root range of the collector: the objects from its start to
+// cool_stack_top are alive. The methods which allocate are given no frame,
+// the generated code having none the collector could walk.
+//
+
+#include "coolrt.h"
+#include "runtime.hpp"
+#include <pthread.h>
+#include <cstdlib>
+
+using namespace coolrt;
+
+cool_Object** cool_stack_top;
+cool_Object** cool_stack_limit;
+
+namespace {
+
+constexpr std::size_t stack_slots = 1 << 22;
+constexpr std::size_t machine_stack = std::size_t{1} << 30;
+
+void (*program_entry)();
+
+Object* from_c(cool_Object* object) {
+    return reinterpret_cast<Object*>(object);
+}
+
+String* string_from_c(cool_Object* object) {
+    return reinterpret_cast<String*>(object);
+}
+
+cool_Object* to_c(Object* object) {
+    return reinterpret_cast<cool_Object*>(object);
+}
+
+void* run_thread(void*) {
+    cool_stack_top = static_cast<cool_Object**>(std::calloc(stack_slots, sizeof(cool_Object*)));
+    if (!cool_stack_top)
+        fail("Can't allocate the stack of the program.\n");
+    cool_stack_limit = cool_stack_top + stack_slots;
+    add_root_range(reinterpret_cast<Object**>(cool_stack_top), reinterpret_cast<Object** const*>(&cool_stack_top));
+    program_entry();
+    finish("COOL program successfully executed\n");
+}
+
+}
+
+void cool_start(const cool_Program* info, void (*entry)()) {
+    program = {reinterpret_cast<Object**>(const_cast<cool_Object**>(info->class_names)), from_c(info->int_proto),
+               from_c(info->string_proto), info->int_tag, info->bool_tag, info->string_tag, nullptr};
+    gc_config = {info->gc.collector, info->gc.heap_init, info->gc.heap_max, info->gc.nursery_percent, info->gc.stats};
+    program_entry = entry;
+
+    pthread_attr_t attributes;
+    pthread_t thread;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, machine_stack);
+    if (pthread_create(&thread, &attributes, run_thread, nullptr))
+        fail("Can't create the thread of the program.\n");
+    pthread_join(thread, nullptr);
+    std::abort();
+}
+
+void cool_stack_overflow() {
+    fail("Stack overflow.\n");
+}
+
+void cool_divide_error() {
+    _divide_abort();
+}
+
+cool_Object* cool_copy(cool_Object* object) {
+    return to_c(copy(from_c(object)));
+}
+
+cool_Object* cool_new_int(int32_t value) {
+    return to_c(new_int(value));
+}
+
+void cool_gc_remember(cool_Object* object) {
+    _gc_remember(from_c(object));
+}
+
+cool_Object* cool_Object_abort(cool_Object* self) {
+    return to_c(object_abort(from_c(self)));
+}
+
+cool_Object* cool_Object_type_name(cool_Object* self) {
+    return to_c(object_type_name(from_c(self)));
+}
+
+cool_Object* cool_Object_copy(cool_Object* self) {
+    return to_c(cool_object_copy(from_c(self), nullptr, nullptr));
+}
+
+cool_Object* cool_IO_out_string(cool_Object* self, cool_Object* s) {
+    return to_c(io_out_string(from_c(self), string_from_c(s)));
+}
+
+cool_Object* cool_IO_out_int(cool_Object* self, cool_Object* i) {
+    return to_c(io_out_int(from_c(self), reinterpret_cast<Int*>(i)));
+}
+
+cool_Object* cool_IO_in_string(cool_Object* self) {
+    return to_c(cool_io_in_string(from_c(self), nullptr, nullptr));
+}
+
+cool_Object* cool_IO_in_int(cool_Object* self) {
+    return to_c(cool_io_in_int(from_c(self), nullptr, nullptr));
+}
+
+cool_Object* cool_String_length(cool_Object* self) {
+    return to_c(string_length(string_from_c(self)));
+}
+
+cool_Object* cool_String_concat(cool_Object* self, cool_Object* s) {
+    return to_c(cool_string_concat(string_from_c(self), string_from_c(s), nullptr, nullptr));
+}
+
+cool_Object* cool_String_substr(cool_Object* self, cool_Object* i, cool_Object* l) {
+    return to_c(cool_string_substr(string_from_c(self), reinterpret_cast<Int*>(i), reinterpret_cast<Int*>(l),
+                                   nullptr, nullptr));
+}
+
+int cool_equality_test(cool_Object* a, cool_Object* b) {
+    return equality_test(from_c(a), from_c(b));
+}
+
+void cool_dispatch_abort(cool_Object* filename, int line) {
+    _dispatch_abort(string_from_c(filename), line);
+}
+
+void cool_case_abort(cool_Object* object) {
+    _case_abort(from_c(object));
+}
+
+void cool_case_abort2(cool_Object* filename, int line) {
+    _case_abort2(string_from_c(filename), line);
+}
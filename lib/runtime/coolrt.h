@@ -0,0 +1,126 @@
+#ifndef COOLRT_H
+#define COOLRT_H
+
+/*
+ * C interface of the COOL runtime, for the C programs generated by coolc
+ * (--target=c), built with:
+ *
+ *      cc -O2 -Ilib/runtime program.c build/libcoolrt.a -lstdc++ -lpthread
+ *
+ * The objects have the layout of runtime.hpp. The C code keeps the objects
+ * its functions hold in a stack of its own, the shadow stack, which the
+ * collector scans for roots: a function takes its slots with cool_enter
+ * and gives them back before returning by resetting cool_stack_top. The
+ * raw Int and Bool values stay in C variables.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+#define COOL_NORETURN [[noreturn]]
+extern "C" {
+#else
+#define COOL_NORETURN _Noreturn
+#endif
+
+typedef void (*cool_method)(void);
+
+typedef struct cool_Object {
+    int32_t tag;
+    uint32_t gc;
+    int64_t size;
+    const cool_method* disp;
+} cool_Object;
+
+typedef struct cool_Int {
+    cool_Object header;
+    int32_t val;
+} cool_Int;
+
+/* the collector and the heap, see GCConfig. */
+typedef struct cool_GCConfig {
+    int64_t collector;
+    int64_t heap_init;
+    int64_t heap_max;
+    int64_t nursery_percent;
+    int64_t stats;
+} cool_GCConfig;
+
+/* what the runtime needs to know of the program, see ProgramInfo. */
+typedef struct cool_Program {
+    cool_Object* const* class_names;
+    cool_Object* int_proto;
+    cool_Object* string_proto;
+    int32_t int_tag;
+    int32_t bool_tag;
+    int32_t string_tag;
+    cool_GCConfig gc;
+} cool_Program;
+
+/* run `entry`, which creates Main and calls its main, on a thread with a
+   large stack, then end the program. */
+COOL_NORETURN void cool_start(const cool_Program* program, void (*entry)(void));
+
+extern cool_Object** cool_stack_top;
+extern cool_Object** cool_stack_limit;
+
+COOL_NORETURN void cool_stack_overflow(void);
+
+/* `n` cleared slots of the shadow stack. */
+static inline cool_Object** cool_enter(int n) {
+    cool_Object** slots = cool_stack_top;
+    if (cool_stack_limit - slots < n)
+        cool_stack_overflow();
+    for (int i = 0; i < n; i++)
+        slots[i] = 0;
+    cool_stack_top = slots + n;
+    return slots;
+}
+
+COOL_NORETURN void cool_divide_error(void);
+
+/* a division by zero stops the program with the runtime error of the other
+   targets, even when the C compiler can see it. the lowest Int divided by -1
+   is itself, as with MIPS. */
+static inline int32_t cool_divide(int32_t a, int32_t b) {
+    if (b == 0)
+        cool_divide_error();
+    if (b == -1)
+        return (int32_t)(0u - (uint32_t)a);
+    return a / b;
+}
+
+cool_Object* cool_copy(cool_Object* object);
+cool_Object* cool_new_int(int32_t value);
+
+/* the write barrier, see GC_BARRIER. */
+void cool_gc_remember(cool_Object* object);
+
+static inline void cool_set_attribute(cool_Object* object, int word, cool_Object* value) {
+    ((cool_Object**)object)[word] = value;
+    if (object->gc & 2u)
+        cool_gc_remember(object);
+}
+
+/* the methods of the basic classes. */
+cool_Object* cool_Object_abort(cool_Object* self);
+cool_Object* cool_Object_type_name(cool_Object* self);
+cool_Object* cool_Object_copy(cool_Object* self);
+cool_Object* cool_IO_out_string(cool_Object* self, cool_Object* s);
+cool_Object* cool_IO_out_int(cool_Object* self, cool_Object* i);
+cool_Object* cool_IO_in_string(cool_Object* self);
+cool_Object* cool_IO_in_int(cool_Object* self);
+cool_Object* cool_String_length(cool_Object* self);
+cool_Object* cool_String_concat(cool_Object* self, cool_Object* s);
+cool_Object* cool_String_substr(cool_Object* self, cool_Object* i, cool_Object* l);
+
+int cool_equality_test(cool_Object* a, cool_Object* b);
+COOL_NORETURN void cool_dispatch_abort(cool_Object* filename, int line);
+COOL_NORETURN void cool_case_abort(cool_Object* object);
+COOL_NORETURN void cool_case_abort2(cool_Object* filename, int line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
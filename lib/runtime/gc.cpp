@@ -0,0 +1,376 @@
+//
+// Generational copying collector of the native runtime.
+//
+// The young objects are bump allocated in the nursery of the thread. A
+// minor collection copies the ones reachable from the roots to the old
+// generation (a Cheney scan of what was copied), the nursery being empty
+// afterwards. When the old generation can't take the whole nursery, a major
+// collection copies every live object to a new old generation, twice as
+// large as what was in use so collections get rarer as the program grows.
+//
+// The roots are precise:
+//  - the object slots of the frames of the generated code. The frame table
+//    the code generator emits (_cool_frame_table) gives, for every function,
+//    its address range and how many slots below its frame pointer hold
+//    objects. The frames are walked from the innermost one, given by the
+//    runtime method entered, following the saved frame pointers.
+//  - the pointers held by the runtime itself, registered with Root.
+//  - the ranges of pointers registered with add_root_range, the registers
+//    of the interpreter of coolc.
+//  - for a minor collection, the old objects written since the last one,
+//    remembered by the write barrier.
+//
+// gc_config chooses the collector: GenGC is the one above, ScnGC does a
+// major collection every time, and NoGC never collects, the nursery being
+// replaced by a new one when it is full. It also gives the size of the heap
+// the program starts with, the share of the nursery, and the size the heap
+// can't grow past. The statistics of the collections are printed on stderr
+// at the end of the program when asked for.
+//
+
+#include "runtime.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace coolrt {
+
+GCConfig gc_config{GEN_GC, 0, 0, 0, 0};
+
+thread_local Nursery nursery{nullptr, nullptr};
+
+namespace {
+
+constexpr std::size_t default_heap_size = 5 << 20;
+constexpr std::size_t default_nursery_percent = 20;
+constexpr std::size_t min_nursery_size = 4 << 10;
+
+struct Space {
+    char* start{nullptr};
+    char* next{nullptr};
+    char* limit{nullptr};
+
+    std::size_t used() const { return next - start; }
+    std::size_t free() const { return limit - next; }
+    bool contains(const void* p) const { return p >= start && p < next; }
+};
+
+struct Frame {
+    const char* start;
+    const char* end;
+    int64_t roots;
+};
+
+struct Heap {
+    char* nursery_start{nullptr};
+    std::size_t nursery_size{0};
+    std::size_t initial_old_size{0};
+    // objects larger than this are allocated in the old generation directly.
+    std::size_t large_object{0};
+    // what was reserved for the heap, 0 for no limit.
+    std::size_t size{0};
+    std::size_t max_size{0};
+    Space old;
+    std::vector<Object*> remembered;
+    std::vector<Object**> roots;
+    std::vector<std::pair<Object**, Object** const*>> ranges;
+    void* top_fp{nullptr};
+    void* top_ra{nullptr};
+
+    // during a collection: the spaces objects are moved from, and where.
+    const Space* from{nullptr};
+    Space* to{nullptr};
+};
+
+thread_local Heap heap;
+
+// of every thread, as in the counters of trap.handler.s.
+struct Stats {
+    std::size_t collections{0};
+    std::size_t majors{0};
+    std::size_t copied{0};
+    std::size_t promoted{0};
+    std::chrono::steady_clock::duration pauses{0};
+    std::chrono::steady_clock::duration max_pause{0};
+    std::size_t max_heap{0};
+};
+
+Stats stats;
+
+void print_stats() {
+    using std::chrono::microseconds;
+    using std::chrono::duration_cast;
+    std::fflush(stdout);
+    std::fprintf(stderr, "GC: %zu collections (%zu major), %zu bytes copied, %zu promoted\n",
+                 stats.collections, stats.majors, stats.copied, stats.promoted);
+    std::fprintf(stderr, "GC: %lld us in the pauses, %lld at most, heap of %zu bytes\n",
+                 static_cast<long long>(duration_cast<microseconds>(stats.pauses).count()),
+                 static_cast<long long>(duration_cast<microseconds>(stats.max_pause).count()), stats.max_heap);
+}
+
+void out_of_memory() {
+    std::fflush(stdout);
+    std::fputs("GC: out of memory.\n", stderr);
+    std::exit(EXIT_FAILURE);
+}
+
+void heap_full() {
+    std::fflush(stdout);
+    std::fputs("GC: the heap can't grow past its maximum size.\n", stderr);
+    std::exit(EXIT_FAILURE);
+}
+
+char* reserve(std::size_t bytes) {
+    if (heap.max_size && heap.size + bytes > heap.max_size)
+        heap_full();
+    char* memory = static_cast<char*>(std::malloc(bytes));
+    if (!memory)
+        out_of_memory();
+    heap.size += bytes;
+    stats.max_heap = std::max(stats.max_heap, heap.size);
+    return memory;
+}
+
+void release(char* memory, std::size_t bytes) {
+    std::free(memory);
+    heap.size -= bytes;
+}
+
+// the functions of the generated code, by address.
+std::vector<Frame> load_frames() {
+    std::vector<Frame> frames;
+    const int64_t* table = program.frame_table;
+    if (!table)
+        return frames;
+    for (int64_t i = 0; i < table[0]; i++) {
+        const int64_t* entry = &table[1 + 3 * i];
+        frames.push_back({reinterpret_cast<const char*>(entry[0]), reinterpret_cast<const char*>(entry[1]), entry[2]});
+    }
+    std::sort(frames.begin(), frames.end(), [](const Frame& a, const Frame& b) { return a.start < b.start; });
+    return frames;
+}
+
+const Frame* find_frame(const void* ra) {
+    static const std::vector<Frame> frames = load_frames();
+    // a call ending a function returns to its end.
+    auto after = std::lower_bound(frames.begin(), frames.end(), ra,
+                                  [](const Frame& f, const void* p) { return f.start < p; });
+    if (after == frames.begin())
+        return nullptr;
+    const Frame* frame = &*(after - 1);
+    return ra <= frame->end ? frame : nullptr;
+}
+
+bool in_from(const Object* object) {
+    const char* p = reinterpret_cast<const char*>(object);
+    return (p >= heap.nursery_start && p < nursery.next) || heap.from->contains(p);
+}
+
+Object* forward(Object* object) {
+    if (object->gc & GC_FORWARDED)
+        return reinterpret_cast<Object*>(object->disp);
+    std::size_t bytes = object->size * word_size;
+    // a space kept under the maximum size of the heap may be too small.
+    if (heap.to->free() < bytes)
+        heap_full();
+    Object* copy = reinterpret_cast<Object*>(heap.to->next);
+    heap.to->next += bytes;
+    std::memcpy(copy, object, bytes);
+    copy->gc = GC_BARRIER;
+    object->gc = GC_FORWARDED;
+    object->disp = reinterpret_cast<void**>(copy);
+    return copy;
+}
+
+void update(Object** slot) {
+    if (*slot && in_from(*slot))
+        *slot = forward(*slot);
+}
+
+void update_fields(Object* object) {
+    if (object->tag == program.int_tag || object->tag == program.bool_tag)
+        return;
+    Object** fields = reinterpret_cast<Object**>(object) + header_words;
+    std::size_t count = object->tag == program.string_tag ? 1 : object->size - header_words;
+    for (std::size_t i = 0; i < count; i++)
+        update(&fields[i]);
+}
+
+void update_stack() {
+    char* fp = static_cast<char*>(heap.top_fp);
+    void* ra = heap.top_ra;
+    while (fp) {
+        const Frame* frame = find_frame(ra);
+        if (!frame)
+            break;
+        Object** slots = reinterpret_cast<Object**>(fp);
+        for (int64_t i = 1; i <= frame->roots; i++)
+            update(slots - i);
+        ra = reinterpret_cast<void**>(fp)[1];
+        fp = reinterpret_cast<char**>(fp)[0];
+    }
+}
+
+// move the live objects of `from` and of the nursery to `to`.
+void copy_live(const Space& from, Space& to, bool minor) {
+    heap.from = &from;
+    heap.to = &to;
+    char* scan = to.next;
+
+    update_stack();
+    for (Object** root: heap.roots)
+        update(root);
+    for (auto& range: heap.ranges) {
+        for (Object** slot = range.first; slot < *range.second; slot++)
+            update(slot);
+    }
+    if (minor) {
+        for (Object* object: heap.remembered) {
+            update_fields(object);
+            object->gc |= GC_BARRIER;
+        }
+    }
+    heap.remembered.clear();
+
+    while (scan < to.next) {
+        Object* object = reinterpret_cast<Object*>(scan);
+        update_fields(object);
+        scan += object->size * word_size;
+    }
+    nursery.next = heap.nursery_start;
+    heap.from = nullptr;
+    heap.to = nullptr;
+}
+
+// the old generation was replaced by another of `capacity` bytes, or of
+// what the maximum size of the heap leaves next to the current one.
+void major_collection(std::size_t capacity) {
+    Space from = heap.old;
+    std::size_t from_size = from.limit - from.start;
+    if (heap.max_size)
+        capacity = std::min(capacity, heap.max_size - heap.size);
+    Space to;
+    to.start = to.next = reserve(capacity);
+    to.limit = to.start + capacity;
+    copy_live(from, to, false);
+    heap.old = to;
+    release(from.start, from_size);
+    stats.majors++;
+    stats.copied += to.used();
+}
+
+// make room for `bytes` more in the old generation, or for the nursery to
+// be promoted if `bytes` is 0. The new old generation keeps at least as
+// much free as what was live, and room for a whole nursery.
+void collect(std::size_t bytes) {
+    auto start = std::chrono::steady_clock::now();
+    std::size_t young = nursery.next - heap.nursery_start;
+    if (!bytes && heap.old.free() >= young && gc_config.collector != SCN_GC) {
+        Space none;
+        std::size_t used = heap.old.used();
+        copy_live(none, heap.old, true);
+        stats.copied += heap.old.used() - used;
+        stats.promoted += heap.old.used() - used;
+    } else {
+        std::size_t capacity = 2 * (heap.old.used() + young) + heap.nursery_size + bytes;
+        major_collection(std::max(capacity, heap.initial_old_size));
+        if (heap.old.free() < bytes)
+            heap_full();
+    }
+    auto pause = std::chrono::steady_clock::now() - start;
+    stats.collections++;
+    stats.pauses += pause;
+    stats.max_pause = std::max(stats.max_pause, pause);
+}
+
+// without a collector, a new nursery takes the place of the full one.
+void grow(std::size_t bytes) {
+    std::size_t size = std::max(heap.nursery_size, bytes);
+    heap.nursery_start = reserve(size);
+    nursery.next = heap.nursery_start;
+    nursery.limit = heap.nursery_start + size;
+    stats.collections++;
+}
+
+void initialize() {
+    static bool printing = false;
+    if (gc_config.stats && !printing) {
+        std::atexit(print_stats);
+        printing = true;
+    }
+
+    std::size_t size = gc_config.heap_init ? gc_config.heap_init : default_heap_size;
+    std::size_t percent = gc_config.nursery_percent ? gc_config.nursery_percent : default_nursery_percent;
+    heap.max_size = gc_config.heap_max;
+    if (heap.max_size)
+        size = std::min(size, heap.max_size);
+    heap.nursery_size = std::max(size / 100 * percent / word_size * word_size, min_nursery_size);
+    heap.initial_old_size = std::max(size, 2 * heap.nursery_size) - heap.nursery_size;
+    heap.large_object = heap.nursery_size / 4;
+    // without a collector, the whole heap is a nursery.
+    if (gc_config.collector == NO_GC)
+        heap.nursery_size = std::max(size, min_nursery_size);
+
+    heap.nursery_start = reserve(heap.nursery_size);
+    nursery.next = heap.nursery_start;
+    nursery.limit = heap.nursery_start + heap.nursery_size;
+    if (gc_config.collector != NO_GC) {
+        heap.old.start = heap.old.next = reserve(heap.initial_old_size);
+        heap.old.limit = heap.old.start + heap.initial_old_size;
+    }
+}
+
+}
+
+void* allocate_slow(std::size_t words) {
+    std::size_t bytes = words * word_size;
+    if (!heap.nursery_start)
+        initialize();
+
+    if (gc_config.collector == NO_GC) {
+        grow(bytes);
+        return allocate(words);
+    }
+
+    // in the old generation, where the object may point to young ones.
+    if (bytes > heap.large_object) {
+        if (heap.old.free() < bytes)
+            collect(bytes);
+        Object* object = reinterpret_cast<Object*>(heap.old.next);
+        heap.old.next += bytes;
+        object->gc = 0;
+        heap.remembered.push_back(object);
+        return object;
+    }
+
+    if (static_cast<std::size_t>(nursery.limit - nursery.next) < bytes)
+        collect(0);
+    return allocate(words);
+}
+
+void set_top_frame(void* fp, void* ra) {
+    heap.top_fp = fp;
+    heap.top_ra = ra;
+}
+
+void add_root_range(Object** start, Object** const* end) {
+    heap.ranges.push_back({start, end});
+}
+
+Root::Root(Object*& slot) {
+    heap.roots.push_back(&slot);
+}
+
+Root::~Root() {
+    heap.roots.pop_back();
+}
+
+}
+
+void _gc_remember(coolrt::Object* object) {
+    object->gc &= ~coolrt::GC_BARRIER;
+    coolrt::heap.remembered.push_back(object);
+}
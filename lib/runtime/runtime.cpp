@@ -0,0 +1,339 @@
+//
+// Methods of the basic classes, equality test and runtime errors of the
+// native runtime (see runtime.hpp).
+//
+// The methods follow the System V calling convention, self being the first
+// argument. The ones which allocate are entered through a stub passing them
+// the frame of the generated code calling them, where the collector starts
+// looking for roots. The standard input and output are buffered here, the
+// output being flushed before reading and when the program ends.
+//
+
+#include "runtime.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+using namespace coolrt;
+
+#if defined(__x86_64__)
+// the frame pointer of the caller and the return address are added after
+// the arguments.
+__asm__(R"(
+        .text
+        .globl  Object.copy
+Object.copy:
+        movq    %rbp, %rsi
+        movq    (%rsp), %rdx
+        jmp     cool_object_copy@PLT
+        .globl  IO.in_string
+IO.in_string:
+        movq    %rbp, %rsi
+        movq    (%rsp), %rdx
+        jmp     cool_io_in_string@PLT
+        .globl  IO.in_int
+IO.in_int:
+        movq    %rbp, %rsi
+        movq    (%rsp), %rdx
+        jmp     cool_io_in_int@PLT
+        .globl  String.concat
+String.concat:
+        movq    %rbp, %rdx
+        movq    (%rsp), %rcx
+        jmp     cool_string_concat@PLT
+        .globl  String.substr
+String.substr:
+        movq    %rbp, %rcx
+        movq    (%rsp), %r8
+        jmp     cool_string_substr@PLT
+)");
+#endif
+
+namespace coolrt {
+
+ProgramInfo program;
+
+namespace {
+
+constexpr std::size_t max_string_read = 1026;   // as str_maxsize in trap.handler.s.
+constexpr std::size_t max_int_read = 256;
+
+// buffered standard input and output.
+char out_buffer[1 << 16];
+std::size_t out_length = 0;
+char in_buffer[1 << 16];
+std::size_t in_next = 0, in_length = 0;
+
+void flush() {
+    std::size_t written = 0;
+    while (written < out_length) {
+        ssize_t n = ::write(STDOUT_FILENO, out_buffer + written, out_length - written);
+        if (n <= 0)
+            break;
+        written += n;
+    }
+    out_length = 0;
+}
+
+void write(const char* s, std::size_t length) {
+    if (out_length + length > sizeof out_buffer) {
+        flush();
+        if (length > sizeof out_buffer) {
+            while (length > 0) {
+                ssize_t n = ::write(STDOUT_FILENO, s, length);
+                if (n <= 0)
+                    return;
+                s += n;
+                length -= n;
+            }
+            return;
+        }
+    }
+    std::memcpy(out_buffer + out_length, s, length);
+    out_length += length;
+}
+
+void write(const char* s) {
+    write(s, std::strlen(s));
+}
+
+void write(int64_t value) {
+    char digits[24];
+    char* p = digits + sizeof digits;
+    uint64_t magnitude = value < 0 ? -static_cast<uint64_t>(value) : value;
+    do {
+        *--p = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0)
+        *--p = '-';
+    write(p, digits + sizeof digits - p);
+}
+
+// the next character of the input, -1 at its end.
+int read_char() {
+    if (in_next == in_length) {
+        ssize_t n = ::read(STDIN_FILENO, in_buffer, sizeof in_buffer);
+        if (n <= 0)
+            return -1;
+        in_next = 0;
+        in_length = n;
+    }
+    return static_cast<unsigned char>(in_buffer[in_next++]);
+}
+
+// read a line of at most size - 1 characters, with its '\n' if it fits.
+std::size_t read_line(char* line, std::size_t size) {
+    flush();
+    std::size_t length = 0;
+    while (length + 1 < size) {
+        int c = read_char();
+        if (c < 0)
+            break;
+        line[length++] = c;
+        if (c == '\n')
+            break;
+    }
+    line[length] = '\0';
+    return length;
+}
+
+[[noreturn]] void halt() {
+    flush();
+    std::exit(EXIT_FAILURE);
+}
+
+// a string of `length` characters, left for the caller to fill. Its length
+// is allocated with it.
+String* new_string(std::size_t length) {
+    std::size_t words = header_words + 1 + length / word_size + 1;
+    Object* int_proto = program.int_proto;
+    Int* size = static_cast<Int*>(allocate(int_proto->size + words));
+    uint32_t gc = size->gc;
+    std::memcpy(size, int_proto, int_proto->size * word_size);
+    size->gc = gc;
+    size->val = static_cast<int32_t>(length);
+
+    String* s = reinterpret_cast<String*>(reinterpret_cast<Object**>(size) + int_proto->size);
+    s->tag = program.string_proto->tag;
+    s->gc = 0;
+    s->size = words;
+    s->disp = program.string_proto->disp;
+    s->length = size;
+    s->chars[length] = '\0';
+    return s;
+}
+
+const char* class_name(Object* object) {
+    return static_cast<String*>(program.class_names[object->tag])->chars;
+}
+
+}
+
+Object* copy(Object* self) {
+    Root root(self);
+    Object* copy = static_cast<Object*>(allocate(self->size));
+    uint32_t gc = copy->gc;
+    std::memcpy(copy, self, self->size * word_size);
+    copy->gc = gc;
+    return copy;
+}
+
+Int* new_int(int32_t value) {
+    Object* int_proto = program.int_proto;
+    Int* i = static_cast<Int*>(allocate(int_proto->size));
+    uint32_t gc = i->gc;
+    std::memcpy(i, int_proto, int_proto->size * word_size);
+    i->gc = gc;
+    i->val = value;
+    return i;
+}
+
+void finish(const char* message) {
+    write(message);
+    flush();
+    std::exit(EXIT_SUCCESS);
+}
+
+void fail(const char* message) {
+    write(message);
+    halt();
+}
+
+}
+
+Object* cool_object_copy(Object* self, void* fp, void* ra) {
+    if (self->size <= 0) {
+        write("Object.copy: Invalid object size.\n");
+        halt();
+    }
+    set_top_frame(fp, ra);
+    return copy(self);
+}
+
+Object* object_abort(Object* self) {
+    write("Abort called from class ");
+    write(class_name(self));
+    write("\n");
+    halt();
+}
+
+Object* object_type_name(Object* self) {
+    return program.class_names[self->tag];
+}
+
+Object* io_out_string(Object* self, String* s) {
+    write(s->chars);
+    return self;
+}
+
+Object* io_out_int(Object* self, Int* i) {
+    write(static_cast<int64_t>(i->val));
+    return self;
+}
+
+Object* cool_io_in_string(Object*, void* fp, void* ra) {
+    // the line read without its '\n', or "\n" if nothing could be read.
+    char line[max_string_read];
+    std::size_t length = read_line(line, sizeof line);
+    if (!length)
+        line[length++] = '\n';
+    else if (line[length - 1] == '\n')
+        length--;
+    set_top_frame(fp, ra);
+    String* s = new_string(length);
+    std::memcpy(s->chars, line, length);
+    return s;
+}
+
+Object* cool_io_in_int(Object*, void* fp, void* ra) {
+    char line[max_int_read];
+    read_line(line, sizeof line);
+    set_top_frame(fp, ra);
+    return new_int(static_cast<int32_t>(std::strtol(line, nullptr, 10)));
+}
+
+Object* string_length(String* self) {
+    return self->length;
+}
+
+Object* cool_string_concat(String* self, String* s, void* fp, void* ra) {
+    if (s->length->val <= 0)
+        return self;
+    set_top_frame(fp, ra);
+    Root self_root(self), s_root(s);
+    std::size_t left = self->length->val, right = s->length->val;
+    String* result = new_string(left + right);
+    std::memcpy(result->chars, self->chars, left);
+    std::memcpy(result->chars + left, s->chars, right);
+    return result;
+}
+
+Object* cool_string_substr(String* self, Int* i, Int* l, void* fp, void* ra) {
+    int32_t index = i->val, length = l->val, size = self->length->val;
+    const char* error = nullptr;
+    if (index < 0)
+        error = "Index to substr is negative\n";
+    else if (index > size)
+        error = "Index to substr is too big\n";
+    else if (index + length > size)
+        error = "Length to substr too long\n";
+    else if (length < 0)
+        error = "Length to substr is negative\n";
+    if (error) {
+        write(error);
+        write("Execution aborted.\n");
+        halt();
+    }
+    set_top_frame(fp, ra);
+    Root root(self);
+    String* result = new_string(length);
+    std::memcpy(result->chars, self->chars + index, length);
+    return result;
+}
+
+int equality_test(Object* a, Object* b) {
+    if (a == b)
+        return 1;
+    if (!a || !b || a->tag != b->tag)
+        return 0;
+    if (a->tag == program.int_tag || a->tag == program.bool_tag)
+        return static_cast<Int*>(a)->val == static_cast<Int*>(b)->val;
+    if (a->tag != program.string_tag)
+        return 0;
+    auto left = static_cast<String*>(a), right = static_cast<String*>(b);
+    return left->length->val == right->length->val &&
+           std::memcmp(left->chars, right->chars, left->length->val) == 0;
+}
+
+void _dispatch_abort(String* filename, int line) {
+    write(filename->chars);
+    write(":");
+    write(static_cast<int64_t>(line));
+    write(": Dispatch to void.\n");
+    halt();
+}
+
+void _case_abort(Object* object) {
+    write("No match in case statement for Class ");
+    write(class_name(object));
+    write("\n");
+    halt();
+}
+
+void _case_abort2(String* filename, int line) {
+    write(filename->chars);
+    write(":");
+    write(static_cast<int64_t>(line));
+    write("Match on void in case statement.\n");
+    halt();
+}
+
+void _divide_abort() {
+    write("Division by zero.\n");
+    halt();
+}
+
+void _stack_overflow() {
+    fail("Stack overflow.\n");
+}
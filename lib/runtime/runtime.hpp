@@ -0,0 +1,178 @@
+#pragma once
+
+//
+// COOL runtime for the native code generated by coolc (--target=x86_64),
+// also used by its interpreter (--run) and, through coolrt.h, by the C code
+// it generates (--target=c).
+//
+// It provides what lib/trap.handler.s provides to the MIPS code: the startup
+// code, the methods of the basic classes (Object, IO, String), the equality
+// test, the runtime errors and the memory manager, with the same names and
+// the same messages. The objects have the layout of the MIPS ones with 8
+// bytes words:
+//
+//      0   class tag (32 bits), followed by 32 bits for the collector
+//      8   size of the object in words
+//      16  dispatch table
+//      24  attributes: the value of an Int or a Bool (32 bits), the length
+//          of a String (an Int object) followed by its characters.
+//
+
+#include <cstddef>
+#include <cstdint>
+
+namespace coolrt {
+
+struct Object {
+    int32_t tag;
+    uint32_t gc;        // GC_* bits, 0 in the constants and the prototypes.
+    int64_t size;
+    void** disp;
+};
+
+struct Int: Object {
+    int32_t val;
+};
+
+struct String: Object {
+    Int* length;
+    char chars[8];
+};
+
+constexpr std::size_t word_size = 8;
+constexpr std::size_t header_words = 3;
+
+// the object was moved, its dispatch table slot holds the new address.
+constexpr uint32_t GC_FORWARDED = 1u << 0;
+// an old object which isn't in the remembered set: storing in one of its
+// attributes must call _gc_remember (see the write barrier of x86lower.cpp).
+constexpr uint32_t GC_BARRIER = 1u << 1;
+
+// what the runtime needs to know of the program, set before it starts: from
+// the symbols of the generated code by start.cpp, or by the interpreter from
+// the objects it builds.
+struct ProgramInfo {
+    Object** class_names;       // class_nameTab: the name of the class of every tag.
+    Object* int_proto;
+    Object* string_proto;
+    int32_t int_tag;
+    int32_t bool_tag;
+    int32_t string_tag;
+    // _cool_frame_table: the number of functions of the generated code, then
+    // their start, end and number of object slots. Null for none.
+    const int64_t* frame_table;
+};
+
+extern ProgramInfo program;
+
+//
+// Memory manager (gc.cpp): objects are bump allocated in a nursery private
+// to the thread; when it is full the live objects are copied to the old
+// generation, which is itself copied to a larger space when it is full. The
+// roots are the attributes of the old objects stored in since the last
+// collection, the object slots of the frames of the generated code (found
+// with the frame table it emits), the pointers held by the runtime (Root)
+// and the registers of the interpreter (add_root_range).
+//
+
+// the collector and the sizes of the heap, from the options of coolc (see
+// GCOptions): _cool_gc_config of the generated code, or set by coolc before
+// running the program. The fields left at 0 take the defaults of gc.cpp.
+enum : int64_t { NO_GC, GEN_GC, SCN_GC };
+
+struct GCConfig {
+    int64_t collector;
+    int64_t heap_init;          // bytes, the nursery and the old generation.
+    int64_t heap_max;           // bytes, 0 for no limit.
+    int64_t nursery_percent;    // of the heap.
+    int64_t stats;              // print the statistics of the collections at the end.
+};
+
+extern GCConfig gc_config;
+
+struct Nursery {
+    char* next;
+    char* limit;
+};
+
+extern thread_local Nursery nursery;
+
+// the memory of an object of `words` words (its header isn't initialized
+// but for the gc bits), after collecting if needed.
+void* allocate_slow(std::size_t words);
+
+inline void* allocate(std::size_t words) {
+    std::size_t bytes = words * word_size;
+    if (static_cast<std::size_t>(nursery.limit - nursery.next) >= bytes) {
+        Object* object = reinterpret_cast<Object*>(nursery.next);
+        nursery.next += bytes;
+        object->gc = 0;
+        return object;
+    }
+    return allocate_slow(words);
+}
+
+// the innermost frame of the generated code when the runtime is entered
+// from it: its frame pointer and the return address in it. The methods of
+// the runtime which allocate set it first.
+void set_top_frame(void* fp, void* ra);
+
+// keeps `*slot` alive and up to date while it is in scope.
+class Root {
+    public:
+        explicit Root(Object*& slot);
+        template<class T>
+        explicit Root(T*& slot): Root(reinterpret_cast<Object*&>(slot)) {}
+        ~Root();
+        Root(const Root&) = delete;
+        Root& operator=(const Root&) = delete;
+};
+
+// keeps the objects from `start` to `*end`, which moves, alive and up to
+// date.
+void add_root_range(Object** start, Object** const* end);
+
+// a copy of `self` in the heap.
+Object* copy(Object* self);
+
+// a new Int object holding `value`.
+Int* new_int(int32_t value);
+
+// end the program after printing `message`, with an error for fail.
+[[noreturn]] void finish(const char* message);
+[[noreturn]] void fail(const char* message);
+
+}
+
+// the methods of the basic classes, under the labels of the generated code.
+coolrt::Object* object_abort(coolrt::Object* self) __asm__("Object.abort");
+coolrt::Object* object_type_name(coolrt::Object* self) __asm__("Object.type_name");
+coolrt::Object* io_out_string(coolrt::Object* self, coolrt::String* s) __asm__("IO.out_string");
+coolrt::Object* io_out_int(coolrt::Object* self, coolrt::Int* i) __asm__("IO.out_int");
+coolrt::Object* string_length(coolrt::String* self) __asm__("String.length");
+
+extern "C" {
+// the methods which allocate, entered through stubs passing them the frame
+// pointer and the return address of the generated code calling them.
+coolrt::Object* cool_object_copy(coolrt::Object* self, void* fp, void* ra);
+coolrt::Object* cool_io_in_string(coolrt::Object* self, void* fp, void* ra);
+coolrt::Object* cool_io_in_int(coolrt::Object* self, void* fp, void* ra);
+coolrt::Object* cool_string_concat(coolrt::String* self, coolrt::String* s, void* fp, void* ra);
+coolrt::Object* cool_string_substr(coolrt::String* self, coolrt::Int* i, coolrt::Int* l, void* fp, void* ra);
+
+int equality_test(coolrt::Object* a, coolrt::Object* b);
+[[noreturn]] void _dispatch_abort(coolrt::String* filename, int line);
+[[noreturn]] void _case_abort(coolrt::Object* object);
+[[noreturn]] void _case_abort2(coolrt::String* filename, int line);
+// a division by zero, reported after the output written so far.
+[[noreturn]] void _divide_abort();
+
+// the lowest address the stack of the generated code may reach, set by
+// start.cpp: the prologue of every method compares rsp with it and calls
+// _stack_overflow below.
+extern char* _stack_limit;
+[[noreturn]] void _stack_overflow();
+
+// the write barrier: `object` (an old one) may now point to young objects.
+void _gc_remember(coolrt::Object* object);
+}
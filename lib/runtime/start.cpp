@@ -0,0 +1,65 @@
+//
+// Startup code of the native programs: create the Main object, run its
+// main method and report the end of the program, as __start does in
+// trap.handler.s. It is apart from the rest of the runtime so the runtime
+// can be linked with a program having its own main.
+//
+// As the C code (see capi.cpp), the program runs on a thread of its own,
+// whose stack is large enough for the deep recursions the other targets
+// allow. Its methods stop with "Stack overflow." when they would go past
+// _stack_limit, which leaves some room below for the runtime.
+//
+
+#include "runtime.hpp"
+#include <pthread.h>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace coolrt;
+
+// defined by the generated code.
+extern "C" {
+extern Object* class_nameTab[];
+extern Object Int_protObj;
+extern Object String_protObj;
+extern int64_t _int_tag;
+extern int64_t _bool_tag;
+extern int64_t _string_tag;
+extern const int64_t _cool_frame_table[];
+extern const GCConfig _cool_gc_config;
+extern Object Main_protObj;
+Object* Main_init(Object* self);
+}
+Object* main_main(Object* self) __asm__("Main.main");
+
+char* _stack_limit;
+
+namespace {
+
+constexpr std::size_t machine_stack = std::size_t{1} << 30;
+constexpr std::size_t stack_margin = 1 << 20;
+
+void* run_thread(void*) {
+    char top;
+    _stack_limit = reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(&top) - machine_stack + stack_margin);
+    Object* main_object = Main_init(copy(&Main_protObj));
+    main_main(main_object);
+    finish("COOL program successfully executed\n");
+}
+
+}
+
+int main() {
+    program = {class_nameTab, &Int_protObj, &String_protObj, static_cast<int32_t>(_int_tag),
+               static_cast<int32_t>(_bool_tag), static_cast<int32_t>(_string_tag), _cool_frame_table};
+    gc_config = _cool_gc_config;
+
+    pthread_attr_t attributes;
+    pthread_t thread;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, machine_stack);
+    if (pthread_create(&thread, &attributes, run_thread, nullptr))
+        fail("Can't create the thread of the program.\n");
+    pthread_join(thread, nullptr);
+    std::abort();
+}
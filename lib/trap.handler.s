@@ -268,6 +268,11 @@ ret:	lw $v0 s1
 
 #
 # Functions that return to the cool caller, should preserve $s0-$s7
+# and $fp.
+#
+# The methods get self in $a0 and their first three arguments in $a1-$a3,
+# the others on top of the stack (the fourth at 4($sp)) which they pop
+# before returning. A method allocates its own frame.
 #
 # $s7 is reserved as the limit pointer.
 # $gp is the heap pointer (points to the next unused word)
@@ -318,8 +323,30 @@ _GenGC_MAJORERROR:	.asciiz "GenGC: Error during major garbage collection.\n"
 _NoGC_COLLECT:		.asciiz "Increasing heap...\n"
 #_NoGC_COLLECT:		.asciiz ""
 
+#
+# Messages and counters of the memory manager
+#
+
+_MemMgr_HEAPMAXERROR:	.asciiz "GC: the heap can't grow past its maximum size.\n"
+_MemMgr_STATS1:		.asciiz "GC: "
+_MemMgr_STATS2:		.asciiz " collections ("
+_MemMgr_STATS3:		.asciiz " major), "
+_MemMgr_STATS4:		.asciiz " bytes copied, "
+_MemMgr_STATS5:		.asciiz " promoted\nGC: "
+_MemMgr_STATS6:		.asciiz " instructions in the pauses, "
+_MemMgr_STATS7:		.asciiz " at most, heap of "
+_MemMgr_STATS8:		.asciiz " bytes\n"
+
 	.align 2
 
+_MemMgr_NCOLLECT:	.word 0		# collections (expansions for NoGC)
+_MemMgr_NMAJOR:		.word 0		# major collections
+_MemMgr_COPIED:		.word 0		# bytes copied by the collections
+_MemMgr_PROMOTED:	.word 0		# bytes copied to the old area
+_MemMgr_PAUSE:		.word 0		# instructions run by the collections
+_MemMgr_MAXPAUSE:	.word 0		# by the longest one
+_MemMgr_START:		.word 0		# instructions before the current one
+
 #
 # Define some constants
 #
@@ -334,7 +361,6 @@ bool_slot=12
 str_size=12	# This is a pointer to an Int object!!!
 str_field=16	# The beginning of the ascii sequence
 str_maxsize=1026	# the maximum string length
-ar_base_size=12
 
 #
 # The REG mask tells the garbage collector which register(s) it
@@ -360,7 +386,22 @@ MemMgr_REG_MASK=0x007F0000
 __start:
 	li	$v0 9
 	move	$a0 $zero
-	syscall				# sbrk
+	syscall				# sbrk, the heap SPIM starts with
+	la	$t0 heap_start
+	subu	$t0 $v0 $t0		# its size
+	lw	$a0 _MemMgr_HEAPINIT	# the initial size, that one if not given
+	bnez	$a0 __start_max
+	move	$a0 $t0
+__start_max:
+	lw	$t1 _MemMgr_HEAPMAX	# but not past the maximum
+	beqz	$t1 __start_size
+	bleu	$a0 $t1 __start_size
+	move	$a0 $t1
+__start_size:
+	subu	$a0 $a0 $t0		# grow or shrink the heap to that size
+	beqz	$a0 __start_heap
+	jal	_MemMgr_Expand		# new end of heap in $v0
+__start_heap:
 	move	$a0 $sp			# initialize the garbage collector
 	li	$a1 MemMgr_REG_MASK
 	move	$a2 $v0
@@ -377,6 +418,7 @@ __start:
 	la	$a0 _term_msg		# show terminal message
 	li	$v0 4
 	syscall
+	jal	_MemMgr_Stats		# show the statistics of the collections
 	li $v0 10
 	syscall				# syscall 10 (exit)
 
@@ -657,17 +699,11 @@ Object.abort:
 
 	.globl	Object.type_name
 Object.type_name:
-	sw $ra 4($sp)
 	la	$t1 class_nameTab
 	lw	$v0 obj_tag($a0)	# Get object tag
 	sll	$v0 $v0 2	# *4
 	addu	$t1 $t1 $v0	# index table
 	lw	$a0 0($t1)	# Load class name string obj.
-	# restore the stack
-	lw $fp 12($sp)
-	lw $s0 8($sp)
-	lw $ra 4($sp)
-	addiu $sp $sp 12
 	jr	$ra
 
 #
@@ -675,23 +711,18 @@ Object.type_name:
 # IO.out_string
 #
 #	Prints out the contents of a string object argument
-#	which is on top of the stack.
+#	which is in $a1.
 #
 #	$a0 is preserved!
 #
 
 	.globl	IO.out_string
 IO.out_string:
-	addiu	$sp $sp -4
-	sw	$a0 4($sp)	# save self
-	lw	$a0 4($fp)	# get arg
-	addiu	$a0 $a0 str_field	# Adjust to beginning of str
+	move	$t0 $a0		# save self
+	addiu	$a0 $a1 str_field	# Adjust to beginning of str
 	li	$v0 4		# print_str
 	syscall
-	lw	$a0 16($sp)	# return self
-	lw $fp 20($sp)	
-	lw $s0 16($sp)	
-	addiu	$sp $sp 20	# pop argument
+	move	$a0 $t0		# return self
 	jr	$ra
 
 #.globl IO.out_string
@@ -732,16 +763,11 @@ IO.out_string:
 
     .globl IO.out_int
 IO.out_int:
-	addiu $sp, $sp, -4
-	sw $a0, 4($sp) # Save self
-    lw $a0, 4($fp)
-    lw $a0, 12($a0) #  12 is the INT_CONST_OFFSET
+	move $t0, $a0 # Save self
+    lw $a0, 12($a1) #  12 is the INT_CONST_OFFSET
     li $v0, 1
     syscall
-    lw $fp, 20($sp)
-    lw $s0, 16($sp)
-	lw $a0, 4($sp) # restore self
-    addiu $sp $sp 20
+	move $a0, $t0 # restore self
     jr $ra
 
 #
@@ -753,27 +779,22 @@ IO.out_int:
 
 	.globl	IO.in_int
 IO.in_int:
-	sw	$ra 4($sp)	# save return address
+	addiu	$sp $sp -8
+	sw	$ra 8($sp)	# save return address
 
     la      $a0 Int_protObj
     jal     _quick_copy	# Call copy
     jal     Int_init
 
-	addiu	$sp $sp -4
 	sw	$a0 4($sp)	# save new object
 
 	li	$v0, 5		# read int
 	syscall
 
 	lw	$a0 4($sp)
-
-
-	addiu	$sp $sp 4
 	sw	$v0 int_slot($a0)	# store int read into obj
-	lw $fp 12($sp)
-	lw $s0 8($sp)
-	lw	$ra 4($sp)
-	addiu	$sp $sp 12
+	lw	$ra 8($sp)
+	addiu	$sp $sp 8
 	jr	$ra
 
 #
@@ -788,8 +809,8 @@ IO.in_int:
 
 	.globl	IO.in_string
 IO.in_string:
-	sw	$ra 4($sp)			# save return address
-	addiu	$sp $sp -4
+	addiu	$sp $sp -8
+	sw	$ra 8($sp)			# save return address
 	sw	$0 4($sp)			# init GC area
 
 	jal	_MemMgr_Test			# test GC area
@@ -860,10 +881,8 @@ _instr_nonl:
 	srl	$t0 $t0 2			# divide by 4
 	sw	$t0 obj_size($a0)		# set size field of obj
 
-	lw $fp 16($sp)
-	lw $s0 12($sp)
 	lw	$ra 8($sp)			# restore return address
-	addiu	$sp $sp 16
+	addiu	$sp $sp 8
 	jr	$ra				# return
 
 #
@@ -878,8 +897,6 @@ _instr_nonl:
 	.globl	String.length
 String.length:
 	lw	$a0 str_size($a0)	# fetch attr
-	lw $fp,	ar_base_size($sp) # restore the $fp even though it does not change it. [due to how dispatch is designed.]
-	addiu $sp $sp ar_base_size
 	jr	$ra	# Return
 
 #
@@ -889,7 +906,7 @@ String.length:
 #   to the new object.
 #
 #	INPUT:	$a0: the first string object (self)
-#		Top of stack: the second string object (arg1)
+#		$a1: the second string object (arg1)
 #
 #	OUTPUT:	$a0 the new string object
 #
@@ -897,8 +914,9 @@ String.length:
 	.globl	String.concat
 String.concat:
 
-	sw	$ra 4($sp)			# save return address
-	addiu	$sp $sp -12
+	addiu	$sp $sp -20
+	sw	$ra 20($sp)			# save return address
+	sw	$a1 16($sp)			# save arg1
 	sw	$a0 12($sp)			# save self arg.
 	sw	$0 8($sp)			# init GC area
 	sw	$0 4($sp)			# init GC area
@@ -910,7 +928,7 @@ String.concat:
 	jal     _quick_copy			# Call copy
 	sw	$a0 8($sp)			# save new size object
 
-	lw	$t1 4($fp)			# load arg object
+	lw	$t1 16($sp)			# load arg object
 	lw	$t1 str_size($t1)		# get size object
 	lw	$t1 int_slot($t1)		# arg string size
 	blez	$t1 _strcat_argempty		# nothing to add
@@ -947,7 +965,7 @@ String.concat:
 	lw	$t0 int_slot($t0)		# self string size
 	addiu	$t1 $a0 str_field		# points to start of string data
 	addu	$t1 $t1 $t0			# points to end: '\0'
-	lw	$t0 4($fp)			# load arg object
+	lw	$t0 16($sp)			# load arg object
 	addiu	$t2 $t0 str_field		# points to start of arg data
 	lw	$t0 str_size($t0)		# get arg size
 	lw	$t0 int_slot($t0)
@@ -961,20 +979,14 @@ _strcat_copy:
 	bne	$t2 $t0 _strcat_copy		# check limit
 	sb	$0 0($t1)			# add '\0'
 
-	addiu $sp $sp 12
-	lw $fp 16($sp)
-	lw $s0 12($sp) 
-	lw	$ra 4($sp)			# restore return address
-	addiu	$sp $sp 16			# pop argument
+	lw	$ra 20($sp)			# restore return address
+	addiu	$sp $sp 20			# remove frame
 	jr	$ra				# return
 
 _strcat_argempty:
 	lw	$a0 12($sp)			# load original self
-	addiu $sp $sp 12
-	lw $fp 16($sp)
-	lw $s0 12($sp)
-	lw	$ra 4($sp)			# restore return address
-	addiu	$sp $sp 16			# pop argument
+	lw	$ra 20($sp)			# restore return address
+	addiu	$sp $sp 20			# remove frame
 	jr	$ra				# return
 
 #
@@ -984,23 +996,23 @@ _strcat_argempty:
 #		Offset starts at 0.
 #
 #	INPUT:	$a0 the string
-#		length int object on top of stack (-4)
-#		index int object below length on stack (-8)
+#		$a1 the index int object
+#		$a2 the length int object
 #	OUTPUT:	The substring object in $a0
 #
 
 	.globl	String.substr
 String.substr:
-	sw	$ra 4($sp)		# save return
-	addiu	$sp $sp -12		# frame
-	sw	$a0 12($sp)		# save self
-	sw $a1 8($sp) # save a1
+	addiu	$sp $sp -20		# frame
+	sw	$ra 20($sp)		# save return
+	sw	$a1 16($sp)		# save index
+	sw	$a2 12($sp)		# save length
+	sw	$a0 8($sp)		# save self
 	sw	$0 4($sp)		# init GC area
 
 	jal	_MemMgr_Test		# test GC area
 
-
-	addiu	$sp $sp 4
+	lw	$a0 8($sp)
 	lw	$v0 obj_size($a0)
     la      $a0 Int_protObj		# ask if enough room to allocate
 	lw	$a0 obj_size($a0)	#   a string object, an int object,
@@ -1014,16 +1026,15 @@ _ss_ok:
 	la	$a0 Int_protObj
 	jal	_quick_copy
 	jal	Int_init
-	sw	$a0 0($sp)	# save new length obj
-	addiu $sp $sp -4
+	sw	$a0 4($sp)	# save new length obj
 	la	$a0 String_protObj
 	jal	_quick_copy
 	jal	String_init	# new obj ptr in $a0
 	move	$a2 $a0		# use a2 to make copy
 	addiu	$gp $gp -4	# backup alloc ptr
-	lw	$a1 12($sp)	# load orig
-	lw	$t1 4($fp)	# index obj
-	lw	$t2 8($fp)	# length obj
+	lw	$a1 8($sp)	# load orig
+	lw	$t1 16($sp)	# index obj
+	lw	$t2 12($sp)	# length obj
 	lw	$t0 str_size($a1)
 	lw	$v1 int_slot($t1) # index
 	lw	$v0 int_slot($t0) # size of orig
@@ -1034,7 +1045,6 @@ _ss_ok:
 	bgt	$v1 $v0 _ss_abort3
 	bltz	$t3 _ss_abort4
 	lw	$t4 4($sp)	# load new length obj
-	addiu $sp $sp 4 # restore $sp since we got the object saved.
 	sw	$t3 int_slot($t4) # save new size
 	sw	$t4 str_size($a0) # store size in string
 	lw	$v1 int_slot($t1) # index
@@ -1060,11 +1070,8 @@ _ss_end:
 	srl	$t0 $t0 2	# div by 4
 	sw	$t0 obj_size($a0)
 
-	lw $fp 28($sp) # restore old frame pointer
-	lw $s0 24($sp) # restore self
-	lw	$ra 12($sp) # restore return address
-	lw $a1 4($sp) # restore a1
-	addiu	$sp $sp 28	# pop arguments
+	lw	$ra 20($sp)	# restore return address
+	addiu	$sp $sp 20	# remove frame
 	jr	$ra
 
 _ss_abort1:
@@ -1252,6 +1259,157 @@ _MemMgr_Test:
 _MemMgr_Test_end:
 	jr	$ra
 
+#
+# Expand the heap
+#
+#   Grows the heap by the requested amount, unless it would then be
+#   larger than _MemMgr_HEAPMAX (when not 0), which stops the program.
+#   A negative amount shrinks it.
+#
+#   INPUT:
+#	$a0: size of the expansion in bytes
+#	heap_start: start of the heap
+#
+#   OUTPUT:
+#	$v0: new end of the heap
+#
+#   Registers modified:
+#	$v0, $v1, $a0
+#
+
+	.globl _MemMgr_Expand
+_MemMgr_Expand:
+	addiu	$sp $sp -4
+	sw	$a0 4($sp)			# save size
+	lw	$v1 _MemMgr_HEAPMAX
+	beqz	$v1 _MemMgr_Expand_ok		# no maximum
+	li	$v0 9
+	move	$a0 $zero
+	syscall					# current end of heap
+	lw	$a0 4($sp)
+	addu	$v0 $v0 $a0			# end after the expansion
+	la	$a0 heap_start
+	subu	$v0 $v0 $a0			# size after the expansion
+	bgtu	$v0 $v1 _MemMgr_Expand_error
+_MemMgr_Expand_ok:
+	lw	$a0 4($sp)
+	li	$v0 9
+	syscall					# sbrk
+	li	$v0 9
+	move	$a0 $zero
+	syscall					# get new end of heap in $v0
+	addiu	$sp $sp 4
+	jr	$ra				# return
+_MemMgr_Expand_error:
+	la	$a0 _MemMgr_HEAPMAXERROR	# show error message
+	li	$v0 4
+	syscall
+	li	$v0 10				# exit
+	syscall
+
+#
+# Time a collection
+#
+#   When _MemMgr_STATS is set, _MemMgr_PauseStart and _MemMgr_PauseEnd
+#   bracket a collection, whose instructions are added to _MemMgr_PAUSE.
+#   They are read with the syscall 100 of coolsim, which spim lacks.
+#
+#   Registers modified:
+#	$v0, $v1
+#
+
+	.globl _MemMgr_PauseStart
+_MemMgr_PauseStart:
+	lw	$v1 _MemMgr_STATS
+	beqz	$v1 _MemMgr_PauseStart_done
+	li	$v0 100
+	syscall					# instructions executed
+	sw	$v0 _MemMgr_START
+_MemMgr_PauseStart_done:
+	jr	$ra				# return
+
+	.globl _MemMgr_PauseEnd
+_MemMgr_PauseEnd:
+	lw	$v1 _MemMgr_STATS
+	beqz	$v1 _MemMgr_PauseEnd_done
+	li	$v0 100
+	syscall					# instructions executed
+	lw	$v1 _MemMgr_START
+	subu	$v0 $v0 $v1			# length of the pause
+	lw	$v1 _MemMgr_PAUSE
+	addu	$v1 $v1 $v0
+	sw	$v1 _MemMgr_PAUSE
+	lw	$v1 _MemMgr_MAXPAUSE
+	bgeu	$v1 $v0 _MemMgr_PauseEnd_done
+	sw	$v0 _MemMgr_MAXPAUSE
+_MemMgr_PauseEnd_done:
+	jr	$ra				# return
+
+#
+# Statistics of the collections
+#
+#   Shows the counters of the memory manager when _MemMgr_STATS is set.
+#
+#   Registers modified:
+#	$a0, $v0
+#
+
+	.globl _MemMgr_Stats
+_MemMgr_Stats:
+	lw	$v0 _MemMgr_STATS
+	beqz	$v0 _MemMgr_Stats_done
+	la	$a0 _MemMgr_STATS1
+	li	$v0 4
+	syscall
+	lw	$a0 _MemMgr_NCOLLECT
+	li	$v0 1
+	syscall
+	la	$a0 _MemMgr_STATS2
+	li	$v0 4
+	syscall
+	lw	$a0 _MemMgr_NMAJOR
+	li	$v0 1
+	syscall
+	la	$a0 _MemMgr_STATS3
+	li	$v0 4
+	syscall
+	lw	$a0 _MemMgr_COPIED
+	li	$v0 1
+	syscall
+	la	$a0 _MemMgr_STATS4
+	li	$v0 4
+	syscall
+	lw	$a0 _MemMgr_PROMOTED
+	li	$v0 1
+	syscall
+	la	$a0 _MemMgr_STATS5
+	li	$v0 4
+	syscall
+	lw	$a0 _MemMgr_PAUSE
+	li	$v0 1
+	syscall
+	la	$a0 _MemMgr_STATS6
+	li	$v0 4
+	syscall
+	lw	$a0 _MemMgr_MAXPAUSE
+	li	$v0 1
+	syscall
+	la	$a0 _MemMgr_STATS7
+	li	$v0 4
+	syscall
+	li	$v0 9
+	move	$a0 $zero
+	syscall					# end of heap
+	la	$a0 heap_start
+	subu	$a0 $v0 $a0
+	li	$v0 1
+	syscall
+	la	$a0 _MemMgr_STATS8
+	li	$v0 4
+	syscall
+_MemMgr_Stats_done:
+	jr	$ra				# return
+
 #
 # GenGC Generational Garbage Collector
 #
@@ -1295,7 +1453,7 @@ _MemMgr_Test_end:
 #   The heap is expanded on two different occasions:
 #
 #     1) After a major collection, the old area is set to be at most
-#        1/(2^GenGC_OLDRATIO) of the usable heap (L0 to L3).  Note that
+#        (100-_MemMgr_NURSERY)% of the usable heap (L0 to L3).  Note that
 #        first L4 is checked to see if any of the unused memory between L3
 #        and L4 is enough to satisfy this requirement.  If not, then the
 #        heap will be expanded.  If it is, the appropriate amount will be
@@ -1453,13 +1611,14 @@ GenGC_HDRREG=40					# current REG mask
 GenGC_HEAPEXPGRAN=14				# 2^14=16K
 
 #
-# Old to usable heap size ratio
+# Share of the usable heap left to the new areas
 #
-#   After a major collection, the ratio of size of old area to the usable
-#   size of the heap is at most 1/(2^k) where k is the value provided.
+#   After a major collection, the size of the old area is at most
+#   (100-p)% of the usable size of the heap, where p is _MemMgr_NURSERY,
+#   or this default when it is 0.
 #
 
-GenGC_OLDRATIO=2				# 1/(2^2)=.25=25%
+GenGC_NURSERY=75				# the old area takes 25%
 
 #
 # Mask to speficy which registers can be automatically updated
@@ -1614,7 +1773,7 @@ _gc_abort:
 #   enough room to allocate the requested size, a major garbage
 #   collection then takes place by calling "_GenGC_MajorC".  After
 #   the major collection, the size of the old area is analyzed.  If
-#   it is greater than 1/(2^GenGC_OLDRATIO) of the total usable heap
+#   it is greater than (100-_MemMgr_NURSERY)% of the total usable heap
 #   size (L0 to L3), the heap is expanded.  Also, if there is still not
 #   enough room to allocate the requested size, the heap is expanded
 #   further to make sure that the specified amount of memory can be
@@ -1645,17 +1804,30 @@ _GenGC_Collect:
 	sw	$ra 12($sp)			# save return address
 	sw	$a0 8($sp)			# save stack end
 	sw	$a1 4($sp)			# save size
+	jal	_MemMgr_PauseStart
 	la	$a0 _GenGC_COLLECT		# print collection message
 	li	$v0 4
 	syscall
 	lw	$a0 8($sp)			# restore stack end
 	jal	_GenGC_MinorC			# minor collection
+	lw	$v0 _MemMgr_NCOLLECT		# count the collection
+	addiu	$v0 $v0 1
+	sw	$v0 _MemMgr_NCOLLECT
+	lw	$v0 _MemMgr_COPIED		# and what it promoted
+	addu	$v0 $v0 $a0
+	sw	$v0 _MemMgr_COPIED
+	lw	$v0 _MemMgr_PROMOTED
+	addu	$v0 $v0 $a0
+	sw	$v0 _MemMgr_PROMOTED
 	la	$a1 heap_start
 	lw	$t1 GenGC_HDRMINOR1($a1)
 	addu	$t1 $t1 $a0
 	srl	$t1 $t1 1
 	sw	$t1 GenGC_HDRMINOR1($a1)	# update histories
 	sw	$a0 GenGC_HDRMINOR0($a1)
+	lw	$t2 _MemMgr_COLLECTOR		# ScnGC: every collection is major
+	la	$t3 _ScnGC_Collect
+	beq	$t2 $t3 _GenGC_Collect_major
 	move	$t0 $t1				# set $t0 to max of minor
 	bgt	$t1 $a0 _GenGC_Collect_maxmaj
 	move	$t0 $a0
@@ -1700,20 +1872,34 @@ _GenGC_Collect_major:
 	syscall
 	lw	$a0 8($sp)			# restore stack end
 	jal	_GenGC_MajorC			# major collection
+	lw	$v0 _MemMgr_NMAJOR		# count the collection
+	addiu	$v0 $v0 1
+	sw	$v0 _MemMgr_NMAJOR
+	lw	$v0 _MemMgr_COPIED		# and what it copied
+	addu	$v0 $v0 $a0
+	sw	$v0 _MemMgr_COPIED
 	la	$a1 heap_start
 	lw	$t1 GenGC_HDRMAJOR1($a1)
 	addu	$t1 $t1 $a0
 	srl	$t1 $t1 1
 	sw	$t1 GenGC_HDRMAJOR1($a1)	# update histories
 	sw	$a0 GenGC_HDRMAJOR0($a1)
+	lw	$t2 _MemMgr_NURSERY		# share of the new areas
+	bnez	$t2 _GenGC_Collect_ratio
+	li	$t2 GenGC_NURSERY
+_GenGC_Collect_ratio:
+	li	$t4 100
+	sub	$t3 $t4 $t2			# percent of the old area
 	lw	$t1 GenGC_HDRL3($a1)		# find ratio of the old area
 	lw	$t0 GenGC_HDRL0($a1)
 	sub	$t1 $t1 $t0
-	srl	$t1 $t1 GenGC_OLDRATIO
+	divu	$t1 $t1 $t4
+	mul	$t1 $t1 $t3
 	addu	$t1 $t0 $t1
 	lw	$t0 GenGC_HDRL1($a1)
 	sub	$t0 $t0 $t1
-	sll	$t0 $t0 GenGC_OLDRATIO		# amount to expand in $t0
+	mul	$t0 $t0 $t4
+	div	$t0 $t0 $t3			# amount to expand in $t0
 	lw	$t1 GenGC_HDRL3($a1)		# load L3
 	lw	$t2 GenGC_HDRL1($a1)		# load L1
 	sub	$t2 $t1 $t2
@@ -1748,12 +1934,8 @@ _GenGC_Collect_xfermem:
 	sw	$s7 GenGC_HDRL3($a1)		# save L3
 	b	_GenGC_Collect_findL2
 _GenGC_Collect_getmem:
-	li	$v0 9				# sbrk
 	move	$a0 $t2				# set the size to expand the heap
-	syscall
-	li	$v0 9
-	move	$a0 $zero
-	syscall					# get new end of heap in $v0
+	jal	_MemMgr_Expand			# get new end of heap in $v0
 	sw	$v0 GenGC_HDRL4($a1)		# save L4
 	sw	$v0 GenGC_HDRL3($a1)		# save L3
 	move	$s7 $v0				# set $s7
@@ -1777,6 +1959,7 @@ _GenGC_Clear_loop:
 	addiu	$t0 $t0 4
 	blt	$t0 $s7 _GenGC_Clear_loop
 
+	jal	_MemMgr_PauseEnd
 	lw	$a1 4($sp)			# restore size
 	lw	$ra 12($sp)			# restore return address
 	addiu	$sp $sp 12
@@ -2169,11 +2352,13 @@ _GenGC_OfsCopy_old:
 	addiu	$v0 $v0 -1
 	nor	$v0 $v0 $v0			# get grain mask
 	and	$a0 $a0 $v0			# align to grain size
-	li	$v0 9
-	syscall					# expand heap
-	li	$v0 9
-	move	$a0 $0
-	syscall					# get end of heap in $v0
+	addiu	$sp $sp -8
+	sw	$ra 8($sp)			# save return address
+	sw	$v1 4($sp)			# save L2 pointer
+	jal	_MemMgr_Expand			# expand heap, end of heap in $v0
+	lw	$v1 4($sp)			# restore L2 pointer
+	lw	$ra 8($sp)			# restore return address
+	addiu	$sp $sp 8
 	move	$s7 $v0				# save heap end in $s7
 	move	$a0 $t0				# restore pointer to old object in $a0
 _GenGC_OfsCopy_memok:
@@ -2523,28 +2708,49 @@ _NoGC_Init:
 #	$a1: size will need to allocate in bytes (unchanged)
 #
 #   Registers modified:
-#	$t0, $a0, $v0, $gp, $s7
+#	$t0, $a0, $v0, $v1, $gp, $s7
 #
 
 	.globl _NoGC_Collect
 _NoGC_Collect:
+	addiu	$sp $sp -4
+	sw	$ra 4($sp)			# save return address
+	jal	_MemMgr_PauseStart
 	la	$a0 _NoGC_COLLECT		# show collection message
 	li	$v0 4
 	syscall
+	lw	$v0 _MemMgr_NCOLLECT		# count the expansion
+	addiu	$v0 $v0 1
+	sw	$v0 _MemMgr_NCOLLECT
 _NoGC_Collect_loop:
 	add	$t0 $gp $a1			# test allocation
 	blt	$t0 $s7 _NoGC_Collect_ok	# stop if enough
-	li	$v0 9				# expand heap
 	li	$a0 NoGC_EXPANDSIZE		# set the size to expand the heap
-	syscall					# sbrk
-	li	$v0 9				# get heap end
-	move	$a0 $zero
-	syscall					# sbrk
+	jal	_MemMgr_Expand			# expand heap
 	move	$s7 $v0				# set limit pointer
 	b	_NoGC_Collect_loop		# loop
 _NoGC_Collect_ok:
+	jal	_MemMgr_PauseEnd
+	lw	$ra 4($sp)			# restore return address
+	addiu	$sp $sp 4
 	jr	$ra				# return
 
+#
+# ScnGC Garbage Collector
+#
+#   The Stop & Copy collector is gone (see revision 2.0): ScnGC is GenGC
+#   doing a major collection every time, which copies all the live objects
+#   (see _GenGC_Collect).
+#
+
+	.globl _ScnGC_Init
+_ScnGC_Init:
+	j	_GenGC_Init
+
+	.globl _ScnGC_Collect
+_ScnGC_Collect:
+	j	_GenGC_Collect
+
 
 ########################################################
 # Helper functions for code generation added by        #
@@ -2554,7 +2760,7 @@ _NoGC_Collect_ok:
     .globl less 
 less:   
     lw $t1, 12($a0) # 12 is the offset where attributes start
-    lw $t2, 12($s1)
+    lw $t2, 12($a1)
     blt $t2, $t1, __less    # the args here are switched since a1=lhs, a0=rhs 
     la $a0 bool_const0
     jr $ra
@@ -2565,7 +2771,7 @@ __less:
 	.globl less_eq
 less_eq:   
     lw $t1, 12($a0) # 12 is the offset where attributes start
-    lw $t2, 12($s1)
+    lw $t2, 12($a1)
     ble $t2, $t1, __less    # the args here are switched since a1=lhs, a0=rhs 
     la $a0 bool_const0
     jr $ra
@@ -2576,20 +2782,49 @@ __less_eq:
 
     .globl eq
 eq:
-    beq $a0, $s1, __eq 
+    beq $a0, $a1, __eq
+    beqz $a0, __not_eq
+    beqz $a1, __not_eq
     lw $t1, 0($a0)      # Object header tag
+    lw $t2, 0($a1)
+    bne $t1, $t2, __not_eq
     lw $t2, _int_tag
     beq $t1, $t2, __int_bool_eq
     lw $t2, _bool_tag
     beq $t1, $t2, __int_bool_eq
+    lw $t2, _string_tag
+    bne $t1, $t2, __not_eq  # other objects are only equal to themselves
 __str_eq:
-    lw $t1, 16($a0)     # 16 is the offset where the actual sequence of ascii chars starts
-    lw $t2, 16($s1)
-    beq $t1, $t2, __eq
+    lw $t1, 12($a0)     # the lengths (Int objects) first
+    lw $t2, 12($a1)
+    lw $t1, 12($t1)
+    lw $t2, 12($t2)
+    bne $t1, $t2, __not_eq
+    addiu $sp, $sp, -12
+    sw $t3, 4($sp)
+    sw $t4, 8($sp)
+    sw $t5, 12($sp)
+    addiu $t3, $a0, 16  # 16 is the offset where the actual sequence of ascii chars starts
+    addiu $t4, $a1, 16
+__str_eq_loop:
+    beqz $t1, __str_eq_done
+    lbu $t2, 0($t3)
+    lbu $t5, 0($t4)
+    bne $t2, $t5, __str_eq_done
+    addiu $t3, $t3, 1
+    addiu $t4, $t4, 1
+    addiu $t1, $t1, -1
+    b __str_eq_loop
+__str_eq_done:          # t1 is 0 iff every char matched
+    lw $t3, 4($sp)
+    lw $t4, 8($sp)
+    lw $t5, 12($sp)
+    addiu $sp, $sp, 12
+    beqz $t1, __eq
     b __not_eq
 __int_bool_eq:
     lw $t1, 12($a0)
-    lw $t2, 12($s1)
+    lw $t2, 12($a1)
     beq $t1, $t2, __eq
     b __not_eq
 __eq:
@@ -2612,8 +2847,7 @@ __false:
 
     .globl isvoid
 isvoid:
-    la $t1, bool_const0
-    beq $a0, $t1, __isovoid
+    beqz $a0, __isovoid
     la $a0, bool_const0
     jr $ra
 __isovoid:
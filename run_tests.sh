@@ -35,4 +35,78 @@ do
         fi
     fi
 done
-echo "********* $n_test tests in total. ************* "
\ No newline at end of file
+echo "********* $n_test tests in total. ************* "
+
+# every example is then run by coolsim, and by the other targets whose
+# output must be the same: the interpreter (--run), the JIT (--jit) and the
+# executables built from the x86-64 and the C code. examples/<name>.in is
+# the standard input of examples/<name>.cl (or examples/<name>), when there
+# is one.
+root=`pwd`
+out_dir=`mktemp -d`
+n_run=0
+n_failed=0
+for f in $(ls ./examples)
+do
+    name=${f%.cl}
+    if [[ -d "$root/examples/$f" ]]
+    then
+        args=""
+        for f1 in $(ls "$root/examples/$f")
+        do
+            args="$root/examples/$f/$f1 "$args
+        done
+    elif [[ $f == *.cl ]]
+    then
+        args="$root/examples/$f"
+    else
+        continue
+    fi
+    input=/dev/null
+    if [[ -f "$root/examples/$name.in" ]]
+    then
+        input="$root/examples/$name.in"
+    fi
+    echo "==== Running $name on every target ===="
+    mkdir -p "$out_dir/$name/mips" "$out_dir/$name/x86_64" "$out_dir/$name/c"
+    # a heap large enough for coolsim never to print that it grows.
+    cd "$out_dir/$name/mips"
+    $root/build/coolc --heap-init=64M $args > /dev/null &&
+        timeout 120 $root/build/coolsim *.s < $input > ../mips.txt
+    if [ $? -ne 0 ]
+    then
+        echo "******** failed to run $name with coolsim. ********"
+        ((n_failed++))
+        cd "$root"
+        continue
+    fi
+    cd "$out_dir/$name"
+    timeout 120 $root/build/coolc --run $args < $input > run.txt
+    timeout 120 $root/build/coolc --jit $args < $input > jit.txt
+    cd "$out_dir/$name/x86_64"
+    $root/build/coolc --target=x86_64 $args > /dev/null &&
+        g++ *.s $root/build/libcoolrt.a -lpthread -o program &&
+        timeout 120 ./program < $input > ../x86_64.txt
+    cd "$out_dir/$name/c"
+    $root/build/coolc --target=c $args > /dev/null &&
+        cc -I$root/lib/runtime *.c $root/build/libcoolrt.a -lstdc++ -lpthread -o program &&
+        timeout 120 ./program < $input > ../c.txt
+    cd "$out_dir/$name"
+    for target in run jit x86_64 c
+    do
+        if ! cmp -s mips.txt $target.txt
+        then
+            echo "******** the output of $name with $target differs from the MIPS one. ********"
+            diff mips.txt $target.txt | head -10
+            ((n_failed++))
+        fi
+    done
+    ((n_run++))
+    cd "$root"
+done
+rm -r "$out_dir"
+echo "********* $n_run examples run, $n_failed failures. ************* "
+if [ $n_failed -ne 0 ]
+then
+    exit 1
+fi
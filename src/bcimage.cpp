@@ -0,0 +1,127 @@
+#include "bcimage.hpp"
+#include "runtime.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace cool {
+
+using coolrt::Object;
+using coolrt::Int;
+using coolrt::String;
+
+BCImage::BCImage(const BCProgram& program_): program(program_) {
+    slots.resize(program.functions.size());
+    dispatch_tables.assign(program.classes.size(), nullptr);
+    for (std::size_t tag = 0; tag < program.classes.size(); tag++) {
+        auto& methods = program.classes[tag].methods;
+        if (program.classes[tag].name.empty())
+            continue;
+        void** table = reinterpret_cast<void**>(allocate_static(methods.size() + 1));
+        for (std::size_t i = 0; i < methods.size(); i++) {
+            if (methods[i] >= 0)
+                slots[methods[i]].push_back(&table[i]);
+        }
+        dispatch_tables[tag] = table;
+    }
+
+    for (auto& constant: program.constants)
+        constants.push_back(make_constant(constant));
+    for (int value = 0; value < 2; value++)
+        bools[value] = make_constant({BCConstant::Kind::Bool, value, ""});
+
+    protos.assign(program.classes.size(), nullptr);
+    for (std::size_t tag = 0; tag < program.classes.size(); tag++) {
+        const BCClass& class_ = program.classes[tag];
+        if (class_.name.empty())
+            continue;
+        Object* proto = make_object(tag, class_.size);
+        Object** fields = reinterpret_cast<Object**>(proto) + coolrt::header_words;
+        for (std::size_t i = 0; i < class_.attributes.size(); i++)
+            fields[i] = class_.attributes[i] < 0 ? nullptr : constants[class_.attributes[i]];
+        protos[tag] = proto;
+    }
+    class_names.assign(program.class_names.size(), nullptr);
+    for (std::size_t tag = 0; tag < program.class_names.size(); tag++) {
+        if (program.class_names[tag] >= 0)
+            class_names[tag] = constants[program.class_names[tag]];
+    }
+    if (program.filename >= 0)
+        filename = constants[program.filename];
+
+    int int_tag = tag_of("Int"), string_tag = tag_of("String");
+    coolrt::program = {class_names.data(), protos[int_tag], protos[string_tag], int_tag, tag_of("Bool"), string_tag, nullptr};
+}
+
+void BCImage::set_entry(std::size_t function, void* entry) {
+    for (void** slot: slots[function])
+        *slot = entry;
+}
+
+int64_t* BCImage::allocate_static(std::size_t words) {
+    storage.emplace_back(new int64_t[words]());
+    return storage.back().get();
+}
+
+Object* BCImage::make_object(int tag, std::size_t words) {
+    Object* object = reinterpret_cast<Object*>(allocate_static(words));
+    object->tag = tag;
+    object->gc = 0;
+    object->size = words;
+    object->disp = dispatch_tables[tag];
+    return object;
+}
+
+Object* BCImage::make_constant(const BCConstant& constant) {
+    if (constant.kind != BCConstant::Kind::String) {
+        Object* object = make_object(tag_of(constant.kind == BCConstant::Kind::Int ? "Int" : "Bool"), coolrt::header_words + 1);
+        static_cast<Int*>(object)->val = constant.value;
+        return object;
+    }
+    // the characters are padded with zeros up to the length.
+    const std::string& text = constant.text;
+    std::size_t size = std::max(text.size(), static_cast<std::size_t>(constant.value));
+    Object* length = make_constant({BCConstant::Kind::Int, constant.value, ""});
+    String* s = static_cast<String*>(make_object(tag_of("String"), coolrt::header_words + 1 + size / coolrt::word_size + 1));
+    s->length = static_cast<Int*>(length);
+    std::memcpy(s->chars, text.c_str(), text.size() + 1);
+    return s;
+}
+
+Object* BCImage::call_native(BCNative native, Object** args) {
+    switch (native) {
+        case BCNative::ObjectAbort:
+            return object_abort(args[0]);
+        case BCNative::ObjectTypeName:
+            return object_type_name(args[0]);
+        case BCNative::ObjectCopy:
+            return cool_object_copy(args[0], nullptr, nullptr);
+        case BCNative::IOOutString:
+            return io_out_string(args[0], static_cast<String*>(args[1]));
+        case BCNative::IOOutInt:
+            return io_out_int(args[0], static_cast<Int*>(args[1]));
+        case BCNative::IOInString:
+            return cool_io_in_string(args[0], nullptr, nullptr);
+        case BCNative::IOInInt:
+            return cool_io_in_int(args[0], nullptr, nullptr);
+        case BCNative::StringLength:
+            return string_length(static_cast<String*>(args[0]));
+        case BCNative::StringConcat:
+            return cool_string_concat(static_cast<String*>(args[0]), static_cast<String*>(args[1]), nullptr, nullptr);
+        case BCNative::StringSubstr:
+            return cool_string_substr(static_cast<String*>(args[0]), static_cast<Int*>(args[1]),
+                                      static_cast<Int*>(args[2]), nullptr, nullptr);
+        case BCNative::None:
+            break;
+    }
+    return nullptr;
+}
+
+int BCImage::tag_of(const std::string& name) const {
+    for (std::size_t tag = 0; tag < program.classes.size(); tag++) {
+        if (program.classes[tag].name == name)
+            return tag;
+    }
+    return -1;
+}
+
+}
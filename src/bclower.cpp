@@ -0,0 +1,488 @@
+#include "cgen.hpp"
+#include "emit.hpp"
+#include <algorithm>
+
+// Bytecode generation from the IR (--run), for the interpreter of vm.cpp.
+// Every value gets a register of the file of its type, the parameters
+// being the first object registers, except the constants folded into the
+// instructions using them (boxed constants, additions and subtractions of a
+// constant). Phis get their values from moves at the end of
+// their predecessors, the critical edges being split beforehand, and the
+// calls whose result is only returned become tail calls, as with the x86-64
+// code. The superinstructions replace:
+//   - Box(Add(Unbox a, Unbox b)) and Box(Add(Unbox a, constant)) in a block,
+//     the Add and the Unboxes used nowhere else (AddBoxed, AddIBoxed),
+//   - the dispatches on self and the attributes of self,
+//   - a compare only used by the branch right after it.
+// The classes, their prototypes and dispatch tables are described by tag
+// and the constants they use put in a pool, for the interpreter to build the
+// objects with the layout of the native code.
+
+namespace cool {
+
+static void bc_emit(BCFunction& out, BCOp op, std::initializer_list<uint32_t> operands) {
+    out.code.push_back(static_cast<uint32_t>(op));
+    out.code.insert(out.code.end(), operands.begin(), operands.end());
+}
+
+static bool is_self(IRInstr* value) {
+    return value->op == IROp::Param && value->value == 0;
+}
+
+void Cgen::bc_compile() {
+    // the methods of the basic classes first, then the IR functions so the
+    // calls can refer to any of them.
+    struct Native {
+        const char* name;
+        BCNative native;
+        std::size_t nparams;
+    };
+    const Native natives[] = {
+        {"Object.abort", BCNative::ObjectAbort, 1}, {"Object.type_name", BCNative::ObjectTypeName, 1},
+        {"Object.copy", BCNative::ObjectCopy, 1}, {"IO.out_string", BCNative::IOOutString, 2},
+        {"IO.out_int", BCNative::IOOutInt, 2}, {"IO.in_string", BCNative::IOInString, 1},
+        {"IO.in_int", BCNative::IOInInt, 1}, {"String.length", BCNative::StringLength, 1},
+        {"String.concat", BCNative::StringConcat, 2}, {"String.substr", BCNative::StringSubstr, 3},
+    };
+    for (auto& native: natives) {
+        BCFunction function;
+        function.name = native.name;
+        function.native = native.native;
+        function.nparams = native.nparams;
+        bc_functions[function.name] = bc_program.functions.size();
+        bc_program.functions.push_back(function);
+    }
+    for (auto& function: ir_module.functions) {
+        BCFunction code;
+        code.name = function->name;
+        code.nparams = function->nparams;
+        bc_functions[function->name] = bc_program.functions.size();
+        bc_program.functions.push_back(code);
+    }
+
+    int max_tag = 0;
+    for (auto& class_: classtag_map)
+        max_tag = std::max(max_tag, class_.second);
+    bc_program.classes.resize(max_tag + 1);
+    bc_program.class_names.assign(max_tag + 1, -1);
+    for (auto& entry: classtag_map) {
+        Class* class_ = class_table_ptr->get(entry.first);
+        BCClass& bc_class = bc_program.classes[entry.second];
+        bc_class.name = entry.first;
+        bc_class.size = DEFAULT_OBJFIELDS + calc_obj_size(class_);
+        for (auto& word: proto_attrs[entry.first])
+            bc_class.attributes.push_back(bc_word(word));
+
+        // the methods of the dispatch table, from the closest class defining
+        // them.
+        auto& methods = method_table[entry.first];
+        bc_class.methods.assign(methods.size(), -1);
+        for (auto& method: methods) {
+            for (Class* c = class_; ; c = class_table_ptr->get(c->superClass.lexeme)) {
+                auto defines = std::find_if(c->features.begin(), c->features.end(), [&](auto& f) {
+                    return f->featuretype == FeatureType::METHOD && f->id.lexeme == method.first;
+                });
+                if (defines != c->features.end()) {
+                    auto found = bc_functions.find(c->name.lexeme + METHOD_SEP + method.first);
+                    if (found != bc_functions.end())
+                        bc_class.methods[method.second] = found->second;
+                    break;
+                }
+                if (c->superClass == No_class)
+                    break;
+            }
+        }
+        bc_program.class_names[entry.second] = bc_string(entry.first);
+    }
+    for (auto& elt: stringtable().get_elements()) {
+        if (std::string(STRCONST_PREFIX) + std::to_string(stringtable().get_index(elt.first)) == FILENAME)
+            bc_program.filename = bc_string(elt.first);
+    }
+
+    // create Main, run its _init and main.
+    BCFunction start;
+    start.name = "__start";
+    start.nparams = 0;
+    start.nobjects = 2;
+    int main_tag = classtag_map["Main"];
+    bc_emit(start, BCOp::New, {0, static_cast<uint32_t>(main_tag)});
+    auto init = bc_functions.find(std::string("Main") + CLASSINIT_SUFFIX);
+    if (init != bc_functions.end())
+        bc_emit(start, BCOp::Call, {0, static_cast<uint32_t>(init->second), 1, 0});
+    int main_method = bc_program.classes[main_tag].methods[method_table["Main"]["main"]];
+    bc_emit(start, BCOp::Call, {1, static_cast<uint32_t>(main_method), 1, 0});
+    bc_emit(start, BCOp::Halt, {});
+    bc_program.start = bc_program.functions.size();
+    bc_program.functions.push_back(start);
+
+    for (auto& function: ir_module.functions)
+        bc_function(*function, bc_program.functions[bc_functions[function->name]]);
+}
+
+int Cgen::bc_int(int value) {
+    auto found = bc_ints.find(value);
+    if (found != bc_ints.end())
+        return found->second;
+    bc_program.constants.push_back({BCConstant::Kind::Int, value, ""});
+    return bc_ints[value] = bc_program.constants.size() - 1;
+}
+
+int Cgen::bc_bool(bool value) {
+    if (bc_bools[value] < 0) {
+        bc_program.constants.push_back({BCConstant::Kind::Bool, value, ""});
+        bc_bools[value] = bc_program.constants.size() - 1;
+    }
+    return bc_bools[value];
+}
+
+int Cgen::bc_string(const std::string& text) {
+    auto found = bc_strings.find(text);
+    if (found != bc_strings.end())
+        return found->second;
+    std::string chars = unescape(text);
+    bc_program.constants.push_back({BCConstant::Kind::String, static_cast<int>(chars.size()), chars});
+    return bc_strings[text] = bc_program.constants.size() - 1;
+}
+
+int Cgen::bc_word(const std::string& word) {
+    if (word == BOOLCONST_TRUE || word == BOOLCONST_FALSE)
+        return bc_bool(word == BOOLCONST_TRUE);
+    auto constant_of = [&word](TokenTable& table, const char* prefix) -> const std::string* {
+        if (word.rfind(prefix, 0) != 0)
+            return nullptr;
+        int index = std::stoi(word.substr(std::string(prefix).size()));
+        for (auto& elt: table.get_elements()) {
+            if (table.get_index(elt.first) == index)
+                return &elt.first;
+        }
+        return nullptr;
+    };
+    if (auto value = constant_of(inttable(), INTCONST_PREFIX))
+        return bc_int(std::stoi(*value));
+    if (auto text = constant_of(stringtable(), STRCONST_PREFIX))
+        return bc_string(*text);
+    return -1;
+}
+
+uint32_t Cgen::bc_reg(IRInstr* value) {
+    auto found = bc_regs.find(value);
+    if (found != bc_regs.end())
+        return found->second;
+    uint32_t reg = value->type == IRType::Obj ? bc_objects++ : bc_raws++;
+    bc_regs[value] = reg;
+    return reg;
+}
+
+void Cgen::bc_function(IRFunction& function, BCFunction& out) {
+    split_critical_edges(function);
+    verify_or_die(function, "after splitting the critical edges");
+
+    std::unordered_map<IRInstr*, std::size_t> uses;
+    for (auto& block: function.blocks) {
+        for (auto& instr: block->instrs) {
+            for (IRInstr* operand: instr->operands)
+                uses[operand]++;
+        }
+    }
+
+    bc_regs.clear();
+    bc_blocks.clear();
+    bc_patches.clear();
+    bc_skipped.clear();
+    ir_fused.clear();
+    ir_tail_calls.clear();
+    bc_objects = function.nparams;
+    bc_raws = 0;
+    std::unordered_set<IRInstr*> kept_consts;
+    for (auto& block: function.blocks) {
+        for (std::size_t i = 0; i < block->instrs.size(); i++) {
+            IRInstr* instr = block->instrs[i].get();
+            if (instr->op == IROp::Param)
+                bc_regs[instr] = instr->value;
+            if (ir_is_tail_call(instr))
+                ir_tail_calls.insert(instr);
+
+            // the constants boxed, added or subtracted are operands of the
+            // instruction.
+            for (std::size_t j = 0; j < instr->operands.size(); j++) {
+                IRInstr* operand = instr->operands[j];
+                bool folded = instr->op == IROp::Box ||
+                              ((instr->op == IROp::Add || instr->op == IROp::Sub) && j == 1 && instr->operands[0] != operand);
+                if (operand->op == IROp::Const && !folded)
+                    kept_consts.insert(operand);
+            }
+
+            bool compare = instr->op == IROp::Lt || instr->op == IROp::Le || instr->op == IROp::Eq || instr->op == IROp::Not;
+            if (compare && i + 2 == block->instrs.size() && block->terminator()->op == IROp::Branch &&
+                uses[instr] == 1 && block->terminator()->operands[0] == instr)
+                ir_fused.insert(instr);
+
+            if (instr->op == IROp::Box && instr->operands[0]->op == IROp::Add) {
+                IRInstr* add = instr->operands[0];
+                auto unboxed = [&](IRInstr* value) {
+                    return value->op == IROp::Unbox && value->block == block.get() && uses[value] == 1;
+                };
+                if (add->block == block.get() && uses[add] == 1 && unboxed(add->operands[0]) &&
+                    (unboxed(add->operands[1]) || add->operands[1]->op == IROp::Const)) {
+                    bc_skipped.insert(add);
+                    bc_skipped.insert(add->operands[0]);
+                    if (add->operands[1]->op == IROp::Unbox)
+                        bc_skipped.insert(add->operands[1]);
+                }
+            }
+        }
+    }
+    for (auto& block: function.blocks) {
+        for (auto& instr: block->instrs) {
+            if (instr->op == IROp::Const && !kept_consts.count(instr.get()))
+                bc_skipped.insert(instr.get());
+        }
+    }
+
+    for (std::size_t i = 0; i < function.blocks.size(); i++) {
+        IRBlock* block = function.blocks[i].get();
+        IRBlock* next = i + 1 < function.blocks.size() ? function.blocks[i + 1].get() : nullptr;
+        bc_blocks[block] = out.code.size();
+        for (auto& instr: block->instrs) {
+            if (bc_skipped.count(instr.get()) || ir_fused.count(instr.get()))
+                continue;
+            bc_instr(instr.get(), next, out);
+            // the rest of the block is the return of the result.
+            if (ir_tail_calls.count(instr.get()))
+                break;
+        }
+    }
+    for (auto& patch: bc_patches)
+        out.code[patch.first] = bc_blocks[patch.second];
+    out.nobjects = bc_objects;
+    out.nraws = bc_raws;
+}
+
+void Cgen::bc_instr(IRInstr* instr, IRBlock* next, BCFunction& out) {
+    auto& ops = instr->operands;
+    auto reg = [this](IRInstr* value) { return bc_reg(value); };
+
+    switch (instr->op) {
+        case IROp::Param:
+        case IROp::Phi:
+            break;
+        case IROp::Const:
+            bc_emit(out, BCOp::LoadI, {reg(instr), static_cast<uint32_t>(instr->value)});
+            break;
+        case IROp::String:
+            bc_emit(out, BCOp::LoadK, {reg(instr), static_cast<uint32_t>(bc_string(instr->name))});
+            break;
+        case IROp::Void:
+            bc_emit(out, BCOp::LoadVoid, {reg(instr)});
+            break;
+
+        case IROp::Add:
+        case IROp::Sub:
+            if (ops[1]->op == IROp::Const && ops[0] != ops[1]) {
+                uint32_t constant = static_cast<uint32_t>(ops[1]->value);
+                if (instr->op == IROp::Sub)
+                    constant = 0u - constant;
+                bc_emit(out, BCOp::AddI, {reg(instr), reg(ops[0]), constant});
+                break;
+            }
+            bc_emit(out, instr->op == IROp::Add ? BCOp::Add : BCOp::Sub, {reg(instr), reg(ops[0]), reg(ops[1])});
+            break;
+        case IROp::Mul:
+        case IROp::Div:
+        case IROp::Lt:
+        case IROp::Le:
+        case IROp::Eq: {
+            BCOp op = instr->op == IROp::Mul ? BCOp::Mul : instr->op == IROp::Div ? BCOp::Div :
+                      instr->op == IROp::Lt ? BCOp::Lt : instr->op == IROp::Le ? BCOp::Le : BCOp::Eq;
+            bc_emit(out, op, {reg(instr), reg(ops[0]), reg(ops[1])});
+            break;
+        }
+        case IROp::Neg:
+            bc_emit(out, BCOp::Neg, {reg(instr), reg(ops[0])});
+            break;
+        case IROp::Not:
+            bc_emit(out, BCOp::Not, {reg(instr), reg(ops[0])});
+            break;
+
+        case IROp::Box: {
+            IRInstr* raw = ops[0];
+            if (raw->op == IROp::Const) {
+                int constant = raw->type == IRType::Bool ? bc_bool(raw->value) : bc_int(raw->value);
+                bc_emit(out, BCOp::LoadK, {reg(instr), static_cast<uint32_t>(constant)});
+            } else if (bc_skipped.count(raw)) {
+                IRInstr* left = raw->operands[0]->operands[0];
+                IRInstr* right = raw->operands[1];
+                if (right->op == IROp::Const)
+                    bc_emit(out, BCOp::AddIBoxed, {reg(instr), reg(left), static_cast<uint32_t>(right->value)});
+                else
+                    bc_emit(out, BCOp::AddBoxed, {reg(instr), reg(left), reg(right->operands[0])});
+                bc_superinstructions++;
+            } else {
+                bc_emit(out, raw->type == IRType::Bool ? BCOp::BoxBool : BCOp::BoxInt, {reg(instr), reg(raw)});
+            }
+            break;
+        }
+        case IROp::Unbox:
+            bc_emit(out, BCOp::Unbox, {reg(instr), reg(ops[0])});
+            break;
+        case IROp::ObjEq:
+            bc_emit(out, BCOp::ObjEq, {reg(instr), reg(ops[0]), reg(ops[1])});
+            break;
+        case IROp::IsVoid:
+            bc_emit(out, BCOp::IsVoid, {reg(instr), reg(ops[0])});
+            break;
+
+        case IROp::New: {
+            bc_emit(out, BCOp::New, {reg(instr), static_cast<uint32_t>(classtag_map[instr->class_name])});
+            auto init = bc_functions.find(instr->class_name + CLASSINIT_SUFFIX);
+            if (init != bc_functions.end())
+                bc_emit(out, BCOp::Call, {reg(instr), static_cast<uint32_t>(init->second), 1, reg(instr)});
+            break;
+        }
+        case IROp::GetAttr: {
+            uint32_t index = attr_table[instr->class_name][instr->name] + 2;
+            if (is_self(ops[0])) {
+                bc_emit(out, BCOp::GetAttrSelf, {reg(instr), index});
+                bc_superinstructions++;
+            } else {
+                bc_emit(out, BCOp::GetAttr, {reg(instr), reg(ops[0]), index});
+            }
+            break;
+        }
+        case IROp::SetAttr: {
+            uint32_t index = attr_table[instr->class_name][instr->name] + 2;
+            if (is_self(ops[0])) {
+                bc_emit(out, BCOp::SetAttrSelf, {index, reg(ops[1])});
+                bc_superinstructions++;
+            } else {
+                bc_emit(out, BCOp::SetAttr, {reg(ops[0]), index, reg(ops[1])});
+            }
+            break;
+        }
+        case IROp::Dispatch:
+        case IROp::Call:
+            bc_call(instr, out);
+            break;
+        case IROp::CheckDispatch:
+        case IROp::CheckCase:
+            bc_emit(out, instr->op == IROp::CheckDispatch ? BCOp::CheckDispatch : BCOp::CheckCase,
+                    {reg(ops[0]), static_cast<uint32_t>(instr->value)});
+            break;
+
+        case IROp::Jump:
+            bc_phi_moves(instr->block, instr->targets[0], out);
+            if (instr->targets[0] != next) {
+                bc_emit(out, BCOp::Jump, {0});
+                bc_patches.push_back({out.code.size() - 1, instr->targets[0]});
+            }
+            break;
+        case IROp::Branch:
+            bc_branch(instr, out);
+            break;
+        case IROp::TypeCase: {
+            std::vector<CaseInterval> intervals;
+            for (auto& interval: case_intervals(instr->class_name, instr->cases)) {
+                if (interval.branch >= 0)
+                    intervals.push_back(interval);
+            }
+            bc_emit(out, BCOp::TypeCase, {reg(ops[0]), static_cast<uint32_t>(intervals.size())});
+            for (auto& interval: intervals) {
+                out.code.push_back(interval.lo);
+                out.code.push_back(interval.hi);
+                out.code.push_back(0);
+                bc_patches.push_back({out.code.size() - 1, instr->targets[interval.branch]});
+            }
+            break;
+        }
+        case IROp::Return:
+            bc_emit(out, BCOp::Return, {reg(ops[0])});
+            break;
+    }
+}
+
+void Cgen::bc_call(IRInstr* instr, BCFunction& out) {
+    auto& ops = instr->operands;
+    bool tail = ir_tail_calls.count(instr);
+    std::vector<uint32_t> words;
+    if (instr->op == IROp::Call) {
+        uint32_t function = bc_functions.at(instr->class_name + METHOD_SEP + instr->name);
+        if (tail)
+            words = {static_cast<uint32_t>(BCOp::TailCall), function};
+        else
+            words = {static_cast<uint32_t>(BCOp::Call), bc_reg(instr), function};
+        words.push_back(ops.size());
+        for (IRInstr* operand: ops)
+            words.push_back(bc_reg(operand));
+    } else {
+        uint32_t slot = method_table[instr->class_name][instr->name];
+        std::size_t first = 0;
+        if (tail) {
+            words = {static_cast<uint32_t>(BCOp::TailDispatch), slot};
+        } else if (is_self(ops[0])) {
+            words = {static_cast<uint32_t>(BCOp::DispatchSelf), bc_reg(instr), slot};
+            first = 1;
+            bc_superinstructions++;
+        } else {
+            words = {static_cast<uint32_t>(BCOp::Dispatch), bc_reg(instr), slot};
+        }
+        words.push_back(ops.size() - first);
+        for (std::size_t i = first; i < ops.size(); i++)
+            words.push_back(bc_reg(ops[i]));
+    }
+    out.code.insert(out.code.end(), words.begin(), words.end());
+}
+
+void Cgen::bc_branch(IRInstr* instr, BCFunction& out) {
+    IRInstr* cond = instr->operands[0];
+    IRBlock* if_true = instr->targets[0];
+    IRBlock* if_false = instr->targets[1];
+    if (ir_fused.count(cond) && cond->op == IROp::Not) {
+        std::swap(if_true, if_false);
+        cond = cond->operands[0];
+    }
+
+    if (ir_fused.count(cond)) {
+        BCOp op = cond->op == IROp::Lt ? BCOp::BranchLt : cond->op == IROp::Le ? BCOp::BranchLe : BCOp::BranchEq;
+        bc_emit(out, op, {bc_reg(cond->operands[0]), bc_reg(cond->operands[1]), 0, 0});
+        bc_superinstructions++;
+    } else {
+        bc_emit(out, BCOp::Branch, {bc_reg(cond), 0, 0});
+    }
+    bc_patches.push_back({out.code.size() - 2, if_true});
+    bc_patches.push_back({out.code.size() - 1, if_false});
+}
+
+void Cgen::bc_phi_moves(IRBlock* from, IRBlock* to, BCFunction& out) {
+    std::size_t index = std::find(to->preds.begin(), to->preds.end(), from) - to->preds.begin();
+    std::vector<std::pair<IRInstr*, IRInstr*>> moves;
+    bool overlap = false;
+    for (auto& instr: to->instrs) {
+        if (instr->op != IROp::Phi)
+            break;
+        IRInstr* source = instr->operands[index];
+        if (source == instr.get())
+            continue;
+        moves.push_back({instr.get(), source});
+        overlap = overlap || (source->op == IROp::Phi && source->block == to);
+    }
+
+    auto move = [&](uint32_t dest, uint32_t source, IRType type) {
+        bc_emit(out, type == IRType::Obj ? BCOp::MovO : BCOp::MovR, {dest, source});
+    };
+    // when a phi takes the value of another, all the values are read into
+    // registers of their own before any is written.
+    if (overlap) {
+        std::vector<uint32_t> temps;
+        for (auto& m: moves) {
+            temps.push_back(m.first->type == IRType::Obj ? bc_objects++ : bc_raws++);
+            move(temps.back(), bc_reg(m.second), m.first->type);
+        }
+        for (std::size_t i = 0; i < moves.size(); i++)
+            move(bc_reg(moves[i].first), temps[i], moves[i].first->type);
+        return;
+    }
+    for (auto& m: moves)
+        move(bc_reg(m.first), bc_reg(m.second), m.first->type);
+}
+
+}
@@ -0,0 +1,62 @@
+#include "bytecode.hpp"
+
+namespace cool {
+
+static const char* op_names[] = {
+#define BC_NAME(name, operands) #name,
+    BC_OPCODES(BC_NAME)
+#undef BC_NAME
+};
+
+static const int op_operands[] = {
+#define BC_OPERANDS(name, operands) operands,
+    BC_OPCODES(BC_OPERANDS)
+#undef BC_OPERANDS
+};
+
+const char* bc_op_name(BCOp op) {
+    return op_names[static_cast<uint32_t>(op)];
+}
+
+std::size_t bc_length(const uint32_t* code) {
+    BCOp op = static_cast<BCOp>(code[0]);
+    switch (op) {
+        case BCOp::Call:
+        case BCOp::Dispatch:
+        case BCOp::DispatchSelf:
+            return 4 + code[3];
+        case BCOp::TailCall:
+        case BCOp::TailDispatch:
+            return 3 + code[2];
+        case BCOp::TypeCase:
+            return 3 + 3 * code[2];
+        default:
+            return 1 + op_operands[code[0]];
+    }
+}
+
+std::size_t BCProgram::code_words() {
+    std::size_t words = 0;
+    for (auto& function: functions)
+        words += function.code.size();
+    return words;
+}
+
+void print_bytecode(std::ostream& os, const BCProgram& program) {
+    for (auto& function: program.functions) {
+        if (function.native != BCNative::None)
+            continue;
+        os << "function " << function.name << "(" << function.nparams << ") objects "
+           << function.nobjects << " raws " << function.nraws << " {\n";
+        for (std::size_t pc = 0; pc < function.code.size(); pc += bc_length(&function.code[pc])) {
+            const uint32_t* code = &function.code[pc];
+            os << "  " << pc << "\t" << bc_op_name(static_cast<BCOp>(code[0]));
+            for (std::size_t i = 1; i < bc_length(code); i++)
+                os << (i == 1 ? " " : ", ") << static_cast<int32_t>(code[i]);
+            os << "\n";
+        }
+        os << "}\n\n";
+    }
+}
+
+}
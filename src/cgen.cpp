@@ -2,7 +2,11 @@
 
 #include "cgen.hpp"
 #include "emit.hpp"
+#include "assignednames.hpp"
+#include "bodysize.hpp"
 #include <algorithm>
+#include <cstdint>
+#include <functional>
 
 
 namespace cool {
@@ -43,6 +47,10 @@ void Cgen::emit_mul(const char* dest, const char* src1, const char* src2) {
     os << MUL << dest << ", $" << src1 << ", $" << src2 << std::endl;
 }
 
+void Cgen::emit_sll(const char* dest, const char* src1, int imm) {
+    os << SLL << dest << ", $" << src1 << ", " << imm << std::endl;
+}
+
 void Cgen::emit_sub(const char* dest, const char* src1, const char* src2) {
     os << SUB << dest << ", $" << src1 << ", $" << src2 << std::endl;
 }
@@ -105,11 +113,11 @@ void Cgen::emit_sge(const char* dest, const char* src1, int imm) {
 }
 
 void Cgen::emit_sgt(const char* dest, const char* src1, const char* src2) {
-    os << SGE << dest << ", $" << src1 << ", $" << src2 << std::endl;
+    os << SGT << dest << ", $" << src1 << ", $" << src2 << std::endl;
 }
 
 void Cgen::emit_sgt(const char* dest, const char* src1, int imm) {
-    os << SGE << dest << ", $" << src1 << ", " << imm << std::endl;
+    os << SGT << dest << ", $" << src1 << ", " << imm << std::endl;
 }
 
 void Cgen::emit_sle(const char* dest, const char* src1, const char* src2) {
@@ -132,14 +140,30 @@ void Cgen::emit_b(const std::string& label) {
     os << B << label << std::endl;
 }
 
+void Cgen::emit_bgt(const char* src1, const char* src2, const std::string& label) {
+    os << BGT << src1 << ", $" << src2 << ", " << label << std::endl;
+}
+
 void Cgen::emit_bgt(const char* src1, int imm, const std::string& label) {
     os << BGT << src1 << ", " << imm << ", " << label << std::endl;
 }
 
+void Cgen::emit_blt(const char* src1, const char* src2, const std::string& label) {
+    os << BLT << src1 << ", $" << src2 << ", " << label << std::endl;
+}
+
 void Cgen::emit_blt(const char* src1, int imm, const std::string& label) {
     os << BLT << src1 << ", " << imm << ", " << label << std::endl;
 }
 
+void Cgen::emit_ble(const char* src1, const char* src2, const std::string& label) {
+    os << BLEQ << src1 << ", $" << src2 << ", " << label << std::endl;
+}
+
+void Cgen::emit_ble(const char* src1, int imm, const std::string& label) {
+    os << BLEQ << src1 << ", " << imm << ", " << label << std::endl;
+}
+
 
 void Cgen::emit_beq(const char* src1, const char* src2, const std::string& label) {
     os << BEQ << src1 << ", $" << src2 << ", " << label << std::endl;
@@ -214,6 +238,12 @@ void Cgen::emit_move(const char* dest, const char* src) {
 
 void Cgen::emit_push(int num_words) {
     emit_addiu(SP, SP, WORD_SIZE * -num_words);
+    // a stale pointer left in a slot not written yet would be taken for a
+    // root by the collector.
+    if (mips_gc()) {
+        for (int i = 1; i <= num_words; i++)
+            emit_sw(ZERO, WORD_SIZE * i, SP);
+    }
 }
 
 void Cgen::emit_pop(int num_words) {
@@ -306,6 +336,18 @@ void Cgen::print_string_literal (const std::string& s) {
         this->os << "\"" << std::endl;
 }
 
+const char* Cgen::word_directive() {
+    return target == Target::X86_64 ? QUAD : WORD;
+}
+
+const char* Cgen::align_directive() {
+    return target == Target::X86_64 ? X86_ALIGN : ALIGN;
+}
+
+int Cgen::word_bytes() {
+    return target == Target::X86_64 ? X86_WORD_SIZE : WORD_SIZE;
+}
+
 void Cgen::code_constants() {
     //
     // Add constants that are required by the code generator
@@ -333,70 +375,95 @@ void Cgen::code_constants() {
     };
 
     for (auto& elt: stringtable().get_elements()) {
-        
+        if (!reachability.uses_string(elt.first))
+            continue;
+
         int idx = stringtable().get_index(elt.first);
         int string_obj_size = elt.first.size() % 4 == 0 ? elt.first.size() / 4 : elt.first.size() / 4 + 1;
+        if (target == Target::X86_64)
+            string_obj_size = elt.first.size() / X86_WORD_SIZE + 1;    // with the '\0'.
         os << STRCONST_PREFIX << idx << LABEL;                                                // label
-        os << WORD << STRING_CLASS_TAG << std::endl;                                            // tag 
-        os << WORD << (DEFAULT_OBJFIELDS + STRING_SLOTS + string_obj_size) << std::endl;   // size
-        os << WORD << "String" << DISPTAB_SUFFIX << std::endl;
-        os << WORD << INTCONST_PREFIX << inttable().get_index(std::to_string(elt.first.size())) << std::endl;
+        os << word_directive() << STRING_CLASS_TAG << std::endl;                                            // tag 
+        os << word_directive() << (DEFAULT_OBJFIELDS + STRING_SLOTS + string_obj_size) << std::endl;   // size
+        os << word_directive() << "String" << DISPTAB_SUFFIX << std::endl;
+        os << word_directive() << INTCONST_PREFIX << inttable().get_index(std::to_string(unescape(elt.first).size())) << std::endl;
         if (contains_unrecognized_char(elt.first))
             print_string_literal(elt.first);
         else
             os << ASCII << "\"" << elt.first.c_str() << "\"\n";
         os << BYTE << 0 << std::endl;
-        os << ALIGN;
-        os << WORD << -1 << std::endl;
+        os << align_directive();
+        os << word_directive() << -1 << std::endl;
 
     }
 
     for (auto& elt: inttable().get_elements()) {
+        if (!reachability.uses_int(std::stoi(elt.first)))
+            continue;
 
         int idx = inttable().get_index(elt.first);
         os << INTCONST_PREFIX << idx << LABEL;                                                // label
-        os << WORD << INT_CLASS_TAG << std::endl;
-        os << WORD << (DEFAULT_OBJFIELDS + INT_SLOTS) << std::endl;
-        os << WORD << "Int" << DISPTAB_SUFFIX << std::endl;
-        os << WORD << elt.first.c_str() << std::endl;
-        os << WORD << -1 << std::endl;
+        os << word_directive() << INT_CLASS_TAG << std::endl;
+        os << word_directive() << (DEFAULT_OBJFIELDS + INT_SLOTS) << std::endl;
+        os << word_directive() << "Int" << DISPTAB_SUFFIX << std::endl;
+        os << word_directive() << elt.first.c_str() << std::endl;
+        os << word_directive() << -1 << std::endl;
 
     }
 
     // code gen for bools
     os << BOOLCONST_FALSE << LABEL; // false
-    os << WORD << BOOL_CLASS_TAG << std::endl;
-    os << WORD << (DEFAULT_OBJFIELDS + BOOL_SLOTS) << std::endl; 
-    os << WORD << "Bool" << DISPTAB_SUFFIX << std::endl;
-    os << WORD << "0" << std::endl;
+    os << word_directive() << BOOL_CLASS_TAG << std::endl;
+    os << word_directive() << (DEFAULT_OBJFIELDS + BOOL_SLOTS) << std::endl; 
+    os << word_directive() << "Bool" << DISPTAB_SUFFIX << std::endl;
+    os << word_directive() << "0" << std::endl;
 
     os << BOOLCONST_TRUE << LABEL; // true
-    os << WORD << BOOL_CLASS_TAG << std::endl;
-    os << WORD << (DEFAULT_OBJFIELDS + BOOL_SLOTS) << std::endl; 
-    os << WORD << "Bool" << DISPTAB_SUFFIX << std::endl;
-    os << WORD << "1" << std::endl;
+    os << word_directive() << BOOL_CLASS_TAG << std::endl;
+    os << word_directive() << (DEFAULT_OBJFIELDS + BOOL_SLOTS) << std::endl; 
+    os << word_directive() << "Bool" << DISPTAB_SUFFIX << std::endl;
+    os << word_directive() << "1" << std::endl;
 
 }
 
 void Cgen::construct_classtag_map() {
 
-    int classtag = 8;    // to avoid clash with basic class values
-    classtag_map.insert({Object.lexeme, OBJECT_CLASS_TAG});
-    for (auto& class_: g->DFS(Object)) {
+    // classes are tagged in DFS preorder so a class and its descendants get
+    // the range of tags [tag, tag + size of its subtree - 1]. Bool, Int and
+    // String come right after Object with fixed tags, which is fine since
+    // they can't be inherited.
+    std::map<Token, std::vector<Token>> children;
+    for (auto& edge: g->get_graph())
+        children[edge.second].push_back(edge.first);
 
-        if (classtag_map.find(class_.lexeme) != classtag_map.end()) 
-            continue;
-        if (class_ == Str)
-            classtag_map.insert({class_.lexeme, STRING_CLASS_TAG});
+    int classtag = 8;    // to avoid clash with basic class values
+    std::function<int(const Token&)> tag_subtree = [&](const Token& class_) -> int {
+        int tag;
+        if (class_ == Object)
+            tag = OBJECT_CLASS_TAG;
+        else if (class_ == Str)
+            tag = STRING_CLASS_TAG;
         else if (class_ == Int)
-            classtag_map.insert({class_.lexeme, INT_CLASS_TAG});
+            tag = INT_CLASS_TAG;
         else if (class_ == Bool)
-            classtag_map.insert({class_.lexeme, BOOL_CLASS_TAG});
-        else {
-            classtag_map.insert({class_.lexeme, classtag});
-            classtag++;
+            tag = BOOL_CLASS_TAG;
+        else
+            tag = classtag++;
+        classtag_map[class_.lexeme] = tag;
+
+        int max_tag = tag;
+        for (auto& child: children[class_]) {
+            if (child == Str || child == Int || child == Bool)
+                max_tag = std::max(max_tag, tag_subtree(child));
         }
-    }
+        for (auto& child: children[class_]) {
+            if (child != Str && child != Int && child != Bool)
+                max_tag = std::max(max_tag, tag_subtree(child));
+        }
+        class_tag_ranges[class_.lexeme] = {tag, max_tag};
+        return max_tag;
+    };
+    tag_subtree(Object);
 }
 
 void Cgen::class_name_table() {
@@ -411,10 +478,14 @@ void Cgen::class_name_table() {
         }
     );
     os << CLASSNAMETAB << LABEL;
-    os << SPACE << 4 * 4 << std::endl; // since the first class (Object) Index start at 4 add a padding of 16 bytes 
+    os << SPACE << 4 * word_bytes() << std::endl; // since the first class (Object) Index start at 4 add a padding of 4 words 
     for (auto& v: class_tag_pairs) {
+        if (!reachability.is_instantiated(v.first)) {
+            os << word_directive() << 0 << std::endl;   // no object has this tag.
+            continue;
+        }
         int idx = stringtable().get_index(v.first); // we sure to get an index since classes are added previously
-        os << WORD << STRCONST_PREFIX << idx << std::endl;
+        os << word_directive() << STRCONST_PREFIX << idx << std::endl;
     }
 }
 
@@ -427,6 +498,12 @@ void Cgen::code_dispatch_table(Class* class_) {
 
     Class* curr_class = class_;
 
+    // the offsets are needed for every class but only the objects of
+    // instantiated classes point to a dispatch table.
+    bool emitted = reachability.is_instantiated(class_->name.lexeme);
+    if (emitted)
+        os << class_->name.lexeme << DISPTAB_SUFFIX << LABEL;
+
     // go up the inheritance tree and for each class, push it to the stack
     // (so class Object will be on the top of the stack after this loop) and
     // all the method names in mnames.
@@ -459,7 +536,13 @@ void Cgen::code_dispatch_table(Class* class_) {
         for (auto& m: curr_class->features) {
             if (mnames.find(m->id) != mnames.end()) {
                 method_table[class_->name.lexeme][m->id.lexeme] = dispoffset++;
-                os << WORD << mnames[m->id].lexeme << METHOD_SEP << m->id.lexeme << std::endl;
+                const std::string& impl = mnames[m->id].lexeme;
+                if (emitted) {
+                    if (is_base_class(class_table_ptr->get(impl)) || reachability.is_reachable(cha.get_method(impl, m->id.lexeme)))
+                        os << word_directive() << impl << METHOD_SEP << m->id.lexeme << std::endl;
+                    else
+                        os << word_directive() << 0 << std::endl;   // never called, keep the slot.
+                }
                 mnames.erase(m->id);
             }
         }
@@ -499,17 +582,57 @@ void Cgen::emit_obj_attributes(Class* class_) {
     }
 
     int current_attribut_offset = 0;
-
+    bool emitted = reachability.is_instantiated(class_->name.lexeme);
+
+    // the attributes start with the default value of their type. The
+    // constant initializers run before any other code of the _init are
+    // stored in the prototype as well: code run earlier could tell.
+    auto& words = proto_attrs[class_->name.lexeme];
+    words.clear();
+    bool constant = true;
     while (!classes.empty()) {
         curr_class = classes.top();
 
         for (auto& f: curr_class->features)
             if (f->featuretype == FeatureType::ATTRIBUT) {
-                os << WORD << "0" << std::endl;
+                std::string word = default_word(f->type_);
+                if (f->expr && constant && typeId.identify(f->expr.get()) == Type::Literal) {
+                    word = literal_word(static_cast<Literal*>(f->expr.get()));
+                    baked_attrs.insert(f.get());
+                } else if (f->expr)
+                    constant = false;
+                if (emitted)
+                    os << word_directive() << word << std::endl;
+                words.push_back(word);
                 attr_table[class_->name.lexeme][f->id.lexeme] = ++current_attribut_offset;
             }
         classes.pop();
     }
+    if (constant)
+        noop_inits.insert(class_->name.lexeme);
+}
+
+std::string Cgen::default_word(const Token& type) {
+    if (type == Int)
+        return std::string(INTCONST_PREFIX) + std::to_string(inttable().get_index("0"));
+    if (type == Str)
+        return std::string(STRCONST_PREFIX) + std::to_string(stringtable().get_index(""));
+    if (type == Bool)
+        return BOOLCONST_FALSE;
+    return "0";
+}
+
+std::string Cgen::literal_word(Literal* expr) {
+    switch (expr->object.type()) {
+        case CoolType::Bool_t:
+            return expr->object.bool_value() ? BOOLCONST_TRUE : BOOLCONST_FALSE;
+        case CoolType::Number_t:
+            return std::string(INTCONST_PREFIX) + std::to_string(inttable().get_index(std::to_string(expr->object.int_value())));
+        case CoolType::String_t:
+            return std::string(STRCONST_PREFIX) + std::to_string(stringtable().get_index(expr->object.string_value()));
+        default:
+            return "0";
+    }
 }
 
 
@@ -518,17 +641,20 @@ void Cgen::code_prototype_objects() {
 
     for (auto& class_: classtag_map) {
 
-        os << class_.first << PROTOBJ_SUFFIX << LABEL;
-        os << WORD << class_.second << std::endl;
-        os << WORD << (DEFAULT_OBJFIELDS + calc_obj_size(class_table_ptr->get(class_.first))) << std::endl;
-        os << WORD << class_.first << DISPTAB_SUFFIX << std::endl;
+        if (reachability.is_instantiated(class_.first)) {
+            os << class_.first << PROTOBJ_SUFFIX << LABEL;
+            os << word_directive() << class_.second << std::endl;
+            os << word_directive() << (DEFAULT_OBJFIELDS + calc_obj_size(class_table_ptr->get(class_.first))) << std::endl;
+            os << word_directive() << class_.first << DISPTAB_SUFFIX << std::endl;
+        }
+        // the attribute offsets are needed by the methods of every class.
         emit_obj_attributes(class_table_ptr->get(class_.first));
     }
 }
 
 void Cgen::code_global_data() {
 
-    os << ".data\n" << ALIGN;
+    os << ".data\n" << align_directive();
 
     // The following global names should be defined first.
     os << GLOBAL << CLASSNAMETAB << std::endl;
@@ -545,18 +671,17 @@ void Cgen::code_global_data() {
     // during code generation.
 
     os << INTTAG << LABEL
-       << WORD << INT_CLASS_TAG << std::endl;
+       << word_directive() << INT_CLASS_TAG << std::endl;
     os << BOOLTAG << LABEL
-       << WORD << BOOL_CLASS_TAG << std::endl;
+       << word_directive() << BOOL_CLASS_TAG << std::endl;
     os << STRINGTAG << LABEL
-       << WORD << STRING_CLASS_TAG << std::endl;
+       << word_directive() << STRING_CLASS_TAG << std::endl;
 
-    if (CGEN_DEBUG) code_select_gc();
+    if (target == Target::MIPS || target == Target::X86_64)
+        code_select_gc();
 }
 
 void Cgen::code_global_text() {
-    os << GLOBAL << HEAP_START << std::endl;
-    os << HEAP_START << LABEL << WORD << 0 << std::endl;
     os << "\t.text" << std::endl;
 
     os << GLOBAL; emit_init_ref(MAINNAME); os << std::endl;
@@ -566,18 +691,46 @@ void Cgen::code_global_text() {
     os << GLOBAL << MAINNAME << METHOD_SEP << "main" << std::endl;
 }
 
+void Cgen::code_heap_start() {
+    os << "\t.data" << std::endl;
+    os << case_tables.str();
+    os << GLOBAL << HEAP_START << std::endl;
+    os << HEAP_START << LABEL << word_directive() << 0 << std::endl;
+}
+
 void Cgen::code_select_gc() {
-    
+    int collector = static_cast<int>(gc.collector);
+
+    // the native runtime reads its settings from _cool_gc_config (see
+    // coolrt::GCConfig).
+    if (target == Target::X86_64) {
+        os << GLOBAL << X86_GC_CONFIG << std::endl;
+        os << X86_GC_CONFIG << LABEL;
+        for (std::size_t word: {static_cast<std::size_t>(collector), gc.heap_init, gc.heap_max,
+                                static_cast<std::size_t>(gc.nursery_percent), static_cast<std::size_t>(gc.stats)})
+            os << word_directive() << word << std::endl;
+        return;
+    }
+
     // Generate GC choice constants (pointers to GC functions)
     os << GLOBAL << "_MemMgr_INITIALIZER" << std::endl;
     os << "_MemMgr_INITIALIZER:" << std::endl;
-    os << WORD <<  gc_init_names[cgen_Memmgr]  << std::endl;
+    os << word_directive() <<  gc_init_names[collector]  << std::endl;
     os << GLOBAL << "_MemMgr_COLLECTOR" << std::endl;
     os << "_MemMgr_COLLECTOR:" << std::endl;
-    os << WORD <<  gc_collect_names[cgen_Memmgr]  << std::endl;
+    os << word_directive() <<  gc_collect_names[collector]  << std::endl;
     os << GLOBAL << "_MemMgr_TEST" << std::endl;
     os << "_MemMgr_TEST:" << std::endl;
-    os << WORD <<  (cgen_Memmgr_Test == GC_TEST)  << std::endl;
+    os << word_directive() <<  gc.test  << std::endl;
+
+    // the settings of the heap, 0 taking the default of trap.handler.s.
+    std::pair<const char*, std::size_t> settings[] = {
+        {"_MemMgr_HEAPINIT", gc.heap_init}, {"_MemMgr_HEAPMAX", gc.heap_max},
+        {"_MemMgr_NURSERY", gc.nursery_percent}, {"_MemMgr_STATS", gc.stats}};
+    for (auto& setting: settings) {
+        os << GLOBAL << setting.first << std::endl;
+        os << setting.first << LABEL << word_directive() << setting.second << std::endl;
+    }
 }
 
 void Cgen::cgen_init_formal(Token& formal_type) {
@@ -592,32 +745,128 @@ void Cgen::cgen_init_formal(Token& formal_type) {
         emit_move(ACC, ZERO);
 }
 
+void Cgen::cgen_bind_local(Formal* formal, std::size_t offset) {
+    const char* reg = inside_function ? regalloc.get_register(formal) : nullptr;
+    if (reg)
+        emit_move(reg, ACC);
+    else
+        emit_sw(ACC, offset * WORD_SIZE, FP);
+    var_env.insert(formal->id.lexeme, {offset, reg});
+}
+
+std::size_t Cgen::frame_locals(Feature* method) {
+    return localsizer.getFuncLocalSize(method) + inliner.get_inline_slots(method) + escape.get_stack_words(method);
+}
+
+void Cgen::cgen_dispatch_check(Expr* expr) {
+    // nothing to check when the receiver is proven non-void.
+    if (nullness.is_non_void_receiver(expr))
+        return;
+    emit_bne(ACC, ZERO, "DispatchLabel" + std::to_string(dispatch_count));
+    emit_la(ACC, FILENAME);
+    emit_li(T1, 1);
+    emit_jal("_dispatch_abort");
+    emit_label("DispatchLabel" + std::to_string(dispatch_count));
+    dispatch_count++;
+}
+
+void Cgen::cgen_inline(Expr* site_expr, Expr* receiver, std::vector<std::unique_ptr<Expr>>& args, const Inliner::InlineSite* site) {
+
+    emit_comment("inlined " + site->class_->name.lexeme + METHOD_SEP + site->method->id.lexeme);
+
+    // same evaluation order as a call: the arguments then the receiver.
+    for (auto& arg: args) {
+        arg->accept(this);
+        emit_push(ACC);
+    }
+    receiver->accept(this);
+
+    cgen_dispatch_check(site_expr);
+
+    // the formals go to the slots reserved after the locals of the caller.
+    std::size_t slot = AR_BASE_SIZE + localsizer.getFuncLocalSize(curr_method);
+    auto caller_env = var_env;
+    var_env = SymbolTable<std::string, VarLocation>{};
+    var_env.enterScope();
+    for (std::size_t i = 0; i < args.size(); i++) {
+        emit_lw(T1, (args.size() - i) * WORD_SIZE, SP);
+        emit_sw(T1, (slot + i) * WORD_SIZE, FP);
+        var_env.insert(site->method->formals[i]->id.lexeme, {slot + i, nullptr});
+    }
+    if (!args.empty())
+        emit_pop(args.size());
+
+    // the body sees the receiver as self and the attributes of its class.
+    emit_push(SELF);
+    emit_move(SELF, ACC);
+    Class* caller_class = curr_class;
+    curr_class = site->class_;
+    inlining = true;
+
+    site->method->expr->accept(this);
+
+    inlining = false;
+    curr_class = caller_class;
+    var_env = caller_env;
+    emit_pop(SELF);
+}
+
 // Cgen for Exprs and Stmts
 void Cgen::visitProgramStmt(Program* stmt) {
 #ifdef DEBUG_PRINT_CODE
     std::cout << "debut code generation\n\n";
 #endif
 
+    // the C is generated from the tables the data of the assembly is
+    // emitted with, and not the data itself.
+    std::streambuf* assembly = target == Target::C ? os.rdbuf(nullptr) : nullptr;
+
     code_global_data();
 
     construct_classtag_map();
 
+    localsizer.computeSize(stmt);
+
+    resolver.resolve(stmt);
+
+    inliner.run(stmt);
+
+    nullness.run(stmt);
+
+    reachability.run(stmt);
+
+    escape.run(stmt);
+
     code_constants();
 
     class_name_table();
 
-    localsizer.computeSize(stmt);
+    for(auto& p: g->get_graph())
+        code_dispatch_table(class_table_ptr->get(p.first.lexeme));
 
-    for(auto& p: g->get_graph()) {
-        auto class_ = class_table_ptr->get(p.first.lexeme);
-        os << class_->name.lexeme << DISPTAB_SUFFIX << LABEL;
-        code_dispatch_table(class_);
+    code_prototype_objects();
+
+    if (ir_mode)
+        build_ir(stmt);
+
+    if (target == Target::Bytecode) {
+        bc_compile();
+        return;
     }
 
-    code_prototype_objects();
+    if (target == Target::C) {
+        os.rdbuf(assembly);
+        c_code_text();
+        return;
+    }
 
     code_global_text(); 
 
+    if (target == Target::X86_64) {
+        x86_code_text(stmt);
+        return;
+    }
+
     // Codegen the basic classes first.
     std::vector<std::string> basic_classes = 
             {"Object", "IO", "String", "Int", "Bool"};
@@ -631,6 +880,8 @@ void Cgen::visitProgramStmt(Program* stmt) {
         curr_class = class_.get();
         class_->accept(this);
     }
+
+    code_heap_start();
 #ifdef DEBUG_PRINT_CODE
     std::cout << "fin code generation\n\n";
 #endif
@@ -640,16 +891,53 @@ void Cgen::visitProgramStmt(Program* stmt) {
 void Cgen::visitClassStmt(Class* stmt) {
 
     // as each class node is traversed, its _init method (akin to constructor)
-    // is also generated.
+    // is also generated unless no object of the class is ever created.
 
     var_env.enterScope();
+    if (is_base_class(stmt) || reachability.is_instantiated(stmt->name.lexeme))
+        cgen_class_init(stmt);
+
+    curr_attr_count = 0;
+    for (auto& method: stmt->features) {
+        if (method->featuretype == FeatureType::METHOD)
+            method->accept(this);
+    }
+
+    var_env.exitScope();
+}
+
+void Cgen::cgen_class_init(Class* stmt) {
+
     Token classname = stmt->name;
     os << classname.lexeme + CLASSINIT_SUFFIX << LABEL;
 
+    // the prototype already holds the value of every attribute.
+    if (noop_inits.count(classname.lexeme)) {
+        emit_jr(RA);
+        return;
+    }
+    IRFunction* ir_init = ir_mode ? ir_module.get(classname.lexeme + CLASSINIT_SUFFIX) : nullptr;
+    if (ir_init) {
+        cgen_ir_function(*ir_init);
+        return;
+    }
+
+    // the initializers of the ancestors are run here as well, from Object
+    // down, instead of calling their _init.
+    std::vector<Class*> chain;
+    for (Class* c = stmt; ; c = class_table_ptr->get(c->superClass.lexeme)) {
+        chain.insert(chain.begin(), c);
+        if (c->superClass == No_class)
+            break;
+    }
+
     // reserve space for AR (old frame pointer + self object + return adress + potential local variables[cases, let])
-    size_t object_size = AR_BASE_SIZE;
-    if (!is_base_class(curr_class))
-        object_size += localsizer.getClassLocalSize(curr_class->name.lexeme);
+    size_t object_size = 0;
+    for (Class* c: chain) {
+        if (!is_base_class(c))
+            object_size = std::max(object_size, localsizer.getClassLocalSize(c->name.lexeme));
+    }
+    object_size += AR_BASE_SIZE;
     emit_push(object_size);
 
     // standard registers that are saved to the stack
@@ -661,16 +949,15 @@ void Cgen::visitClassStmt(Class* stmt) {
 
     class_fp_offset = 1;
 
-    // if the class is anything other than the object class, call
-    // base class init method
-    if (classname != Object)
-        emit_jal(stmt->superClass.lexeme + CLASSINIT_SUFFIX);
-
-    // emit code for attributes
-    for (auto& attrib: stmt->features) {
-        if (attrib->featuretype == FeatureType::ATTRIBUT)
-            attrib->accept(this);
+    // emit code for the attributes not initialized by the prototype
+    for (Class* c: chain) {
+        curr_class = c;
+        for (auto& attrib: c->features) {
+            if (attrib->featuretype == FeatureType::ATTRIBUT && attrib->expr && !baked_attrs.count(attrib.get()))
+                attrib->accept(this);
+        }
     }
+    curr_class = stmt;
 
     // restore registers
     emit_move(ACC, SELF);
@@ -679,14 +966,6 @@ void Cgen::visitClassStmt(Class* stmt) {
     emit_lw(RA, 4, SP);
     emit_pop(object_size);
     emit_jr(RA);
-
-    curr_attr_count = 0;
-    for (auto& method: stmt->features) {
-        if (method->featuretype == FeatureType::METHOD)
-            method->accept(this);
-    }
-
-    var_env.exitScope();
 }
 
 void Cgen::cgen_attribut(Feature* attr) {
@@ -701,50 +980,303 @@ void Cgen::cgen_attribut(Feature* attr) {
     // for an attribute in the object layout if offset 3 (offset 0-2 being the headers)
     // and then multiplied by 4 since there are 4 bytes in a word.
     int offset = attr_table[curr_class->name.lexeme][attr->id.lexeme];
-    if (attr->type_ != prim_slot) 
+    if (attr->type_ != prim_slot) {
         emit_sw(ACC, WORD_SIZE * (offset + 2), SELF);
+        cgen_attribute_barrier(WORD_SIZE * (offset + 2));
+    }
 
 }
 
+void Cgen::cgen_attribute_barrier(int offset) {
+    // _GenGC_Assign records the address of the attribute, keeping ACC.
+    if (!mips_gc())
+        return;
+    emit_addiu(A1, SELF, offset);
+    emit_jal("_GenGC_Assign");
+}
+
 void Cgen::cgen_method(Feature* method) {
-    if (is_base_class(curr_class))
+    if (is_base_class(curr_class) || !reachability.is_reachable(method))
         return;
+    if (ir_mode) {
+        emit_label(curr_class->name.lexeme + METHOD_SEP + method->id.lexeme);
+        cgen_ir_function(*ir_module.get(curr_class->name.lexeme + METHOD_SEP + method->id.lexeme));
+        return;
+    }
 
     inside_function = true; 
-    std::size_t ar_size = AR_BASE_SIZE + method->formals.size() + localsizer.getFuncLocalSize(method->id.lexeme);
+    curr_method = method;
+    tail_calls.clear();
+    collect_tail_calls(method->expr.get());
+    tail_loop_label.clear();
+    for (auto call: tail_calls) {
+        Token& callee = typeId.identify(call) == Type::Dispatch ? static_cast<Dispatch*>(call)->callee_name
+                                                                : static_cast<StaticDispatch*>(call)->callee_name;
+        if (callee == method->id && resolver.get_target(call) == curr_class->name.lexeme)
+            tail_loop_label = "tail_loop" + std::to_string(dispatch_count++);
+    }
     var_env.enterScope();
-    emit_label(curr_class->name.lexeme + METHOD_SEP + method->id.lexeme);
-    if (method->id == main_meth) {
-        // No dispatch prior to main hence doing allocation inside and registers save here.
-        emit_push(ar_size);
-        emit_sw(FP, ar_size * WORD_SIZE, SP);
-        emit_sw(SELF, ar_size * WORD_SIZE - WORD_SIZE, SP);
+
+    // the method allocates its own frame and saves the fp, self and RA in it
+    // only if it changes them: a leaf method keeps its return address in RA
+    // and the fp is only set up when something is addressed through it.
+    // A method that saves nothing has no frame at all.
+    regalloc.allocate(method);
+    auto& saved_regs = regalloc.used_registers();
+    std::size_t nformals = method->formals.size();
+    std::size_t nstack = nformals > ARG_REGS ? nformals - ARG_REGS : 0;
+    curr_frame = {curr_class->name.lexeme + METHOD_SEP + method->id.lexeme, 0, saved_regs.size(), false, false, false};
+    std::vector<std::pair<std::string, bool>> locals;
+    for (auto& f: method->formals)
+        locals.push_back({f->id.lexeme, regalloc.get_register(f.get()) != nullptr});
+    scan_frame(method->expr.get(), curr_frame, locals, false);
+
+    std::size_t frame_size = 0;
+    if (curr_frame.uses_fp)
+        frame_size = AR_BASE_SIZE + frame_locals(method) + nformals - nstack;
+    else if (curr_frame.calls || curr_frame.uses_self)
+        frame_size = AR_BASE_SIZE;
+    curr_frame_size = frame_size;
+    curr_frame.ar_size = frame_size + nstack;
+
+    emit_label(curr_frame.name);
+    if (frame_size)
+        emit_push(frame_size);
+    if (curr_frame.calls)
+        emit_sw(RA, WORD_SIZE, SP);
+    if (curr_frame.uses_fp) {
+        emit_sw(FP, 2 * WORD_SIZE, SP);
+        emit_addiu(FP, SP, 4);
+    }
+    if (curr_frame.uses_self)
+        emit_sw(SELF, 3 * WORD_SIZE, SP);
+
+    // save the callee-saved registers the method's locals are allocated to.
+    if (!saved_regs.empty()) {
+        emit_push(saved_regs.size());
+        for (std::size_t i = 0; i < saved_regs.size(); i++)
+            emit_sw(saved_regs[i], (i + 1) * WORD_SIZE, SP);
     }
-    emit_sw(RA, 4, SP);
 
-    //int curr_offset = 1; !TODO double check later
-    fp_offset = 1;
-    for(auto& f: method->formals) {
-        var_env.insert(f->id.lexeme, fp_offset);
-        fp_offset++;
+    // self-recursive tail calls loop back here with new formals and self.
+    if (!tail_loop_label.empty())
+        emit_label(tail_loop_label);
+
+    // the locals come first in the AR then the formals, the ones passed on
+    // the stack being right above the frame.
+    static const char* arg_regs[ARG_REGS] = {A1, A2, A3};
+    fp_offset = AR_BASE_SIZE + frame_locals(method);
+    for (std::size_t i = 0; i < nformals; i++) {
+        Formal* f = method->formals[i].get();
+        const char* reg = regalloc.get_register(f);
+        if (i < ARG_REGS && reg)
+            emit_move(reg, arg_regs[i]);
+        else if (i < ARG_REGS && curr_frame.uses_fp)
+            emit_sw(arg_regs[i], (fp_offset + i) * WORD_SIZE, FP);
+        else if (reg)
+            emit_lw(reg, (saved_regs.size() + frame_size + i - ARG_REGS + 1) * WORD_SIZE, SP);
+        var_env.insert(f->id.lexeme, {fp_offset + i, reg});
     }
+    fp_offset = AR_BASE_SIZE;
 
-    emit_move(SELF, ACC);
+    if (curr_frame.uses_self)
+        emit_move(SELF, ACC);
     method->expr->accept(this);
 
+    if (!saved_regs.empty()) {
+        for (std::size_t i = 0; i < saved_regs.size(); i++)
+            emit_lw(saved_regs[i], (i + 1) * WORD_SIZE, SP);
+        emit_pop(saved_regs.size());
+    }
+
     // refer to stack frame layout in header file
-    emit_lw(FP, ar_size * WORD_SIZE, SP);
-    emit_lw(SELF, ar_size * WORD_SIZE - WORD_SIZE, SP);
-    emit_lw(RA, 4, SP);
-    emit_pop(ar_size);
+    if (curr_frame.calls)
+        emit_lw(RA, WORD_SIZE, SP);
+    if (curr_frame.uses_fp)
+        emit_lw(FP, 2 * WORD_SIZE, SP);
+    if (curr_frame.uses_self)
+        emit_lw(SELF, 3 * WORD_SIZE, SP);
+    if (curr_frame.ar_size)
+        emit_pop(curr_frame.ar_size);
     emit_jr(RA);
 
     var_env.exitScope();
+    frames.push_back(curr_frame);
 
     inside_function = false;
 
 }
 
+void Cgen::scan_frame(Expr* expr, FrameSummary& frame, std::vector<std::pair<std::string, bool>>& locals, bool inlined) {
+    switch (typeId.identify(expr)) {
+        case Type::Assign: {
+            auto assign = static_cast<Assign*>(expr);
+            scan_frame(assign->expr.get(), frame, locals, inlined);
+            scan_frame_variable(assign->id.lexeme, frame, locals, inlined);
+            // the write barrier of an attribute is a call.
+            bool local = std::any_of(locals.begin(), locals.end(),
+                                     [&](auto& l) { return l.first == assign->id.lexeme; });
+            if (!local && mips_gc())
+                frame.calls = true;
+            break;
+        }
+        case Type::If: {
+            auto if_ = static_cast<If*>(expr);
+            scan_frame_branch(if_->cond.get(), frame, locals, inlined);
+            scan_frame(if_->thenBranch.get(), frame, locals, inlined);
+            scan_frame(if_->elseBranch.get(), frame, locals, inlined);
+            break;
+        }
+        case Type::While: {
+            auto while_ = static_cast<While*>(expr);
+            int value;
+            if (literal_value(while_->cond.get(), value) && !value)
+                break;
+            scan_frame_branch(while_->cond.get(), frame, locals, inlined);
+            scan_frame(while_->expr.get(), frame, locals, inlined);
+            break;
+        }
+        case Type::Binary: {
+            // arithmetic copies an Int, comparisons call the runtime.
+            auto binary = static_cast<Binary*>(expr);
+            scan_frame(binary->lhs.get(), frame, locals, inlined);
+            scan_frame(binary->rhs.get(), frame, locals, inlined);
+            frame.calls = true;
+            break;
+        }
+        case Type::Unary:
+            scan_frame(static_cast<Unary*>(expr)->expr.get(), frame, locals, inlined);
+            frame.calls = true;
+            break;
+        case Type::Variable:
+            scan_frame_variable(static_cast<Variable*>(expr)->name.lexeme, frame, locals, inlined);
+            break;
+        case Type::New:
+            // the objects built in the frame are addressed through the fp.
+            if (!inlined && escape.is_stack_allocated(static_cast<New*>(expr)))
+                frame.uses_fp = true;
+            frame.calls = true;
+            break;
+        case Type::Block:
+            for (auto& e: static_cast<Block*>(expr)->exprs)
+                scan_frame(e.get(), frame, locals, inlined);
+            break;
+        case Type::Grouping:
+            scan_frame(static_cast<Grouping*>(expr)->expr.get(), frame, locals, inlined);
+            break;
+        case Type::Dispatch:
+        case Type::StaticDispatch: {
+            bool is_dispatch = typeId.identify(expr) == Type::Dispatch;
+            Expr* receiver = is_dispatch ? static_cast<Dispatch*>(expr)->expr.get()
+                                         : static_cast<StaticDispatch*>(expr)->expr.get();
+            auto& args = is_dispatch ? static_cast<Dispatch*>(expr)->args
+                                     : static_cast<StaticDispatch*>(expr)->args;
+            for (auto& arg: args)
+                scan_frame(arg.get(), frame, locals, inlined);
+            scan_frame(receiver, frame, locals, inlined);
+
+            const Inliner::InlineSite* site = inliner.get_site(expr);
+            if (site && !inlined) {
+                // the formals of the inlined method are slots of the frame.
+                if (!args.empty())
+                    frame.uses_fp = true;
+                std::vector<std::pair<std::string, bool>> inline_locals;
+                for (auto& f: site->method->formals)
+                    inline_locals.push_back({f->id.lexeme, false});
+                scan_frame(site->method->expr.get(), frame, inline_locals, true);
+                break;
+            }
+            // a tail call jumps.
+            if (inlined || !tail_calls.count(expr))
+                frame.calls = true;
+            break;
+        }
+        case Type::Let: {
+            auto let = static_cast<Let*>(expr);
+            std::size_t scope = locals.size();
+            for (auto& binding: let->vecAssigns) {
+                if (std::get<1>(binding))
+                    scan_frame(std::get<1>(binding).get(), frame, locals, inlined);
+                scan_frame_bind(std::get<0>(binding).get(), frame, locals, inlined);
+            }
+            scan_frame(let->body.get(), frame, locals, inlined);
+            locals.resize(scope);
+            break;
+        }
+        case Type::Case: {
+            auto case_ = static_cast<Case*>(expr);
+            scan_frame(case_->expr.get(), frame, locals, inlined);
+            for (auto& match: case_->matches) {
+                std::size_t scope = locals.size();
+                scan_frame_bind(std::get<0>(match).get(), frame, locals, inlined);
+                scan_frame(std::get<1>(match).get(), frame, locals, inlined);
+                locals.resize(scope);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void Cgen::scan_frame_branch(Expr* cond, FrameSummary& frame, std::vector<std::pair<std::string, bool>>& locals, bool inlined) {
+    switch (typeId.identify(cond)) {
+        case Type::Grouping:
+            scan_frame_branch(static_cast<Grouping*>(cond)->expr.get(), frame, locals, inlined);
+            return;
+        case Type::Unary:
+            if (static_cast<Unary*>(cond)->op.token_type != NOT)
+                break;
+            scan_frame_branch(static_cast<Unary*>(cond)->expr.get(), frame, locals, inlined);
+            return;
+        case Type::Block: {
+            auto block = static_cast<Block*>(cond);
+            for (size_t i = 0; i + 1 < block->exprs.size(); i++)
+                scan_frame(block->exprs[i].get(), frame, locals, inlined);
+            scan_frame_branch(block->exprs.back().get(), frame, locals, inlined);
+            return;
+        }
+        case Type::If: {
+            auto if_ = static_cast<If*>(cond);
+            scan_frame_branch(if_->cond.get(), frame, locals, inlined);
+            scan_frame_branch(if_->thenBranch.get(), frame, locals, inlined);
+            scan_frame_branch(if_->elseBranch.get(), frame, locals, inlined);
+            return;
+        }
+        case Type::Binary: {
+            auto binary = static_cast<Binary*>(cond);
+            if (!is_compare_branch(binary))
+                break;
+            scan_frame(binary->lhs.get(), frame, locals, inlined);
+            scan_frame(binary->rhs.get(), frame, locals, inlined);
+            return;
+        }
+        default:
+            break;
+    }
+    scan_frame(cond, frame, locals, inlined);
+}
+
+void Cgen::scan_frame_variable(const std::string& name, FrameSummary& frame, std::vector<std::pair<std::string, bool>>& locals, bool inlined) {
+    for (auto local = locals.rbegin(); local != locals.rend(); local++) {
+        if (local->first == name) {
+            if (!local->second)
+                frame.uses_fp = true;
+            return;
+        }
+    }
+    // self or an attribute, those of the receiver in an inlined body.
+    if (!inlined)
+        frame.uses_self = true;
+}
+
+void Cgen::scan_frame_bind(Formal* formal, FrameSummary& frame, std::vector<std::pair<std::string, bool>>& locals, bool inlined) {
+    bool in_register = !inlined && regalloc.get_register(formal);
+    if (!in_register)
+        frame.uses_fp = true;
+    locals.push_back({formal->id.lexeme, in_register});
+}
+
 void Cgen::visitFeatureExpr(Feature* expr) {
     switch (expr->featuretype) {
         case FeatureType::ATTRIBUT:
@@ -763,7 +1295,7 @@ void Cgen::visitFormalExpr(Formal* expr) {
 
 void Cgen::visitAssignExpr(Assign* expr) {
     expr->expr->accept(this);
-    int *offset = var_env.get(expr->id.lexeme);
+    VarLocation *local = var_env.get(expr->id.lexeme);
 
     // result of evaluating rhs of assignment 
     // is expected to be in the register ACC
@@ -773,10 +1305,15 @@ void Cgen::visitAssignExpr(Assign* expr) {
 
     // !TODO not sure here cause different from 
     // (inspired repo file astnodecodegenerator.cpp:663)
-    if (offset) // local var
-        emit_sw(ACC, (*offset) * WORD_SIZE, FP);
-    else // attribute
-        emit_sw(ACC, WORD_SIZE * ( attr_table[curr_class->name.lexeme][expr->id.lexeme] + 2 ), SELF);
+    if (local && local->reg) // register allocated local var
+        emit_move(local->reg, ACC);
+    else if (local) // local var
+        emit_sw(ACC, local->offset * WORD_SIZE, FP);
+    else { // attribute
+        int offset = WORD_SIZE * (attr_table[curr_class->name.lexeme][expr->id.lexeme] + 2);
+        emit_sw(ACC, offset, SELF);
+        cgen_attribute_barrier(offset);
+    }
 
 }
 
@@ -784,10 +1321,7 @@ void Cgen::visitIfExpr(If* expr) {
 
     ifcount++;
     std::string label_suffix = std::to_string(ifcount);
-    expr->cond->accept(this);
-
-    emit_la(T1, BOOLCONST_TRUE); // bool_const1
-    emit_beq(T1, ACC, "iftrue_branch" + label_suffix);
+    cgen_branch(expr->cond.get(), true, "iftrue_branch" + label_suffix);
     emit_label("iffalse_branch" + label_suffix);
     expr->elseBranch->accept(this);
     emit_b("end_if" + label_suffix);   
@@ -799,20 +1333,303 @@ void Cgen::visitIfExpr(If* expr) {
 
 void Cgen::visitWhileExpr(While* expr) {
 
+    int value;
+    if (literal_value(expr->cond.get(), value) && !value) {
+        // `while false` is just void.
+        emit_li(ACC, 0);
+        return;
+    }
+
+    // the test is at the bottom so an iteration takes a single branch.
     while_count++;
     std::string label_suffix = std::to_string(while_count);
-    emit_label("while_branch" + label_suffix);
-    expr->cond->accept(this);
+    std::string body_label = "while_branch" + label_suffix;
+    std::string cond_label = "while_cond" + label_suffix;
+    std::string end_label = "end_while_branch" + label_suffix;
+
+    Variable* counter;
+    int step;
+    if (!counted_loop(expr, counter, step)) {
+        // a small condition is tested on entry too, saving the jump to the
+        // bottom when the loop isn't entered.
+        BodySize cond_size;
+        expr->cond->accept(&cond_size);
+        if (cond_size.has_locals || cond_size.has_loop || cond_size.size > UNROLL_MAX_SIZE)
+            emit_b(cond_label);
+        else
+            cgen_branch(expr->cond.get(), false, end_label);
+        emit_label(body_label);
+        expr->expr->accept(this);
+        emit_label(cond_label);
+        cgen_branch(expr->cond.get(), true, body_label);
+        emit_label(end_label);
+        emit_li(ACC, 0); // a while always returns null.
+        return;
+    }
 
+    // the body is run twice as long as `counter + step` is within the bound,
+    // that is `counter` within `bound - step`, then once more if `counter`
+    // still is. Neither `bound - step` nor `bound + step` overflows so the
+    // counter reaches the bound without wrapping and the loop is done.
+    unrolled_count++;
+    auto cond = static_cast<Binary*>(expr->cond.get());
+    int bound;
+    literal_value(cond->rhs.get(), bound);
+    emit_b(cond_label);
+    emit_label(body_label);
+    expr->expr->accept(this);
+    expr->expr->accept(this);
+    emit_label(cond_label);
+    cgen_unboxed(counter, T1);
+    emit_compare_branch(cond->op.token_type, true, T1, bound - step, body_label);
+    cgen_branch(cond, false, end_label);
+    expr->expr->accept(this);
+    emit_label(end_label);
+    emit_li(ACC, 0);
+}
+
+bool Cgen::counted_loop(While* expr, Variable*& counter, int& step) {
+    if (typeId.identify(expr->cond.get()) != Type::Binary || typeId.identify(expr->expr.get()) != Type::Block)
+        return false;
+    auto cond = static_cast<Binary*>(expr->cond.get());
+    auto body = static_cast<Block*>(expr->expr.get());
+    TokenType op = cond->op.token_type;
+    if ((op != LESS && op != LESS_EQUAL) || typeId.identify(cond->lhs.get()) != Type::Variable)
+        return false;
+
+    counter = static_cast<Variable*>(cond->lhs.get());
+    int bound;
+    if (counter->expr_type != Int || !var_env.get(counter->name.lexeme) || !literal_value(cond->rhs.get(), bound))
+        return false;
+
+    // the body ends with `counter <- counter + step`.
+    Expr* last = body->exprs.back().get();
+    if (typeId.identify(last) != Type::Assign)
+        return false;
+    auto assign = static_cast<Assign*>(last);
+    if (assign->id != counter->name || typeId.identify(assign->expr.get()) != Type::Binary)
+        return false;
+    auto increment = static_cast<Binary*>(assign->expr.get());
+    if (increment->op.token_type != PLUS || typeId.identify(increment->lhs.get()) != Type::Variable ||
+        static_cast<Variable*>(increment->lhs.get())->name != counter->name ||
+        !literal_value(increment->rhs.get(), step) || step <= 0)
+        return false;
+
+    BodySize size;
+    AssignedNames assigned;
+    for (std::size_t i = 0; i + 1 < body->exprs.size(); i++) {
+        body->exprs[i]->accept(&size);
+        body->exprs[i]->accept(&assigned);
+    }
+    if (size.has_locals || size.has_loop || size.size > UNROLL_MAX_SIZE || assigned.names.count(counter->name.lexeme))
+        return false;
+    return static_cast<long long>(bound) - step >= INT32_MIN && static_cast<long long>(bound) + step <= INT32_MAX;
+}
+
+void Cgen::cgen_branch(Expr* cond, bool jump_if, const std::string& label) {
+
+    switch (typeId.identify(cond)) {
+        case Type::Grouping:
+            cgen_branch(static_cast<Grouping*>(cond)->expr.get(), jump_if, label);
+            return;
+
+        case Type::Literal: {
+            auto literal = static_cast<Literal*>(cond);
+            if (literal->object.type() != CoolType::Bool_t)
+                break;
+            if (literal->object.bool_value() == jump_if)
+                emit_b(label);
+            return;
+        }
+
+        case Type::Unary: {
+            auto unary = static_cast<Unary*>(cond);
+            if (unary->op.token_type != NOT)
+                break;
+            // `not` only flips the sense of the branch.
+            cgen_branch(unary->expr.get(), !jump_if, label);
+            return;
+        }
+
+        case Type::Block: {
+            // only the value of the last expression matters.
+            auto block = static_cast<Block*>(cond);
+            for (size_t i = 0; i + 1 < block->exprs.size(); i++)
+                block->exprs[i]->accept(this);
+            cgen_branch(block->exprs.back().get(), jump_if, label);
+            return;
+        }
+
+        case Type::If: {
+            // a conditional used as a condition (eg. `while if a < b then false else true fi loop`)
+            // branches directly from its arms.
+            auto if_ = static_cast<If*>(cond);
+            ifcount++;
+            std::string label_suffix = std::to_string(ifcount);
+            cgen_branch(if_->cond.get(), true, "iftrue_branch" + label_suffix);
+            cgen_branch(if_->elseBranch.get(), jump_if, label);
+            emit_b("end_if" + label_suffix);
+            emit_label("iftrue_branch" + label_suffix);
+            cgen_branch(if_->thenBranch.get(), jump_if, label);
+            emit_label("end_if" + label_suffix);
+            return;
+        }
+
+        case Type::Binary:
+            if (cgen_compare_branch(static_cast<Binary*>(cond), jump_if, label))
+                return;
+            break;
+
+        default:
+            break;
+    }
+
+    // materialize the Bool object and test it against true.
+    cond->accept(this);
     emit_la(T1, BOOLCONST_TRUE); // bool_const1
-    emit_bne(T1, ACC, "end_while_branch" + label_suffix);
+    if (jump_if)
+        emit_beq(T1, ACC, label);
+    else
+        emit_bne(T1, ACC, label);
+}
 
-    expr->expr->accept(this);
+bool Cgen::cgen_compare_branch(Binary* cond, bool jump_if, const std::string& label) {
+
+    if (!is_compare_branch(cond))
+        return false;
+
+    TokenType op = cond->op.token_type;
+    Expr* lhs = cond->lhs.get();
+    Expr* rhs = cond->rhs.get();
+    int value;
+
+    if (literal_value(rhs, value)) {
+        cgen_unboxed(lhs, T1);
+        emit_compare_branch(op, jump_if, T1, value, label);
+    } else if (literal_value(lhs, value)) {
+        // the literal goes on the right: mirror the comparison.
+        cgen_unboxed(rhs, T1);
+        if (op == EQUAL)
+            emit_compare_branch(op, jump_if, T1, value, label);
+        else    // c < x  <=> not (x <= c) and c <= x <=> not (x < c)
+            emit_compare_branch(op == LESS ? LESS_EQUAL : LESS, !jump_if, T1, value, label);
+    } else if (is_simple_operand(rhs)) {
+        cgen_unboxed(lhs, T1);
+        cgen_unboxed(rhs, T2);
+        emit_compare_branch(op, jump_if, T1, T2, label);
+    } else {
+        // keep the boxed lhs on the stack (and not its raw value) while the rhs
+        // is evaluated since it is scanned by the garbage collector.
+        lhs->accept(this);
+        emit_push(ACC);
+        rhs->accept(this);
+        emit_lw(T1, 4, SP);
+        emit_pop(1);
+        emit_lw(T1, 12, T1);
+        emit_lw(T2, 12, ACC);
+        emit_compare_branch(op, jump_if, T1, T2, label);
+    }
+    return true;
+}
+
+bool Cgen::is_compare_branch(Binary* cond) {
+    TokenType op = cond->op.token_type;
+    if (op != LESS && op != LESS_EQUAL && op != EQUAL)
+        return false;
+
+    // Int and Bool objects keep their value in the first attribute so both 
+    // sides can be compared unboxed. Other `=` go through the runtime `eq`.
+    Token& lhs_type = cond->lhs->expr_type;
+    Token& rhs_type = cond->rhs->expr_type;
+    return (lhs_type == Int && rhs_type == Int) || (op == EQUAL && lhs_type == Bool && rhs_type == Bool);
+}
+
+void Cgen::emit_compare_branch(TokenType op, bool jump_if, const char* lhs, const char* rhs, const std::string& label) {
+    switch (op) {
+        case LESS:
+            jump_if ? emit_blt(lhs, rhs, label) : emit_bge(lhs, rhs, label);
+            break;
+        case LESS_EQUAL:
+            jump_if ? emit_ble(lhs, rhs, label) : emit_bgt(lhs, rhs, label);
+            break;
+        case EQUAL:
+            jump_if ? emit_beq(lhs, rhs, label) : emit_bne(lhs, rhs, label);
+            break;
+        default:
+            break;
+    }
+}
 
-    emit_b("while_branch" + label_suffix);
-    emit_label("end_while_branch" + label_suffix);
-    emit_li(ACC, 0); // a while always returns null.
+void Cgen::emit_compare_branch(TokenType op, bool jump_if, const char* lhs, int rhs, const std::string& label) {
+    switch (op) {
+        case LESS:
+            jump_if ? emit_blt(lhs, rhs, label) : emit_bge(lhs, rhs, label);
+            break;
+        case LESS_EQUAL:
+            jump_if ? emit_ble(lhs, rhs, label) : emit_bgt(lhs, rhs, label);
+            break;
+        case EQUAL:
+            jump_if ? emit_beq(lhs, rhs, label) : emit_bne(lhs, rhs, label);
+            break;
+        default:
+            break;
+    }
+}
 
+void Cgen::cgen_unboxed(Expr* expr, const char* dest) {
+    const char* reg = local_register(expr);
+    if (reg) {
+        emit_lw(dest, 12, reg);
+    } else {
+        expr->accept(this);
+        emit_lw(dest, 12, ACC);
+    }
+}
+
+const char* Cgen::local_register(Expr* expr) {
+    switch (typeId.identify(expr)) {
+        case Type::Variable: {
+            VarLocation* local = var_env.get(static_cast<Variable*>(expr)->name.lexeme);
+            return local ? local->reg : nullptr;
+        }
+        case Type::Grouping:
+            return local_register(static_cast<Grouping*>(expr)->expr.get());
+        default:
+            return nullptr;
+    }
+}
+
+bool Cgen::is_simple_operand(Expr* expr) {
+    switch (typeId.identify(expr)) {
+        case Type::Variable:
+        case Type::Literal:
+            return true;
+        case Type::Grouping:
+            return is_simple_operand(static_cast<Grouping*>(expr)->expr.get());
+        default:
+            return false;
+    }
+}
+
+bool Cgen::literal_value(Expr* expr, int& value) {
+    switch (typeId.identify(expr)) {
+        case Type::Grouping:
+            return literal_value(static_cast<Grouping*>(expr)->expr.get(), value);
+        case Type::Literal: {
+            auto literal = static_cast<Literal*>(expr);
+            if (literal->object.type() == CoolType::Number_t) {
+                value = literal->object.int_value();
+                return true;
+            }
+            if (literal->object.type() == CoolType::Bool_t) {
+                value = literal->object.bool_value() ? 1 : 0;
+                return true;
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
 }
 
 void Cgen::visitBinaryExpr(Binary* expr) {
@@ -824,7 +1641,7 @@ void Cgen::visitBinaryExpr(Binary* expr) {
 
             emit_push(ACC);
             expr->rhs->accept(this);
-            emit_jal("Object.copy");
+            cgen_alloc(Int.lexeme, true);
             emit_lw(T1, 4, SP);
             emit_lw(T1, 12, T1);
             emit_lw(T2, 12, ACC);
@@ -837,7 +1654,7 @@ void Cgen::visitBinaryExpr(Binary* expr) {
 
             emit_push(ACC);
             expr->rhs->accept(this);
-            emit_jal("Object.copy");
+            cgen_alloc(Int.lexeme, true);
             emit_lw(T1, 4, SP);
             emit_lw(T1, 12, T1);
             emit_lw(T2, 12, ACC);
@@ -850,7 +1667,7 @@ void Cgen::visitBinaryExpr(Binary* expr) {
 
             emit_push(ACC);
             expr->rhs->accept(this);
-            emit_jal("Object.copy");
+            cgen_alloc(Int.lexeme, true);
             emit_lw(T1, 4, SP);
             emit_lw(T1, 12, T1);
             emit_lw(T2, 12, ACC);
@@ -863,7 +1680,7 @@ void Cgen::visitBinaryExpr(Binary* expr) {
 
             emit_push(ACC);
             expr->rhs->accept(this);
-            emit_jal("Object.copy");
+            cgen_alloc(Int.lexeme, true);
             emit_lw(T1, 4, SP);
             emit_lw(T1, 12, T1);
             emit_lw(T2, 12, ACC);
@@ -876,7 +1693,7 @@ void Cgen::visitBinaryExpr(Binary* expr) {
 
             emit_push(ACC);
             expr->rhs->accept(this);
-            emit_pop(S1);
+            emit_pop(A1);
             emit_jal("less");
             break;
 
@@ -884,7 +1701,7 @@ void Cgen::visitBinaryExpr(Binary* expr) {
 
             emit_push(ACC);
             expr->rhs->accept(this);
-            emit_pop(S1);
+            emit_pop(A1);
             emit_jal("less_eq");
             break;
 
@@ -892,7 +1709,7 @@ void Cgen::visitBinaryExpr(Binary* expr) {
 
             emit_push(ACC);
             expr->rhs->accept(this);
-            emit_pop(S1);
+            emit_pop(A1);
             emit_jal("eq");
             break;
     }
@@ -905,9 +1722,9 @@ void Cgen::visitUnaryExpr(Unary* expr) {
         case TILDE:
             // ~ is used on integer only hence the offset 12 to get 
             // the value.
-            emit_jal("Object.copy");
+            cgen_alloc(Int.lexeme, true);
             emit_lw(T1, 12, ACC);
-            emit_not(T2, T1),
+            emit_neg(T2, T1);
             emit_sw(T2, 12, ACC);
             break;
 
@@ -923,25 +1740,96 @@ void Cgen::visitUnaryExpr(Unary* expr) {
 }
 
 void Cgen::visitVariableExpr(Variable* expr) {
+    cgen_variable(expr, ACC);
+}
+
+void Cgen::cgen_variable(Variable* expr, const char* dest) {
     if (expr->name == self) {
-        emit_move(ACC, SELF);
+        emit_move(dest, SELF);
     } else {
 
         // if the variable name is not in the current local scope
         // check if it's an attribute of the current class.
-        int *offset = var_env.get(expr->name.lexeme);
-        if (offset)
-                emit_lw(ACC, (*offset) * WORD_SIZE, FP);
+        VarLocation *local = var_env.get(expr->name.lexeme);
+        if (local && local->reg)
+            emit_move(dest, local->reg);
+        else if (local)
+            emit_lw(dest, local->offset * WORD_SIZE, FP);
         else {
-            emit_lw(ACC, WORD_SIZE * (attr_table[curr_class->name.lexeme][expr->name.lexeme] + 2), SELF);
+            emit_lw(dest, WORD_SIZE * (attr_table[curr_class->name.lexeme][expr->name.lexeme] + 2), SELF);
         } 
     }
 }
 
 void Cgen::visitNewExpr(New* expr) {
-    emit_la(ACC, expr->expr_type.lexeme + PROTOBJ_SUFFIX);
+    if (inside_function && !inlining && escape.is_stack_allocated(expr)) {
+        // copy the prototype into the slots of the frame after the locals
+        // and the formals of the inlined methods.
+        std::size_t slot = AR_BASE_SIZE + localsizer.getFuncLocalSize(curr_method) +
+                           inliner.get_inline_slots(curr_method) + escape.get_stack_offset(expr);
+        std::size_t size = DEFAULT_OBJFIELDS + attr_table[expr->expr_type.lexeme].size();
+        emit_la(T1, expr->expr_type.lexeme + PROTOBJ_SUFFIX);
+        for (std::size_t i = 0; i < size; i++) {
+            emit_lw(T2, i * WORD_SIZE, T1);
+            emit_sw(T2, (slot + i) * WORD_SIZE, FP);
+        }
+        emit_addiu(ACC, FP, slot * WORD_SIZE);
+    } else
+        cgen_alloc(expr->expr_type.lexeme, false);
+    if (!noop_inits.count(expr->expr_type.lexeme))
+        emit_jal(expr->expr_type.lexeme + CLASSINIT_SUFFIX);
+}
+
+void Cgen::cgen_alloc(const std::string& class_name, bool copy_acc) {
+    if (gc.test || class_name == SELF_TYPE.lexeme) {
+        if (!copy_acc)
+            emit_la(ACC, class_name + PROTOBJ_SUFFIX);
+        emit_jal("Object.copy");
+        return;
+    }
+
+    // the size of the object is known: check the room left below the limit
+    // of the work area like _MemMgr_Alloc, then write the eyecatcher, the
+    // header and the attributes of the prototype from immediates.
+    std::size_t nattrs = calc_obj_size(class_table_ptr->get(class_name));
+    std::size_t bytes = (DEFAULT_OBJFIELDS + nattrs + 1) * WORD_SIZE;
+    std::string slow_label = "alloc_slow" + std::to_string(alloc_count);
+    std::string end_label = "alloc_end" + std::to_string(alloc_count++);
+    if (copy_acc)
+        emit_move(T2, ACC);
+    emit_addiu(T1, GP, bytes);
+    emit_bge(T1, S7, slow_label);
+    emit_addiu(ACC, GP, WORD_SIZE);
+    emit_move(GP, T1);
+    emit_li(T1, -1);
+    emit_sw(T1, -WORD_SIZE, ACC);
+    emit_li(T1, classtag_map[class_name]);
+    emit_sw(T1, 0, ACC);
+    emit_li(T1, DEFAULT_OBJFIELDS + nattrs);
+    emit_sw(T1, WORD_SIZE, ACC);
+    emit_la(T1, class_name + DISPTAB_SUFFIX);
+    emit_sw(T1, 2 * WORD_SIZE, ACC);
+    for (std::size_t i = 0; i < nattrs; i++) {
+        int offset = (DEFAULT_OBJFIELDS + i) * WORD_SIZE;
+        const std::string& word = proto_attrs[class_name][i];
+        if (copy_acc) {
+            emit_lw(T1, offset, T2);
+            emit_sw(T1, offset, ACC);
+        } else if (word == "0")
+            emit_sw(ZERO, offset, ACC);
+        else {
+            emit_la(T1, word);
+            emit_sw(T1, offset, ACC);
+        }
+    }
+    emit_b(end_label);
+
+    // the collector makes room.
+    emit_label(slow_label);
+    if (!copy_acc)
+        emit_la(ACC, class_name + PROTOBJ_SUFFIX);
     emit_jal("Object.copy");
-    emit_jal(expr->expr_type.lexeme + CLASSINIT_SUFFIX);
+    emit_label(end_label);
 }
 
 void Cgen::visitBlockExpr(Block* expr) {
@@ -956,97 +1844,128 @@ void Cgen::visitGroupingExpr(Grouping* expr) {
 
 void Cgen::visitStaticDispatchExpr(StaticDispatch* expr) {
 
-    
-    std::size_t ar_size = AR_BASE_SIZE + expr->args.size();
-    if (!is_base_function(expr->callee_name))
-        ar_size += localsizer.getFuncLocalSize(expr->callee_name.lexeme);
-    
-    emit_push(ar_size);
-    emit_sw(FP, ar_size * WORD_SIZE, SP);
-    emit_sw(SELF, ar_size * WORD_SIZE - WORD_SIZE, SP);
-
-
-    std::size_t formal_offset = 8;
-    for (auto& arg: expr->args) {
-        arg->accept(this);
-        emit_sw(ACC, formal_offset, SP);
-        formal_offset += WORD_SIZE;
+    const Inliner::InlineSite* site = inliner.get_site(expr);
+    if (site && inside_function && !inlining) {
+        cgen_inline(expr, expr->expr.get(), expr->args, site);
+        return;
     }
+    if (cgen_tail_dispatch(expr, expr->expr.get(), expr->args, expr->callee_name, resolver.get_target(expr)))
+        return;
 
-    expr->expr->accept(this);
-    emit_addiu(FP, SP, 4);
-
-    emit_bne(ACC, ZERO, "DispatchLabel" + std::to_string(dispatch_count));
-    emit_la(ACC, FILENAME);
-    emit_li(T1, 1);
-    emit_jal("_dispatch_abort");
-    emit_label("DispatchLabel" + std::to_string(dispatch_count)); 
-    dispatch_count++;
-    // code for dispatch
-    emit_la(T1, expr->class_.lexeme + std::string(PROTOBJ_SUFFIX));
-    emit_lw(T1, 8, T1); // to get the dispatch table pointer.
-    emit_lw(T1, method_table[expr->class_.lexeme][expr->callee_name.lexeme] * WORD_SIZE, T1);
-    emit_jalr(T1);
+    // the callee pops the arguments passed on the stack.
+    cgen_call_args(expr, expr->expr.get(), expr->args);
+    // the target of a static dispatch is known at compile time.
+    emit_jal(resolver.get_target(expr) + METHOD_SEP + expr->callee_name.lexeme);
 }
 
 void Cgen::visitDispatchExpr(Dispatch* expr) {
-    
-    std::size_t ar_size = AR_BASE_SIZE + expr->args.size();
-    if (!is_base_function(expr->callee_name))
-        ar_size += localsizer.getFuncLocalSize(expr->callee_name.lexeme);
-
-    emit_push(ar_size);
-    emit_sw(FP, ar_size * WORD_SIZE, SP);
-    emit_sw(SELF, ar_size * WORD_SIZE - WORD_SIZE, SP);
-
 
-    std::size_t formal_offset = 8;
-    for (auto& arg: expr->args) {
-        arg->accept(this);
-        emit_sw(ACC, formal_offset, SP);
-        formal_offset += WORD_SIZE;
+    const Inliner::InlineSite* site = inliner.get_site(expr);
+    if (site && inside_function && !inlining) {
+        cgen_inline(expr, expr->expr.get(), expr->args, site);
+        return;
     }
 
-    expr->expr->accept(this);
-    emit_addiu(FP, SP, 4);
+    // empty unless the call site can reach a single method.
+    const std::string& target = resolver.get_target(expr);
+    if (cgen_tail_dispatch(expr, expr->expr.get(), expr->args, expr->callee_name, target))
+        return;
 
-    // dispatch error on void
-    emit_bne(ACC, ZERO, "DispatchLabel" + std::to_string(dispatch_count));
-    emit_la(ACC, FILENAME);
-    emit_li(T1, 1);
-    emit_jal("_dispatch_abort");
+    // the callee pops the arguments passed on the stack.
+    cgen_call_args(expr, expr->expr.get(), expr->args);
     // code for dispatch
-    emit_label("DispatchLabel" + std::to_string(dispatch_count));
-    dispatch_count++;
+    if (!target.empty()) {
+        // monomorphic call site.
+        emit_jal(target + METHOD_SEP + expr->callee_name.lexeme);
+        return;
+    }
     emit_lw(T1, 8, ACC); // to get the dispatch table pointer.
     emit_lw(T1, method_table[expr->expr->expr_type.lexeme][expr->callee_name.lexeme] * WORD_SIZE, T1);
     emit_jalr(T1);
 }
 
-void Cgen::visitLiteralExpr(Literal* expr) {
+std::size_t Cgen::cgen_call_args(Expr* expr, Expr* receiver, std::vector<std::unique_ptr<Expr>>& args) {
 
-    switch (expr->object.type()) {
-        case CoolType::Bool_t:
-            if (expr->object.bool_value())
-                emit_la(ACC, BOOLCONST_TRUE);
-            else 
-                emit_la(ACC, BOOLCONST_FALSE);
+    // an argument passed in a register is loaded last when it is a literal,
+    // or a variable only followed by variables and literals.
+    std::size_t nargs = args.size();
+    std::size_t nregs = std::min<std::size_t>(nargs, ARG_REGS);
+    std::vector<bool> late(nregs, false);
+    bool simple_after = is_simple_operand(receiver);
+    for (std::size_t i = nargs; i-- > 0; ) {
+        if (i < nregs)
+            late[i] = typeId.identify(args[i].get()) == Type::Literal || (simple_after && is_simple_operand(args[i].get()));
+        simple_after = simple_after && is_simple_operand(args[i].get());
+    }
+
+    // the others are evaluated to the stack: those going to registers on top
+    // of those passed on the stack.
+    std::vector<std::size_t> slot(nargs);
+    std::size_t ntemps = 0;
+    for (std::size_t i = 0; i < nregs; i++) {
+        if (!late[i])
+            slot[i] = ++ntemps;
+    }
+    std::size_t nstack = nargs - nregs;
+    for (std::size_t i = nregs; i < nargs; i++)
+        slot[i] = ntemps + i - nregs + 1;
+    if (ntemps + nstack)
+        emit_push(ntemps + nstack);
+    for (std::size_t i = 0; i < nargs; i++) {
+        if (i < nregs && late[i])
+            continue;
+        args[i]->accept(this);
+        emit_sw(ACC, slot[i] * WORD_SIZE, SP);
+    }
+
+    receiver->accept(this);
+    cgen_dispatch_check(expr);
+
+    static const char* arg_regs[ARG_REGS] = {A1, A2, A3};
+    for (std::size_t i = 0; i < nregs; i++) {
+        if (late[i])
+            cgen_simple_operand(args[i].get(), arg_regs[i]);
+        else
+            emit_lw(arg_regs[i], slot[i] * WORD_SIZE, SP);
+    }
+    if (ntemps)
+        emit_pop(ntemps);
+    return nstack;
+}
+
+void Cgen::cgen_simple_operand(Expr* expr, const char* dest) {
+    switch (typeId.identify(expr)) {
+        case Type::Grouping:
+            cgen_simple_operand(static_cast<Grouping*>(expr)->expr.get(), dest);
             break;
-        case CoolType::Number_t:
-            emit_la(ACC, std::string(INTCONST_PREFIX) + std::to_string(inttable().get_index(std::to_string(expr->object.int_value()))));
+        case Type::Literal:
+            cgen_literal(static_cast<Literal*>(expr), dest);
             break;
-        case CoolType::String_t:
-            emit_la(ACC, std::string(STRCONST_PREFIX) + std::to_string(stringtable().get_index(expr->object.string_value())));
+        case Type::Variable:
+            cgen_variable(static_cast<Variable*>(expr), dest);
             break;
-        case CoolType::Void_t:
-            emit_move(ACC, ZERO);
+        default:
             break;
-
     }
 }
 
+void Cgen::visitLiteralExpr(Literal* expr) {
+    cgen_literal(expr, ACC);
+}
+
+void Cgen::cgen_literal(Literal* expr, const char* dest) {
+    if (expr->object.type() == CoolType::Void_t)
+        emit_move(dest, ZERO);
+    else
+        emit_la(dest, literal_word(expr));
+}
+
 void Cgen::visitLetExpr(Let* expr) {
 
+    // the slots of the bindings are free again once the let is done (see LocalSizer).
+    // lets in methods and the ones initializing attributes have their own offsets.
+    std::size_t& offset = inside_function ? fp_offset : class_fp_offset;
+    std::size_t scope = offset;
     var_env.enterScope();
     for (auto& let: expr->vecAssigns) {
         // codegen all the expressions in the let init if exists.
@@ -1058,33 +1977,16 @@ void Cgen::visitLetExpr(Let* expr) {
         } else { // use default initialization.
             cgen_init_formal(let_type);
         }
-        if (inside_function) {
-            emit_sw(ACC, fp_offset * WORD_SIZE, FP);
-            var_env.insert(let_id.lexeme, fp_offset);
-            fp_offset++;
-        } else { // a let that initialize an attribute
-            emit_sw(ACC, class_fp_offset * WORD_SIZE, FP);
-            var_env.insert(let_id.lexeme, class_fp_offset);
-            class_fp_offset++;
-        }
+        cgen_bind_local(std::get<0>(let).get(), offset++);
     }
     expr->body->accept(this);
     emit_comment("Let ends here");
     var_env.exitScope();
+    offset = scope;
 }
 
 void Cgen::visitCaseExpr(Case* expr) {
 
-    // a lambda to find the child class with the highest tag of a certain
-    // class hierarchy.
-    auto max_inherited_class_tag = [this](Token& class_name) -> int {
-        int max_tag = this->classtag_map[class_name.lexeme]; // the lowest.
-        for(auto& class_: this->g->DFS(class_name)) {
-            if (this->classtag_map[class_.lexeme] > max_tag)
-                    max_tag = this->classtag_map[class_.lexeme];
-        }
-        return max_tag;
-    };
     emit_comment("Label construct starts here.");
     expr->expr->accept(this);
     int tagCaseEnd = casecount++;
@@ -1092,63 +1994,216 @@ void Cgen::visitCaseExpr(Case* expr) {
     emit_la(ACC, FILENAME);
     emit_li(T1, 1);
     emit_jal("_case_abort2");
+    emit_label("CaseLabel" + std::to_string(casecount++));
 
-    // Object case branch is to be handled last if present.
-    bool there_is_object = false, first_iter=true;
-    Formal* object_formal;
-    Expr* obj_expr;
-
-    // we want the lowest classes (highest tags) in the hierarchy to get 
-    // the caseLabels first.
-    std::sort(expr->matches.begin(), expr->matches.end(), 
-    [this](letAssign& a, letAssign& b){
-        return this->classtag_map[std::get<0>(a).get()->type_.lexeme] >
-        this->classtag_map[std::get<0>(b).get()->type_.lexeme];
-    });
-
-    for (auto& match: expr->matches) {
-
-        // codegen every match expression.
-        auto formal = std::get<0>(match).get();
-        Expr* match_expr = std::get<1>(match).get();
-        if (formal->type_ == Object) {
-            there_is_object = true;
-            object_formal = formal;
-            obj_expr = match_expr;
-            continue; // handle Object branch later.
-        }
-        emit_label("CaseLabel" + std::to_string(casecount++));
-        if (first_iter) {
-            emit_lw(T2, TAG_OFFSET, ACC);
-            first_iter = false;
-        }
-        emit_blt(T2, classtag_map[formal->type_.lexeme], "CaseLabel" + std::to_string(casecount));
-        emit_bgt(T2, max_inherited_class_tag(formal->type_), "CaseLabel" + std::to_string(casecount));
+    std::vector<std::string> branch_types;
+    for (auto& match: expr->matches)
+        branch_types.push_back(std::get<0>(match)->type_.lexeme);
+    std::vector<CaseInterval> intervals = case_intervals(resolver.get_case_type(expr), branch_types);
+
+    std::vector<std::string> branch_labels;
+    for (std::size_t i = 0; i < expr->matches.size(); i++)
+        branch_labels.push_back("CaseLabel" + std::to_string(casecount++));
+    std::string abort_label = "CaseLabel" + std::to_string(casecount++);
+
+    emit_lw(T2, TAG_OFFSET, ACC);
+    if (intervals.size() >= CASE_JUMP_TABLE_MIN_INTERVALS)
+        cgen_case_jump_table(intervals, branch_labels, abort_label);
+    else
+        cgen_case_search(intervals, 0, intervals.size() - 1, branch_labels, abort_label);
+
+    // the branches bind their identifier to the same slot.
+    std::size_t& offset = inside_function ? fp_offset : class_fp_offset;
+    for (std::size_t i = 0; i < expr->matches.size(); i++) {
         // bind idk to expr0 before evaluating exprk.
-        if (inside_function) {
-            emit_sw(ACC, fp_offset * WORD_SIZE, FP);
-            var_env.insert(formal->id.lexeme, fp_offset);
-        } else {
-            emit_sw(ACC, class_fp_offset * WORD_SIZE, FP);
-            var_env.insert(formal->id.lexeme, class_fp_offset);
-        }
-        match_expr->accept(this); 
+        emit_label(branch_labels[i]);
+        var_env.enterScope();
+        cgen_bind_local(std::get<0>(expr->matches[i]).get(), offset++);
+        std::get<1>(expr->matches[i])->accept(this);
+        offset--;
+        var_env.exitScope();
         emit_b("CaseLabel" + std::to_string(tagCaseEnd));
     }
 
-    if (there_is_object) {
-        emit_label("CaseLabel" + std::to_string(casecount++));
-        emit_blt(T2, classtag_map[object_formal->type_.lexeme], "CaseLabel" + std::to_string(casecount));
-        emit_bgt(T2, max_inherited_class_tag(object_formal->type_), "CaseLabel" + std::to_string(casecount));
-        obj_expr->accept(this); 
-        emit_b("CaseLabel" + std::to_string(tagCaseEnd));
-    }
-    
     // Not found corresponding case.
-    emit_label("CaseLabel" + std::to_string(casecount++));
+    emit_label(abort_label);
     emit_jal("_case_abort");
     // code after the switch case.
     emit_label("CaseLabel" + std::to_string(tagCaseEnd));
 }
 
-}   // end of namespace.
\ No newline at end of file
+std::vector<CaseInterval> Cgen::case_intervals(const std::string& static_type, const std::vector<std::string>& branch_types) {
+
+    // the branch taken for a tag is the one of the closest ancestor of its class.
+    // Since tags are given in DFS preorder, painting the tag ranges of the
+    // branches from the highest in the hierarchy to the lowest (increasing tags)
+    // leaves every tag with its branch (-1 when no branch matches).
+    std::vector<std::size_t> order(branch_types.size());
+    for (std::size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [this, &branch_types](std::size_t a, std::size_t b) {
+        return classtag_map[branch_types[a]] < classtag_map[branch_types[b]];
+    });
+
+    // the object can only have the tag of a class conforming to the type of
+    // the expression.
+    auto scrutinee_range = class_tag_ranges.find(static_type);
+    if (scrutinee_range == class_tag_ranges.end())
+        scrutinee_range = class_tag_ranges.find(Object.lexeme);
+    auto& possible_tags = scrutinee_range->second;
+    std::vector<int> branch_of_tag(class_tag_ranges[Object.lexeme].second + 1, -1);
+    for (auto i: order) {
+        auto& range = class_tag_ranges[branch_types[i]];
+        for (int tag = range.first; tag <= range.second; tag++)
+            branch_of_tag[tag] = i;
+    }
+
+    // consecutive tags going to the same branch form an interval.
+    std::vector<CaseInterval> intervals;
+    for (int tag = possible_tags.first; tag <= possible_tags.second; tag++) {
+        if (intervals.empty() || intervals.back().branch != branch_of_tag[tag])
+            intervals.push_back({tag, tag, branch_of_tag[tag]});
+        else
+            intervals.back().hi = tag;
+    }
+
+    return intervals;
+}
+
+void Cgen::cgen_case_search(std::vector<CaseInterval>& intervals, std::size_t first, std::size_t last,
+        std::vector<std::string>& branch_labels, std::string& abort_label) {
+
+    // binary search on the tag in T2: O(log n) branches for n intervals.
+    auto target = [&](std::size_t i) -> std::string& {
+        return intervals[i].branch >= 0 ? branch_labels[intervals[i].branch] : abort_label;
+    };
+    if (first == last) {
+        emit_b(target(first));
+        return;
+    }
+    std::size_t middle = (first + last + 1) / 2;
+    if (middle - 1 == first) {
+        // the lower half is a single interval, jump right to its branch.
+        emit_blt(T2, intervals[middle].lo, target(first));
+        cgen_case_search(intervals, middle, last, branch_labels, abort_label);
+        return;
+    }
+    std::string lower_half = "CaseLabel" + std::to_string(casecount++);
+    emit_blt(T2, intervals[middle].lo, lower_half);
+    cgen_case_search(intervals, middle, last, branch_labels, abort_label);
+    emit_label(lower_half);
+    cgen_case_search(intervals, first, middle - 1, branch_labels, abort_label);
+}
+
+void Cgen::cgen_case_jump_table(std::vector<CaseInterval>& intervals,
+        std::vector<std::string>& branch_labels, std::string& abort_label) {
+
+    // the intervals cover all the tags the object can have so the tag in T2
+    // directly indexes a table holding the address of the branch of every tag.
+    std::string table = "CaseTable" + std::to_string(casecount++);
+    emit_la(T1, table);
+    emit_addiu(T2, T2, -intervals.front().lo);
+    emit_sll(T2, T2, LOG_WORD_SIZE);
+    emit_addu(T1, T1, T2);
+    emit_lw(T1, 0, T1);
+    emit_jr(T1);
+
+    case_tables << table << LABEL;
+    for (auto& interval: intervals) {
+        for (int tag = interval.lo; tag <= interval.hi; tag++)
+            case_tables << WORD << (interval.branch >= 0 ? branch_labels[interval.branch] : abort_label) << std::endl;
+    }
+}
+
+void Cgen::collect_tail_calls(Expr* expr) {
+    switch (typeId.identify(expr)) {
+        case Type::Dispatch:
+        case Type::StaticDispatch:
+            tail_calls.insert(expr);
+            break;
+        case Type::Grouping:
+            collect_tail_calls(static_cast<Grouping*>(expr)->expr.get());
+            break;
+        case Type::Block:
+            collect_tail_calls(static_cast<Block*>(expr)->exprs.back().get());
+            break;
+        case Type::If:
+            collect_tail_calls(static_cast<If*>(expr)->thenBranch.get());
+            collect_tail_calls(static_cast<If*>(expr)->elseBranch.get());
+            break;
+        case Type::Let:
+            collect_tail_calls(static_cast<Let*>(expr)->body.get());
+            break;
+        case Type::Case:
+            for (auto& match: static_cast<Case*>(expr)->matches)
+                collect_tail_calls(std::get<1>(match).get());
+            break;
+        default:
+            break;
+    }
+}
+
+bool Cgen::cgen_tail_dispatch(Expr* expr, Expr* receiver, std::vector<std::unique_ptr<Expr>>& args,
+        Token& callee_name, const std::string& target) {
+
+    if (!inside_function || inlining || !tail_calls.count(expr))
+        return false;
+
+    std::size_t nstack = cgen_call_args(expr, receiver, args);
+    auto& saved_regs = regalloc.used_registers();
+    std::size_t nsaved = saved_regs.size();
+    std::size_t nformals = curr_method->formals.size();
+    std::size_t curr_nstack = nformals > ARG_REGS ? nformals - ARG_REGS : 0;
+
+    if (target == curr_class->name.lexeme && callee_name == curr_method->id) {
+        // self recursion: the arguments become the formals of this AR and
+        // the method starts over.
+        for (std::size_t i = 0; i < nstack; i++) {
+            emit_lw(T1, (i + 1) * WORD_SIZE, SP);
+            emit_sw(T1, (nstack + nsaved + curr_frame_size + i + 1) * WORD_SIZE, SP);
+        }
+        if (nstack)
+            emit_pop(nstack);
+        emit_b(tail_loop_label);
+        self_tail_call_count++;
+        return true;
+    }
+
+    if (target.empty()) {
+        emit_lw(T1, 8, ACC); // to get the dispatch table pointer.
+        emit_lw(T1, method_table[receiver->expr_type.lexeme][callee_name.lexeme] * WORD_SIZE, T1);
+    }
+
+    // restore what the epilogue would: the callee-saved registers, the
+    // return address, fp and self of the current method's caller.
+    for (std::size_t i = 0; i < nsaved; i++)
+        emit_lw(saved_regs[i], (nstack + i + 1) * WORD_SIZE, SP);
+    std::size_t frame = nstack + nsaved;
+    if (curr_frame.calls)
+        emit_lw(RA, (frame + 1) * WORD_SIZE, SP);
+    if (curr_frame.uses_fp)
+        emit_lw(FP, (frame + 2) * WORD_SIZE, SP);
+    if (curr_frame.uses_self)
+        emit_lw(SELF, (frame + 3) * WORD_SIZE, SP);
+
+    // the callee returns to the caller of the current method, which expects
+    // the formals it passed on the stack to be popped: the arguments passed
+    // on the stack go right below them. Copy from the last not to overwrite
+    // arguments not copied yet.
+    std::size_t shift = nsaved + curr_frame_size + curr_nstack;
+    for (std::size_t i = nstack; shift && i-- > 0; ) {
+        emit_lw(T2, (i + 1) * WORD_SIZE, SP);
+        emit_sw(T2, (shift + i + 1) * WORD_SIZE, SP);
+    }
+    if (shift)
+        emit_addiu(SP, SP, shift * WORD_SIZE);
+
+    if (target.empty())
+        emit_jr(T1);
+    else
+        emit_j(target + METHOD_SEP + callee_name.lexeme);
+    tail_call_count++;
+    return true;
+}
+
+}   // end of namespace.
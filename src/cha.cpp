@@ -0,0 +1,79 @@
+#include "cha.hpp"
+
+namespace cool {
+
+const std::string& ClassHierarchy::implementation(const std::string& class_name, const std::string& method) {
+    auto& cached = implementations[class_name];
+    auto impl = cached.find(method);
+    if (impl != cached.end())
+        return impl->second;
+
+    // go up the inheritance tree until a class defines the method.
+    Class* class_ = class_table_ptr->get(class_name);
+    while (class_) {
+        for (auto& f: class_->features) {
+            if (f->featuretype == FeatureType::METHOD && f->id.lexeme == method)
+                return cached[method] = class_->name.lexeme;
+        }
+        if (class_->superClass == No_class)
+            break;
+        class_ = class_table_ptr->get(class_->superClass.lexeme);
+    }
+    return cached[method] = "";
+}
+
+const std::string& ClassHierarchy::unique_implementation(const std::string& class_name, const std::string& method) {
+    auto& cached = unique_implementations[class_name];
+    auto impl = cached.find(method);
+    if (impl != cached.end())
+        return impl->second;
+
+    const std::string& target = implementation(class_name, method);
+    Token root{TokenType::IDENTIFIER, class_name};
+    for (auto& sub: g->DFS(root)) {
+        if (implementation(sub.lexeme, method) != target)
+            return cached[method] = "";
+    }
+    return cached[method] = target;
+}
+
+std::string ClassHierarchy::introducing_class(const std::string& class_name, const std::string& method) {
+    std::string introducing = implementation(class_name, method);
+    while (!introducing.empty()) {
+        Class* class_ = class_table_ptr->get(introducing);
+        if (class_->superClass == No_class)
+            break;
+        const std::string& above = implementation(class_->superClass.lexeme, method);
+        if (above.empty())
+            break;
+        introducing = above;
+    }
+    return introducing;
+}
+
+Feature* ClassHierarchy::get_method(const std::string& class_name, const std::string& method) {
+    const std::string& impl = implementation(class_name, method);
+    if (impl.empty())
+        return nullptr;
+    for (auto& f: class_table_ptr->get(impl)->features) {
+        if (f->featuretype == FeatureType::METHOD && f->id.lexeme == method)
+            return f.get();
+    }
+    return nullptr;
+}
+
+std::string ClassHierarchy::attribute_type(const std::string& class_name, const std::string& attr) {
+    Class* class_ = class_table_ptr->get(class_name);
+    while (class_) {
+        for (auto& f: class_->features) {
+            if (f->featuretype == FeatureType::ATTRIBUT && f->id.lexeme == attr)
+                return f->type_.lexeme;
+        }
+        if (class_->superClass == No_class)
+            break;
+        class_ = class_table_ptr->get(class_->superClass.lexeme);
+    }
+    return "";
+}
+
+}
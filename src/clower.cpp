@@ -0,0 +1,592 @@
+#include "cgen.hpp"
+#include "emit.hpp"
+#include <algorithm>
+
+// C generation from the IR (--target=c): a single C11 translation unit built
+// with the native runtime through lib/runtime/coolrt.h.
+// The data is the one of the native code: the prototypes, the dispatch
+// tables of function pointers, the constants and class_nameTab, as static
+// definitions with the layout of the runtime. Every method and _init is a
+// static C function taking self and the arguments, dispatches calling the
+// function of the table cast to its type. The objects a function holds live
+// in its slots of the shadow stack, which the collector updates, and its
+// raw values in C variables; phis are assigned on the edges, the blocks
+// being labels. The calls whose result is only returned are emitted after
+// the slots of the function are given back, so the C compiler can make them
+// jumps. Only the definitions the program reaches are emitted.
+
+namespace cool {
+
+namespace {
+
+// the methods of the basic classes, in the runtime.
+const char* const c_natives[] = {
+    "Object.abort", "Object.type_name", "Object.copy", "IO.out_string", "IO.out_int",
+    "IO.in_string", "IO.in_int", "String.length", "String.concat", "String.substr",
+};
+
+std::string c_identifier(const std::string& label) {
+    std::string name = label;
+    std::replace(name.begin(), name.end(), '.', '_');
+    return name;
+}
+
+// the type of a function taking `nparams` objects.
+std::string c_function_type(std::size_t nparams) {
+    std::string type = "cool_Object* (*)(";
+    for (std::size_t i = 0; i < nparams; i++)
+        type += i ? ", cool_Object*" : "cool_Object*";
+    return type + ")";
+}
+
+// a C literal of the characters of a string, the ones that could be read
+// otherwise in octal.
+std::string c_string_literal(const std::string& chars) {
+    static const char digits[] = "01234567";
+    std::string literal = "\"";
+    for (unsigned char c: chars) {
+        if (c == '"' || c == '\\') {
+            literal += '\\';
+            literal += c;
+        } else if (c >= ' ' && c <= '~' && c != '?') {
+            literal += c;
+        } else {
+            literal += '\\';
+            literal += digits[c >> 6];
+            literal += digits[(c >> 3) & 7];
+            literal += digits[c & 7];
+        }
+    }
+    return literal + "\"";
+}
+
+// `object` as the operand of ->.
+std::string c_pointer(const std::string& object) {
+    return object[0] == '&' ? "(" + object + ")" : object;
+}
+
+std::string c_int(int value) {
+    // the smallest int can't be written as a literal.
+    if (value == INT32_MIN)
+        return "(-2147483647 - 1)";
+    return std::to_string(value);
+}
+
+}
+
+void Cgen::c_code_text() {
+    // the data labels are taken, the functions are named after their label.
+    for (auto& entry: classtag_map) {
+        c_taken.insert(entry.first + PROTOBJ_SUFFIX);
+        c_taken.insert(entry.first + DISPTAB_SUFFIX);
+    }
+    for (auto& function: ir_module.functions)
+        c_function_name(function->name);
+
+    c_data();
+    for (auto& function: ir_module.functions)
+        c_function(*function);
+
+    // create Main, run its _init and main.
+    std::string start_name = "cool_main";
+    c_order.push_back(start_name);
+    CDefinition& start = c_definitions[start_name];
+    c_current = &start;
+    std::ostringstream code;
+    std::string main_init = std::string("Main") + CLASSINIT_SUFFIX;
+    code << "static void " << start_name << "(void) {\n";
+    code << "    cool_Object** s = cool_enter(1);\n";
+    code << "    s[0] = cool_copy(" << c_word(std::string("Main") + PROTOBJ_SUFFIX) << ");\n";
+    if (ir_module.get(main_init))
+        code << "    s[0] = " << c_use(c_function_name(main_init)) << "(s[0]);\n";
+    code << "    ((" << c_function_type(1) << ")s[0]->disp[" << method_table["Main"]["main"] << "])(s[0]);\n";
+    code << "}\n";
+    start.code = code.str();
+
+    // what the program reaches from its start and from the runtime.
+    std::vector<std::string> work{start_name, CLASSNAMETAB, std::string("Int") + PROTOBJ_SUFFIX,
+                                  std::string("String") + PROTOBJ_SUFFIX};
+    std::unordered_set<std::string> reached(work.begin(), work.end());
+    while (!work.empty()) {
+        std::string name = work.back();
+        work.pop_back();
+        for (auto& used: c_definitions[name].uses) {
+            if (c_definitions.count(used) && reached.insert(used).second)
+                work.push_back(used);
+        }
+    }
+
+    os << "#include \"coolrt.h\"\n\n";
+    for (auto& name: c_order) {
+        if (reached.count(name) && !c_definitions[name].declaration.empty())
+            os << c_definitions[name].declaration << ";\n";
+    }
+    os << "\n";
+    for (auto& name: c_order) {
+        if (reached.count(name) && c_definitions[name].declaration.empty() && name != start_name)
+            os << c_definitions[name].code;
+    }
+    for (auto& name: c_order) {
+        if (reached.count(name) && !c_definitions[name].declaration.empty())
+            os << "\n" << c_definitions[name].code;
+    }
+    os << "\n" << start.code;
+    os << "\nint main(void) {\n";
+    os << "    static const cool_Program program = {" << CLASSNAMETAB << ", " << c_word(std::string("Int") + PROTOBJ_SUFFIX)
+       << ", " << c_word(std::string("String") + PROTOBJ_SUFFIX) << ", " << INT_CLASS_TAG << ", " << BOOL_CLASS_TAG
+       << ", " << STRING_CLASS_TAG << ", {" << static_cast<int>(gc.collector) << ", " << gc.heap_init << ", "
+       << gc.heap_max << ", " << gc.nursery_percent << ", " << gc.stats << "}};\n";
+    os << "    cool_start(&program, " << start_name << ");\n";
+    os << "}\n";
+}
+
+void Cgen::c_data() {
+    auto define = [this](const std::string& name) -> CDefinition& {
+        c_order.push_back(name);
+        c_current = &c_definitions[name];
+        return *c_current;
+    };
+    std::vector<std::pair<std::string, int>> classes(classtag_map.begin(), classtag_map.end());
+    std::sort(classes.begin(), classes.end(), [](auto& a, auto& b) { return a.second < b.second; });
+
+    // the dispatch tables, with the method of the closest class defining it.
+    for (auto& entry: classes) {
+        if (!reachability.is_instantiated(entry.first))
+            continue;
+        std::string name = entry.first + DISPTAB_SUFFIX;
+        CDefinition& table = define(name);
+        std::vector<std::string> methods(method_table[entry.first].size(), "0");
+        for (auto& method: method_table[entry.first]) {
+            for (Class* c = class_table_ptr->get(entry.first); ; c = class_table_ptr->get(c->superClass.lexeme)) {
+                auto defines = std::find_if(c->features.begin(), c->features.end(), [&](auto& f) {
+                    return f->featuretype == FeatureType::METHOD && f->id.lexeme == method.first;
+                });
+                if (defines != c->features.end()) {
+                    std::string label = c->name.lexeme + METHOD_SEP + method.first;
+                    if (is_base_class(c) || ir_module.get(label))
+                        methods[method.second] = "(cool_method)" + c_use(c_function_name(label));
+                    break;
+                }
+                if (c->superClass == No_class)
+                    break;
+            }
+        }
+        std::ostringstream code;
+        code << "static const cool_method " << name << "[] = {";
+        for (std::size_t i = 0; i < methods.size(); i++)
+            code << (i ? ", " : "") << methods[i];
+        code << "};\n";
+        table.code = code.str();
+    }
+
+    for (auto& elt: inttable().get_elements()) {
+        int value = std::stoi(elt.first);
+        if (!reachability.uses_int(value))
+            continue;
+        std::string name = INTCONST_PREFIX + std::to_string(inttable().get_index(elt.first));
+        CDefinition& constant = define(name);
+        constant.code = "static cool_Int " + name + " = {{" + std::to_string(INT_CLASS_TAG) + ", 0, " +
+                        std::to_string(DEFAULT_OBJFIELDS + INT_SLOTS) + ", " + c_use(std::string("Int") + DISPTAB_SUFFIX) +
+                        "}, " + c_int(value) + "};\n";
+    }
+    for (int value = 0; value < 2; value++) {
+        std::string name = value ? BOOLCONST_TRUE : BOOLCONST_FALSE;
+        CDefinition& constant = define(name);
+        constant.code = "static cool_Int " + name + " = {{" + std::to_string(BOOL_CLASS_TAG) + ", 0, " +
+                        std::to_string(DEFAULT_OBJFIELDS + BOOL_SLOTS) + ", " + c_use(std::string("Bool") + DISPTAB_SUFFIX) +
+                        "}, " + std::to_string(value) + "};\n";
+    }
+
+    // the characters of a string are followed by at least one '\0', as in
+    // the x86-64 data.
+    for (auto& elt: stringtable().get_elements()) {
+        if (!reachability.uses_string(elt.first))
+            continue;
+        std::string name = STRCONST_PREFIX + std::to_string(stringtable().get_index(elt.first));
+        CDefinition& constant = define(name);
+        std::size_t chars = (elt.first.size() / X86_WORD_SIZE + 1) * X86_WORD_SIZE;
+        std::string length = INTCONST_PREFIX + std::to_string(inttable().get_index(std::to_string(unescape(elt.first).size())));
+        c_use(length);
+        constant.code = "static struct { cool_Object header; cool_Int* length; char chars[" + std::to_string(chars) +
+                        "]; } " + name + " = {{" + std::to_string(STRING_CLASS_TAG) + ", 0, " +
+                        std::to_string(DEFAULT_OBJFIELDS + STRING_SLOTS + chars / X86_WORD_SIZE) + ", " +
+                        c_use(std::string("String") + DISPTAB_SUFFIX) + "}, &" + length + ", " +
+                        c_string_literal(unescape(elt.first)) + "};\n";
+    }
+
+    for (auto& entry: classes) {
+        if (!reachability.is_instantiated(entry.first))
+            continue;
+        std::string name = entry.first + PROTOBJ_SUFFIX;
+        CDefinition& proto = define(name);
+        auto& words = proto_attrs[entry.first];
+        std::ostringstream code;
+        code << "static struct { cool_Object header;";
+        if (!words.empty())
+            code << " cool_Object* attributes[" << words.size() << "];";
+        code << " } " << name << " = {{" << entry.second << ", 0, " << DEFAULT_OBJFIELDS + words.size() << ", "
+             << c_use(entry.first + DISPTAB_SUFFIX) << "}";
+        if (!words.empty()) {
+            code << ", {";
+            for (std::size_t i = 0; i < words.size(); i++)
+                code << (i ? ", " : "") << c_word(words[i]);
+            code << "}";
+        }
+        code << "};\n";
+        proto.code = code.str();
+    }
+
+    // the name of the class of every tag, from the tag of Object.
+    CDefinition& names = define(CLASSNAMETAB);
+    std::ostringstream code;
+    code << "static cool_Object* const " << CLASSNAMETAB << "[] = {0, 0, 0, 0";
+    for (auto& entry: classes) {
+        if (reachability.is_instantiated(entry.first))
+            code << ", " << c_word(STRCONST_PREFIX + std::to_string(stringtable().get_index(entry.first)));
+        else
+            code << ", 0";
+    }
+    code << "};\n";
+    names.code = code.str();
+}
+
+void Cgen::c_function(IRFunction& function) {
+    split_critical_edges(function);
+    verify_or_die(function, "after splitting the critical edges");
+
+    std::string name = c_function_name(function.name);
+    c_order.push_back(name);
+    CDefinition& definition = c_definitions[name];
+    c_current = &definition;
+
+    // the objects get a slot, the raw values a variable.
+    ir_slots.clear();
+    ir_labels.clear();
+    ir_tail_calls.clear();
+    std::size_t nobjects = 0;
+    std::vector<IRInstr*> raws;
+    std::unordered_set<IRBlock*> labeled;
+    for (std::size_t i = 0; i < function.blocks.size(); i++) {
+        IRBlock* block = function.blocks[i].get();
+        IRBlock* next = i + 1 < function.blocks.size() ? function.blocks[i + 1].get() : nullptr;
+        ir_labels[block] = "b" + std::to_string(i);
+        bool tail_call = false;
+        for (auto& instr: block->instrs) {
+            if (ir_is_tail_call(instr.get())) {
+                ir_tail_calls.insert(instr.get());
+                tail_call = true;
+                break;
+            }
+            if (instr->type == IRType::None || (instr->op != IROp::Param && ir_rematerialized(instr.get())))
+                continue;
+            if (instr->type == IRType::Obj) {
+                ir_slots[instr.get()] = nobjects++;
+            } else {
+                ir_slots[instr.get()] = raws.size();
+                raws.push_back(instr.get());
+            }
+        }
+        // the blocks jumped to, but not falling through.
+        IRInstr* exit = block->terminator();
+        if (tail_call || exit->op == IROp::Return)
+            continue;
+        if (exit->op == IROp::TypeCase) {
+            for (auto& interval: case_intervals(exit->class_name, exit->cases)) {
+                if (interval.branch >= 0)
+                    labeled.insert(exit->targets[interval.branch]);
+            }
+            continue;
+        }
+        for (IRBlock* target: exit->targets) {
+            if (target != next)
+                labeled.insert(target);
+        }
+    }
+
+    std::ostringstream declaration;
+    declaration << "static cool_Object* " << name << "(";
+    for (std::size_t i = 0; i < function.nparams; i++)
+        declaration << (i ? ", " : "") << "cool_Object* p" << i;
+    declaration << ")";
+    definition.declaration = declaration.str();
+
+    std::ostringstream code;
+    std::streambuf* out = os.rdbuf(code.rdbuf());
+    os << definition.declaration << " {\n";
+    os << "    cool_Object** s = cool_enter(" << nobjects << ");\n";
+    for (std::size_t i = 0; i < raws.size(); i++)
+        os << "    int32_t v" << i << " = 0;\n";
+    for (std::size_t i = 0; i < function.blocks.size(); i++) {
+        IRBlock* block = function.blocks[i].get();
+        IRBlock* next = i + 1 < function.blocks.size() ? function.blocks[i + 1].get() : nullptr;
+        if (labeled.count(block))
+            os << ir_labels[block] << ":\n";
+        for (auto& instr: block->instrs) {
+            c_instr(instr.get(), next);
+            // the rest of the block is the return of the result.
+            if (ir_tail_calls.count(instr.get()))
+                break;
+        }
+    }
+    os << "}\n";
+    os.rdbuf(out);
+    definition.code = code.str();
+}
+
+void Cgen::c_instr(IRInstr* instr, IRBlock* next) {
+    auto& ops = instr->operands;
+    std::string result = ir_slots.count(instr) ? c_value(instr) : "";
+
+    switch (instr->op) {
+        case IROp::Param:
+            if (!result.empty())
+                os << "    " << result << " = p" << instr->value << ";\n";
+            break;
+        case IROp::Const:
+        case IROp::String:
+        case IROp::Void:
+        case IROp::Phi:
+            break;
+
+        // Int arithmetic wraps around.
+        case IROp::Add:
+        case IROp::Sub:
+        case IROp::Mul: {
+            const char* op = instr->op == IROp::Add ? " + " : instr->op == IROp::Sub ? " - " : " * ";
+            os << "    " << result << " = (int32_t)((uint32_t)" << c_value(ops[0]) << op << "(uint32_t)"
+               << c_value(ops[1]) << ");\n";
+            break;
+        }
+        case IROp::Div:
+            os << "    " << result << " = cool_divide(" << c_value(ops[0]) << ", " << c_value(ops[1]) << ");\n";
+            break;
+        case IROp::Neg:
+            os << "    " << result << " = (int32_t)-(uint32_t)" << c_value(ops[0]) << ";\n";
+            break;
+        case IROp::Lt:
+        case IROp::Le:
+        case IROp::Eq: {
+            const char* op = instr->op == IROp::Lt ? " < " : instr->op == IROp::Le ? " <= " : " == ";
+            os << "    " << result << " = " << c_value(ops[0]) << op << c_value(ops[1]) << ";\n";
+            break;
+        }
+        case IROp::Not:
+            os << "    " << result << " = !" << c_value(ops[0]) << ";\n";
+            break;
+
+        case IROp::Box:
+            if (result.empty())
+                break;
+            if (ops[0]->type == IRType::Bool)
+                os << "    " << result << " = " << c_value(ops[0]) << " ? " << c_word(BOOLCONST_TRUE) << " : "
+                   << c_word(BOOLCONST_FALSE) << ";\n";
+            else
+                os << "    " << result << " = cool_new_int(" << c_value(ops[0]) << ");\n";
+            break;
+        case IROp::Unbox:
+            os << "    " << result << " = ((cool_Int*)" << c_value(ops[0]) << ")->val;\n";
+            break;
+        case IROp::ObjEq:
+            os << "    " << result << " = cool_equality_test(" << c_value(ops[0]) << ", " << c_value(ops[1]) << ");\n";
+            break;
+        case IROp::IsVoid:
+            // the constants are known.
+            if (!ir_slots.count(ops[0]))
+                os << "    " << result << " = " << (ops[0]->op == IROp::Void) << ";\n";
+            else
+                os << "    " << result << " = " << c_value(ops[0]) << " == 0;\n";
+            break;
+
+        case IROp::New: {
+            os << "    " << result << " = cool_copy(" << c_word(instr->class_name + PROTOBJ_SUFFIX) << ");\n";
+            std::string init = instr->class_name + CLASSINIT_SUFFIX;
+            if (!noop_inits.count(instr->class_name) && ir_module.get(init))
+                os << "    " << result << " = " << c_use(c_function_name(init)) << "(" << result << ");\n";
+            break;
+        }
+        case IROp::GetAttr:
+            os << "    " << result << " = ((cool_Object**)" << c_value(ops[0]) << ")["
+               << attr_table[instr->class_name][instr->name] + 2 << "];\n";
+            break;
+        case IROp::SetAttr: {
+            int word = attr_table[instr->class_name][instr->name] + 2;
+            // the constants aren't in the heap.
+            if (ir_slots.count(ops[1]))
+                os << "    cool_set_attribute(" << c_value(ops[0]) << ", " << word << ", " << c_value(ops[1]) << ");\n";
+            else
+                os << "    ((cool_Object**)" << c_value(ops[0]) << ")[" << word << "] = " << c_value(ops[1]) << ";\n";
+            break;
+        }
+        case IROp::Dispatch:
+        case IROp::Call:
+            c_call(instr);
+            break;
+        case IROp::CheckDispatch:
+        case IROp::CheckCase: {
+            const char* abort = instr->op == IROp::CheckDispatch ? "cool_dispatch_abort(" : "cool_case_abort2(";
+            if (!ir_slots.count(ops[0])) {
+                if (ops[0]->op == IROp::Void)
+                    os << "    " << abort << c_word(FILENAME) << ", " << instr->value << ");\n";
+                break;
+            }
+            os << "    if (!" << c_value(ops[0]) << ")\n";
+            os << "        " << abort << c_word(FILENAME) << ", " << instr->value << ");\n";
+            break;
+        }
+
+        case IROp::Jump:
+            c_phi_moves(instr->block, instr->targets[0]);
+            if (instr->targets[0] != next)
+                os << "    goto " << ir_labels[instr->targets[0]] << ";\n";
+            break;
+        case IROp::Branch:
+            c_branch(instr, next);
+            break;
+        case IROp::TypeCase:
+            c_type_case(instr);
+            break;
+        case IROp::Return:
+            os << "    cool_stack_top = s;\n";
+            os << "    return " << c_value(ops[0]) << ";\n";
+            break;
+    }
+}
+
+void Cgen::c_call(IRInstr* instr) {
+    auto& ops = instr->operands;
+    std::ostringstream call;
+    if (instr->op == IROp::Call)
+        call << c_use(c_function_name(instr->class_name + METHOD_SEP + instr->name));
+    else
+        call << "((" << c_function_type(ops.size()) << ")" << c_pointer(c_value(ops[0])) << "->disp["
+             << method_table[instr->class_name][instr->name] << "])";
+    call << "(";
+    for (std::size_t i = 0; i < ops.size(); i++)
+        call << (i ? ", " : "") << c_value(ops[i]);
+    call << ")";
+
+    // the arguments are read before the call, once the slots are given back.
+    if (ir_tail_calls.count(instr)) {
+        os << "    cool_stack_top = s;\n";
+        os << "    return " << call.str() << ";\n";
+        return;
+    }
+    os << "    ";
+    if (ir_slots.count(instr))
+        os << c_value(instr) << " = ";
+    os << call.str() << ";\n";
+}
+
+void Cgen::c_branch(IRInstr* instr, IRBlock* next) {
+    IRBlock* if_true = instr->targets[0];
+    IRBlock* if_false = instr->targets[1];
+    std::string cond = c_value(instr->operands[0]);
+    if (if_true == next) {
+        os << "    if (!" << cond << ")\n";
+        os << "        goto " << ir_labels[if_false] << ";\n";
+        return;
+    }
+    os << "    if (" << cond << ")\n";
+    os << "        goto " << ir_labels[if_true] << ";\n";
+    if (if_false != next)
+        os << "    goto " << ir_labels[if_false] << ";\n";
+}
+
+void Cgen::c_type_case(IRInstr* instr) {
+    std::string object = c_value(instr->operands[0]);
+    os << "    switch (" << c_pointer(object) << "->tag) {\n";
+    for (auto& interval: case_intervals(instr->class_name, instr->cases)) {
+        if (interval.branch < 0)
+            continue;
+        for (int tag = interval.lo; tag <= interval.hi; tag++)
+            os << "    case " << tag << ":\n";
+        os << "        goto " << ir_labels[instr->targets[interval.branch]] << ";\n";
+    }
+    os << "    }\n";
+    os << "    cool_case_abort(" << object << ");\n";
+}
+
+void Cgen::c_phi_moves(IRBlock* from, IRBlock* to) {
+    std::size_t index = std::find(to->preds.begin(), to->preds.end(), from) - to->preds.begin();
+    std::vector<std::pair<IRInstr*, IRInstr*>> moves;
+    bool overlap = false;
+    for (auto& instr: to->instrs) {
+        if (instr->op != IROp::Phi)
+            break;
+        IRInstr* source = instr->operands[index];
+        if (source == instr.get())
+            continue;
+        moves.push_back({instr.get(), source});
+        overlap = overlap || (source->op == IROp::Phi && source->block == to);
+    }
+
+    // when a phi takes the value of another, all the values are read before
+    // any is written.
+    if (overlap) {
+        os << "    {\n";
+        for (std::size_t i = 0; i < moves.size(); i++)
+            os << "        " << (moves[i].first->type == IRType::Obj ? "cool_Object*" : "int32_t") << " t" << i << " = "
+               << c_value(moves[i].second) << ";\n";
+        for (std::size_t i = 0; i < moves.size(); i++)
+            os << "        " << c_value(moves[i].first) << " = t" << i << ";\n";
+        os << "    }\n";
+        return;
+    }
+    for (auto& move: moves)
+        os << "    " << c_value(move.first) << " = " << c_value(move.second) << ";\n";
+}
+
+const std::string& Cgen::c_use(const std::string& name) {
+    c_current->uses.push_back(name);
+    return name;
+}
+
+std::string Cgen::c_value(IRInstr* value) {
+    auto slot = ir_slots.find(value);
+    if (slot != ir_slots.end()) {
+        if (value->type == IRType::Obj)
+            return "s[" + std::to_string(slot->second) + "]";
+        return "v" + std::to_string(slot->second);
+    }
+    switch (value->op) {
+        case IROp::Const:
+            return c_int(value->value);
+        case IROp::String:
+            return c_word(STRCONST_PREFIX + std::to_string(stringtable().get_index(value->name)));
+        case IROp::Void:
+            return "((cool_Object*)0)";
+        case IROp::Box: {
+            IRInstr* raw = value->operands[0];
+            if (raw->type == IRType::Bool)
+                return c_word(raw->value ? BOOLCONST_TRUE : BOOLCONST_FALSE);
+            return c_word(INTCONST_PREFIX + std::to_string(inttable().get_index(std::to_string(raw->value))));
+        }
+        default:
+            std::cerr << "IR value %" << value->id << " isn't available.\n";
+            exit(EXIT_FAILURE);
+    }
+}
+
+std::string Cgen::c_word(const std::string& word) {
+    if (word == "0")
+        return word;
+    return "&" + c_use(word) + ".header";
+}
+
+std::string Cgen::c_function_name(const std::string& label) {
+    for (const char* native: c_natives) {
+        if (label == native)
+            return "cool_" + c_identifier(label);
+    }
+    auto found = c_names.find(label);
+    if (found != c_names.end())
+        return found->second;
+    // Class.method and Class_init may give the same name.
+    std::string name = c_identifier(label);
+    for (std::size_t i = 1; c_taken.count(name); i++)
+        name = c_identifier(label) + "_" + std::to_string(i);
+    c_taken.insert(name);
+    return c_names[label] = name;
+}
+
+}
@@ -0,0 +1,289 @@
+#include "escape.hpp"
+#include "constants.hpp"
+#include "emit.hpp"
+
+namespace cool {
+
+void EscapeAnalysis::run(Program* program) {
+    // the summaries only grow, start from nothing escaping and walk the
+    // program again until they are stable.
+    do {
+        summaries_changed = false;
+        program->accept(this);
+    } while (summaries_changed);
+
+    for (auto& site: sites) {
+        const std::string& class_name = site.expr->expr_type.lexeme;
+        if (site.escapes || !site.method || !keeps_object(class_name))
+            continue;
+        stack_offsets[site.expr] = stack_words[site.method];
+        stack_words[site.method] += object_size(class_name);
+    }
+}
+
+bool EscapeAnalysis::keeps_object(const std::string& class_name) {
+    // `new SELF_TYPE` has a runtime class, Int, Bool and String objects are
+    // only created by the runtime.
+    if (class_name == SELF_TYPE.lexeme || class_name == Int.lexeme || class_name == Bool.lexeme ||
+        class_name == Str.lexeme)
+        return false;
+
+    // its _init runs the attribute initializers of all its ancestors.
+    Class* class_ = class_table_ptr->get(class_name);
+    while (true) {
+        if (escaping_init.count(class_->name.lexeme))
+            return false;
+        if (class_->superClass == No_class)
+            return true;
+        class_ = class_table_ptr->get(class_->superClass.lexeme);
+    }
+}
+
+std::size_t EscapeAnalysis::object_size(const std::string& class_name) {
+    std::size_t size = DEFAULT_OBJFIELDS;
+    Class* class_ = class_table_ptr->get(class_name);
+    while (true) {
+        for (auto& f: class_->features)
+            size += f->featuretype == FeatureType::ATTRIBUT;
+        if (class_->superClass == No_class)
+            return size;
+        class_ = class_table_ptr->get(class_->superClass.lexeme);
+    }
+}
+
+void EscapeAnalysis::analyze(Class* class_) {
+    curr_class = class_;
+    for (auto& f: class_->features) {
+        if (!f->expr)
+            continue;
+        curr_method = f->featuretype == FeatureType::METHOD ? f.get() : nullptr;
+        loop_depth = 0;
+        scope.enterScope();
+        if (curr_method) {
+            escaping_formals[curr_method].resize(f->formals.size());
+            for (std::size_t i = 0; i < f->formals.size(); i++)
+                declare(f->formals[i].get(), {SELF_SOURCE - 1 - static_cast<int>(i)});
+        }
+
+        // the variables hold everything assigned to them anywhere in the
+        // method, walk it again until they are stable. An attribute
+        // initializer stores its value in self.
+        do {
+            vars_changed = false;
+            eval(f->expr.get(), curr_method != nullptr);
+            escape(value);
+        } while (vars_changed);
+
+        // a variable living longer than the loop a `new` is in could still
+        // refer to the object when its slot is reused.
+        for (auto& var: var_sources) {
+            for (int source: var.second) {
+                if (source >= 0 && var_depth[var.first] < sites[source].loop_depth)
+                    sites[source].escapes = true;
+            }
+        }
+
+        scope.exitScope();
+        var_sources.clear();
+        var_depth.clear();
+    }
+}
+
+void EscapeAnalysis::eval(Expr* expr, bool tail) {
+    in_tail = tail;
+    expr->accept(this);
+}
+
+void EscapeAnalysis::declare(Formal* formal, const std::set<int>& sources) {
+    scope.insert(formal->id.lexeme, formal);
+    var_depth[formal] = loop_depth;
+    for (int source: sources)
+        vars_changed |= var_sources[formal].insert(source).second;
+}
+
+void EscapeAnalysis::escape(const std::set<int>& sources) {
+    for (int source: sources) {
+        if (source >= 0)
+            sites[source].escapes = true;
+        else if (source == SELF_SOURCE && curr_method)
+            summaries_changed |= escaping_self.insert(curr_method).second;
+        else if (source == SELF_SOURCE)
+            summaries_changed |= escaping_init.insert(curr_class->name.lexeme).second;
+        else {
+            std::vector<bool>& formals = escaping_formals[curr_method];
+            std::size_t i = SELF_SOURCE - 1 - source;
+            summaries_changed |= !formals[i];
+            formals[i] = true;
+        }
+    }
+}
+
+void EscapeAnalysis::call(Expr* receiver, std::vector<std::unique_ptr<Expr>>& args, const std::string& target,
+        const std::string& callee_name, bool tail) {
+
+    std::vector<std::set<int>> arg_values;
+    for (auto& arg: args) {
+        eval(arg.get(), false);
+        arg_values.push_back(value);
+    }
+    eval(receiver, false);
+    std::set<int> receiver_value = value;
+    value.clear();
+
+    // a tail call frees the frame before the callee runs.
+    Feature* method = target.empty() ? nullptr : cha.get_method(target, callee_name);
+    if (!method || tail) {
+        for (auto& arg: arg_values)
+            escape(arg);
+        escape(receiver_value);
+        return;
+    }
+
+    // the methods of the runtime: copy, type_name, abort, in_string and
+    // in_int don't keep their receiver.
+    if (!method->expr) {
+        for (auto& arg: arg_values)
+            escape(arg);
+        bool keeps = callee_name == copy.lexeme || callee_name == type_name.lexeme ||
+                     callee_name == cool_abort.lexeme || callee_name == in_string.lexeme ||
+                     callee_name == in_int.lexeme;
+        if (!keeps)
+            escape(receiver_value);
+        return;
+    }
+
+    std::vector<bool> formals = escaping_formals[method];
+    formals.resize(method->formals.size());
+    for (std::size_t i = 0; i < arg_values.size(); i++) {
+        if (formals[i])
+            escape(arg_values[i]);
+    }
+    if (escaping_self.count(method))
+        escape(receiver_value);
+}
+
+void EscapeAnalysis::visitFeatureExpr(Feature* expr) { }
+
+void EscapeAnalysis::visitFormalExpr(Formal* expr) { }
+
+void EscapeAnalysis::visitAssignExpr(Assign* expr) {
+    eval(expr->expr.get(), false);
+    Formal* local = scope.get(expr->id.lexeme);
+    if (!local) {
+        escape(value);
+        return;
+    }
+    for (int source: value)
+        vars_changed |= var_sources[local].insert(source).second;
+}
+
+void EscapeAnalysis::visitIfExpr(If* expr) {
+    bool tail = in_tail;
+    eval(expr->cond.get(), false);
+    eval(expr->thenBranch.get(), tail);
+    std::set<int> then_value = std::move(value);
+    eval(expr->elseBranch.get(), tail);
+    value.insert(then_value.begin(), then_value.end());
+}
+
+void EscapeAnalysis::visitWhileExpr(While* expr) {
+    loop_depth++;
+    eval(expr->cond.get(), false);
+    eval(expr->expr.get(), false);
+    loop_depth--;
+    value.clear();
+}
+
+void EscapeAnalysis::visitBinaryExpr(Binary* expr) {
+    // comparing objects doesn't keep them.
+    eval(expr->lhs.get(), false);
+    eval(expr->rhs.get(), false);
+    value.clear();
+}
+
+void EscapeAnalysis::visitUnaryExpr(Unary* expr) {
+    eval(expr->expr.get(), false);
+    value.clear();
+}
+
+void EscapeAnalysis::visitVariableExpr(Variable* expr) {
+    value.clear();
+    if (expr->name == self) {
+        value.insert(SELF_SOURCE);
+        return;
+    }
+    Formal* local = scope.get(expr->name.lexeme);
+    if (local)
+        value = var_sources[local];
+}
+
+void EscapeAnalysis::visitNewExpr(New* expr) {
+    auto index = site_index.find(expr);
+    if (index == site_index.end()) {
+        index = site_index.insert({expr, static_cast<int>(sites.size())}).first;
+        sites.push_back({expr, curr_method, loop_depth, false});
+    }
+    value = {index->second};
+}
+
+void EscapeAnalysis::visitBlockExpr(Block* expr) {
+    bool tail = in_tail;
+    for (std::size_t i = 0; i < expr->exprs.size(); i++)
+        eval(expr->exprs[i].get(), tail && i + 1 == expr->exprs.size());
+}
+
+void EscapeAnalysis::visitGroupingExpr(Grouping* expr) {
+    eval(expr->expr.get(), in_tail);
+}
+
+void EscapeAnalysis::visitStaticDispatchExpr(StaticDispatch* expr) {
+    call(expr->expr.get(), expr->args, resolver.get_target(expr), expr->callee_name.lexeme, in_tail);
+}
+
+void EscapeAnalysis::visitDispatchExpr(Dispatch* expr) {
+    call(expr->expr.get(), expr->args, resolver.get_target(expr), expr->callee_name.lexeme, in_tail);
+}
+
+void EscapeAnalysis::visitLiteralExpr(Literal* expr) {
+    value.clear();
+}
+
+void EscapeAnalysis::visitLetExpr(Let* expr) {
+    bool tail = in_tail;
+    for (auto& let: expr->vecAssigns) {
+        value.clear();
+        if (std::get<1>(let))
+            eval(std::get<1>(let).get(), false);
+        scope.enterScope();
+        declare(std::get<0>(let).get(), value);
+    }
+    eval(expr->body.get(), tail);
+    for (std::size_t i = 0; i < expr->vecAssigns.size(); i++)
+        scope.exitScope();
+}
+
+void EscapeAnalysis::visitCaseExpr(Case* expr) {
+    bool tail = in_tail;
+    eval(expr->expr.get(), false);
+    std::set<int> scrutinee = std::move(value);
+    std::set<int> result;
+    for (auto& match: expr->matches) {
+        scope.enterScope();
+        declare(std::get<0>(match).get(), scrutinee);
+        eval(std::get<1>(match).get(), tail);
+        result.insert(value.begin(), value.end());
+        scope.exitScope();
+    }
+    value = std::move(result);
+}
+
+void EscapeAnalysis::visitProgramStmt(Program* stmt) {
+    for (auto& class_: stmt->classes)
+        class_->accept(this);
+}
+
+void EscapeAnalysis::visitClassStmt(Class* stmt) {
+    analyze(stmt);
+}
+
+}
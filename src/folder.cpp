@@ -0,0 +1,341 @@
+#include "folder.hpp"
+#include "assignednames.hpp"
+#include "constants.hpp"
+#include "tokentable.hpp"
+#include <cstdint>
+#include <set>
+
+namespace cool {
+
+// Collects the values of the Int literals of an expression.
+class IntLiterals: public ExprVisitor {
+    public:
+        std::set<int> values;
+
+        void visitFeatureExpr(Feature* expr) { if (expr->expr) expr->expr->accept(this); }
+        void visitFormalExpr(Formal* expr) { }
+        void visitAssignExpr(Assign* expr) { expr->expr->accept(this); }
+        void visitIfExpr(If* expr) {
+            expr->cond->accept(this);
+            expr->thenBranch->accept(this);
+            expr->elseBranch->accept(this);
+        }
+        void visitWhileExpr(While* expr) { expr->cond->accept(this); expr->expr->accept(this); }
+        void visitBinaryExpr(Binary* expr) { expr->lhs->accept(this); expr->rhs->accept(this); }
+        void visitUnaryExpr(Unary* expr) { expr->expr->accept(this); }
+        void visitVariableExpr(Variable* expr) { }
+        void visitNewExpr(New* expr) { }
+        void visitBlockExpr(Block* expr) {
+            for (auto& e: expr->exprs)
+                e->accept(this);
+        }
+        void visitGroupingExpr(Grouping* expr) { expr->expr->accept(this); }
+        void visitStaticDispatchExpr(StaticDispatch* expr) {
+            for (auto& arg: expr->args)
+                arg->accept(this);
+            expr->expr->accept(this);
+        }
+        void visitDispatchExpr(Dispatch* expr) {
+            for (auto& arg: expr->args)
+                arg->accept(this);
+            expr->expr->accept(this);
+        }
+        void visitLiteralExpr(Literal* expr) {
+            if (expr->object.type() == CoolType::Number_t)
+                values.insert(expr->object.int_value());
+        }
+        void visitLetExpr(Let* expr) {
+            for (auto& let: expr->vecAssigns) {
+                if (std::get<1>(let))
+                    std::get<1>(let)->accept(this);
+            }
+            expr->body->accept(this);
+        }
+        void visitCaseExpr(Case* expr) {
+            expr->expr->accept(this);
+            for (auto& match: expr->matches)
+                std::get<1>(match)->accept(this);
+        }
+};
+
+// Int operations wrap around on 32 bits like the mips instructions.
+static int wrap(std::int64_t value) {
+    return static_cast<std::int32_t>(static_cast<std::uint32_t>(value));
+}
+
+void ConstantFolder::fold(Program* program) {
+    program->accept(this);
+    shrink_inttable(program);
+}
+
+void ConstantFolder::fold(std::unique_ptr<Expr>& expr) {
+    expr->accept(this);
+    if (folded)
+        expr = std::move(folded);
+}
+
+const CoolObject* ConstantFolder::constant(Expr* expr) {
+    if (typeId.identify(expr) == Type::Literal)
+        return &static_cast<Literal*>(expr)->object;
+    return nullptr;
+}
+
+std::unique_ptr<Expr> ConstantFolder::make_literal(CoolObject&& object) {
+    auto literal = std::make_unique<Literal>(std::move(object));
+    switch (literal->object.type()) {
+        case CoolType::Number_t: literal->expr_type = Int; break;
+        case CoolType::Bool_t: literal->expr_type = Bool; break;
+        default: literal->expr_type = Str; break;
+    }
+    return literal;
+}
+
+void ConstantFolder::shrink_inttable(Program* program) {
+    // the scanner adds every int literal, the length of every string and
+    // identifier. Only the lengths of the strings and the literals left in
+    // the program are needed, the code generator adds the others it uses.
+    IntLiterals ints;
+    for (auto& class_: program->classes) {
+        for (auto& feature: class_->features)
+            feature->accept(&ints);
+    }
+    for (auto& elt: stringtable().get_elements())
+        ints.values.insert(unescape(elt.first).size());
+
+    inttable().clear();
+    for (auto value: ints.values)
+        inttable().insert(std::to_string(value), Token{NUMBER, std::to_string(value)});
+}
+
+void ConstantFolder::visitFeatureExpr(Feature* expr) {
+    if (!expr->expr)
+        return;
+    constants.enterScope();
+    for (auto& formal: expr->formals)
+        constants.insert(formal->id.lexeme, CoolObject{});
+    fold(expr->expr);
+    constants.exitScope();
+}
+
+void ConstantFolder::visitFormalExpr(Formal* expr) { }
+
+void ConstantFolder::visitAssignExpr(Assign* expr) {
+    fold(expr->expr);
+}
+
+void ConstantFolder::visitIfExpr(If* expr) {
+    fold(expr->cond);
+    auto cond = constant(expr->cond.get());
+    if (cond && cond->type() == CoolType::Bool_t) {
+        auto& taken = cond->bool_value() ? expr->thenBranch : expr->elseBranch;
+        fold(taken);
+        folded = std::move(taken);
+        folded_count++;
+        return;
+    }
+    fold(expr->thenBranch);
+    fold(expr->elseBranch);
+}
+
+void ConstantFolder::visitWhileExpr(While* expr) {
+    fold(expr->cond);
+    auto cond = constant(expr->cond.get());
+    if (cond && cond->type() == CoolType::Bool_t && !cond->bool_value()) {
+        // the body is never run.
+        expr->expr = make_literal(CoolObject{false});
+        folded_count++;
+        return;
+    }
+    fold(expr->expr);
+}
+
+void ConstantFolder::visitBinaryExpr(Binary* expr) {
+    fold(expr->lhs);
+    fold(expr->rhs);
+    auto lhs = constant(expr->lhs.get());
+    auto rhs = constant(expr->rhs.get());
+    if (!lhs || !rhs)
+        return;
+
+    if (expr->op.token_type == EQUAL) {
+        if (lhs->type() != rhs->type())
+            return;
+        switch (lhs->type()) {
+            case CoolType::Number_t:
+                folded = make_literal(CoolObject{lhs->int_value() == rhs->int_value()});
+                break;
+            case CoolType::Bool_t:
+                folded = make_literal(CoolObject{lhs->bool_value() == rhs->bool_value()});
+                break;
+            case CoolType::String_t:
+                folded = make_literal(CoolObject{unescape(lhs->string_value()) == unescape(rhs->string_value())});
+                break;
+            default:
+                return;
+        }
+        folded_count++;
+        return;
+    }
+
+    if (lhs->type() != CoolType::Number_t || rhs->type() != CoolType::Number_t)
+        return;
+    std::int64_t a = lhs->int_value(), b = rhs->int_value();
+    switch (expr->op.token_type) {
+        case PLUS: folded = make_literal(CoolObject{wrap(a + b)}); break;
+        case MINUS: folded = make_literal(CoolObject{wrap(a - b)}); break;
+        case STAR: folded = make_literal(CoolObject{wrap(a * b)}); break;
+        case SLASH:
+            if (b == 0)     // keep the runtime error.
+                return;
+            // INT_MIN / -1 overflows to INT_MIN.
+            folded = make_literal(CoolObject{wrap(a / b)});
+            break;
+        case LESS: folded = make_literal(CoolObject{a < b}); break;
+        case LESS_EQUAL: folded = make_literal(CoolObject{a <= b}); break;
+        default: return;
+    }
+    folded_count++;
+}
+
+void ConstantFolder::visitUnaryExpr(Unary* expr) {
+    fold(expr->expr);
+    auto value = constant(expr->expr.get());
+    if (!value)
+        return;
+    switch (expr->op.token_type) {
+        case TILDE:
+            if (value->type() != CoolType::Number_t)
+                return;
+            folded = make_literal(CoolObject{wrap(-static_cast<std::int64_t>(value->int_value()))});
+            break;
+        case NOT:
+            if (value->type() != CoolType::Bool_t)
+                return;
+            folded = make_literal(CoolObject{!value->bool_value()});
+            break;
+        case ISVOID:
+            // a literal is an object.
+            folded = make_literal(CoolObject{false});
+            break;
+        default:
+            return;
+    }
+    folded_count++;
+}
+
+void ConstantFolder::visitVariableExpr(Variable* expr) {
+    CoolObject* value = constants.get(expr->name.lexeme);
+    if (value && value->type() != CoolType::Void_t) {
+        folded = make_literal(CoolObject{*value});
+        propagated_count++;
+    }
+}
+
+void ConstantFolder::visitNewExpr(New* expr) { }
+
+void ConstantFolder::visitBlockExpr(Block* expr) {
+    std::vector<std::unique_ptr<Expr>> exprs;
+    for (std::size_t i = 0; i < expr->exprs.size(); i++) {
+        fold(expr->exprs[i]);
+        // the value of a literal or a variable is only of use at the end.
+        bool last = i + 1 == expr->exprs.size();
+        Type type = typeId.identify(expr->exprs[i].get());
+        if (!last && (type == Type::Literal || type == Type::Variable))
+            continue;
+        exprs.push_back(std::move(expr->exprs[i]));
+    }
+    expr->exprs = std::move(exprs);
+    if (expr->exprs.size() == 1)
+        folded = std::move(expr->exprs.back());
+}
+
+void ConstantFolder::visitGroupingExpr(Grouping* expr) {
+    fold(expr->expr);
+    if (constant(expr->expr.get()))
+        folded = std::move(expr->expr);
+}
+
+void ConstantFolder::visitStaticDispatchExpr(StaticDispatch* expr) {
+    for (auto& arg: expr->args)
+        fold(arg);
+    fold(expr->expr);
+}
+
+void ConstantFolder::visitDispatchExpr(Dispatch* expr) {
+    for (auto& arg: expr->args)
+        fold(arg);
+    fold(expr->expr);
+
+    // String can't be inherited so `length` on a string literal is the
+    // runtime one.
+    auto receiver = constant(expr->expr.get());
+    if (receiver && receiver->type() == CoolType::String_t && expr->callee_name == length) {
+        folded = make_literal(CoolObject{static_cast<int>(unescape(receiver->string_value()).size())});
+        folded_count++;
+    }
+}
+
+void ConstantFolder::visitLiteralExpr(Literal* expr) { }
+
+void ConstantFolder::visitLetExpr(Let* expr) {
+    AssignedNames assigned;
+    expr->accept(&assigned);
+
+    constants.enterScope();
+    letAssigns kept;
+    for (auto& let: expr->vecAssigns) {
+        auto& formal = std::get<0>(let);
+        auto& init = std::get<1>(let);
+        if (init)
+            fold(init);
+
+        // the value bound, the default one when there is no initialization.
+        CoolObject value;
+        if (init && constant(init.get()))
+            value = *constant(init.get());
+        else if (!init && formal->type_ == Int)
+            value = CoolObject{0};
+        else if (!init && formal->type_ == Bool)
+            value = CoolObject{false};
+        else if (!init && formal->type_ == Str)
+            value = CoolObject{std::string{}};
+
+        bool same_type = (value.type() == CoolType::Number_t && formal->type_ == Int) ||
+                         (value.type() == CoolType::Bool_t && formal->type_ == Bool) ||
+                         (value.type() == CoolType::String_t && formal->type_ == Str);
+        if (same_type && assigned.names.count(formal->id.lexeme) == 0) {
+            constants.insert(formal->id.lexeme, value);
+            continue;
+        }
+        constants.insert(formal->id.lexeme, CoolObject{});
+        kept.push_back(std::move(let));
+    }
+    fold(expr->body);
+    constants.exitScope();
+
+    expr->vecAssigns = std::move(kept);
+    if (expr->vecAssigns.empty())
+        folded = std::move(expr->body);
+}
+
+void ConstantFolder::visitCaseExpr(Case* expr) {
+    fold(expr->expr);
+    for (auto& match: expr->matches) {
+        constants.enterScope();
+        constants.insert(std::get<0>(match)->id.lexeme, CoolObject{});
+        fold(std::get<1>(match));
+        constants.exitScope();
+    }
+}
+
+void ConstantFolder::visitProgramStmt(Program* stmt) {
+    for (auto& class_: stmt->classes)
+        class_->accept(this);
+}
+
+void ConstantFolder::visitClassStmt(Class* stmt) {
+    for (auto& feature: stmt->features)
+        feature->accept(this);
+}
+
+}
@@ -0,0 +1,342 @@
+#include "hoister.hpp"
+#include "assignednames.hpp"
+#include "constants.hpp"
+#include <algorithm>
+
+namespace cool {
+
+// Collects the names assigned, the methods called and the classes created in
+// an expression.
+class EffectsCollector: public AssignedNames {
+    public:
+        std::set<std::string> called;
+        std::set<std::string> created;
+
+        void visitNewExpr(New* expr) { created.insert(expr->type_.lexeme); }
+        void visitStaticDispatchExpr(StaticDispatch* expr) {
+            called.insert(expr->callee_name.lexeme);
+            AssignedNames::visitStaticDispatchExpr(expr);
+        }
+        void visitDispatchExpr(Dispatch* expr) {
+            called.insert(expr->callee_name.lexeme);
+            AssignedNames::visitDispatchExpr(expr);
+        }
+
+        void merge_into(LoopHoister::Effects& effects) {
+            effects.assigned.insert(names.begin(), names.end());
+            effects.called.insert(called.begin(), called.end());
+            effects.created.insert(created.begin(), created.end());
+        }
+};
+
+static bool declared(const std::vector<std::string>& scope, const std::string& name) {
+    return std::find(scope.begin(), scope.end(), name) != scope.end();
+}
+
+void LoopHoister::run(Program* program) {
+    for (auto& class_: program->classes) {
+        parents[class_->name.lexeme] = class_->superClass.lexeme;
+        for (auto& f: class_->features) {
+            EffectsCollector collector;
+            if (f->expr)
+                f->expr->accept(&collector);
+            if (f->featuretype == FeatureType::METHOD)
+                collector.merge_into(method_effects[f->id.lexeme]);
+            else
+                collector.merge_into(init_effects[class_->name.lexeme]);
+        }
+    }
+    program->accept(this);
+}
+
+std::set<std::string> LoopHoister::killed_attributes(const Effects& effects) {
+    std::set<std::string> attributes;
+    std::set<std::string> methods;
+    std::set<std::string> classes;
+    std::vector<const Effects*> worklist{&effects};
+
+    while (!worklist.empty()) {
+        const Effects* e = worklist.back();
+        worklist.pop_back();
+        attributes.insert(e->assigned.begin(), e->assigned.end());
+        for (auto& method: e->called) {
+            auto callee = method_effects.find(method);
+            if (methods.insert(method).second && callee != method_effects.end())
+                worklist.push_back(&callee->second);
+        }
+
+        // the _init of a class runs the initializers of its ancestors, any
+        // of them for `new SELF_TYPE`.
+        std::vector<std::string> created(e->created.begin(), e->created.end());
+        if (e->created.count(SELF_TYPE.lexeme)) {
+            for (auto& parent: parents)
+                created.push_back(parent.first);
+        }
+        for (auto& class_name: created) {
+            for (std::string c = class_name; parents.count(c) && classes.insert(c).second; c = parents[c]) {
+                auto init = init_effects.find(c);
+                if (init != init_effects.end())
+                    worklist.push_back(&init->second);
+            }
+        }
+    }
+    return attributes;
+}
+
+void LoopHoister::walk(std::unique_ptr<Expr>& expr) {
+    expr->accept(this);
+    if (wrapping.empty())
+        return;
+    Token type = expr->expr_type;
+    auto let = std::make_unique<Let>(std::move(wrapping), std::move(expr));
+    let->expr_type = type;
+    wrapping.clear();
+    expr = std::move(let);
+}
+
+bool LoopHoister::invariant(std::unique_ptr<Expr>& expr) {
+    switch (typeId.identify(expr.get())) {
+        case Type::Literal:
+            return true;
+        case Type::Variable: {
+            const std::string& name = static_cast<Variable*>(expr.get())->name.lexeme;
+            if (name == self.lexeme)
+                return true;
+            if (declared(inner_scope, name) || loop_assigned.count(name))
+                return false;
+            return declared(scope, name) || !loop_killed.count(name);
+        }
+        case Type::Grouping:
+            return invariant(static_cast<Grouping*>(expr.get())->expr);
+        case Type::Binary: {
+            auto binary = static_cast<Binary*>(expr.get());
+            bool lhs = invariant(binary->lhs);
+            bool rhs = invariant(binary->rhs);
+            TokenType op = binary->op.token_type;
+            if (lhs && rhs && (op == PLUS || op == MINUS || op == STAR))
+                return true;
+            if (lhs)
+                hoist(binary->lhs);
+            if (rhs)
+                hoist(binary->rhs);
+            return false;
+        }
+        case Type::Unary: {
+            auto unary = static_cast<Unary*>(expr.get());
+            bool operand = invariant(unary->expr);
+            if (operand && unary->op.token_type == TILDE)
+                return true;
+            if (operand)
+                hoist(unary->expr);
+            return false;
+        }
+        case Type::Assign: {
+            auto assign = static_cast<Assign*>(expr.get());
+            if (invariant(assign->expr))
+                hoist(assign->expr);
+            return false;
+        }
+        case Type::If: {
+            auto if_ = static_cast<If*>(expr.get());
+            for (auto part: {&if_->cond, &if_->thenBranch, &if_->elseBranch}) {
+                if (invariant(*part))
+                    hoist(*part);
+            }
+            return false;
+        }
+        case Type::While: {
+            auto while_ = static_cast<While*>(expr.get());
+            for (auto part: {&while_->cond, &while_->expr}) {
+                if (invariant(*part))
+                    hoist(*part);
+            }
+            return false;
+        }
+        case Type::Block:
+            for (auto& e: static_cast<Block*>(expr.get())->exprs) {
+                if (invariant(e))
+                    hoist(e);
+            }
+            return false;
+        case Type::Dispatch:
+        case Type::StaticDispatch: {
+            bool is_static = typeId.identify(expr.get()) == Type::StaticDispatch;
+            auto& args = is_static ? static_cast<StaticDispatch*>(expr.get())->args : static_cast<Dispatch*>(expr.get())->args;
+            auto& receiver = is_static ? static_cast<StaticDispatch*>(expr.get())->expr : static_cast<Dispatch*>(expr.get())->expr;
+            for (auto& arg: args) {
+                if (invariant(arg))
+                    hoist(arg);
+            }
+            if (invariant(receiver))
+                hoist(receiver);
+            return false;
+        }
+        case Type::Let: {
+            auto let = static_cast<Let*>(expr.get());
+            for (auto& binding: let->vecAssigns) {
+                auto& init = std::get<1>(binding);
+                if (init && invariant(init))
+                    hoist(init);
+                inner_scope.push_back(std::get<0>(binding)->id.lexeme);
+            }
+            if (invariant(let->body))
+                hoist(let->body);
+            inner_scope.resize(inner_scope.size() - let->vecAssigns.size());
+            return false;
+        }
+        case Type::Case: {
+            auto case_ = static_cast<Case*>(expr.get());
+            if (invariant(case_->expr))
+                hoist(case_->expr);
+            for (auto& match: case_->matches) {
+                inner_scope.push_back(std::get<0>(match)->id.lexeme);
+                if (invariant(std::get<1>(match)))
+                    hoist(std::get<1>(match));
+                inner_scope.pop_back();
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+void LoopHoister::hoist(std::unique_ptr<Expr>& expr) {
+    // a variable, self or an attribute, costs a load wherever it is read.
+    switch (typeId.identify(expr.get())) {
+        case Type::Grouping:
+            hoist(static_cast<Grouping*>(expr.get())->expr);
+            return;
+        case Type::Binary:
+        case Type::Unary:
+            break;
+        default:
+            return;
+    }
+
+    Token id{TokenType::IDENTIFIER, "_inv" + std::to_string(temp_count++)};
+    Token type = expr->expr_type;
+    hoisted.push_back({std::make_unique<Formal>(id, type), std::move(expr)});
+    expr = std::make_unique<Variable>(id);
+    expr->expr_type = type;
+    hoisted_count++;
+}
+
+void LoopHoister::visitFeatureExpr(Feature* expr) {
+    if (!expr->expr)
+        return;
+    for (auto& formal: expr->formals)
+        scope.push_back(formal->id.lexeme);
+    walk(expr->expr);
+    scope.clear();
+}
+
+void LoopHoister::visitFormalExpr(Formal* expr) { }
+
+void LoopHoister::visitAssignExpr(Assign* expr) {
+    walk(expr->expr);
+}
+
+void LoopHoister::visitIfExpr(If* expr) {
+    walk(expr->cond);
+    walk(expr->thenBranch);
+    walk(expr->elseBranch);
+}
+
+void LoopHoister::visitWhileExpr(While* expr) {
+    AssignedNames assigned;
+    expr->accept(&assigned);
+    EffectsCollector collector;
+    expr->accept(&collector);
+    Effects effects;
+    collector.merge_into(effects);
+
+    loop_assigned = std::move(assigned.names);
+    loop_killed = killed_attributes(effects);
+    inner_scope.clear();
+    hoisted.clear();
+    if (invariant(expr->cond))
+        hoist(expr->cond);
+    if (invariant(expr->expr))
+        hoist(expr->expr);
+    letAssigns lets = std::move(hoisted);
+    hoisted.clear();
+    loop_count += !lets.empty();
+
+    // then the loops inside, the variables holding the invariants being
+    // locals never assigned.
+    for (auto& let: lets)
+        scope.push_back(std::get<0>(let)->id.lexeme);
+    walk(expr->cond);
+    walk(expr->expr);
+    scope.resize(scope.size() - lets.size());
+
+    wrapping = std::move(lets);
+}
+
+void LoopHoister::visitBinaryExpr(Binary* expr) {
+    walk(expr->lhs);
+    walk(expr->rhs);
+}
+
+void LoopHoister::visitUnaryExpr(Unary* expr) {
+    walk(expr->expr);
+}
+
+void LoopHoister::visitVariableExpr(Variable* expr) { }
+
+void LoopHoister::visitNewExpr(New* expr) { }
+
+void LoopHoister::visitBlockExpr(Block* expr) {
+    for (auto& e: expr->exprs)
+        walk(e);
+}
+
+void LoopHoister::visitGroupingExpr(Grouping* expr) {
+    walk(expr->expr);
+}
+
+void LoopHoister::visitStaticDispatchExpr(StaticDispatch* expr) {
+    for (auto& arg: expr->args)
+        walk(arg);
+    walk(expr->expr);
+}
+
+void LoopHoister::visitDispatchExpr(Dispatch* expr) {
+    for (auto& arg: expr->args)
+        walk(arg);
+    walk(expr->expr);
+}
+
+void LoopHoister::visitLiteralExpr(Literal* expr) { }
+
+void LoopHoister::visitLetExpr(Let* expr) {
+    for (auto& let: expr->vecAssigns) {
+        if (std::get<1>(let))
+            walk(std::get<1>(let));
+        scope.push_back(std::get<0>(let)->id.lexeme);
+    }
+    walk(expr->body);
+    scope.resize(scope.size() - expr->vecAssigns.size());
+}
+
+void LoopHoister::visitCaseExpr(Case* expr) {
+    walk(expr->expr);
+    for (auto& match: expr->matches) {
+        scope.push_back(std::get<0>(match)->id.lexeme);
+        walk(std::get<1>(match));
+        scope.pop_back();
+    }
+}
+
+void LoopHoister::visitProgramStmt(Program* stmt) {
+    for (auto& class_: stmt->classes)
+        class_->accept(this);
+}
+
+void LoopHoister::visitClassStmt(Class* stmt) {
+    for (auto& feature: stmt->features)
+        feature->accept(this);
+}
+
+}
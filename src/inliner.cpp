@@ -0,0 +1,140 @@
+#include "inliner.hpp"
+#include "emit.hpp"
+#include "bodysize.hpp"
+
+namespace cool {
+
+void Inliner::decide(Expr* expr, Token& callee_name) {
+    const std::string& target = resolver.get_target(expr);
+    std::string site = curr_class->name.lexeme + METHOD_SEP + curr_method->id.lexeme + ": " + callee_name.lexeme;
+
+    if (target.empty()) {
+        if (log)
+            *log << site << " not inlined: dynamic dispatch.\n";
+        return;
+    }
+
+    site = curr_class->name.lexeme + METHOD_SEP + curr_method->id.lexeme + ": " + target + METHOD_SEP + callee_name.lexeme;
+    Feature* callee = cha.get_method(target, callee_name.lexeme);
+    std::string reason;
+    BodySize body;
+    if (budget == 0)
+        reason = "inlining disabled";
+    else if (!callee->expr)
+        reason = "runtime method";
+    else if (callee == curr_method)
+        reason = "recursive call";
+    else {
+        callee->expr->accept(&body);
+        if (body.has_locals)
+            reason = "declares locals";
+        else if (body.has_loop)
+            reason = "contains a loop";
+        else if (body.size > budget)
+            reason = "size " + std::to_string(body.size) + " over budget " + std::to_string(budget);
+    }
+
+    if (!reason.empty()) {
+        if (log)
+            *log << site << " not inlined: " << reason << ".\n";
+        return;
+    }
+
+    if (log)
+        *log << site << " inlined (size " << body.size << ").\n";
+    sites[expr] = {callee, class_table_ptr->get(target)};
+    std::size_t& slots = inline_slots[curr_method];
+    if (callee->formals.size() > slots)
+        slots = callee->formals.size();
+}
+
+void Inliner::visitFeatureExpr(Feature* expr) {
+    // only the call sites of methods are inlined, the attribute
+    // initializers run in the _init routines.
+    if (expr->featuretype != FeatureType::METHOD)
+        return;
+    curr_method = expr;
+    expr->expr->accept(this);
+}
+
+void Inliner::visitFormalExpr(Formal* expr) { }
+
+void Inliner::visitAssignExpr(Assign* expr) {
+    expr->expr->accept(this);
+}
+
+void Inliner::visitIfExpr(If* expr) {
+    expr->cond->accept(this);
+    expr->thenBranch->accept(this);
+    expr->elseBranch->accept(this);
+}
+
+void Inliner::visitWhileExpr(While* expr) {
+    expr->cond->accept(this);
+    expr->expr->accept(this);
+}
+
+void Inliner::visitBinaryExpr(Binary* expr) {
+    expr->lhs->accept(this);
+    expr->rhs->accept(this);
+}
+
+void Inliner::visitUnaryExpr(Unary* expr) {
+    expr->expr->accept(this);
+}
+
+void Inliner::visitVariableExpr(Variable* expr) { }
+
+void Inliner::visitNewExpr(New* expr) { }
+
+void Inliner::visitBlockExpr(Block* expr) {
+    for (auto& e: expr->exprs)
+        e->accept(this);
+}
+
+void Inliner::visitGroupingExpr(Grouping* expr) {
+    expr->expr->accept(this);
+}
+
+void Inliner::visitStaticDispatchExpr(StaticDispatch* expr) {
+    for (auto& arg: expr->args)
+        arg->accept(this);
+    expr->expr->accept(this);
+    decide(expr, expr->callee_name);
+}
+
+void Inliner::visitDispatchExpr(Dispatch* expr) {
+    for (auto& arg: expr->args)
+        arg->accept(this);
+    expr->expr->accept(this);
+    decide(expr, expr->callee_name);
+}
+
+void Inliner::visitLiteralExpr(Literal* expr) { }
+
+void Inliner::visitLetExpr(Let* expr) {
+    for (auto& let: expr->vecAssigns) {
+        if (std::get<1>(let))
+            std::get<1>(let)->accept(this);
+    }
+    expr->body->accept(this);
+}
+
+void Inliner::visitCaseExpr(Case* expr) {
+    expr->expr->accept(this);
+    for (auto& match: expr->matches)
+        std::get<1>(match)->accept(this);
+}
+
+void Inliner::visitProgramStmt(Program* stmt) {
+    for (auto& class_: stmt->classes)
+        class_->accept(this);
+}
+
+void Inliner::visitClassStmt(Class* stmt) {
+    curr_class = stmt;
+    for (auto& f: stmt->features)
+        f->accept(this);
+}
+
+}
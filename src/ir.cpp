@@ -0,0 +1,517 @@
+#include "ir.hpp"
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
+namespace cool {
+
+bool IRInstr::has_side_effects() const {
+    switch (op) {
+        case IROp::Div:
+            // a division by zero fails at runtime.
+            return operands[1]->op != IROp::Const || operands[1]->value == 0;
+        case IROp::New:         // runs the initializers.
+        case IROp::SetAttr:
+        case IROp::Dispatch:
+        case IROp::Call:
+        case IROp::CheckDispatch:
+        case IROp::CheckCase:
+            return true;
+        default:
+            return is_terminator();
+    }
+}
+
+std::vector<IRBlock*> IRBlock::successors() {
+    IRInstr* term = terminator();
+    return term ? term->targets : std::vector<IRBlock*>{};
+}
+
+std::size_t IRBlock::first_non_phi() {
+    std::size_t i = 0;
+    while (i < instrs.size() && instrs[i]->op == IROp::Phi)
+        i++;
+    return i;
+}
+
+IRBlock* IRFunction::new_block() {
+    blocks.push_back(std::make_unique<IRBlock>());
+    blocks.back()->id = next_block++;
+    return blocks.back().get();
+}
+
+IRInstr* IRFunction::append(IRBlock* block, IROp op, IRType type, std::vector<IRInstr*> operands) {
+    return insert(block, block->instrs.size(), op, type, std::move(operands));
+}
+
+IRInstr* IRFunction::insert(IRBlock* block, std::size_t index, IROp op, IRType type, std::vector<IRInstr*> operands) {
+    auto instr = std::make_unique<IRInstr>();
+    instr->op = op;
+    instr->type = type;
+    instr->operands = std::move(operands);
+    instr->block = block;
+    instr->id = next_value++;
+    IRInstr* result = instr.get();
+    block->instrs.insert(block->instrs.begin() + index, std::move(instr));
+    return result;
+}
+
+void IRFunction::replace_uses(IRInstr* from, IRInstr* to) {
+    for (auto& block: blocks) {
+        for (auto& instr: block->instrs) {
+            for (auto& operand: instr->operands) {
+                if (operand == from)
+                    operand = to;
+            }
+        }
+    }
+}
+
+void IRFunction::erase(const std::vector<IRInstr*>& remove) {
+    std::unordered_set<IRInstr*> removed(remove.begin(), remove.end());
+    for (auto& block: blocks) {
+        auto& instrs = block->instrs;
+        instrs.erase(std::remove_if(instrs.begin(), instrs.end(),
+                                    [&](const std::unique_ptr<IRInstr>& instr) { return removed.count(instr.get()); }),
+                     instrs.end());
+    }
+}
+
+void IRFunction::remove_pred(IRBlock* block, IRBlock* pred) {
+    auto position = std::find(block->preds.begin(), block->preds.end(), pred);
+    std::size_t index = position - block->preds.begin();
+    block->preds.erase(position);
+    for (auto& instr: block->instrs) {
+        if (instr->op == IROp::Phi)
+            instr->operands.erase(instr->operands.begin() + index);
+    }
+}
+
+void IRFunction::renumber() {
+    next_block = next_value = 0;
+    for (auto& block: blocks) {
+        block->id = next_block++;
+        for (auto& instr: block->instrs)
+            instr->id = next_value++;
+    }
+}
+
+std::size_t IRFunction::instruction_count() {
+    std::size_t count = 0;
+    for (auto& block: blocks)
+        count += block->instrs.size();
+    return count;
+}
+
+IRFunction* IRModule::get(const std::string& name) {
+    for (auto& function: functions) {
+        if (function->name == name)
+            return function.get();
+    }
+    return nullptr;
+}
+
+std::size_t IRModule::instruction_count() {
+    std::size_t count = 0;
+    for (auto& function: functions)
+        count += function->instruction_count();
+    return count;
+}
+
+IRDominators::IRDominators(IRFunction& function) {
+    // Cooper, Harvey and Kennedy's iterative algorithm over the reverse
+    // postorder.
+    IRBlock* entry = function.blocks.front().get();
+    std::unordered_set<IRBlock*> visited;
+    std::vector<IRBlock*> postorder;
+    std::function<void(IRBlock*)> visit = [&](IRBlock* block) {
+        visited.insert(block);
+        for (IRBlock* succ: block->successors()) {
+            if (!visited.count(succ))
+                visit(succ);
+        }
+        postorder.push_back(block);
+    };
+    visit(entry);
+    rpo.assign(postorder.rbegin(), postorder.rend());
+    for (std::size_t i = 0; i < rpo.size(); i++)
+        order[rpo[i]] = i;
+
+    auto intersect = [&](IRBlock* a, IRBlock* b) {
+        while (a != b) {
+            while (order[a] > order[b])
+                a = idom[a];
+            while (order[b] > order[a])
+                b = idom[b];
+        }
+        return a;
+    };
+    idom[entry] = entry;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (std::size_t i = 1; i < rpo.size(); i++) {
+            IRBlock* new_idom = nullptr;
+            for (IRBlock* pred: rpo[i]->preds) {
+                if (!idom.count(pred))
+                    continue;
+                new_idom = new_idom ? intersect(pred, new_idom) : pred;
+            }
+            if (idom[rpo[i]] != new_idom) {
+                idom[rpo[i]] = new_idom;
+                changed = true;
+            }
+        }
+    }
+    for (std::size_t i = 1; i < rpo.size(); i++)
+        children[idom[rpo[i]]].push_back(rpo[i]);
+}
+
+bool IRDominators::dominates(IRBlock* a, IRBlock* b) {
+    if (!order.count(a) || !order.count(b))
+        return false;
+    while (order[b] > order[a])
+        b = idom[b];
+    return a == b;
+}
+
+const char* ir_type_name(IRType type) {
+    switch (type) {
+        case IRType::None: return "none";
+        case IRType::Obj:  return "obj";
+        case IRType::Int:  return "int";
+        case IRType::Bool: return "bool";
+    }
+    return "?";
+}
+
+const char* ir_op_name(IROp op) {
+    switch (op) {
+        case IROp::Param:           return "param";
+        case IROp::Const:           return "const";
+        case IROp::String:          return "string";
+        case IROp::Void:            return "void";
+        case IROp::Add:             return "add";
+        case IROp::Sub:             return "sub";
+        case IROp::Mul:             return "mul";
+        case IROp::Div:             return "div";
+        case IROp::Neg:             return "neg";
+        case IROp::Lt:              return "lt";
+        case IROp::Le:              return "le";
+        case IROp::Eq:              return "eq";
+        case IROp::Not:             return "not";
+        case IROp::Box:             return "box";
+        case IROp::Unbox:           return "unbox";
+        case IROp::ObjEq:           return "objeq";
+        case IROp::IsVoid:          return "isvoid";
+        case IROp::New:             return "new";
+        case IROp::GetAttr:         return "getattr";
+        case IROp::SetAttr:         return "setattr";
+        case IROp::Dispatch:        return "dispatch";
+        case IROp::Call:            return "call";
+        case IROp::CheckDispatch:   return "check.dispatch";
+        case IROp::CheckCase:       return "check.case";
+        case IROp::Phi:             return "phi";
+        case IROp::Jump:            return "jump";
+        case IROp::Branch:          return "branch";
+        case IROp::TypeCase:        return "typecase";
+        case IROp::Return:          return "ret";
+    }
+    return "?";
+}
+
+static void print_string(std::ostream& os, const std::string& s) {
+    os << '"';
+    for (char c: s) {
+        switch (c) {
+            case '\n': os << "\\n"; break;
+            case '\t': os << "\\t"; break;
+            case '"':  os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            default:   os << c;
+        }
+    }
+    os << '"';
+}
+
+static void print_instr(std::ostream& os, IRInstr* instr) {
+    os << "    ";
+    if (instr->type != IRType::None)
+        os << "%" << instr->id << ":" << ir_type_name(instr->type) << " = ";
+    os << ir_op_name(instr->op);
+
+    switch (instr->op) {
+        case IROp::Param:
+        case IROp::Const:
+            os << " " << instr->value;
+            break;
+        case IROp::String:
+            os << " ";
+            print_string(os, instr->name);
+            break;
+        case IROp::New:
+            os << " " << instr->class_name;
+            break;
+        case IROp::GetAttr:
+        case IROp::SetAttr:
+        case IROp::Dispatch:
+        case IROp::Call:
+            os << " " << instr->class_name << "." << instr->name;
+            break;
+        default:
+            break;
+    }
+
+    for (std::size_t i = 0; i < instr->operands.size(); i++) {
+        os << (i ? ", " : " ") << "%" << instr->operands[i]->id;
+        if (instr->op == IROp::Phi)
+            os << " <- b" << instr->block->preds[i]->id;
+    }
+
+    switch (instr->op) {
+        case IROp::CheckDispatch:
+        case IROp::CheckCase:
+            os << " line " << instr->value;
+            break;
+        case IROp::Jump:
+            os << " b" << instr->targets[0]->id;
+            break;
+        case IROp::Branch:
+            os << ", b" << instr->targets[0]->id << ", b" << instr->targets[1]->id;
+            break;
+        case IROp::TypeCase:
+            os << " : " << instr->class_name;
+            for (std::size_t i = 0; i < instr->cases.size(); i++)
+                os << (i ? ", " : " [") << instr->cases[i] << " b" << instr->targets[i]->id;
+            os << "]";
+            break;
+        default:
+            break;
+    }
+    os << "\n";
+}
+
+void print_ir(std::ostream& os, IRFunction& function) {
+    os << "function " << function.name << "(" << function.nparams << ") {\n";
+    for (auto& block: function.blocks) {
+        os << "b" << block->id << ":";
+        if (!block->preds.empty()) {
+            os << "    ; preds";
+            for (IRBlock* pred: block->preds)
+                os << " b" << pred->id;
+        }
+        os << "\n";
+        for (auto& instr: block->instrs)
+            print_instr(os, instr.get());
+    }
+    os << "}\n";
+}
+
+void print_ir(std::ostream& os, IRModule& module) {
+    for (auto& function: module.functions) {
+        print_ir(os, *function);
+        os << "\n";
+    }
+}
+
+static std::string expected_operands(IRInstr* instr) {
+    auto types = [instr](std::initializer_list<IRType> expected) -> std::string {
+        if (instr->operands.size() != expected.size())
+            return "takes " + std::to_string(expected.size()) + " operands";
+        std::size_t i = 0;
+        for (IRType type: expected) {
+            if (instr->operands[i++]->type != type)
+                return std::string("expects ") + ir_type_name(type) + " operand " + std::to_string(i);
+        }
+        return "";
+    };
+    auto result = [instr](IRType type) -> std::string {
+        return instr->type == type ? "" : std::string("must be ") + ir_type_name(type);
+    };
+    std::string error;
+
+    switch (instr->op) {
+        case IROp::Param:
+        case IROp::String:
+        case IROp::Void:
+        case IROp::New:
+            return !instr->operands.empty() ? "takes no operands" : result(IRType::Obj);
+        case IROp::Const:
+            if (!instr->operands.empty())
+                return "takes no operands";
+            return instr->type == IRType::Int || instr->type == IRType::Bool ? "" : "must be int or bool";
+        case IROp::Add: case IROp::Sub: case IROp::Mul: case IROp::Div:
+            error = types({IRType::Int, IRType::Int});
+            return error.empty() ? result(IRType::Int) : error;
+        case IROp::Neg:
+            error = types({IRType::Int});
+            return error.empty() ? result(IRType::Int) : error;
+        case IROp::Lt: case IROp::Le:
+            error = types({IRType::Int, IRType::Int});
+            return error.empty() ? result(IRType::Bool) : error;
+        case IROp::Eq:
+            if (instr->operands.size() != 2 || instr->operands[0]->type != instr->operands[1]->type ||
+                (instr->operands[0]->type != IRType::Int && instr->operands[0]->type != IRType::Bool))
+                return "compares two int or two bool";
+            return result(IRType::Bool);
+        case IROp::Not:
+            error = types({IRType::Bool});
+            return error.empty() ? result(IRType::Bool) : error;
+        case IROp::Box:
+            if (instr->operands.size() != 1 || (instr->operands[0]->type != IRType::Int && instr->operands[0]->type != IRType::Bool))
+                return "boxes an int or a bool";
+            return result(IRType::Obj);
+        case IROp::Unbox:
+            error = types({IRType::Obj});
+            if (!error.empty())
+                return error;
+            return instr->type == IRType::Int || instr->type == IRType::Bool ? "" : "must be int or bool";
+        case IROp::ObjEq:
+            error = types({IRType::Obj, IRType::Obj});
+            return error.empty() ? result(IRType::Bool) : error;
+        case IROp::IsVoid:
+            error = types({IRType::Obj});
+            return error.empty() ? result(IRType::Bool) : error;
+        case IROp::GetAttr:
+            error = types({IRType::Obj});
+            return error.empty() ? result(IRType::Obj) : error;
+        case IROp::SetAttr:
+            error = types({IRType::Obj, IRType::Obj});
+            return error.empty() ? result(IRType::None) : error;
+        case IROp::Dispatch:
+        case IROp::Call:
+            if (instr->operands.empty())
+                return "needs a receiver";
+            for (IRInstr* operand: instr->operands) {
+                if (operand->type != IRType::Obj)
+                    return "passes objects only";
+            }
+            return result(IRType::Obj);
+        case IROp::CheckDispatch:
+        case IROp::CheckCase:
+            error = types({IRType::Obj});
+            return error.empty() ? result(IRType::None) : error;
+        case IROp::Phi:
+            if (instr->operands.size() != instr->block->preds.size())
+                return "needs a value for each of the " + std::to_string(instr->block->preds.size()) + " predecessors";
+            if (instr->type == IRType::None)
+                return "must have a type";
+            for (IRInstr* operand: instr->operands) {
+                if (operand->type != instr->type)
+                    return "merges values of another type";
+            }
+            return "";
+        case IROp::Jump:
+            return !instr->operands.empty() || instr->targets.size() != 1 ? "takes a target only" : "";
+        case IROp::Branch:
+            error = types({IRType::Bool});
+            return error.empty() && instr->targets.size() != 2 ? "takes two targets" : error;
+        case IROp::TypeCase:
+            error = types({IRType::Obj});
+            return error.empty() && (instr->targets.empty() || instr->targets.size() != instr->cases.size())
+                   ? "needs a target for each case" : error;
+        case IROp::Return:
+            return types({IRType::Obj});
+    }
+    return "";
+}
+
+std::vector<std::string> verify_ir(IRFunction& function) {
+    std::vector<std::string> errors;
+    auto error = [&](IRBlock* block, IRInstr* instr, const std::string& message) {
+        std::string where = function.name + ": b" + std::to_string(block->id);
+        if (instr)
+            where += ": " + std::string(ir_op_name(instr->op)) + " %" + std::to_string(instr->id);
+        errors.push_back(where + ": " + message);
+    };
+
+    if (function.blocks.empty()) {
+        errors.push_back(function.name + ": no entry block");
+        return errors;
+    }
+
+    // the predecessors are the sources of the edges to the block.
+    std::unordered_map<IRBlock*, std::vector<IRBlock*>> edges;
+    std::unordered_map<IRInstr*, std::size_t> position;
+    std::unordered_set<IRBlock*> blocks;
+    for (auto& block: function.blocks) {
+        blocks.insert(block.get());
+        for (std::size_t i = 0; i < block->instrs.size(); i++)
+            position[block->instrs[i].get()] = i;
+    }
+    for (auto& block: function.blocks) {
+        if (!block->terminator()) {
+            error(block.get(), nullptr, "doesn't end with a terminator");
+            continue;
+        }
+        for (IRBlock* succ: block->successors()) {
+            if (!blocks.count(succ))
+                error(block.get(), block->terminator(), "jumps out of the function");
+            else
+                edges[succ].push_back(block.get());
+        }
+    }
+    if (!errors.empty())
+        return errors;
+    for (auto& block: function.blocks) {
+        auto expected = edges[block.get()];
+        auto actual = block->preds;
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+        if (expected != actual)
+            error(block.get(), nullptr, "predecessors don't match the edges to the block");
+    }
+    if (!function.blocks.front()->preds.empty())
+        error(function.blocks.front().get(), nullptr, "the entry block has predecessors");
+
+    IRDominators dominators{function};
+    for (auto& block: function.blocks) {
+        if (!dominators.order.count(block.get()))
+            error(block.get(), nullptr, "unreachable from the entry");
+        bool phis = true;
+        for (std::size_t i = 0; i < block->instrs.size(); i++) {
+            IRInstr* instr = block->instrs[i].get();
+            if (instr->block != block.get())
+                error(block.get(), instr, "belongs to another block");
+            if (instr->is_terminator() && i + 1 != block->instrs.size())
+                error(block.get(), instr, "terminator in the middle of the block");
+            if (instr->op == IROp::Phi && !phis)
+                error(block.get(), instr, "phi after other instructions");
+            phis = phis && instr->op == IROp::Phi;
+            if (instr->op == IROp::Param && instr->value >= static_cast<int>(function.nparams))
+                error(block.get(), instr, "no such parameter");
+
+            bool operands_ok = true;
+            for (IRInstr* operand: instr->operands) {
+                if (!operand || !position.count(operand) || operand->type == IRType::None) {
+                    error(block.get(), instr, "uses something that isn't a value of the function");
+                    operands_ok = false;
+                }
+            }
+            if (!operands_ok)
+                continue;
+            std::string problem = expected_operands(instr);
+            if (!problem.empty())
+                error(block.get(), instr, problem);
+
+            // the value must be available wherever it is used: at the end of
+            // the predecessor for a phi.
+            for (std::size_t j = 0; j < instr->operands.size(); j++) {
+                IRInstr* operand = instr->operands[j];
+                IRBlock* use_block = block.get();
+                std::size_t use_position = i;
+                if (instr->op == IROp::Phi && j < block->preds.size()) {
+                    use_block = block->preds[j];
+                    use_position = use_block->instrs.size();
+                }
+                bool available = operand->block == use_block ? position[operand] < use_position
+                                                             : dominators.dominates(operand->block, use_block);
+                if (!available)
+                    error(block.get(), instr, "uses %" + std::to_string(operand->id) + " where it isn't defined");
+            }
+        }
+    }
+    return errors;
+}
+
+}
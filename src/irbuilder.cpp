@@ -0,0 +1,445 @@
+#include "irbuilder.hpp"
+#include "constants.hpp"
+#include <algorithm>
+
+namespace cool {
+
+void IRBuilder::begin(const std::string& name, const std::string& class_name, std::size_t nparams) {
+    function = std::make_unique<IRFunction>();
+    function->name = name;
+    function->class_name = class_name;
+    function->nparams = nparams;
+    current_def.clear();
+    sealed.clear();
+    incomplete_phis.clear();
+    phi_variables.clear();
+    scope = SymbolTable<std::string, Formal*>{};
+    scope.enterScope();
+
+    block = function->new_block();
+    sealed.insert(block);
+    self_value = emit(IROp::Param, IRType::Obj);
+}
+
+std::unique_ptr<IRFunction> IRBuilder::build_method(Class* class_, Feature* method) {
+    curr_class = class_;
+    begin(class_->name.lexeme + "." + method->id.lexeme, class_->name.lexeme, method->formals.size() + 1);
+    for (std::size_t i = 0; i < method->formals.size(); i++) {
+        IRInstr* param = emit(IROp::Param, IRType::Obj);
+        param->value = i + 1;
+        Formal* formal = method->formals[i].get();
+        scope.insert(formal->id.lexeme, formal);
+        write_variable(formal, block, param);
+    }
+    IRInstr* value = build(method->expr.get());
+    emit(IROp::Return, IRType::None, {value});
+    function->renumber();
+    return std::move(function);
+}
+
+std::unique_ptr<IRFunction> IRBuilder::build_init(const std::vector<Class*>& chain, const std::unordered_set<Feature*>& skipped) {
+    Class* class_ = chain.back();
+    begin(class_->name.lexeme + "_init", class_->name.lexeme, 1);
+    for (Class* c: chain) {
+        curr_class = c;
+        for (auto& attr: c->features) {
+            if (attr->featuretype != FeatureType::ATTRIBUT || !attr->expr || skipped.count(attr.get()))
+                continue;
+            IRInstr* value = build(attr->expr.get());
+            IRInstr* set = emit(IROp::SetAttr, IRType::None, {self_value, value});
+            set->name = attr->id.lexeme;
+            set->class_name = c->name.lexeme;
+        }
+    }
+    curr_class = class_;
+    emit(IROp::Return, IRType::None, {self_value});
+    function->renumber();
+    return std::move(function);
+}
+
+IRInstr* IRBuilder::build(Expr* expr) {
+    expr->accept(this);
+    return result;
+}
+
+IRInstr* IRBuilder::emit(IROp op, IRType type, std::vector<IRInstr*> operands) {
+    return function->append(block, op, type, std::move(operands));
+}
+
+IRInstr* IRBuilder::box(IRInstr* raw) {
+    return emit(IROp::Box, IRType::Obj, {raw});
+}
+
+IRInstr* IRBuilder::unbox(IRInstr* object, IRType type) {
+    return emit(IROp::Unbox, type, {object});
+}
+
+IRInstr* IRBuilder::raw_const(IRType type, int value) {
+    IRInstr* constant = emit(IROp::Const, type);
+    constant->value = value;
+    return constant;
+}
+
+void IRBuilder::jump(IRBlock* target) {
+    IRInstr* instr = emit(IROp::Jump, IRType::None);
+    instr->targets = {target};
+    target->preds.push_back(block);
+}
+
+void IRBuilder::branch(IRInstr* cond, IRBlock* if_true, IRBlock* if_false) {
+    IRInstr* instr = emit(IROp::Branch, IRType::None, {cond});
+    instr->targets = {if_true, if_false};
+    if_true->preds.push_back(block);
+    if_false->preds.push_back(block);
+}
+
+std::string IRBuilder::class_of(const Token& type) {
+    return type == SELF_TYPE ? curr_class->name.lexeme : type.lexeme;
+}
+
+void IRBuilder::write_variable(Formal* var, IRBlock* block, IRInstr* value) {
+    current_def[var][block] = value;
+}
+
+IRInstr* IRBuilder::read_variable(Formal* var, IRBlock* block) {
+    auto& defs = current_def[var];
+    auto def = defs.find(block);
+    if (def != defs.end())
+        return def->second;
+    return read_variable_recursive(var, block);
+}
+
+IRInstr* IRBuilder::read_variable_recursive(Formal* var, IRBlock* block) {
+    IRInstr* value;
+    if (!sealed.count(block)) {
+        // the predecessors aren't all known yet: the operands are added
+        // when the block is sealed.
+        value = new_phi(block);
+        phi_variables[value] = var;
+        incomplete_phis[block].push_back({var, value});
+    } else if (block->preds.size() == 1) {
+        value = read_variable(var, block->preds[0]);
+    } else {
+        // the phi breaks the cycles through loops.
+        value = new_phi(block);
+        phi_variables[value] = var;
+        write_variable(var, block, value);
+        value = add_phi_operands(var, value);
+    }
+    write_variable(var, block, value);
+    return value;
+}
+
+IRInstr* IRBuilder::new_phi(IRBlock* block) {
+    return function->insert(block, block->first_non_phi(), IROp::Phi, IRType::Obj);
+}
+
+IRInstr* IRBuilder::add_phi_operands(Formal* var, IRInstr* phi) {
+    for (IRBlock* pred: phi->block->preds)
+        phi->operands.push_back(read_variable(var, pred));
+    return try_remove_trivial_phi(phi);
+}
+
+IRInstr* IRBuilder::try_remove_trivial_phi(IRInstr* phi) {
+    IRInstr* same = nullptr;
+    for (IRInstr* operand: phi->operands) {
+        if (operand == same || operand == phi)
+            continue;
+        if (same)
+            return phi;     // merges at least two values.
+        same = operand;
+    }
+    if (!same) {
+        // only reachable from itself, which the code built never is.
+        IRBlock* entry = function->blocks.front().get();
+        same = function->insert(entry, entry->instrs.size() - (entry->terminator() ? 1 : 0), IROp::Void, IRType::Obj);
+    }
+
+    std::vector<IRInstr*> users;
+    for (auto& b: function->blocks) {
+        for (auto& instr: b->instrs) {
+            if (instr.get() != phi && instr->op == IROp::Phi &&
+                std::find(instr->operands.begin(), instr->operands.end(), phi) != instr->operands.end())
+                users.push_back(instr.get());
+        }
+    }
+    function->replace_uses(phi, same);
+    for (auto& defs: current_def) {
+        for (auto& def: defs.second) {
+            if (def.second == phi)
+                def.second = same;
+        }
+    }
+    if (result == phi)
+        result = same;
+    phi_variables.erase(phi);
+    function->erase({phi});
+
+    // the phis using it may have become trivial as well.
+    for (IRInstr* user: users) {
+        if (phi_variables.count(user) && sealed.count(user->block))
+            try_remove_trivial_phi(user);
+    }
+    return same;
+}
+
+void IRBuilder::seal(IRBlock* block) {
+    sealed.insert(block);
+    auto phis = std::move(incomplete_phis[block]);
+    incomplete_phis.erase(block);
+    for (auto& phi: phis) {
+        if (phi_variables.count(phi.second))
+            add_phi_operands(phi.first, phi.second);
+    }
+}
+
+void IRBuilder::visitFeatureExpr(Feature* expr) { }
+
+void IRBuilder::visitFormalExpr(Formal* expr) { }
+
+void IRBuilder::visitAssignExpr(Assign* expr) {
+    IRInstr* value = build(expr->expr.get());
+    Formal* local = scope.get(expr->id.lexeme);
+    if (local) {
+        write_variable(local, block, value);
+    } else {
+        IRInstr* set = emit(IROp::SetAttr, IRType::None, {self_value, value});
+        set->name = expr->id.lexeme;
+        set->class_name = curr_class->name.lexeme;
+    }
+    result = value;
+}
+
+void IRBuilder::visitIfExpr(If* expr) {
+    IRInstr* cond = unbox(build(expr->cond.get()), IRType::Bool);
+    IRBlock* then_block = function->new_block();
+    IRBlock* else_block = function->new_block();
+    IRBlock* merge = function->new_block();
+    branch(cond, then_block, else_block);
+    seal(then_block);
+    seal(else_block);
+
+    block = then_block;
+    IRInstr* then_value = build(expr->thenBranch.get());
+    jump(merge);
+    block = else_block;
+    IRInstr* else_value = build(expr->elseBranch.get());
+    jump(merge);
+
+    block = merge;
+    seal(merge);
+    if (then_value == else_value) {
+        result = then_value;
+        return;
+    }
+    result = new_phi(merge);
+    result->operands = {then_value, else_value};
+}
+
+void IRBuilder::visitWhileExpr(While* expr) {
+    IRBlock* header = function->new_block();
+    IRBlock* body = function->new_block();
+    IRBlock* exit = function->new_block();
+    jump(header);
+
+    // the header is sealed once the back edge of the body is known.
+    block = header;
+    IRInstr* cond = unbox(build(expr->cond.get()), IRType::Bool);
+    branch(cond, body, exit);
+    seal(body);
+    seal(exit);
+
+    block = body;
+    build(expr->expr.get());
+    jump(header);
+    seal(header);
+
+    block = exit;
+    result = emit(IROp::Void, IRType::Obj);
+}
+
+void IRBuilder::visitBinaryExpr(Binary* expr) {
+    IRInstr* lhs = build(expr->lhs.get());
+    IRInstr* rhs = build(expr->rhs.get());
+
+    IROp op;
+    switch (expr->op.token_type) {
+        case PLUS:  op = IROp::Add; break;
+        case MINUS: op = IROp::Sub; break;
+        case STAR:  op = IROp::Mul; break;
+        case SLASH: op = IROp::Div; break;
+        case LESS:
+            result = box(emit(IROp::Lt, IRType::Bool, {unbox(lhs, IRType::Int), unbox(rhs, IRType::Int)}));
+            return;
+        case LESS_EQUAL:
+            result = box(emit(IROp::Le, IRType::Bool, {unbox(lhs, IRType::Int), unbox(rhs, IRType::Int)}));
+            return;
+        default: {
+            // Int and Bool objects are compared by value, anything else
+            // through the runtime.
+            const Token& lhs_type = expr->lhs->expr_type;
+            const Token& rhs_type = expr->rhs->expr_type;
+            if (lhs_type == rhs_type && (lhs_type == Int || lhs_type == Bool)) {
+                IRType type = lhs_type == Int ? IRType::Int : IRType::Bool;
+                result = box(emit(IROp::Eq, IRType::Bool, {unbox(lhs, type), unbox(rhs, type)}));
+            } else {
+                result = box(emit(IROp::ObjEq, IRType::Bool, {lhs, rhs}));
+            }
+            return;
+        }
+    }
+    result = box(emit(op, IRType::Int, {unbox(lhs, IRType::Int), unbox(rhs, IRType::Int)}));
+}
+
+void IRBuilder::visitUnaryExpr(Unary* expr) {
+    IRInstr* operand = build(expr->expr.get());
+    switch (expr->op.token_type) {
+        case TILDE:
+            result = box(emit(IROp::Neg, IRType::Int, {unbox(operand, IRType::Int)}));
+            break;
+        case NOT:
+            result = box(emit(IROp::Not, IRType::Bool, {unbox(operand, IRType::Bool)}));
+            break;
+        default:
+            result = box(emit(IROp::IsVoid, IRType::Bool, {operand}));
+            break;
+    }
+}
+
+void IRBuilder::visitVariableExpr(Variable* expr) {
+    if (expr->name == self) {
+        result = self_value;
+        return;
+    }
+    Formal* local = scope.get(expr->name.lexeme);
+    if (local) {
+        result = read_variable(local, block);
+        return;
+    }
+    result = emit(IROp::GetAttr, IRType::Obj, {self_value});
+    result->name = expr->name.lexeme;
+    result->class_name = curr_class->name.lexeme;
+}
+
+void IRBuilder::visitNewExpr(New* expr) {
+    result = emit(IROp::New, IRType::Obj);
+    result->class_name = class_of(expr->expr_type);
+}
+
+void IRBuilder::visitBlockExpr(Block* expr) {
+    for (auto& e: expr->exprs)
+        build(e.get());
+}
+
+void IRBuilder::visitGroupingExpr(Grouping* expr) {
+    build(expr->expr.get());
+}
+
+void IRBuilder::visitStaticDispatchExpr(StaticDispatch* expr) {
+    std::vector<IRInstr*> operands{nullptr};
+    for (auto& arg: expr->args)
+        operands.push_back(build(arg.get()));
+    operands[0] = build(expr->expr.get());
+    IRInstr* check = emit(IROp::CheckDispatch, IRType::None, {operands[0]});
+    check->value = expr->callee_name.loc;
+
+    result = emit(IROp::Call, IRType::Obj, operands);
+    result->name = expr->callee_name.lexeme;
+    result->class_name = resolver.get_target(expr);
+}
+
+void IRBuilder::visitDispatchExpr(Dispatch* expr) {
+    std::vector<IRInstr*> operands{nullptr};
+    for (auto& arg: expr->args)
+        operands.push_back(build(arg.get()));
+    operands[0] = build(expr->expr.get());
+    IRInstr* check = emit(IROp::CheckDispatch, IRType::None, {operands[0]});
+    check->value = expr->callee_name.loc;
+
+    result = emit(IROp::Dispatch, IRType::Obj, operands);
+    result->name = expr->callee_name.lexeme;
+    result->class_name = resolver.get_receiver_type(expr);
+}
+
+void IRBuilder::visitLiteralExpr(Literal* expr) {
+    switch (expr->object.type()) {
+        case CoolType::Number_t:
+            result = box(raw_const(IRType::Int, expr->object.int_value()));
+            break;
+        case CoolType::Bool_t:
+            result = box(raw_const(IRType::Bool, expr->object.bool_value()));
+            break;
+        case CoolType::String_t:
+            result = emit(IROp::String, IRType::Obj);
+            result->name = expr->object.string_value();
+            break;
+        default:
+            result = emit(IROp::Void, IRType::Obj);
+            break;
+    }
+}
+
+void IRBuilder::visitLetExpr(Let* expr) {
+    scope.enterScope();
+    for (auto& let: expr->vecAssigns) {
+        Formal* formal = std::get<0>(let).get();
+        IRInstr* value;
+        if (std::get<1>(let)) {
+            value = build(std::get<1>(let).get());
+        } else if (formal->type_ == Int) {
+            value = box(raw_const(IRType::Int, 0));
+        } else if (formal->type_ == Bool) {
+            value = box(raw_const(IRType::Bool, 0));
+        } else if (formal->type_ == Str) {
+            value = emit(IROp::String, IRType::Obj);
+        } else {
+            value = emit(IROp::Void, IRType::Obj);
+        }
+        // the initializer doesn't see the variable it initializes.
+        scope.insert(formal->id.lexeme, formal);
+        write_variable(formal, block, value);
+    }
+    build(expr->body.get());
+    scope.exitScope();
+}
+
+void IRBuilder::visitCaseExpr(Case* expr) {
+    IRInstr* value = build(expr->expr.get());
+    emit(IROp::CheckCase, IRType::None, {value})->value = 1;
+
+    IRInstr* type_case = emit(IROp::TypeCase, IRType::None, {value});
+    const std::string& case_type = resolver.get_case_type(expr);
+    type_case->class_name = case_type.empty() ? class_of(expr->expr->expr_type) : case_type;
+    IRBlock* case_block = block;
+    IRBlock* merge = function->new_block();
+
+    std::vector<IRBlock*> ends;
+    std::vector<IRInstr*> values;
+    for (auto& match: expr->matches) {
+        Formal* formal = std::get<0>(match).get();
+        IRBlock* branch_block = function->new_block();
+        type_case->targets.push_back(branch_block);
+        type_case->cases.push_back(formal->type_.lexeme);
+        branch_block->preds.push_back(case_block);
+        seal(branch_block);
+
+        block = branch_block;
+        scope.enterScope();
+        scope.insert(formal->id.lexeme, formal);
+        write_variable(formal, block, value);
+        values.push_back(build(std::get<1>(match).get()));
+        scope.exitScope();
+        jump(merge);
+    }
+
+    block = merge;
+    seal(merge);
+    if (std::all_of(values.begin(), values.end(), [&](IRInstr* v) { return v == values[0]; })) {
+        result = values[0];
+        return;
+    }
+    result = new_phi(merge);
+    result->operands = values;
+}
+
+}
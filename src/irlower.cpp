@@ -0,0 +1,508 @@
+#include "cgen.hpp"
+#include "emit.hpp"
+#include <algorithm>
+#include <cstring>
+
+// Code generation from the IR.
+// Every value lives in a slot of the AR of its function, after the saved
+// registers, unless it is cheaper to compute where it is used (constants,
+// self, the boxed constants of the data segment), a compare only used by the
+// branch right after it, or a value used right after it is computed, which
+// stays in ACC. Phis get their values from moves at the end of their
+// predecessors, the critical edges being split beforehand.
+// The slots may hold the raw value of an Int or a Bool: the collectors that
+// scan the stack for pointers (GenGC, ScnGC) can't be used with this code.
+
+namespace cool {
+
+void Cgen::build_ir(Program* program) {
+    IRBuilder builder{resolver};
+    for (auto& class_: program->classes) {
+        const std::string& name = class_->name.lexeme;
+        if (reachability.is_instantiated(name) && !noop_inits.count(name)) {
+            std::vector<Class*> chain;
+            for (Class* c = class_.get(); ; c = class_table_ptr->get(c->superClass.lexeme)) {
+                chain.insert(chain.begin(), c);
+                if (c->superClass == No_class)
+                    break;
+            }
+            ir_module.functions.push_back(builder.build_init(chain, baked_attrs));
+        }
+        for (auto& feature: class_->features) {
+            if (feature->featuretype == FeatureType::METHOD && reachability.is_reachable(feature.get()))
+                ir_module.functions.push_back(builder.build_method(class_.get(), feature.get()));
+        }
+    }
+    ir_built_instructions = ir_module.instruction_count();
+
+    PassManager manager{cha};
+    for (auto& name: ir_pass_names)
+        manager.add(name);
+    manager.run(ir_module);
+    ir_changes = manager.get_changes();
+    if (ir_dump)
+        print_ir(*ir_dump, ir_module);
+}
+
+bool Cgen::ir_rematerialized(IRInstr* instr) {
+    switch (instr->op) {
+        case IROp::Const:
+        case IROp::String:
+        case IROp::Void:
+            return true;
+        case IROp::Param:
+            return instr->value == 0;
+        case IROp::Box: {
+            // the constants of the data segment.
+            IRInstr* raw = instr->operands[0];
+            if (raw->op != IROp::Const)
+                return false;
+            return raw->type == IRType::Bool ||
+                   (inttable().get_index(std::to_string(raw->value)) >= 0 && reachability.uses_int(raw->value));
+        }
+        default:
+            return false;
+    }
+}
+
+bool Cgen::ir_is_tail_call(IRInstr* instr) {
+    if (instr->op != IROp::Call && instr->op != IROp::Dispatch)
+        return false;
+    IRBlock* block = instr->block;
+    if (block->instrs.size() < 2 || block->instrs[block->instrs.size() - 2].get() != instr)
+        return false;
+    IRInstr* exit = block->terminator();
+    if (!exit)
+        return false;
+    if (exit->op == IROp::Return)
+        return exit->operands[0] == instr;
+    if (exit->op != IROp::Jump)
+        return false;
+
+    // a jump to a block returning a phi taking the result from this block.
+    IRBlock* target = exit->targets[0];
+    IRInstr* ret = target->terminator();
+    if (!ret || ret->op != IROp::Return || ret->operands[0]->op != IROp::Phi || ret->operands[0]->block != target)
+        return false;
+    for (auto& other: target->instrs) {
+        if (other->op != IROp::Phi && other.get() != ret)
+            return false;
+    }
+    std::size_t index = std::find(target->preds.begin(), target->preds.end(), block) - target->preds.begin();
+    return ret->operands[0]->operands[index] == instr;
+}
+
+bool Cgen::ir_in_acc(IRBlock* block, std::size_t index, const std::unordered_map<IRInstr*, std::vector<IRInstr*>>& users) {
+    IRInstr* value = block->instrs[index].get();
+    if (value->op == IROp::Phi || value->op == IROp::Param)
+        return false;
+    auto found = users.find(value);
+    if (found == users.end())
+        return true;
+
+    // the uses in between must be the checks, which leave the value in ACC.
+    std::size_t last = index;
+    for (IRInstr* user: found->second) {
+        if (user->block != block || user->op == IROp::Phi)
+            return false;
+        std::size_t position = index + 1;
+        while (position < block->instrs.size() && block->instrs[position].get() != user)
+            position++;
+        if (position == block->instrs.size())
+            return false;
+        last = std::max(last, position);
+    }
+    for (std::size_t i = index + 1; i < last; i++) {
+        IRInstr* instr = block->instrs[i].get();
+        bool check = instr->op == IROp::CheckDispatch || instr->op == IROp::CheckCase;
+        if (!check || instr->operands[0] != value)
+            return false;
+    }
+
+    // an Int is boxed into an object allocated first.
+    IRInstr* user = block->instrs[last].get();
+    return !(user->op == IROp::Box && value->type == IRType::Int);
+}
+
+void Cgen::ir_load(IRInstr* value, const char* dest) {
+    if (value == ir_acc) {
+        if (std::strcmp(dest, ACC) != 0)
+            emit_move(dest, ACC);
+        return;
+    }
+    auto slot = ir_slots.find(value);
+    if (slot != ir_slots.end()) {
+        emit_lw(dest, slot->second * WORD_SIZE, FP);
+        return;
+    }
+    switch (value->op) {
+        case IROp::Const:
+            emit_li(dest, value->value);
+            break;
+        case IROp::String:
+            emit_la(dest, STRCONST_PREFIX + std::to_string(stringtable().get_index(value->name)));
+            break;
+        case IROp::Void:
+            emit_move(dest, ZERO);
+            break;
+        case IROp::Param:
+            emit_move(dest, SELF);
+            break;
+        case IROp::Box: {
+            IRInstr* raw = value->operands[0];
+            if (raw->type == IRType::Bool)
+                emit_la(dest, raw->value ? BOOLCONST_TRUE : BOOLCONST_FALSE);
+            else
+                emit_la(dest, INTCONST_PREFIX + std::to_string(inttable().get_index(std::to_string(raw->value))));
+            break;
+        }
+        default:
+            std::cerr << "IR value %" << value->id << " isn't available.\n";
+            exit(EXIT_FAILURE);
+    }
+}
+
+const char* Cgen::ir_reg(IRInstr* value, const char* scratch) {
+    if (value == ir_acc)
+        return ACC;
+    if (value->op == IROp::Param && value->value == 0)
+        return SELF;
+    if (value->op == IROp::Const && value->value == 0)
+        return ZERO;
+    ir_load(value, scratch);
+    return scratch;
+}
+
+void Cgen::ir_store(IRInstr* value) {
+    ir_acc = value;
+    auto slot = ir_slots.find(value);
+    if (slot != ir_slots.end())
+        emit_sw(ACC, slot->second * WORD_SIZE, FP);
+}
+
+void Cgen::cgen_ir_function(IRFunction& function) {
+    split_critical_edges(function);
+    verify_or_die(function, "after splitting the critical edges");
+
+    std::unordered_map<IRInstr*, std::vector<IRInstr*>> users;
+    for (auto& block: function.blocks) {
+        for (auto& instr: block->instrs) {
+            for (IRInstr* operand: instr->operands)
+                users[operand].push_back(instr.get());
+        }
+    }
+
+    // the slots follow the RA, the old fp and self in the AR.
+    ir_slots.clear();
+    ir_labels.clear();
+    ir_fused.clear();
+    std::size_t nslots = 0;
+    for (auto& block: function.blocks) {
+        ir_labels[block.get()] = "ir_block" + std::to_string(ir_label_count++);
+        for (std::size_t i = 0; i < block->instrs.size(); i++) {
+            IRInstr* instr = block->instrs[i].get();
+            if (instr->type == IRType::None || ir_rematerialized(instr))
+                continue;
+            bool compare = instr->op == IROp::Lt || instr->op == IROp::Le || instr->op == IROp::Eq || instr->op == IROp::Not;
+            if (compare && i + 2 == block->instrs.size() && block->terminator()->op == IROp::Branch &&
+                users[instr].size() == 1 && users[instr][0] == block->terminator()) {
+                ir_fused.insert(instr);
+                continue;
+            }
+            if (ir_in_acc(block.get(), i, users))
+                continue;
+            ir_slots[instr] = AR_BASE_SIZE + nslots++;
+        }
+    }
+
+    std::size_t nformals = function.nparams - 1;
+    ir_stack_params = nformals > ARG_REGS ? nformals - ARG_REGS : 0;
+    ir_frame_size = AR_BASE_SIZE + nslots;
+    emit_push(ir_frame_size);
+    emit_sw(RA, WORD_SIZE, SP);
+    emit_sw(FP, 2 * WORD_SIZE, SP);
+    emit_sw(SELF, 3 * WORD_SIZE, SP);
+    emit_addiu(FP, SP, 4);
+    emit_move(SELF, ACC);
+
+    for (std::size_t i = 0; i < function.blocks.size(); i++) {
+        IRBlock* block = function.blocks[i].get();
+        IRBlock* next = i + 1 < function.blocks.size() ? function.blocks[i + 1].get() : nullptr;
+        if (i > 0)
+            emit_label(ir_labels[block]);
+        ir_acc = nullptr;
+        for (auto& instr: block->instrs)
+            cgen_ir_instr(instr.get(), next);
+    }
+    frames.push_back({function.name, ir_frame_size + ir_stack_params, 0, true, true, true});
+}
+
+void Cgen::cgen_ir_instr(IRInstr* instr, IRBlock* next) {
+    static const char* arg_regs[ARG_REGS] = {A1, A2, A3};
+    auto& ops = instr->operands;
+
+    switch (instr->op) {
+        case IROp::Param: {
+            // the formals passed on the stack are right above the frame.
+            auto slot = ir_slots.find(instr);
+            if (instr->value == 0 || slot == ir_slots.end())
+                break;
+            std::size_t formal = instr->value - 1;
+            if (formal < ARG_REGS) {
+                emit_sw(arg_regs[formal], slot->second * WORD_SIZE, FP);
+            } else {
+                emit_lw(T1, (ir_frame_size + formal - ARG_REGS + 1) * WORD_SIZE, SP);
+                emit_sw(T1, slot->second * WORD_SIZE, FP);
+            }
+            break;
+        }
+        case IROp::Const:
+        case IROp::String:
+        case IROp::Void:
+        case IROp::Phi:
+            break;
+
+        case IROp::Add:
+        case IROp::Sub:
+        case IROp::Mul:
+        case IROp::Div: {
+            const char* lhs = ir_reg(ops[0], T1);
+            bool immediate = (instr->op == IROp::Add || instr->op == IROp::Sub) && ops[1]->op == IROp::Const &&
+                             ops[1]->value > -32768 && ops[1]->value < 32768;
+            if (immediate) {
+                emit_addi(ACC, lhs, instr->op == IROp::Add ? ops[1]->value : -ops[1]->value);
+            } else {
+                const char* rhs = ir_reg(ops[1], T2);
+                if (instr->op == IROp::Add)
+                    emit_add(ACC, lhs, rhs);
+                else if (instr->op == IROp::Sub)
+                    emit_sub(ACC, lhs, rhs);
+                else if (instr->op == IROp::Mul)
+                    emit_mul(ACC, lhs, rhs);
+                else
+                    emit_div(ACC, lhs, rhs);
+            }
+            ir_store(instr);
+            break;
+        }
+        case IROp::Neg:
+            emit_neg(ACC, ir_reg(ops[0], T1));
+            ir_store(instr);
+            break;
+        case IROp::Lt:
+        case IROp::Le:
+        case IROp::Eq:
+        case IROp::Not: {
+            if (ir_fused.count(instr))
+                break;
+            const char* lhs = ir_reg(ops[0], T1);
+            if (instr->op == IROp::Not)
+                emit_seq(ACC, lhs, 0);
+            else if (instr->op == IROp::Lt)
+                emit_sgt(ACC, ir_reg(ops[1], T2), lhs);
+            else if (instr->op == IROp::Le)
+                emit_sle(ACC, lhs, ir_reg(ops[1], T2));
+            else
+                emit_seq(ACC, lhs, ir_reg(ops[1], T2));
+            ir_store(instr);
+            break;
+        }
+
+        case IROp::Box: {
+            if (ir_rematerialized(instr))
+                break;
+            if (ops[0]->type == IRType::Bool) {
+                // bool_const1 follows bool_const0.
+                const char* raw = ir_reg(ops[0], T1);
+                emit_sll(T1, raw, 4);
+                emit_la(ACC, BOOLCONST_FALSE);
+                emit_addu(ACC, ACC, T1);
+            } else {
+                cgen_alloc(Int.lexeme, false);
+                ir_acc = nullptr;
+                emit_sw(ir_reg(ops[0], T1), DEFAULT_OBJFIELDS * WORD_SIZE, ACC);
+            }
+            ir_store(instr);
+            break;
+        }
+        case IROp::Unbox:
+            emit_lw(ACC, DEFAULT_OBJFIELDS * WORD_SIZE, ir_reg(ops[0], ACC));
+            ir_store(instr);
+            break;
+        case IROp::ObjEq:
+            ir_load(ops[0], A1);
+            ir_load(ops[1], ACC);
+            emit_jal("eq");
+            emit_lw(ACC, DEFAULT_OBJFIELDS * WORD_SIZE, ACC);
+            ir_store(instr);
+            break;
+        case IROp::IsVoid:
+            emit_seq(ACC, ir_reg(ops[0], T1), 0);
+            ir_store(instr);
+            break;
+
+        case IROp::New:
+            cgen_alloc(instr->class_name, false);
+            if (!noop_inits.count(instr->class_name))
+                emit_jal(instr->class_name + CLASSINIT_SUFFIX);
+            ir_store(instr);
+            break;
+        case IROp::GetAttr:
+            emit_lw(ACC, WORD_SIZE * (attr_table[instr->class_name][instr->name] + 2), ir_reg(ops[0], T1));
+            ir_store(instr);
+            break;
+        case IROp::SetAttr: {
+            const char* object = ir_reg(ops[0], T1);
+            emit_sw(ir_reg(ops[1], T2), WORD_SIZE * (attr_table[instr->class_name][instr->name] + 2), object);
+            break;
+        }
+        case IROp::Dispatch:
+        case IROp::Call:
+            cgen_ir_call(instr);
+            break;
+        case IROp::CheckDispatch:
+        case IROp::CheckCase:
+            cgen_ir_check(instr);
+            break;
+
+        case IROp::Jump:
+            cgen_ir_phi_moves(instr->block, instr->targets[0]);
+            if (instr->targets[0] != next)
+                emit_b(ir_labels[instr->targets[0]]);
+            break;
+        case IROp::Branch:
+            cgen_ir_branch(instr, next);
+            break;
+        case IROp::TypeCase: {
+            ir_load(ops[0], ACC);
+            std::vector<std::string> branch_labels;
+            for (IRBlock* target: instr->targets)
+                branch_labels.push_back(ir_labels[target]);
+            std::string abort_label = "ir_case_abort" + std::to_string(ir_label_count++);
+            std::vector<CaseInterval> intervals = case_intervals(instr->class_name, instr->cases);
+            emit_lw(T2, TAG_OFFSET, ACC);
+            if (intervals.size() >= CASE_JUMP_TABLE_MIN_INTERVALS)
+                cgen_case_jump_table(intervals, branch_labels, abort_label);
+            else
+                cgen_case_search(intervals, 0, intervals.size() - 1, branch_labels, abort_label);
+            emit_label(abort_label);
+            emit_jal("_case_abort");
+            break;
+        }
+        case IROp::Return:
+            ir_load(ops[0], ACC);
+            emit_lw(RA, WORD_SIZE, SP);
+            emit_lw(FP, 2 * WORD_SIZE, SP);
+            emit_lw(SELF, 3 * WORD_SIZE, SP);
+            emit_pop(ir_frame_size + ir_stack_params);
+            emit_jr(RA);
+            break;
+    }
+}
+
+void Cgen::cgen_ir_call(IRInstr* instr) {
+    static const char* arg_regs[ARG_REGS] = {A1, A2, A3};
+    auto& ops = instr->operands;
+
+    // the callee pops the arguments passed on the stack, the first of them
+    // on top.
+    std::size_t nargs = ops.size() - 1;
+    std::size_t nstack = nargs > ARG_REGS ? nargs - ARG_REGS : 0;
+    if (nstack)
+        emit_push(nstack);
+    for (std::size_t i = ARG_REGS; i < nargs; i++)
+        emit_sw(ir_reg(ops[i + 1], T1), (i - ARG_REGS + 1) * WORD_SIZE, SP);
+    for (std::size_t i = 0; i < nargs && i < ARG_REGS; i++)
+        ir_load(ops[i + 1], arg_regs[i]);
+    ir_load(ops[0], ACC);
+
+    if (instr->op == IROp::Call) {
+        emit_jal(instr->class_name + METHOD_SEP + instr->name);
+    } else {
+        emit_lw(T1, DISPTABLE_OFFSET * WORD_SIZE, ACC);
+        emit_lw(T1, method_table[instr->class_name][instr->name] * WORD_SIZE, T1);
+        emit_jalr(T1);
+    }
+    ir_store(instr);
+}
+
+void Cgen::cgen_ir_check(IRInstr* instr) {
+    ir_load(instr->operands[0], ACC);
+    ir_acc = instr->operands[0];
+    std::string ok_label = "ir_check" + std::to_string(ir_label_count++);
+    emit_bne(ACC, ZERO, ok_label);
+    emit_la(ACC, FILENAME);
+    emit_li(T1, instr->value);
+    emit_jal(instr->op == IROp::CheckDispatch ? "_dispatch_abort" : "_case_abort2");
+    emit_label(ok_label);
+}
+
+void Cgen::cgen_ir_branch(IRInstr* instr, IRBlock* next) {
+    IRInstr* cond = instr->operands[0];
+    IRBlock* if_true = instr->targets[0];
+    IRBlock* if_false = instr->targets[1];
+    if (ir_fused.count(cond) && cond->op == IROp::Not) {
+        std::swap(if_true, if_false);
+        cond = cond->operands[0];
+    }
+
+    // jump to `target` when the condition is `jump_if`, fall through to
+    // the next block if possible.
+    bool jump_if = true;
+    IRBlock* target = if_true;
+    IRBlock* other = if_false;
+    if (if_true == next) {
+        jump_if = false;
+        std::swap(target, other);
+    }
+    const std::string& label = ir_labels[target];
+
+    if (ir_fused.count(cond)) {
+        TokenType op = cond->op == IROp::Lt ? LESS : cond->op == IROp::Le ? LESS_EQUAL : EQUAL;
+        const char* lhs = ir_reg(cond->operands[0], T1);
+        IRInstr* rhs = cond->operands[1];
+        if (rhs->op == IROp::Const)
+            emit_compare_branch(op, jump_if, lhs, rhs->value, label);
+        else
+            emit_compare_branch(op, jump_if, lhs, ir_reg(rhs, T2), label);
+    } else if (jump_if) {
+        emit_bne(ir_reg(cond, T1), ZERO, label);
+    } else {
+        emit_beq(ir_reg(cond, T1), ZERO, label);
+    }
+    if (other != next)
+        emit_b(ir_labels[other]);
+}
+
+void Cgen::cgen_ir_phi_moves(IRBlock* from, IRBlock* to) {
+    std::size_t index = std::find(to->preds.begin(), to->preds.end(), from) - to->preds.begin();
+    std::vector<std::pair<IRInstr*, IRInstr*>> moves;
+    bool overlap = false;
+    for (auto& instr: to->instrs) {
+        if (instr->op != IROp::Phi)
+            break;
+        IRInstr* source = instr->operands[index];
+        if (source == instr.get())
+            continue;
+        moves.push_back({instr.get(), source});
+        overlap = overlap || (source->op == IROp::Phi && source->block == to);
+    }
+
+    // when a phi takes the value of another, all the values are read before
+    // any is written.
+    if (overlap) {
+        emit_push(moves.size());
+        for (std::size_t i = 0; i < moves.size(); i++)
+            emit_sw(ir_reg(moves[i].second, T1), (i + 1) * WORD_SIZE, SP);
+        for (std::size_t i = 0; i < moves.size(); i++) {
+            emit_lw(T1, (i + 1) * WORD_SIZE, SP);
+            emit_sw(T1, ir_slots[moves[i].first] * WORD_SIZE, FP);
+        }
+        emit_pop(moves.size());
+        return;
+    }
+    for (auto& move: moves)
+        emit_sw(ir_reg(move.second, T1), ir_slots[move.first] * WORD_SIZE, FP);
+}
+
+}
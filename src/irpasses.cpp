@@ -0,0 +1,777 @@
+#include "irpasses.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace cool {
+
+// the instructions using each value.
+static std::unordered_map<IRInstr*, std::vector<IRInstr*>> compute_users(IRFunction& function) {
+    std::unordered_map<IRInstr*, std::vector<IRInstr*>> users;
+    for (auto& block: function.blocks) {
+        for (auto& instr: block->instrs) {
+            for (IRInstr* operand: instr->operands)
+                users[operand].push_back(instr.get());
+        }
+    }
+    return users;
+}
+
+// value of the phi when all its operands, but itself, are the same value.
+static IRInstr* trivial_phi_value(IRInstr* phi) {
+    IRInstr* same = nullptr;
+    for (IRInstr* operand: phi->operands) {
+        if (operand == phi || operand == same)
+            continue;
+        if (same)
+            return nullptr;
+        same = operand;
+    }
+    return same;
+}
+
+static bool is_const(IRInstr* instr, int value) {
+    return instr->op == IROp::Const && instr->value == value;
+}
+
+bool fold_pass(IRFunction& function, IRPassContext& context) {
+    std::vector<IRInstr*> folded;
+    for (auto& block: function.blocks) {
+        for (std::size_t i = 0; i < block->instrs.size(); i++) {
+            IRInstr* instr = block->instrs[i].get();
+            auto& ops = instr->operands;
+            bool constants = !ops.empty() && std::all_of(ops.begin(), ops.end(), [](IRInstr* op) { return op->op == IROp::Const; });
+            IRInstr* replacement = nullptr;
+
+            // the code wraps around on 32 bits, so does the folding.
+            auto constant = [&](IRType type, std::int64_t value) {
+                IRInstr* c = function.insert(block.get(), i++, IROp::Const, type);
+                c->value = static_cast<std::int32_t>(static_cast<std::uint32_t>(value));
+                return c;
+            };
+            auto wrap = [](std::int64_t value) { return static_cast<std::uint32_t>(value); };
+
+            switch (instr->op) {
+                case IROp::Add:
+                    if (constants)
+                        replacement = constant(IRType::Int, wrap(std::int64_t{ops[0]->value} + ops[1]->value));
+                    else if (is_const(ops[1], 0))
+                        replacement = ops[0];
+                    else if (is_const(ops[0], 0))
+                        replacement = ops[1];
+                    break;
+                case IROp::Sub:
+                    if (constants)
+                        replacement = constant(IRType::Int, wrap(std::int64_t{ops[0]->value} - ops[1]->value));
+                    else if (is_const(ops[1], 0))
+                        replacement = ops[0];
+                    break;
+                case IROp::Mul:
+                    if (constants)
+                        replacement = constant(IRType::Int, wrap(std::int64_t{ops[0]->value} * ops[1]->value));
+                    else if (is_const(ops[1], 1))
+                        replacement = ops[0];
+                    else if (is_const(ops[0], 1))
+                        replacement = ops[1];
+                    break;
+                case IROp::Div:
+                    // a division by zero is left to fail at runtime.
+                    if (constants && ops[1]->value != 0 && !(ops[0]->value == INT_MIN && ops[1]->value == -1))
+                        replacement = constant(IRType::Int, ops[0]->value / ops[1]->value);
+                    else if (is_const(ops[1], 1))
+                        replacement = ops[0];
+                    break;
+                case IROp::Neg:
+                    if (constants)
+                        replacement = constant(IRType::Int, wrap(-std::int64_t{ops[0]->value}));
+                    else if (ops[0]->op == IROp::Neg)
+                        replacement = ops[0]->operands[0];
+                    break;
+                case IROp::Lt:
+                    if (constants)
+                        replacement = constant(IRType::Bool, ops[0]->value < ops[1]->value);
+                    else if (ops[0] == ops[1])
+                        replacement = constant(IRType::Bool, false);
+                    break;
+                case IROp::Le:
+                case IROp::Eq:
+                    if (constants)
+                        replacement = constant(IRType::Bool, instr->op == IROp::Le ? ops[0]->value <= ops[1]->value
+                                                                                   : ops[0]->value == ops[1]->value);
+                    else if (ops[0] == ops[1])
+                        replacement = constant(IRType::Bool, true);
+                    break;
+                case IROp::Not:
+                    if (constants)
+                        replacement = constant(IRType::Bool, !ops[0]->value);
+                    else if (ops[0]->op == IROp::Not)
+                        replacement = ops[0]->operands[0];
+                    break;
+                case IROp::Unbox:
+                    if (ops[0]->op == IROp::Box && ops[0]->operands[0]->type == instr->type)
+                        replacement = ops[0]->operands[0];
+                    break;
+                case IROp::IsVoid:
+                    if (ops[0]->op == IROp::Void)
+                        replacement = constant(IRType::Bool, true);
+                    else if (ops[0]->op == IROp::New || ops[0]->op == IROp::Box || ops[0]->op == IROp::String ||
+                             (ops[0]->op == IROp::Param && ops[0]->value == 0))
+                        replacement = constant(IRType::Bool, false);
+                    break;
+                case IROp::ObjEq:
+                    if (ops[0] == ops[1]) {
+                        replacement = constant(IRType::Bool, true);
+                    } else if (ops[0]->op == IROp::Box && ops[1]->op == IROp::Box &&
+                               ops[0]->operands[0]->type == ops[1]->operands[0]->type) {
+                        replacement = function.insert(block.get(), i++, IROp::Eq, IRType::Bool,
+                                                      {ops[0]->operands[0], ops[1]->operands[0]});
+                    }
+                    break;
+                case IROp::Phi:
+                    replacement = trivial_phi_value(instr);
+                    break;
+                default:
+                    break;
+            }
+            if (replacement) {
+                function.replace_uses(instr, replacement);
+                folded.push_back(instr);
+            }
+        }
+    }
+    function.erase(folded);
+    return !folded.empty();
+}
+
+// replace the terminator of `block` by a jump to `target`.
+static void make_jump(IRFunction& function, IRBlock* block, IRBlock* target) {
+    IRInstr* term = block->terminator();
+    term->op = IROp::Jump;
+    term->operands.clear();
+    term->targets = {target};
+    term->cases.clear();
+    term->class_name.clear();
+}
+
+// whether the phis of `block` get the same value from its predecessors
+// `a` and `b`.
+static bool same_phi_values(IRBlock* block, std::size_t a, std::size_t b) {
+    for (auto& instr: block->instrs) {
+        if (instr->op == IROp::Phi && instr->operands[a] != instr->operands[b])
+            return false;
+    }
+    return true;
+}
+
+static std::size_t pred_index(IRBlock* block, IRBlock* pred, std::size_t from = 0) {
+    return std::find(block->preds.begin() + from, block->preds.end(), pred) - block->preds.begin();
+}
+
+bool simplify_cfg_pass(IRFunction& function, IRPassContext& context) {
+    bool changed = false;
+    for (bool again = true; again; ) {
+        again = false;
+
+        // branches whose way is known.
+        for (auto& block: function.blocks) {
+            IRInstr* term = block->terminator();
+            if (term->op != IROp::Branch)
+                continue;
+            IRBlock* taken = nullptr;
+            IRBlock* dropped = nullptr;
+            if (term->operands[0]->op == IROp::Const) {
+                taken = term->targets[term->operands[0]->value ? 0 : 1];
+                dropped = term->targets[term->operands[0]->value ? 1 : 0];
+            } else if (term->targets[0] == term->targets[1]) {
+                IRBlock* target = term->targets[0];
+                std::size_t first = pred_index(target, block.get());
+                if (!same_phi_values(target, first, pred_index(target, block.get(), first + 1)))
+                    continue;
+                taken = dropped = target;
+            } else {
+                continue;
+            }
+            IRFunction::remove_pred(dropped, block.get());
+            make_jump(function, block.get(), taken);
+            again = true;
+        }
+
+        // blocks no longer reachable.
+        std::unordered_set<IRBlock*> reachable;
+        std::vector<IRBlock*> worklist{function.blocks.front().get()};
+        reachable.insert(worklist.back());
+        while (!worklist.empty()) {
+            IRBlock* b = worklist.back();
+            worklist.pop_back();
+            for (IRBlock* succ: b->successors()) {
+                if (reachable.insert(succ).second)
+                    worklist.push_back(succ);
+            }
+        }
+        if (reachable.size() != function.blocks.size()) {
+            for (auto& block: function.blocks) {
+                if (reachable.count(block.get()))
+                    continue;
+                for (IRBlock* succ: block->successors()) {
+                    if (reachable.count(succ))
+                        IRFunction::remove_pred(succ, block.get());
+                }
+            }
+            auto& blocks = function.blocks;
+            blocks.erase(std::remove_if(blocks.begin(), blocks.end(),
+                                        [&](const std::unique_ptr<IRBlock>& b) { return !reachable.count(b.get()); }),
+                         blocks.end());
+            again = true;
+        }
+
+        // phis left with a single value.
+        std::vector<IRInstr*> trivial;
+        for (auto& block: function.blocks) {
+            for (auto& instr: block->instrs) {
+                if (instr->op != IROp::Phi)
+                    break;
+                IRInstr* value = trivial_phi_value(instr.get());
+                if (value) {
+                    function.replace_uses(instr.get(), value);
+                    trivial.push_back(instr.get());
+                }
+            }
+        }
+        if (!trivial.empty()) {
+            function.erase(trivial);
+            again = true;
+        }
+        if (again) {
+            changed = true;
+            continue;
+        }
+
+        // a block only jumping to another is skipped by its predecessors,
+        // unless that would give a predecessor two edges to a block with phis.
+        for (std::size_t i = 1; i < function.blocks.size(); i++) {
+            IRBlock* block = function.blocks[i].get();
+            if (block->instrs.size() != 1 || block->terminator()->op != IROp::Jump)
+                continue;
+            IRBlock* target = block->terminator()->targets.front();
+            if (target == block)
+                continue;
+            std::size_t index = pred_index(target, block);
+            bool phis = target->first_non_phi() > 0;
+            bool ok = true;
+            for (IRBlock* pred: block->preds) {
+                if (phis && std::count(target->preds.begin(), target->preds.end(), pred) +
+                            std::count(block->preds.begin(), block->preds.end(), pred) > 1)
+                    ok = false;
+            }
+            if (!ok)
+                continue;
+            for (IRBlock* pred: block->preds) {
+                for (auto& t: pred->terminator()->targets) {
+                    if (t == block)
+                        t = target;
+                }
+                target->preds.push_back(pred);
+                for (auto& instr: target->instrs) {
+                    if (instr->op == IROp::Phi)
+                        instr->operands.push_back(instr->operands[index]);
+                }
+            }
+            IRFunction::remove_pred(target, block);
+            function.blocks.erase(function.blocks.begin() + i);
+            again = true;
+            break;
+        }
+        if (again) {
+            changed = true;
+            continue;
+        }
+
+        // a block is merged into its only predecessor when it is its only
+        // successor.
+        for (std::size_t i = 1; i < function.blocks.size(); i++) {
+            IRBlock* block = function.blocks[i].get();
+            if (block->preds.size() != 1)
+                continue;
+            IRBlock* pred = block->preds[0];
+            if (pred == block || pred->terminator()->op != IROp::Jump)
+                continue;
+            pred->instrs.pop_back();
+            for (auto& instr: block->instrs) {
+                instr->block = pred;
+                pred->instrs.push_back(std::move(instr));
+            }
+            for (IRBlock* succ: pred->successors()) {
+                for (auto& p: succ->preds) {
+                    if (p == block)
+                        p = pred;
+                }
+            }
+            function.blocks.erase(function.blocks.begin() + i);
+            again = true;
+            break;
+        }
+        changed = changed || again;
+    }
+    return changed;
+}
+
+bool dce_pass(IRFunction& function, IRPassContext& context) {
+    std::unordered_set<IRInstr*> live;
+    std::vector<IRInstr*> worklist;
+    for (auto& block: function.blocks) {
+        for (auto& instr: block->instrs) {
+            if (instr->has_side_effects() && live.insert(instr.get()).second)
+                worklist.push_back(instr.get());
+        }
+    }
+    while (!worklist.empty()) {
+        IRInstr* instr = worklist.back();
+        worklist.pop_back();
+        for (IRInstr* operand: instr->operands) {
+            if (live.insert(operand).second)
+                worklist.push_back(operand);
+        }
+    }
+    std::vector<IRInstr*> dead;
+    for (auto& block: function.blocks) {
+        for (auto& instr: block->instrs) {
+            if (!live.count(instr.get()))
+                dead.push_back(instr.get());
+        }
+    }
+    function.erase(dead);
+    return !dead.empty();
+}
+
+bool devirtualize_pass(IRFunction& function, IRPassContext& context) {
+    bool changed = false;
+    for (auto& block: function.blocks) {
+        for (auto& instr: block->instrs) {
+            if (instr->op != IROp::Dispatch)
+                continue;
+
+            // the class of the receiver is known exactly for the values
+            // created here.
+            IRInstr* receiver = instr->operands[0];
+            std::string exact;
+            if (receiver->op == IROp::New)
+                exact = receiver->class_name;
+            else if (receiver->op == IROp::Box)
+                exact = receiver->operands[0]->type == IRType::Int ? "Int" : "Bool";
+            else if (receiver->op == IROp::String)
+                exact = "String";
+
+            std::string target = exact.empty() ? context.cha.unique_implementation(instr->class_name, instr->name)
+                                               : context.cha.implementation(exact, instr->name);
+            if (target.empty())
+                continue;
+            instr->op = IROp::Call;
+            instr->class_name = target;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// whether `value` can't be void, the phis being assumed not to be while
+// their operands are looked at.
+static bool non_void(IRInstr* value, std::unordered_map<IRInstr*, bool>& known) {
+    switch (value->op) {
+        case IROp::New:
+        case IROp::Box:
+        case IROp::String:
+            return true;
+        case IROp::Param:
+            return value->value == 0;
+        case IROp::Phi: {
+            auto fact = known.find(value);
+            if (fact != known.end())
+                return fact->second;
+            known[value] = true;
+            bool result = std::all_of(value->operands.begin(), value->operands.end(),
+                                      [&](IRInstr* operand) { return non_void(operand, known); });
+            known[value] = result;
+            return result;
+        }
+        default:
+            return false;
+    }
+}
+
+bool void_checks_pass(IRFunction& function, IRPassContext& context) {
+    IRDominators dominators{function};
+    std::unordered_set<IRInstr*> checked;
+    std::vector<IRInstr*> removed;
+
+    // the values checked in a block are known not to be void in the blocks
+    // it dominates.
+    std::function<void(IRBlock*)> walk = [&](IRBlock* block) {
+        std::vector<IRInstr*> added;
+        for (auto& instr: block->instrs) {
+            if (instr->op != IROp::CheckDispatch && instr->op != IROp::CheckCase)
+                continue;
+            IRInstr* value = instr->operands[0];
+            std::unordered_map<IRInstr*, bool> known;
+            if (checked.count(value) || non_void(value, known)) {
+                removed.push_back(instr.get());
+            } else {
+                checked.insert(value);
+                added.push_back(value);
+            }
+        }
+        for (IRBlock* child: dominators.children[block])
+            walk(child);
+        for (IRInstr* value: added)
+            checked.erase(value);
+    };
+    walk(function.blocks.front().get());
+    function.erase(removed);
+    return !removed.empty();
+}
+
+bool unbox_phis_pass(IRFunction& function, IRPassContext& context) {
+    auto users = compute_users(function);
+
+    // the phis whose values are all boxed, directly or through other such
+    // phis, of a single raw type.
+    std::vector<IRInstr*> phis;
+    for (auto& block: function.blocks) {
+        for (auto& instr: block->instrs) {
+            if (instr->op == IROp::Phi && instr->type == IRType::Obj)
+                phis.push_back(instr.get());
+        }
+    }
+    std::unordered_map<IRInstr*, IRType> raw_type;
+    for (IRInstr* phi: phis)
+        raw_type[phi] = IRType::None;
+    for (bool again = true; again; ) {
+        again = false;
+        for (IRInstr* phi: phis) {
+            auto entry = raw_type.find(phi);
+            if (entry == raw_type.end())
+                continue;
+            IRType type = entry->second;
+            bool ok = true;
+            for (IRInstr* operand: phi->operands) {
+                IRType t = IRType::None;
+                if (operand->op == IROp::Box)
+                    t = operand->operands[0]->type;
+                else if (raw_type.count(operand))
+                    t = raw_type[operand];
+                else
+                    ok = false;
+                if (t != IRType::None && type != IRType::None && t != type)
+                    ok = false;
+                if (t != IRType::None)
+                    type = t;
+            }
+            if (!ok) {
+                raw_type.erase(phi);
+                again = true;
+            } else if (type != entry->second) {
+                entry->second = type;
+                again = true;
+            }
+        }
+    }
+
+    // only worth it when some of the values are unboxed.
+    bool unboxed = false;
+    for (auto& entry: raw_type) {
+        for (IRInstr* user: users[entry.first])
+            unboxed = unboxed || (user->op == IROp::Unbox && user->type == entry.second);
+    }
+    for (auto it = raw_type.begin(); it != raw_type.end(); ) {
+        if (it->second == IRType::None)
+            it = raw_type.erase(it);
+        else
+            ++it;
+    }
+    if (!unboxed || raw_type.empty())
+        return false;
+
+    std::unordered_map<IRInstr*, IRInstr*> raw;
+    for (IRInstr* phi: phis) {
+        if (raw_type.count(phi))
+            raw[phi] = function.insert(phi->block, phi->block->first_non_phi(), IROp::Phi, raw_type[phi]);
+    }
+    std::vector<IRInstr*> removed;
+    for (auto& entry: raw) {
+        IRInstr* phi = entry.first;
+        IRInstr* raw_phi = entry.second;
+        for (IRInstr* operand: phi->operands)
+            raw_phi->operands.push_back(operand->op == IROp::Box ? operand->operands[0] : raw[operand]);
+
+        // the other uses get the value boxed again.
+        IRInstr* boxed = nullptr;
+        for (IRInstr* user: users[phi]) {
+            if (raw.count(user))
+                continue;
+            if (user->op == IROp::Unbox && user->type == raw_phi->type) {
+                function.replace_uses(user, raw_phi);
+                removed.push_back(user);
+                continue;
+            }
+            if (!boxed)
+                boxed = function.insert(phi->block, phi->block->first_non_phi(), IROp::Box, IRType::Obj, {raw_phi});
+            for (auto& operand: user->operands) {
+                if (operand == phi)
+                    operand = boxed;
+            }
+        }
+        removed.push_back(phi);
+    }
+    function.erase(removed);
+    return true;
+}
+
+bool cse_pass(IRFunction& function, IRPassContext& context) {
+    using Key = std::tuple<IROp, IRType, int, std::string, std::string, std::vector<IRInstr*>>;
+    IRDominators dominators{function};
+    std::map<Key, IRInstr*> available;
+    std::vector<IRInstr*> removed;
+
+    auto pure = [](IRInstr* instr) {
+        switch (instr->op) {
+            case IROp::Const: case IROp::String: case IROp::Void:
+            case IROp::Add: case IROp::Sub: case IROp::Mul: case IROp::Neg:
+            case IROp::Lt: case IROp::Le: case IROp::Eq: case IROp::Not:
+            case IROp::Unbox: case IROp::ObjEq: case IROp::IsVoid:
+                return true;
+            case IROp::Div:
+                return !instr->has_side_effects();
+            default:
+                return false;
+        }
+    };
+
+    // the values computed in a block are available in the blocks it
+    // dominates.
+    std::function<void(IRBlock*)> walk = [&](IRBlock* block) {
+        std::vector<Key> added;
+        for (auto& instr: block->instrs) {
+            if (!pure(instr.get()))
+                continue;
+            std::vector<IRInstr*> operands = instr->operands;
+            if (instr->op == IROp::Add || instr->op == IROp::Mul || instr->op == IROp::Eq)
+                std::sort(operands.begin(), operands.end());
+            Key key{instr->op, instr->type, instr->value, instr->name, instr->class_name, operands};
+            auto found = available.find(key);
+            if (found != available.end()) {
+                function.replace_uses(instr.get(), found->second);
+                removed.push_back(instr.get());
+            } else {
+                available[key] = instr.get();
+                added.push_back(key);
+            }
+        }
+        for (IRBlock* child: dominators.children[block])
+            walk(child);
+        for (auto& key: added)
+            available.erase(key);
+    };
+    walk(function.blocks.front().get());
+    function.erase(removed);
+    return !removed.empty();
+}
+
+// expand the body of `callee` in place of the call `call`.
+static void inline_call(IRFunction& function, IRInstr* call, IRFunction& callee) {
+    IRBlock* block = call->block;
+    std::size_t index = std::find_if(block->instrs.begin(), block->instrs.end(),
+                                     [call](const std::unique_ptr<IRInstr>& i) { return i.get() == call; }) - block->instrs.begin();
+    std::size_t position = std::find_if(function.blocks.begin(), function.blocks.end(),
+                                        [block](const std::unique_ptr<IRBlock>& b) { return b.get() == block; }) - function.blocks.begin();
+    std::size_t first_new = function.blocks.size();
+
+    // the code after the call goes to a block of its own.
+    IRBlock* rest = function.new_block();
+    for (std::size_t i = index + 1; i < block->instrs.size(); i++) {
+        block->instrs[i]->block = rest;
+        rest->instrs.push_back(std::move(block->instrs[i]));
+    }
+    block->instrs.resize(index + 1);
+    for (IRBlock* succ: rest->successors()) {
+        for (auto& pred: succ->preds) {
+            if (pred == block)
+                pred = rest;
+        }
+    }
+
+    // copy the blocks of the callee, its parameters being the operands of
+    // the call and its returns jumps to the rest.
+    std::unordered_map<IRBlock*, IRBlock*> blocks;
+    std::unordered_map<IRInstr*, IRInstr*> values;
+    for (auto& b: callee.blocks)
+        blocks[b.get()] = function.new_block();
+    std::vector<std::pair<IRBlock*, IRInstr*>> returns;
+    for (auto& b: callee.blocks) {
+        IRBlock* copy = blocks[b.get()];
+        for (IRBlock* pred: b->preds)
+            copy->preds.push_back(blocks[pred]);
+        for (auto& instr: b->instrs) {
+            if (instr->op == IROp::Param) {
+                values[instr.get()] = call->operands[instr->value];
+                continue;
+            }
+            IRInstr* c = function.append(copy, instr->op, instr->type, instr->operands);
+            c->value = instr->value;
+            c->name = instr->name;
+            c->class_name = instr->class_name;
+            c->cases = instr->cases;
+            for (IRBlock* target: instr->targets)
+                c->targets.push_back(blocks[target]);
+            values[instr.get()] = c;
+        }
+    }
+    for (auto& b: callee.blocks) {
+        IRBlock* copy = blocks[b.get()];
+        for (auto& instr: copy->instrs) {
+            for (auto& operand: instr->operands)
+                operand = values[operand];
+        }
+        IRInstr* term = copy->terminator();
+        if (term->op == IROp::Return) {
+            returns.push_back({copy, term->operands[0]});
+            term->op = IROp::Jump;
+            term->type = IRType::None;
+            term->operands.clear();
+            term->targets = {rest};
+            rest->preds.push_back(copy);
+        }
+    }
+
+    IRBlock* entry = blocks[callee.blocks.front().get()];
+    IRInstr* jump = function.append(block, IROp::Jump, IRType::None);
+    jump->targets = {entry};
+    entry->preds.push_back(block);
+
+    IRInstr* value = returns.front().second;
+    if (returns.size() > 1) {
+        value = function.insert(rest, 0, IROp::Phi, IRType::Obj);
+        for (auto& ret: returns)
+            value->operands.push_back(ret.second);
+    }
+    function.replace_uses(call, value);
+    function.erase({call});
+
+    // keep the blocks in the order of the code: the callee then the rest
+    // right after the call.
+    std::rotate(function.blocks.begin() + first_new, function.blocks.begin() + first_new + 1, function.blocks.end());
+    std::rotate(function.blocks.begin() + position + 1, function.blocks.begin() + first_new, function.blocks.end());
+}
+
+bool inline_pass(IRFunction& function, IRPassContext& context) {
+    std::vector<IRInstr*> calls;
+    for (auto& block: function.blocks) {
+        for (auto& instr: block->instrs) {
+            if (instr->op == IROp::Call)
+                calls.push_back(instr.get());
+        }
+    }
+    bool changed = false;
+    for (IRInstr* call: calls) {
+        IRFunction* callee = context.module.get(call->class_name + "." + call->name);
+        if (!callee || callee == &function || callee->instruction_count() > context.inline_size)
+            continue;
+        inline_call(function, call, *callee);
+        changed = true;
+    }
+    return changed;
+}
+
+void split_critical_edges(IRFunction& function) {
+    std::size_t nblocks = function.blocks.size();
+    for (std::size_t i = 0; i < nblocks; i++) {
+        IRBlock* block = function.blocks[i].get();
+        IRInstr* term = block->terminator();
+        if (term->op == IROp::Jump)
+            continue;
+        for (auto& target: term->targets) {
+            if (target->preds.size() == 1 && target->first_non_phi() == 0)
+                continue;
+            IRBlock* edge = function.new_block();
+            IRInstr* jump = function.append(edge, IROp::Jump, IRType::None);
+            jump->targets = {target};
+            edge->preds.push_back(block);
+            *std::find(target->preds.begin(), target->preds.end(), block) = edge;
+            target = edge;
+        }
+    }
+}
+
+void verify_or_die(IRFunction& function, const std::string& when) {
+    auto errors = verify_ir(function);
+    if (errors.empty())
+        return;
+    std::cerr << "Invalid IR " << when << ":\n";
+    for (auto& error: errors)
+        std::cerr << "  " << error << "\n";
+    print_ir(std::cerr, function);
+    exit(EXIT_FAILURE);
+}
+
+static const std::vector<std::pair<std::string, IRPass>>& all_passes() {
+    static const std::vector<std::pair<std::string, IRPass>> passes{
+        {"fold", fold_pass},
+        {"simplify-cfg", simplify_cfg_pass},
+        {"dce", dce_pass},
+        {"devirtualize", devirtualize_pass},
+        {"void-checks", void_checks_pass},
+        {"unbox-phis", unbox_phis_pass},
+        {"cse", cse_pass},
+        {"inline", inline_pass},
+    };
+    return passes;
+}
+
+std::vector<std::string> PassManager::pipeline(int level) {
+    if (level <= 0)
+        return {};
+    if (level == 1)
+        return {"fold", "simplify-cfg", "devirtualize", "void-checks", "dce"};
+    return {"devirtualize", "fold", "simplify-cfg", "dce", "inline", "fold", "simplify-cfg",
+            "unbox-phis", "fold", "cse", "void-checks", "dce", "simplify-cfg"};
+}
+
+bool PassManager::exists(const std::string& name) {
+    for (auto& pass: all_passes()) {
+        if (pass.first == name)
+            return true;
+    }
+    return false;
+}
+
+bool PassManager::add(const std::string& name) {
+    for (auto& pass: all_passes()) {
+        if (pass.first == name) {
+            passes.push_back(pass);
+            return true;
+        }
+    }
+    return false;
+}
+
+void PassManager::run(IRModule& module) {
+    IRPassContext context{cha, module, inline_size};
+    for (auto& function: module.functions)
+        verify_or_die(*function, "built from the AST");
+    for (auto& pass: passes) {
+        std::size_t changed = 0;
+        for (auto& function: module.functions) {
+            changed += pass.second(*function, context);
+            verify_or_die(*function, "after " + pass.first);
+        }
+        changes.push_back({pass.first, changed});
+    }
+    for (auto& function: module.functions)
+        function->renumber();
+}
+
+}
@@ -0,0 +1,755 @@
+#include "jit.hpp"
+#include "runtime.hpp"
+#include <pthread.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+
+// The code of an instruction of the bytecode reads its operands from the
+// registers of the frame and writes its result back: rax, rcx, rdx, rsi and
+// rdi are scratch, and nothing but raw values is kept in a machine register
+// across a call to the runtime, so the collector finds every object in the
+// stacks. rbx and r12 are saved by the functions, r13, r14 and r15 are set
+// once when entering the code, holding the limits of the two stacks and the
+// address of objects_top. The frame of a function on the machine stack is
+// the return address, rbx, r12 and a word keeping rsp aligned on 16 bytes.
+
+namespace cool {
+
+using coolrt::Object;
+using coolrt::Int;
+using R = X86Reg;
+
+namespace {
+
+constexpr std::size_t code_size = 64 << 20;
+constexpr std::size_t stack_objects = 1 << 23;
+constexpr std::size_t stack_raws = 1 << 23;
+// every frame takes at least an object register and 32 bytes of the machine
+// stack, which is large enough for the stack of registers to fill first.
+constexpr std::size_t machine_stack = stack_objects * 32 + (16 << 20);
+constexpr int32_t value_offset = coolrt::header_words * coolrt::word_size;
+constexpr int32_t disp_offset = 2 * coolrt::word_size;
+
+const char stack_overflow[] = "Stack overflow.\n";
+const char executed[] = "COOL program successfully executed\n";
+
+// the JIT printing the hit rates of its caches when the program exits.
+const JIT* exiting_jit;
+
+X86Mem O(uint32_t reg) {
+    return {R::rbx, static_cast<int32_t>(reg * sizeof(Object*))};
+}
+
+X86Mem Raw(uint32_t reg) {
+    return {R::r12, static_cast<int32_t>(reg * sizeof(int32_t))};
+}
+
+// the function of the runtime implementing a method of the basic classes,
+// the number of its object arguments and of the null ones following them
+// (the frame of the generated code, which the JIT code has none of).
+struct Native {
+    const void* function;
+    int objects;
+    int nulls;
+};
+
+Native native_of(BCNative native) {
+    switch (native) {
+        case BCNative::ObjectAbort:
+            return {reinterpret_cast<const void*>(&object_abort), 1, 0};
+        case BCNative::ObjectTypeName:
+            return {reinterpret_cast<const void*>(&object_type_name), 1, 0};
+        case BCNative::ObjectCopy:
+            return {reinterpret_cast<const void*>(&cool_object_copy), 1, 2};
+        case BCNative::IOOutString:
+            return {reinterpret_cast<const void*>(&io_out_string), 2, 0};
+        case BCNative::IOOutInt:
+            return {reinterpret_cast<const void*>(&io_out_int), 2, 0};
+        case BCNative::IOInString:
+            return {reinterpret_cast<const void*>(&cool_io_in_string), 1, 2};
+        case BCNative::IOInInt:
+            return {reinterpret_cast<const void*>(&cool_io_in_int), 1, 2};
+        case BCNative::StringLength:
+            return {reinterpret_cast<const void*>(&string_length), 1, 0};
+        case BCNative::StringConcat:
+            return {reinterpret_cast<const void*>(&cool_string_concat), 2, 2};
+        case BCNative::StringSubstr:
+            return {reinterpret_cast<const void*>(&cool_string_substr), 3, 2};
+        case BCNative::None:
+            break;
+    }
+    return {nullptr, 0, 0};
+}
+
+}
+
+JIT::JIT(const BCProgram& program_, std::ostream* log_, std::ostream* cache_stats_)
+    : program(program_), image(program_), log(log_), cache_stats(cache_stats_) {
+    for (auto& function: program.functions)
+        max_params = std::max(max_params, function.nparams);
+
+    void* memory = mmap(nullptr, code_size, PROT_READ | PROT_WRITE | PROT_EXEC,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED)
+        coolrt::fail("JIT: can't map the memory of the code.\n");
+    code_start = code_next = static_cast<char*>(memory);
+    code_end = code_start + code_size;
+
+    // the stacks are reserved, their pages being used as the calls get
+    // deeper.
+    objects = static_cast<Object**>(std::calloc(stack_objects, sizeof(Object*)));
+    raws = static_cast<int32_t*>(std::calloc(stack_raws, sizeof(int32_t)));
+    if (!objects || !raws)
+        coolrt::fail("JIT: can't allocate the stacks.\n");
+    objects_top = objects;
+    objects_end = objects + stack_objects;
+    raws_end = raws + stack_raws;
+
+    emit_runtime();
+    for (std::size_t i = 0; i < program.functions.size(); i++) {
+        X86Assembler as{code_next};
+        as.mov32(R::rdx, static_cast<int32_t>(i));
+        as.jmp(compile_trampoline);
+        stubs.push_back(install(as));
+        image.set_entry(i, stubs.back());
+    }
+    entries = stubs;
+}
+
+char* JIT::install(const X86Assembler& as) {
+    if (code_end - code_next < static_cast<std::ptrdiff_t>(as.size()))
+        coolrt::fail("JIT: out of code memory.\n");
+    char* code = code_next;
+    std::memcpy(code, as.code().data(), as.size());
+    code_next += (as.size() + 15) & ~static_cast<std::size_t>(15);
+    return code;
+}
+
+void JIT::emit_runtime() {
+    // the stubs jump here with the function in edx: compile it, then run it
+    // with the arguments of the call.
+    X86Assembler trampoline{code_next};
+    trampoline.push(R::rdi);
+    trampoline.push(R::rsi);
+    trampoline.sub(R::rsp, 8);
+    trampoline.mov32(R::rsi, R::rdx);
+    trampoline.mov(R::rdi, this);
+    trampoline.mov(R::rax, reinterpret_cast<const void*>(&compile_stub));
+    trampoline.call(R::rax);
+    trampoline.add(R::rsp, 8);
+    trampoline.pop(R::rsi);
+    trampoline.pop(R::rdi);
+    trampoline.jmp(R::rax);
+    compile_trampoline = install(trampoline);
+
+    // the stubs of the caches jump here with the receiver in the registers
+    // of the callee, rdi, and the site in edx: add its class to the cache,
+    // then run its method.
+    X86Assembler miss{code_next};
+    miss.push(R::rdi);
+    miss.push(R::rsi);
+    miss.sub(R::rsp, 8);
+    miss.mov32(R::rsi, R::rdx);
+    miss.mov(R::rdx, R::rdi);
+    miss.mov(R::rdi, this);
+    miss.mov(R::rax, reinterpret_cast<const void*>(&cache_miss));
+    miss.call(R::rax);
+    miss.add(R::rsp, 8);
+    miss.pop(R::rsi);
+    miss.pop(R::rdi);
+    miss.jmp(R::rax);
+    miss_trampoline = install(miss);
+
+    // enter(objects, raws, function, objects limit, raws limit, &objects_top)
+    // calls the function from C++.
+    X86Assembler entry{code_next};
+    for (R reg: {R::rbx, R::r12, R::r13, R::r14, R::r15})
+        entry.push(reg);
+    entry.mov(R::r13, R::rcx);
+    entry.mov(R::r14, R::r8);
+    entry.mov(R::r15, R::r9);
+    entry.call(R::rdx);
+    for (R reg: {R::r15, R::r14, R::r13, R::r12, R::rbx})
+        entry.pop(reg);
+    entry.ret();
+    enter = install(entry);
+}
+
+void JIT::run() {
+    pthread_attr_t attributes;
+    pthread_t thread;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, machine_stack);
+    if (cache_stats) {
+        exiting_jit = this;
+        std::atexit([] { exiting_jit->print_cache_stats(); });
+    }
+    if (pthread_create(&thread, &attributes, run_thread, this))
+        coolrt::fail("JIT: can't create the thread of the program.\n");
+    pthread_join(thread, nullptr);
+    std::abort();
+}
+
+void* JIT::run_thread(void* jit_) {
+    // the memory manager is private to the thread, which the registers
+    // become roots of.
+    JIT* jit = static_cast<JIT*>(jit_);
+    coolrt::add_root_range(jit->objects, &jit->objects_top);
+    using Enter = Object* (*)(Object**, int32_t*, char*, Object**, int32_t*, Object***);
+    // the arguments of a call are stored above the frame before the callee
+    // checks its registers fit.
+    Object** objects_limit = jit->objects_end - jit->max_params - 1;
+    reinterpret_cast<Enter>(jit->enter)(jit->objects, jit->raws, jit->entries[jit->program.start],
+                                        objects_limit, jit->raws_end, &jit->objects_top);
+    return nullptr;
+}
+
+char* JIT::compile_stub(JIT* jit, uint32_t function) {
+    return jit->compile(function);
+}
+
+char* JIT::compile(std::size_t index) {
+    const BCFunction& function = program.functions[index];
+    X86Assembler as{code_next};
+    std::size_t first_site = caches.size();
+    if (function.native != BCNative::None)
+        compile_native(function, as);
+    else
+        compile_function(function, as);
+    char* code = install(as);
+    for (std::size_t site = first_site; site < caches.size(); site++)
+        caches[site]->target = code + caches[site]->offset;
+
+    // the stub jumps to the code from now on.
+    char* stub = stubs[index];
+    int32_t offset = static_cast<int32_t>(code - (stub + 5));
+    stub[0] = static_cast<char>(0xe9);
+    std::memcpy(stub + 1, &offset, 4);
+    entries[index] = code;
+    image.set_entry(index, code);
+
+    compiled++;
+    if (log)
+        *log << "jit: " << function.name << ", " << as.size() << " bytes (" << compiled << " of "
+             << program.functions.size() << " functions compiled)\n";
+    return code;
+}
+
+void JIT::compile_native(const BCFunction& function, X86Assembler& as) {
+    // self and the arguments are in the registers of the frame, rdi.
+    static const R args[] = {R::rdi, R::rsi, R::rdx, R::rcx, R::r8};
+    Native native = native_of(function.native);
+    for (int i = native.objects - 1; i >= 0; i--)
+        as.mov(args[i], X86Mem{R::rdi, static_cast<int32_t>(i * sizeof(Object*))});
+    for (int i = native.objects; i < native.objects + native.nulls; i++)
+        as.xor32(args[i], args[i]);
+    as.mov(R::rax, native.function);
+    as.jmp(R::rax);
+}
+
+void JIT::compile_function(const BCFunction& function, X86Assembler& as) {
+    uint32_t nobjects = function.nobjects, nparams = function.nparams;
+    X86Label overflow;
+    as.push(R::rbx);
+    as.push(R::r12);
+    as.sub(R::rsp, 8);
+    as.mov(R::rbx, R::rdi);
+    as.mov(R::r12, R::rsi);
+    as.lea(R::rax, O(nobjects));
+    as.cmp(R::rax, R::r13);
+    as.jcc(X86Cond::a, overflow);
+    as.lea(R::rcx, Raw(function.nraws));
+    as.cmp(R::rcx, R::r14);
+    as.jcc(X86Cond::a, overflow);
+    as.mov(X86Mem{R::r15, 0}, R::rax);
+
+    // the registers which aren't parameters are cleared for the collector.
+    if (nobjects - nparams <= 8) {
+        as.xor32(R::rcx, R::rcx);
+        for (uint32_t reg = nparams; reg < nobjects; reg++)
+            as.mov(O(reg), R::rcx);
+    } else {
+        as.lea(R::rdi, O(nparams));
+        as.mov32(R::rcx, static_cast<int32_t>(nobjects - nparams));
+        as.xor32(R::rax, R::rax);
+        as.rep_stosq();
+    }
+
+    std::vector<X86Label> labels(function.code.size());
+    for (std::size_t pc = 0; pc < function.code.size(); pc += bc_length(&function.code[pc])) {
+        as.bind(labels[pc]);
+        compile_instr(function, pc, labels, as);
+    }
+
+    as.bind(overflow);
+    as.mov(R::rdi, stack_overflow);
+    as.mov(R::rax, reinterpret_cast<const void*>(&coolrt::fail));
+    as.call(R::rax);
+}
+
+void JIT::leave(X86Assembler& as) {
+    as.add(R::rsp, 8);
+    as.pop(R::r12);
+    as.pop(R::rbx);
+}
+
+void JIT::jump_to(std::size_t target, std::size_t next, std::vector<X86Label>& labels, X86Assembler& as) {
+    if (target != next)
+        as.jmp(labels[target]);
+}
+
+void JIT::dispatch(const BCFunction& function, std::size_t pc, uint32_t slot, bool tail, X86Assembler& as) {
+    // the site starts with no class, its stub being the trampoline.
+    auto cache = std::make_unique<InlineCache>();
+    cache->function = function.name;
+    cache->pc = pc;
+    cache->slot = slot;
+    as.mov32(R::rdx, static_cast<int32_t>(caches.size()));
+    cache->offset = as.size() + 1;
+    if (tail)
+        as.jmp(miss_trampoline);
+    else
+        as.call(miss_trampoline);
+    caches.push_back(std::move(cache));
+}
+
+char* JIT::cache_miss(JIT* jit, uint32_t site, Object** registers) {
+    InlineCache& cache = *jit->caches[site];
+    int32_t tag = registers[0]->tag;
+    int method = jit->program.classes[tag].methods[cache.slot];
+    // the cache jumps to the code of the method rather than its stub.
+    char* target = method < 0 ? static_cast<char*>(jit->image.dispatch_tables[tag][cache.slot])
+                   : jit->entries[method] == jit->stubs[method] ? jit->compile(method)
+                                                                 : jit->entries[method];
+    cache.misses++;
+    if (cache.classes.size() < max_cache_classes)
+        cache.classes.emplace_back(tag, target);
+    else
+        cache.megamorphic = true;
+    jit->link_cache(cache);
+    return target;
+}
+
+void JIT::link_cache(InlineCache& cache) {
+    X86Assembler as{code_next};
+    auto count = [&](uint64_t* counter) {
+        as.mov(R::rcx, counter);
+        as.add(X86Mem{R::rcx, 0}, 1);
+    };
+    if (cache.megamorphic) {
+        if (cache_stats)
+            count(&cache.hits[max_cache_classes]);
+        as.mov(R::rax, X86Mem{R::rdi, 0});
+        as.mov(R::rax, X86Mem{R::rax, disp_offset});
+        as.jmp(X86Mem{R::rax, static_cast<int32_t>(cache.slot * sizeof(void*))});
+    } else {
+        as.mov(R::rax, X86Mem{R::rdi, 0});
+        as.mov32(R::rax, X86Mem{R::rax, 0});
+        for (std::size_t i = 0; i < cache.classes.size(); i++) {
+            as.cmp32(R::rax, cache.classes[i].first);
+            if (!cache_stats) {
+                as.jcc(X86Cond::e, cache.classes[i].second);
+                continue;
+            }
+            X86Label next;
+            as.jcc(X86Cond::ne, next);
+            count(&cache.hits[i]);
+            as.jmp(cache.classes[i].second);
+            as.bind(next);
+        }
+        as.jmp(miss_trampoline);
+    }
+    char* stub = install(as);
+
+    // the site calls the new stub from now on.
+    int32_t offset = static_cast<int32_t>(stub - (cache.target + 4));
+    std::memcpy(cache.target, &offset, 4);
+}
+
+void JIT::print_cache_stats() const {
+    std::vector<const InlineCache*> sites;
+    uint64_t total = 0, total_hits = 0;
+    std::size_t megamorphic = 0;
+    auto hits_of = [](const InlineCache& cache) {
+        uint64_t hits = 0;
+        for (std::size_t i = 0; i < max_cache_classes; i++)
+            hits += cache.hits[i];
+        return hits;
+    };
+    auto calls_of = [&](const InlineCache& cache) {
+        return hits_of(cache) + cache.hits[max_cache_classes] + cache.misses;
+    };
+    for (auto& cache: caches) {
+        if (!cache->misses)
+            continue;
+        sites.push_back(cache.get());
+        total += calls_of(*cache);
+        total_hits += hits_of(*cache);
+        megamorphic += cache->megamorphic;
+    }
+    std::stable_sort(sites.begin(), sites.end(), [&](const InlineCache* a, const InlineCache* b) {
+        return calls_of(*a) > calls_of(*b);
+    });
+
+    std::ostream& os = *cache_stats;
+    os << std::fixed << std::setprecision(1);
+    for (const InlineCache* cache: sites) {
+        uint64_t calls = calls_of(*cache);
+        os << "ic: " << cache->function << "@" << cache->pc << ", slot " << cache->slot << ": " << calls
+           << (calls == 1 ? " call, " : " calls, ") << 100.0 * hits_of(*cache) / calls << "% hits, ";
+        if (cache->megamorphic)
+            os << "megamorphic (" << cache->hits[max_cache_classes] << " through the table), ";
+        os << cache->classes.size() << (cache->classes.size() == 1 ? " class:" : " classes:");
+        for (std::size_t i = 0; i < cache->classes.size(); i++)
+            os << (i ? ", " : " ") << program.classes[cache->classes[i].first].name << " " << cache->hits[i];
+        os << "\n";
+    }
+    os << "ic: " << sites.size() << " sites, " << total << " calls, "
+       << (total ? 100.0 * total_hits / total : 0.0) << "% hits, " << megamorphic << " megamorphic\n";
+}
+
+void JIT::store_arguments(const BCFunction& function, const uint32_t* args, uint32_t nargs, uint32_t first,
+                          X86Assembler& as) {
+    for (uint32_t i = 0; i < nargs; i++) {
+        as.mov(R::rax, O(args[i]));
+        as.mov(O(function.nobjects + first + i), R::rax);
+    }
+}
+
+void JIT::tail_arguments(const BCFunction& function, const uint32_t* args, uint32_t nargs, X86Assembler& as) {
+    // the arguments are stored in place, through the registers above the
+    // frame when one would be overwritten before it is read.
+    bool in_place = true;
+    for (uint32_t i = 0; i < nargs; i++)
+        in_place = in_place && (args[i] == i || args[i] >= nargs);
+    if (in_place) {
+        for (uint32_t i = 0; i < nargs; i++) {
+            if (args[i] == i)
+                continue;
+            as.mov(R::rax, O(args[i]));
+            as.mov(O(i), R::rax);
+        }
+        return;
+    }
+    store_arguments(function, args, nargs, 0, as);
+    for (uint32_t i = 0; i < nargs; i++) {
+        as.mov(R::rax, O(function.nobjects + i));
+        as.mov(O(i), R::rax);
+    }
+}
+
+void JIT::box_int(X86Assembler& as) {
+    // allocates the Int holding edi in the nursery, as coolrt::allocate
+    // does, calling new_int when it is full.
+    Object* proto = image.protos[image.tag_of("Int")];
+    X86Label slow, done;
+    as.mov(R::rdx, &coolrt::nursery);
+    as.mov(R::rax, X86Mem{R::rdx, 0});
+    as.lea(R::rcx, X86Mem{R::rax, static_cast<int32_t>(proto->size * coolrt::word_size)});
+    as.cmp(R::rcx, X86Mem{R::rdx, sizeof(char*)});
+    as.jcc(X86Cond::a, slow);
+    as.mov(X86Mem{R::rdx, 0}, R::rcx);
+    as.mov(X86Mem{R::rax, 0}, static_cast<int32_t>(proto->tag));
+    as.mov(X86Mem{R::rax, sizeof(Object*)}, static_cast<int32_t>(proto->size));
+    as.mov(R::rcx, proto->disp);
+    as.mov(X86Mem{R::rax, disp_offset}, R::rcx);
+    as.mov32(R::rcx, R::rdi);
+    as.mov(X86Mem{R::rax, value_offset}, R::rcx);
+    as.jmp(done);
+    as.bind(slow);
+    as.mov(R::rax, reinterpret_cast<const void*>(&coolrt::new_int));
+    as.call(R::rax);
+    as.bind(done);
+}
+
+void JIT::compile_instr(const BCFunction& function, std::size_t pc, std::vector<X86Label>& labels,
+                        X86Assembler& as) {
+    const uint32_t* code = &function.code[pc];
+    std::size_t next = pc + bc_length(code);
+    uint32_t nobjects = function.nobjects;
+
+    auto call = [&](const void* target) {
+        as.mov(R::rax, target);
+        as.call(R::rax);
+    };
+    auto arithmetic = [&](void (X86Assembler::*op)(X86Reg, X86Mem)) {
+        as.mov32(R::rax, Raw(code[2]));
+        (as.*op)(R::rax, Raw(code[3]));
+        as.mov32(Raw(code[1]), R::rax);
+    };
+    auto compare = [&](X86Cond cond) {
+        as.mov32(R::rax, Raw(code[2]));
+        as.cmp32(R::rax, Raw(code[3]));
+        as.set32(cond, R::rax);
+        as.mov32(Raw(code[1]), R::rax);
+    };
+    // to code[3] if code[1] `cond` code[2], to code[4] otherwise.
+    auto branch = [&](X86Cond cond, X86Cond negated) {
+        as.mov32(R::rax, Raw(code[1]));
+        as.cmp32(R::rax, Raw(code[2]));
+        if (code[3] == next) {
+            as.jcc(negated, labels[code[4]]);
+        } else {
+            as.jcc(cond, labels[code[3]]);
+            jump_to(code[4], next, labels, as);
+        }
+    };
+    auto set_attribute = [&](X86Mem object, uint32_t attribute, uint32_t value) {
+        X86Label remembered;
+        as.mov(R::rdi, object);
+        as.mov(R::rax, O(value));
+        as.mov(X86Mem{R::rdi, static_cast<int32_t>(attribute * sizeof(Object*))}, R::rax);
+        as.test32(X86Mem{R::rdi, 4}, coolrt::GC_BARRIER);
+        as.jcc(X86Cond::e, remembered);
+        call(reinterpret_cast<const void*>(&_gc_remember));
+        as.bind(remembered);
+    };
+    auto check_void = [&](const void* abort) {
+        X86Label ok;
+        as.cmp(O(code[1]), 0);
+        as.jcc(X86Cond::ne, ok);
+        as.mov(R::rdi, image.filename);
+        as.mov32(R::rsi, static_cast<int32_t>(code[2]));
+        call(abort);
+        as.bind(ok);
+    };
+    auto callee_registers = [&]() {
+        as.lea(R::rdi, O(nobjects));
+        as.lea(R::rsi, Raw(function.nraws));
+    };
+
+    switch (static_cast<BCOp>(code[0])) {
+        case BCOp::LoadK:
+            as.mov(R::rax, image.constants[code[2]]);
+            as.mov(O(code[1]), R::rax);
+            break;
+        case BCOp::LoadVoid:
+            as.mov(O(code[1]), 0);
+            break;
+        case BCOp::LoadI:
+            as.mov32(Raw(code[1]), static_cast<int32_t>(code[2]));
+            break;
+        case BCOp::MovO:
+            as.mov(R::rax, O(code[2]));
+            as.mov(O(code[1]), R::rax);
+            break;
+        case BCOp::MovR:
+            as.mov32(R::rax, Raw(code[2]));
+            as.mov32(Raw(code[1]), R::rax);
+            break;
+        case BCOp::Add:
+            arithmetic(&X86Assembler::add32);
+            break;
+        case BCOp::AddI:
+            as.mov32(R::rax, Raw(code[2]));
+            as.add32(R::rax, static_cast<int32_t>(code[3]));
+            as.mov32(Raw(code[1]), R::rax);
+            break;
+        case BCOp::Sub:
+            arithmetic(&X86Assembler::sub32);
+            break;
+        case BCOp::Mul:
+            arithmetic(&X86Assembler::imul32);
+            break;
+        case BCOp::Div: {
+            // idiv faults on a zero divisor and on the lowest Int divided by
+            // -1, which gives itself as with MIPS.
+            X86Label nonzero, divide, done;
+            as.cmp32(Raw(code[3]), 0);
+            as.jcc(X86Cond::ne, nonzero);
+            call(reinterpret_cast<const void*>(&_divide_abort));
+            as.bind(nonzero);
+            as.mov32(R::rax, Raw(code[2]));
+            as.cmp32(Raw(code[3]), -1);
+            as.jcc(X86Cond::ne, divide);
+            as.neg32(R::rax);
+            as.jmp(done);
+            as.bind(divide);
+            as.cdq();
+            as.idiv32(Raw(code[3]));
+            as.bind(done);
+            as.mov32(Raw(code[1]), R::rax);
+            break;
+        }
+        case BCOp::Neg:
+            as.mov32(R::rax, Raw(code[2]));
+            as.neg32(R::rax);
+            as.mov32(Raw(code[1]), R::rax);
+            break;
+        case BCOp::Lt:
+            compare(X86Cond::l);
+            break;
+        case BCOp::Le:
+            compare(X86Cond::le);
+            break;
+        case BCOp::Eq:
+            compare(X86Cond::e);
+            break;
+        case BCOp::Not:
+            as.mov32(R::rax, Raw(code[2]));
+            as.test32(R::rax, R::rax);
+            as.set32(X86Cond::e, R::rax);
+            as.mov32(Raw(code[1]), R::rax);
+            break;
+
+        case BCOp::BoxInt:
+            as.mov32(R::rdi, Raw(code[2]));
+            box_int(as);
+            as.mov(O(code[1]), R::rax);
+            break;
+        case BCOp::BoxBool:
+            as.mov32(R::rcx, Raw(code[2]));
+            as.mov(R::rax, image.bools[0]);
+            as.mov(R::rdx, image.bools[1]);
+            as.test32(R::rcx, R::rcx);
+            as.cmov(X86Cond::ne, R::rax, R::rdx);
+            as.mov(O(code[1]), R::rax);
+            break;
+        case BCOp::Unbox:
+            as.mov(R::rax, O(code[2]));
+            as.mov32(R::rax, X86Mem{R::rax, value_offset});
+            as.mov32(Raw(code[1]), R::rax);
+            break;
+        case BCOp::AddBoxed:
+            as.mov(R::rax, O(code[2]));
+            as.mov32(R::rdi, X86Mem{R::rax, value_offset});
+            as.mov(R::rax, O(code[3]));
+            as.add32(R::rdi, X86Mem{R::rax, value_offset});
+            box_int(as);
+            as.mov(O(code[1]), R::rax);
+            break;
+        case BCOp::AddIBoxed:
+            as.mov(R::rax, O(code[2]));
+            as.mov32(R::rdi, X86Mem{R::rax, value_offset});
+            as.add32(R::rdi, static_cast<int32_t>(code[3]));
+            box_int(as);
+            as.mov(O(code[1]), R::rax);
+            break;
+        case BCOp::ObjEq:
+            as.mov(R::rdi, O(code[2]));
+            as.mov(R::rsi, O(code[3]));
+            call(reinterpret_cast<const void*>(&equality_test));
+            as.mov32(Raw(code[1]), R::rax);
+            break;
+        case BCOp::IsVoid:
+            as.cmp(O(code[2]), 0);
+            as.set32(X86Cond::e, R::rax);
+            as.mov32(Raw(code[1]), R::rax);
+            break;
+
+        case BCOp::New:
+            as.mov(R::rdi, image.protos[code[2]]);
+            call(reinterpret_cast<const void*>(&coolrt::copy));
+            as.mov(O(code[1]), R::rax);
+            break;
+        case BCOp::GetAttr:
+            as.mov(R::rax, O(code[2]));
+            as.mov(R::rax, X86Mem{R::rax, static_cast<int32_t>(code[3] * sizeof(Object*))});
+            as.mov(O(code[1]), R::rax);
+            break;
+        case BCOp::SetAttr:
+            set_attribute(O(code[1]), code[2], code[3]);
+            break;
+        case BCOp::GetAttrSelf:
+            as.mov(R::rax, O(0));
+            as.mov(R::rax, X86Mem{R::rax, static_cast<int32_t>(code[2] * sizeof(Object*))});
+            as.mov(O(code[1]), R::rax);
+            break;
+        case BCOp::SetAttrSelf:
+            set_attribute(O(0), code[1], code[2]);
+            break;
+
+        case BCOp::Call:
+            store_arguments(function, code + 4, code[3], 0, as);
+            callee_registers();
+            as.call(entries[code[2]]);
+            as.mov(O(code[1]), R::rax);
+            break;
+        case BCOp::Dispatch:
+            store_arguments(function, code + 4, code[3], 0, as);
+            callee_registers();
+            dispatch(function, pc, code[2], false, as);
+            as.mov(O(code[1]), R::rax);
+            break;
+        case BCOp::DispatchSelf:
+            as.mov(R::rax, O(0));
+            as.mov(O(nobjects), R::rax);
+            store_arguments(function, code + 4, code[3], 1, as);
+            callee_registers();
+            dispatch(function, pc, code[2], false, as);
+            as.mov(O(code[1]), R::rax);
+            break;
+        case BCOp::TailCall:
+            tail_arguments(function, code + 3, code[2], as);
+            as.mov(R::rdi, R::rbx);
+            as.mov(R::rsi, R::r12);
+            leave(as);
+            as.jmp(entries[code[1]]);
+            break;
+        case BCOp::TailDispatch:
+            tail_arguments(function, code + 3, code[2], as);
+            as.mov(R::rdi, R::rbx);
+            as.mov(R::rsi, R::r12);
+            leave(as);
+            dispatch(function, pc, code[1], true, as);
+            break;
+        case BCOp::CheckDispatch:
+            check_void(reinterpret_cast<const void*>(&_dispatch_abort));
+            break;
+        case BCOp::CheckCase:
+            check_void(reinterpret_cast<const void*>(&_case_abort2));
+            break;
+
+        case BCOp::Jump:
+            jump_to(code[1], next, labels, as);
+            break;
+        case BCOp::Branch:
+            as.cmp32(Raw(code[1]), 0);
+            if (code[2] == next) {
+                as.jcc(X86Cond::e, labels[code[3]]);
+            } else {
+                as.jcc(X86Cond::ne, labels[code[2]]);
+                jump_to(code[3], next, labels, as);
+            }
+            break;
+        case BCOp::BranchLt:
+            branch(X86Cond::l, X86Cond::ge);
+            break;
+        case BCOp::BranchLe:
+            branch(X86Cond::le, X86Cond::g);
+            break;
+        case BCOp::BranchEq:
+            branch(X86Cond::e, X86Cond::ne);
+            break;
+        case BCOp::TypeCase: {
+            as.mov(R::rax, O(code[1]));
+            as.mov32(R::rax, X86Mem{R::rax, 0});
+            const uint32_t* interval = code + 3;
+            for (uint32_t i = 0; i < code[2]; i++, interval += 3) {
+                as.mov32(R::rcx, R::rax);
+                as.sub32(R::rcx, static_cast<int32_t>(interval[0]));
+                as.cmp32(R::rcx, static_cast<int32_t>(interval[1] - interval[0]));
+                as.jcc(X86Cond::be, labels[interval[2]]);
+            }
+            as.mov(R::rdi, O(code[1]));
+            call(reinterpret_cast<const void*>(&_case_abort));
+            break;
+        }
+        case BCOp::Return:
+            as.mov(R::rax, O(code[1]));
+            leave(as);
+            as.ret();
+            break;
+        case BCOp::Halt:
+            as.mov(R::rdi, executed);
+            call(reinterpret_cast<const void*>(&coolrt::finish));
+            break;
+        case BCOp::Count:
+            break;
+    }
+}
+
+}
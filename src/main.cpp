@@ -1,3 +1,4 @@
+#include <cctype>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -7,8 +8,13 @@
 #include "parser.hpp"
 #include "ASTPrinter.hpp"
 #include "semant.hpp"
+#include "folder.hpp"
+#include "hoister.hpp"
 #include "cgen.hpp"
+#include "vm.hpp"
+#include "jit.hpp"
 #include "common.hpp"
+#include "runtime.hpp"
 
 using namespace cool;
 
@@ -16,20 +22,192 @@ using namespace cool;
 // codegen as well.
 std::string cool::curr_filename;
 
+static void usage() {
+    std::cerr << "Usage coolc [options] [filename.cool...]\n"
+              << "Options:\n"
+              << "  --inline-budget=N   inline methods whose body has at most N nodes (default 10, 0 disables)\n"
+              << "  --inline-log        print the inlining decision taken for every call site\n"
+              << "  --void-check-log    print the dispatch-on-void checks removed in every method\n"
+              << "  --frame-log         print what the prologue of every method saves and sets up\n"
+              << "  -O0, -O1, -O2       generate the code from the IR, optimized at that level\n"
+              << "  --ir-passes=P,...   generate the code from the IR, running the passes P in order\n"
+              << "  --dump-ir           print the IR after the passes (implies -O1 unless another level is given)\n"
+              << "  --target=T          generate code for T: mips (default), x86_64 or c, which imply -O1 unless\n"
+              << "                      another level is given\n"
+              << "  --run               run the program with the bytecode interpreter instead of generating code\n"
+              << "                      (implies -O1 unless another level is given)\n"
+              << "  --dump-bytecode     with --run or --jit, print the bytecode before running it\n"
+              << "  --jit               run the program compiled to x86-64 machine code in the process, each method\n"
+              << "                      when first called (implies -O1 unless another level is given)\n"
+              << "  --jit-log           with --jit, print every method on stderr as it is compiled\n"
+              << "  --jit-ic-stats      with --jit, print the hit rates of the inline caches of the dispatches and\n"
+              << "                      their megamorphic sites on stderr when the program ends\n"
+              << "  --gc=C              collect the garbage with C: none (default for mips), gen (generational, the\n"
+              << "                      default of the other targets) or scn (copying everything at each collection)\n"
+              << "  --gc-test           with mips, collect at every allocation\n"
+              << "  --heap-init=SIZE    start with a heap of SIZE bytes (K, M or G suffix allowed)\n"
+              << "  --heap-max=SIZE     stop the program when its heap would grow past SIZE bytes\n"
+              << "  --nursery-ratio=P   give P percent of the heap to the young objects (1 to 99)\n"
+              << "  --gc-stats          print the collections, the bytes copied and promoted and the pauses on stderr\n"
+              << "                      when the program ends\n";
+    exit(64);
+}
+
+// a size in bytes, with an optional K, M or G suffix.
+static std::size_t parse_size(const std::string& arg) {
+    std::string value = arg.substr(arg.find('=') + 1);
+    std::size_t end = 0, size = 0;
+    // std::stoul would wrap a negative size around.
+    if (value.empty() || !std::isdigit(static_cast<unsigned char>(value[0])))
+        usage();
+    try {
+        size = std::stoul(value, &end);
+    } catch (std::exception&) {
+        usage();
+    }
+    std::string suffix = value.substr(end);
+    int shift = suffix.empty() ? 0 : suffix == "K" || suffix == "k" ? 10 : suffix == "M" || suffix == "m" ? 20
+                                   : suffix == "G" || suffix == "g" ? 30 : -1;
+    if (shift < 0 || size > (SIZE_MAX >> shift))
+        usage();
+    return size << shift;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage coolc [filename.cool...]\n";
+    std::vector<std::string> files;
+    std::size_t inline_budget = 10;
+    bool inline_log = false;
+    bool void_check_log = false;
+    bool frame_log = false;
+    int ir_level = -1;
+    bool dump_ir = false;
+    std::vector<std::string> ir_passes;
+    bool ir_passes_given = false;
+    Target target = Target::MIPS;
+    bool run = false;
+    bool dump_bytecode = false;
+    bool jit = false;
+    bool jit_log = false;
+    bool jit_ic_stats = false;
+    GCOptions gc;
+    bool gc_given = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg{argv[i]};
+        if (arg.rfind("--inline-budget=", 0) == 0) {
+            long budget = 0;
+            try {
+                budget = std::stol(arg.substr(arg.find('=') + 1));
+            } catch (std::exception&) {
+                usage();
+            }
+            if (budget < 0)
+                usage();
+            inline_budget = budget;
+        } else if (arg == "--inline-log") {
+            inline_log = true;
+        } else if (arg == "--void-check-log") {
+            void_check_log = true;
+        } else if (arg == "--frame-log") {
+            frame_log = true;
+        } else if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            ir_level = arg[2] - '0';
+        } else if (arg == "--dump-ir") {
+            dump_ir = true;
+        } else if (arg.rfind("--ir-passes=", 0) == 0) {
+            ir_passes_given = true;
+            std::stringstream names{arg.substr(arg.find('=') + 1)};
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                if (!PassManager::exists(name)) {
+                    std::cerr << "unknown IR pass `" << name << "`\n";
+                    usage();
+                }
+                ir_passes.push_back(name);
+            }
+        } else if (arg == "--target=mips") {
+            target = Target::MIPS;
+        } else if (arg == "--target=x86_64") {
+            target = Target::X86_64;
+        } else if (arg == "--target=c") {
+            target = Target::C;
+        } else if (arg == "--run") {
+            run = true;
+        } else if (arg == "--dump-bytecode") {
+            dump_bytecode = true;
+        } else if (arg == "--jit") {
+            jit = true;
+        } else if (arg == "--jit-log") {
+            jit_log = true;
+        } else if (arg == "--jit-ic-stats") {
+            jit_ic_stats = true;
+        } else if (arg == "--gc=none" || arg == "--gc=gen" || arg == "--gc=scn") {
+            gc.collector = arg == "--gc=none" ? Collector::NoGC : arg == "--gc=gen" ? Collector::GenGC : Collector::ScnGC;
+            gc_given = true;
+        } else if (arg == "--gc-test") {
+            gc.test = true;
+        } else if (arg.rfind("--heap-init=", 0) == 0) {
+            gc.heap_init = parse_size(arg);
+        } else if (arg.rfind("--heap-max=", 0) == 0) {
+            gc.heap_max = parse_size(arg);
+        } else if (arg.rfind("--nursery-ratio=", 0) == 0) {
+            long percent = 0;
+            try {
+                percent = std::stol(arg.substr(arg.find('=') + 1));
+            } catch (std::exception&) {
+                usage();
+            }
+            if (percent < 1 || percent > 99)
+                usage();
+            gc.nursery_percent = percent;
+        } else if (arg == "--gc-stats") {
+            gc.stats = true;
+        } else if (arg.rfind("-", 0) == 0) {
+            std::cerr << "unknown option `" << arg << "`\n";
+            usage();
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty())
+        usage();
+    // the JIT compiles the bytecode of the interpreter.
+    run = run || jit;
+    if (run)
+        target = Target::Bytecode;
+
+    // the MIPS code generated from the IR keeps raw Int and Bool values in
+    // the stack, which the collectors of trap.handler.s would take for
+    // pointers.
+    bool mips_ir = target == Target::MIPS && (ir_level >= 0 || dump_ir || ir_passes_given);
+    if (!gc_given)
+        gc.collector = target == Target::MIPS ? Collector::NoGC : Collector::GenGC;
+    if (mips_ir && gc.collector != Collector::NoGC) {
+        std::cerr << "--gc=gen and --gc=scn need the mips code generated without the IR\n";
         exit(64);
     }
+    if (gc.test && target != Target::MIPS) {
+        std::cerr << "--gc-test only applies to mips\n";
+        exit(64);
+    }
+    if (gc.heap_max && gc.heap_init > gc.heap_max) {
+        std::cerr << "the initial heap is larger than --heap-max\n";
+        exit(64);
+    }
+
+    // the program run writes to the standard output, the compiler keeps
+    // quiet then.
+    std::ostream quiet{nullptr};
+    std::ostream& log = run ? quiet : std::cout;
+
     std::string source;
-    curr_filename = std::string(argv[1]);   // handle later for multiple files.
+    curr_filename = files[0];   // handle later for multiple files.
     curr_filename = curr_filename.substr(curr_filename.find_last_of('/') + 1);
-    std::cout << curr_filename << std::endl;
+    log << curr_filename << std::endl;
     std::vector<Token> tokens, current_tokens;
-    for (int i = 1; i < argc; i++) {
-        std::ifstream f{argv[i]};
+    for (std::size_t i = 0; i < files.size(); i++) {
+        std::ifstream f{files[i]};
         if (!f) {
-            std::cerr << "failed to open file `" << argv[i] << "`\n";
+            std::cerr << "failed to open file `" << files[i] << "`\n";
             exit(EXIT_FAILURE);
         }
         std::stringstream sstr;
@@ -42,30 +220,33 @@ int main(int argc, char* argv[]) {
         }
 
         Scanner s{current_file_source};
-        current_tokens = s.scanTokens(i == argc-1 ? true : false);
+        current_tokens = s.scanTokens(i == files.size() - 1 ? true : false);
         tokens.insert(tokens.end(), current_tokens.begin(), current_tokens.end());
     }
 
-    std::string out_file = curr_filename.substr(0, curr_filename.find_last_of('.')) + ".s"; 
-    std::ofstream out{out_file};
-    if (!out.is_open()) {
-        std::cerr << "Cannot open `" << out_file << "` for writing.";
-        exit(EXIT_FAILURE); // !TODO: better this later.
+    std::string out_file = curr_filename.substr(0, curr_filename.find_last_of('.')) + (target == Target::C ? ".c" : ".s");
+    std::ofstream out;
+    if (!run) {
+        out.open(out_file);
+        if (!out.is_open()) {
+            std::cerr << "Cannot open `" << out_file << "` for writing.";
+            exit(EXIT_FAILURE); // !TODO: better this later.
+        }
     }
 
     if (tokens.empty()) {
-        std::cout << "Empty source file(s). " << std::endl;
+        log << "Empty source file(s). " << std::endl;
         exit(EXIT_SUCCESS);
     }
 
 #ifdef DEBUG_PRINT_CODE
-    std::cout << "Printing tokens." << std::endl;
+    log << "Printing tokens." << std::endl;
     for (auto& token : tokens) {
-        std::cout << token << "\n";
+        log << token << "\n";
     }
 #endif
     Parser p{tokens};
-    std::cout << "Parsing...\n";
+    log << "Parsing...\n";
     auto program = p.parse();
 
     if (p.hasError()) {
@@ -73,21 +254,100 @@ int main(int argc, char* argv[]) {
         exit(EXIT_FAILURE);
     }
 #ifdef DEBUG_PRINT_CODE
-    std::cout << "Printing AST...\n";
+    log << "Printing AST...\n";
     ASTPrinter{}.print(program);
 #endif
     auto semanter = Semant{};
-    std::cout << "Semanting...\n";
+    log << "Semanting...\n";
     semanter.semant(program);
     if (semanter.hasError()) {
         std::cerr << "Compilation halted due to semantic errors." << std::endl;
         exit(EXIT_FAILURE);
     }
 #ifdef DEBUG_PRINT_CODE
-    std::cout << "Printing AST after semant analysis..." << std::endl;
+    log << "Printing AST after semant analysis..." << std::endl;
     ASTPrinter{}.print(program);
 #endif
-    std::cout << "Generating code into `" << out_file << "`...\n";
-    Cgen{semanter.get_inheritancegraph(), semanter.get_classtable(), out}.cgen(program);
+    ConstantFolder folder;
+    folder.fold(static_cast<Program*>(program.get()));
+    log << "Folded " << folder.get_folded_count() << " constant expressions, propagated "
+              << folder.get_propagated_count() << " let constants.\n";
+    LoopHoister hoister;
+    hoister.run(static_cast<Program*>(program.get()));
+    log << "Hoisted " << hoister.get_hoisted_count() << " loop invariant expressions out of "
+              << hoister.get_loop_count() << " loops.\n";
+#ifdef DEBUG_PRINT_CODE
+    log << "Printing AST after constant folding..." << std::endl;
+    ASTPrinter{}.print(program);
+#endif
+    log << "Generating code into `" << out_file << "`...\n";
+    Cgen cgen{semanter.get_inheritancegraph(), semanter.get_classtable(), run ? quiet : out};
+    cgen.set_inline_budget(inline_budget);
+    cgen.set_target(target);
+    cgen.set_gc(gc);
+    if (ir_level >= 0 || dump_ir || ir_passes_given || target != Target::MIPS)
+        cgen.set_ir(ir_passes_given ? ir_passes : PassManager::pipeline(ir_level < 0 ? 1 : ir_level),
+                    dump_ir ? &std::cout : nullptr);
+    if (inline_log)
+        cgen.set_inline_log(&std::cout);
+    cgen.cgen(program);
+    if (cgen.get_ir_mode()) {
+        for (auto& pass: cgen.get_ir_changes())
+            log << "IR pass " << pass.first << " changed " << pass.second << " functions.\n";
+        log << "Built " << cgen.get_ir_built_instructions() << " IR instructions, "
+                  << cgen.get_ir_instructions() << " left after the passes.\n";
+    }
+    log << "Devirtualized " << cgen.get_devirtualized_sites() << " of "
+              << cgen.get_dispatch_sites() << " dispatch sites, inlined "
+              << cgen.get_inlined_sites() << ".\n";
+
+    std::size_t removed = 0, total = 0;
+    for (auto& checks: cgen.get_void_checks()) {
+        if (void_check_log && checks.total)
+            log << checks.name << ": removed " << checks.removed << " of "
+                      << checks.total << " dispatch-on-void checks.\n";
+        removed += checks.removed;
+        total += checks.total;
+    }
+    log << "Removed " << removed << " of " << total << " dispatch-on-void checks.\n";
+    log << "Compiled " << cgen.get_tail_calls() + cgen.get_self_tail_calls() << " tail calls to jumps, "
+              << cgen.get_self_tail_calls() << " of them to loops.\n";
+
+    std::size_t leaves = 0, frameless = 0;
+    for (auto& frame: cgen.get_frames()) {
+        if (frame_log)
+            log << frame.name << ": " << (frame.calls ? "saves ra" : "leaf")
+                      << (frame.uses_fp ? ", sets up fp" : ", no fp")
+                      << (frame.uses_self ? ", saves self" : ", no self")
+                      << ", " << frame.ar_size << " words AR, "
+                      << frame.saved_regs << " saved registers.\n";
+        leaves += !frame.calls;
+        frameless += !frame.uses_fp;
+    }
+    log << "Rotated " << cgen.get_rotated_loops() << " loops, unrolled "
+              << cgen.get_unrolled_loops() << " of them.\n";
+    log << "Allocated " << cgen.get_stack_new_sites() << " of " << cgen.get_new_sites()
+              << " `new` sites in the frame.\n";
+    log << "Emitted " << leaves << " leaf methods and " << frameless << " without frame pointer of "
+              << cgen.get_frames().size() << " methods.\n";
+    log << "Emitted " << cgen.get_emitted_method_count() << " of " << cgen.get_method_count()
+              << " methods and " << cgen.get_emitted_class_count() << " of " << cgen.get_class_count()
+              << " classes reachable from Main.main.\n";
+
+    if (run) {
+        BCProgram& bytecode = cgen.get_bytecode();
+        if (dump_bytecode) {
+            print_bytecode(std::cout, bytecode);
+            std::cout << "Compiled " << bytecode.functions.size() << " functions to " << bytecode.code_words()
+                      << " words of bytecode, with " << cgen.get_superinstructions() << " superinstructions.\n";
+        }
+        std::cout.flush();
+        coolrt::gc_config = {static_cast<int64_t>(gc.collector), static_cast<int64_t>(gc.heap_init),
+                             static_cast<int64_t>(gc.heap_max), gc.nursery_percent, gc.stats};
+        if (jit)
+            JIT{bytecode, jit_log ? &std::cerr : nullptr, jit_ic_stats ? &std::cerr : nullptr}.run();
+        else
+            VM{bytecode}.run();
+    }
     return 0;   
 }
\ No newline at end of file
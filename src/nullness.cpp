@@ -0,0 +1,280 @@
+#include "nullness.hpp"
+#include "assignednames.hpp"
+#include "emit.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace cool {
+
+void NullnessAnalysis::State::intersect(const State& other) {
+    std::set<Formal*> common_locals;
+    std::set_intersection(locals.begin(), locals.end(), other.locals.begin(), other.locals.end(),
+                          std::inserter(common_locals, common_locals.begin()));
+    std::set<std::string> common_attributes;
+    std::set_intersection(attributes.begin(), attributes.end(), other.attributes.begin(), other.attributes.end(),
+                          std::inserter(common_attributes, common_attributes.begin()));
+    locals = std::move(common_locals);
+    attributes = std::move(common_attributes);
+}
+
+bool NullnessAnalysis::never_void(const std::string& type) {
+    return type == Int.lexeme || type == Bool.lexeme || type == Str.lexeme;
+}
+
+void NullnessAnalysis::set_fact(const std::string& name, bool non_void_value) {
+    Formal* local = scope.get(name);
+    if (local) {
+        if (non_void_value)
+            state.locals.insert(local);
+        else
+            state.locals.erase(local);
+    } else {
+        if (non_void_value)
+            state.attributes.insert(name);
+        else
+            state.attributes.erase(name);
+    }
+}
+
+Variable* NullnessAnalysis::voidness_test(Expr* cond, bool& negated) {
+    switch (typeId.identify(cond)) {
+        case Type::Grouping:
+            return voidness_test(static_cast<Grouping*>(cond)->expr.get(), negated);
+        case Type::Unary: {
+            auto unary = static_cast<Unary*>(cond);
+            if (unary->op.token_type == NOT) {
+                Variable* var = voidness_test(unary->expr.get(), negated);
+                negated = !negated;
+                return var;
+            }
+            if (unary->op.token_type != ISVOID)
+                return nullptr;
+            Expr* operand = unary->expr.get();
+            while (typeId.identify(operand) == Type::Grouping)
+                operand = static_cast<Grouping*>(operand)->expr.get();
+            negated = false;
+            if (typeId.identify(operand) == Type::Variable && static_cast<Variable*>(operand)->name != self)
+                return static_cast<Variable*>(operand);
+            return nullptr;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+void NullnessAnalysis::start_method(const std::string& name) {
+    state = State{};
+    method_checks.push_back({name, 0, 0});
+}
+
+void NullnessAnalysis::dispatch(Expr* expr, Expr* receiver, std::vector<std::unique_ptr<Expr>>& args, Token& callee_name) {
+    for (auto& arg: args)
+        arg->accept(this);
+    receiver->accept(this);
+
+    method_checks.back().total++;
+    if (non_void) {
+        non_void_receivers.insert(expr);
+        method_checks.back().removed++;
+    }
+
+    // a dispatch on a local that didn't abort proves it non-void. The callee
+    // may change attributes though.
+    Expr* var = receiver;
+    while (typeId.identify(var) == Type::Grouping)
+        var = static_cast<Grouping*>(var)->expr.get();
+    if (typeId.identify(var) == Type::Variable && scope.get(static_cast<Variable*>(var)->name.lexeme))
+        set_fact(static_cast<Variable*>(var)->name.lexeme, true);
+    state.attributes.clear();
+
+    // the result is known from the declared type of the method. The runtime
+    // methods returning SELF_TYPE return their (non-void) receiver.
+    non_void = false;
+    const std::string& target = resolver.get_target(expr);
+    if (!target.empty()) {
+        Feature* method = cha.get_method(target, callee_name.lexeme);
+        non_void = never_void(method->type_.lexeme) || (method->type_ == SELF_TYPE && !method->expr);
+    }
+}
+
+void NullnessAnalysis::visitFeatureExpr(Feature* expr) {
+    scope.enterScope();
+    if (expr->featuretype == FeatureType::METHOD) {
+        start_method(curr_class->name.lexeme + METHOD_SEP + expr->id.lexeme);
+        for (auto& f: expr->formals)
+            scope.insert(f->id.lexeme, f.get());
+    } else {
+        // attribute initializers are all checked in the _init of the class.
+        state = State{};
+    }
+    if (expr->expr)
+        expr->expr->accept(this);
+    scope.exitScope();
+}
+
+void NullnessAnalysis::visitFormalExpr(Formal* expr) { }
+
+void NullnessAnalysis::visitAssignExpr(Assign* expr) {
+    expr->expr->accept(this);
+    set_fact(expr->id.lexeme, non_void);
+}
+
+void NullnessAnalysis::visitIfExpr(If* expr) {
+    expr->cond->accept(this);
+
+    bool negated;
+    Variable* tested = voidness_test(expr->cond.get(), negated);
+
+    State before = state;
+    if (tested && negated)
+        set_fact(tested->name.lexeme, true);
+    expr->thenBranch->accept(this);
+    bool then_non_void = non_void;
+    State after_then = std::move(state);
+
+    state = std::move(before);
+    if (tested && !negated)
+        set_fact(tested->name.lexeme, true);
+    expr->elseBranch->accept(this);
+
+    state.intersect(after_then);
+    non_void = non_void && then_non_void;
+}
+
+void NullnessAnalysis::visitWhileExpr(While* expr) {
+    // forget what the loop may invalidate before its first iteration.
+    AssignedNames assigned;
+    expr->cond->accept(&assigned);
+    expr->expr->accept(&assigned);
+    for (auto& name: assigned.names) {
+        if (scope.get(name))
+            set_fact(name, false);
+    }
+    state.attributes.clear();
+
+    expr->cond->accept(this);
+    State after_cond = state;
+
+    bool negated;
+    Variable* tested = voidness_test(expr->cond.get(), negated);
+    if (tested && negated)
+        set_fact(tested->name.lexeme, true);
+    expr->expr->accept(this);
+
+    // the loop exits right after evaluating its condition.
+    state = std::move(after_cond);
+    non_void = false;
+}
+
+void NullnessAnalysis::visitBinaryExpr(Binary* expr) {
+    expr->lhs->accept(this);
+    expr->rhs->accept(this);
+    non_void = true;
+}
+
+void NullnessAnalysis::visitUnaryExpr(Unary* expr) {
+    expr->expr->accept(this);
+    non_void = true;
+}
+
+void NullnessAnalysis::visitVariableExpr(Variable* expr) {
+    if (expr->name == self) {
+        non_void = true;
+        return;
+    }
+    Formal* local = scope.get(expr->name.lexeme);
+    if (local)
+        non_void = state.locals.count(local) != 0 || never_void(local->type_.lexeme);
+    else // the prototype objects hold void in every attribute so before its
+         // initializer runs even an Int attribute may be void.
+        non_void = state.attributes.count(expr->name.lexeme) != 0;
+}
+
+void NullnessAnalysis::visitNewExpr(New* expr) {
+    // the _init of the new object may change attributes.
+    state.attributes.clear();
+    non_void = true;
+}
+
+void NullnessAnalysis::visitBlockExpr(Block* expr) {
+    for (auto& e: expr->exprs)
+        e->accept(this);
+}
+
+void NullnessAnalysis::visitGroupingExpr(Grouping* expr) {
+    expr->expr->accept(this);
+}
+
+void NullnessAnalysis::visitStaticDispatchExpr(StaticDispatch* expr) {
+    dispatch(expr, expr->expr.get(), expr->args, expr->callee_name);
+}
+
+void NullnessAnalysis::visitDispatchExpr(Dispatch* expr) {
+    dispatch(expr, expr->expr.get(), expr->args, expr->callee_name);
+}
+
+void NullnessAnalysis::visitLiteralExpr(Literal* expr) {
+    non_void = static_cast<Literal*>(expr)->object.type() != CoolType::Void_t;
+}
+
+void NullnessAnalysis::visitLetExpr(Let* expr) {
+    scope.enterScope();
+    for (auto& let: expr->vecAssigns) {
+        Formal* formal = std::get<0>(let).get();
+        if (std::get<1>(let))
+            std::get<1>(let)->accept(this);
+        else // default initialization, void for classes.
+            non_void = never_void(formal->type_.lexeme);
+        scope.insert(formal->id.lexeme, formal);
+        set_fact(formal->id.lexeme, non_void);
+    }
+    expr->body->accept(this);
+    scope.exitScope();
+}
+
+void NullnessAnalysis::visitCaseExpr(Case* expr) {
+    expr->expr->accept(this);
+
+    // a case on void aborts so its binders are always bound to an object.
+    State before = std::move(state);
+    State after;
+    bool all_non_void = true, first = true;
+    for (auto& match: expr->matches) {
+        state = before;
+        scope.enterScope();
+        Formal* formal = std::get<0>(match).get();
+        scope.insert(formal->id.lexeme, formal);
+        set_fact(formal->id.lexeme, true);
+        std::get<1>(match)->accept(this);
+        scope.exitScope();
+
+        all_non_void = all_non_void && non_void;
+        if (first)
+            after = std::move(state);
+        else
+            after.intersect(state);
+        first = false;
+    }
+    state = std::move(after);
+    non_void = all_non_void;
+}
+
+void NullnessAnalysis::visitProgramStmt(Program* stmt) {
+    for (auto& class_: stmt->classes)
+        class_->accept(this);
+}
+
+void NullnessAnalysis::visitClassStmt(Class* stmt) {
+    curr_class = stmt;
+    start_method(stmt->name.lexeme + CLASSINIT_SUFFIX);
+    for (auto& f: stmt->features) {
+        if (f->featuretype == FeatureType::ATTRIBUT)
+            f->accept(this);
+    }
+    for (auto& f: stmt->features) {
+        if (f->featuretype == FeatureType::METHOD)
+            f->accept(this);
+    }
+}
+
+}
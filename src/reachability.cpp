@@ -0,0 +1,174 @@
+#include "reachability.hpp"
+#include "constants.hpp"
+#include "scanner.hpp"
+
+namespace cool {
+
+void Reachability::run(Program* program) {
+    // the runtime reports errors with the file name, newly allocated
+    // objects use the empty string and 0 as default values.
+    strings.insert(curr_filename);
+    strings.insert("");
+    ints.insert(0);
+
+    // the runtime creates Main, and Int, Bool and String objects (literals,
+    // arithmetic, comparisons, in_string...).
+    instantiate(Main.lexeme);
+    instantiate(Int.lexeme);
+    instantiate(Bool.lexeme);
+    instantiate(Str.lexeme);
+    reach(cha.get_method(Main.lexeme, main_meth.lexeme));
+
+    while (!worklist.empty()) {
+        Feature* feature = worklist.back();
+        worklist.pop_back();
+        feature->expr->accept(this);
+    }
+
+    // class_nameTab holds the names of the classes of the objects.
+    for (auto& class_name: instantiated)
+        strings.insert(class_name);
+    for (auto& s: strings)
+        ints.insert(unescape(s).size());
+
+    program->accept(this);
+}
+
+void Reachability::instantiate(const std::string& class_name) {
+    if (!instantiated.insert(class_name).second)
+        return;
+
+    // its _init runs the initializers of the attributes of all its ancestors.
+    Class* class_ = class_table_ptr->get(class_name);
+    while (class_ && initialized.insert(class_->name.lexeme).second) {
+        for (auto& f: class_->features) {
+            if (f->featuretype == FeatureType::ATTRIBUT)
+                reach(f.get());
+        }
+        if (class_->superClass == No_class)
+            break;
+        class_ = class_table_ptr->get(class_->superClass.lexeme);
+    }
+
+    for (auto& method_name: called)
+        reach(cha.get_method(class_name, method_name));
+}
+
+void Reachability::call(const std::string& method_name) {
+    if (!called.insert(method_name).second)
+        return;
+    for (auto& class_name: instantiated)
+        reach(cha.get_method(class_name, method_name));
+}
+
+void Reachability::reach(Feature* feature) {
+    if (feature && reachable.insert(feature).second && feature->expr)
+        worklist.push_back(feature);
+}
+
+void Reachability::visitFeatureExpr(Feature* expr) { }
+
+void Reachability::visitFormalExpr(Formal* expr) { }
+
+void Reachability::visitAssignExpr(Assign* expr) {
+    expr->expr->accept(this);
+}
+
+void Reachability::visitIfExpr(If* expr) {
+    expr->cond->accept(this);
+    expr->thenBranch->accept(this);
+    expr->elseBranch->accept(this);
+}
+
+void Reachability::visitWhileExpr(While* expr) {
+    expr->cond->accept(this);
+    expr->expr->accept(this);
+}
+
+void Reachability::visitBinaryExpr(Binary* expr) {
+    expr->lhs->accept(this);
+    expr->rhs->accept(this);
+}
+
+void Reachability::visitUnaryExpr(Unary* expr) {
+    expr->expr->accept(this);
+}
+
+void Reachability::visitVariableExpr(Variable* expr) { }
+
+void Reachability::visitNewExpr(New* expr) {
+    // the class the code generator allocates.
+    instantiate(expr->expr_type.lexeme);
+}
+
+void Reachability::visitBlockExpr(Block* expr) {
+    for (auto& e: expr->exprs)
+        e->accept(this);
+}
+
+void Reachability::visitGroupingExpr(Grouping* expr) {
+    expr->expr->accept(this);
+}
+
+void Reachability::visitStaticDispatchExpr(StaticDispatch* expr) {
+    for (auto& arg: expr->args)
+        arg->accept(this);
+    expr->expr->accept(this);
+    reach(cha.get_method(expr->class_.lexeme, expr->callee_name.lexeme));
+}
+
+void Reachability::visitDispatchExpr(Dispatch* expr) {
+    for (auto& arg: expr->args)
+        arg->accept(this);
+    expr->expr->accept(this);
+
+    const std::string& target = resolver.get_target(expr);
+    if (!target.empty())
+        reach(cha.get_method(target, expr->callee_name.lexeme));
+    else
+        call(expr->callee_name.lexeme);
+}
+
+void Reachability::visitLiteralExpr(Literal* expr) {
+    if (expr->object.type() == CoolType::String_t)
+        strings.insert(expr->object.string_value());
+    else if (expr->object.type() == CoolType::Number_t)
+        ints.insert(expr->object.int_value());
+}
+
+void Reachability::visitLetExpr(Let* expr) {
+    for (auto& let: expr->vecAssigns) {
+        if (std::get<1>(let))
+            std::get<1>(let)->accept(this);
+    }
+    expr->body->accept(this);
+}
+
+void Reachability::visitCaseExpr(Case* expr) {
+    expr->expr->accept(this);
+    for (auto& match: expr->matches)
+        std::get<1>(match)->accept(this);
+}
+
+void Reachability::visitProgramStmt(Program* stmt) {
+    for (auto& class_: stmt->classes)
+        class_->accept(this);
+}
+
+void Reachability::visitClassStmt(Class* stmt) {
+    class_count++;
+    bool live = is_initialized(stmt->name.lexeme);
+    for (auto& f: stmt->features) {
+        if (f->featuretype != FeatureType::METHOD)
+            continue;
+        method_count++;
+        if (is_reachable(f.get())) {
+            reachable_method_count++;
+            live = true;
+        }
+    }
+    if (live)
+        live_class_count++;
+}
+
+}
@@ -0,0 +1,218 @@
+#include "regalloc.hpp"
+#include "emit.hpp"
+#include <algorithm>
+
+namespace cool {
+
+static const char* allocatable_registers[] = {S1, S2, S3, S4, S5, S6};
+
+void RegAllocator::allocate(Feature* method) {
+    intervals.clear();
+    assignment.clear();
+    used.clear();
+    position = 0;
+
+    scope.enterScope();
+    for (auto& f: method->formals)
+        define(f.get());
+    method->expr->accept(this);
+    scope.exitScope();
+
+    linear_scan();
+}
+
+const char* RegAllocator::get_register(Formal* formal) {
+    auto reg = assignment.find(formal);
+    if (reg != assignment.end())
+        return reg->second;
+    return nullptr;
+}
+
+void RegAllocator::define(Formal* formal) {
+    scope.insert(formal->id.lexeme, intervals.size());
+    intervals.push_back({formal, position, position, 0});
+}
+
+void RegAllocator::use(const std::string& name) {
+    std::size_t* index = scope.get(name);
+    if (!index) // an attribute or self.
+        return;
+    Interval& interval = intervals[*index];
+    interval.end = position;
+    // a use in a loop is worth 8 outside of it.
+    interval.weight += std::size_t(1) << std::min<std::size_t>(3 * loop_starts.size(), 24);
+    if (!loop_uses.empty())
+        loop_uses.back().push_back(*index);
+}
+
+void RegAllocator::linear_scan() {
+    std::vector<Interval*> candidates;
+    for (auto& interval: intervals)
+        if (interval.weight >= MIN_WEIGHT)
+            candidates.push_back(&interval);
+    std::stable_sort(candidates.begin(), candidates.end(), [](Interval* a, Interval* b) {
+        return a->start < b->start;
+    });
+
+    std::vector<const char*> free_registers(std::rbegin(allocatable_registers), std::rend(allocatable_registers));
+    std::vector<Interval*> active;
+
+    for (auto current: candidates) {
+        // release the registers of the intervals that ended.
+        for (auto it = active.begin(); it != active.end(); ) {
+            if ((*it)->end < current->start) {
+                free_registers.push_back(assignment[(*it)->formal]);
+                it = active.erase(it);
+            } else {
+                it++;
+            }
+        }
+
+        if (!free_registers.empty()) {
+            assignment[current->formal] = free_registers.back();
+            free_registers.pop_back();
+            active.push_back(current);
+            continue;
+        }
+
+        // spill the coldest interval, the one ending last on ties.
+        auto coldest = std::min_element(active.begin(), active.end(), [](Interval* a, Interval* b) {
+            return a->weight < b->weight || (a->weight == b->weight && a->end > b->end);
+        });
+        if ((*coldest)->weight < current->weight) {
+            assignment[current->formal] = assignment[(*coldest)->formal];
+            assignment.erase((*coldest)->formal);
+            *coldest = current;
+        }
+    }
+
+    for (auto reg: allocatable_registers) {
+        for (auto& a: assignment) {
+            if (a.second == reg) {
+                used.push_back(reg);
+                break;
+            }
+        }
+    }
+}
+
+void RegAllocator::visitFeatureExpr(Feature* expr) { }
+
+void RegAllocator::visitFormalExpr(Formal* expr) { }
+
+void RegAllocator::visitAssignExpr(Assign* expr) {
+    position++;
+    expr->expr->accept(this);
+    use(expr->id.lexeme);
+}
+
+void RegAllocator::visitIfExpr(If* expr) {
+    position++;
+    expr->cond->accept(this);
+    expr->thenBranch->accept(this);
+    expr->elseBranch->accept(this);
+}
+
+void RegAllocator::visitWhileExpr(While* expr) {
+    position++;
+    loop_starts.push_back(position);
+    loop_uses.emplace_back();
+    expr->cond->accept(this);
+    expr->expr->accept(this);
+    position++;
+
+    // locals bound before the loop and used inside are live through all of it.
+    std::size_t start = loop_starts.back();
+    std::vector<std::size_t> uses = std::move(loop_uses.back());
+    loop_starts.pop_back();
+    loop_uses.pop_back();
+    for (auto index: uses) {
+        if (intervals[index].start < start) {
+            intervals[index].end = position;
+            if (!loop_uses.empty())
+                loop_uses.back().push_back(index);
+        }
+    }
+}
+
+void RegAllocator::visitBinaryExpr(Binary* expr) {
+    position++;
+    expr->lhs->accept(this);
+    expr->rhs->accept(this);
+}
+
+void RegAllocator::visitUnaryExpr(Unary* expr) {
+    position++;
+    expr->expr->accept(this);
+}
+
+void RegAllocator::visitVariableExpr(Variable* expr) {
+    position++;
+    use(expr->name.lexeme);
+}
+
+void RegAllocator::visitNewExpr(New* expr) {
+    position++;
+}
+
+void RegAllocator::visitBlockExpr(Block* expr) {
+    position++;
+    for (auto& e: expr->exprs)
+        e->accept(this);
+}
+
+void RegAllocator::visitGroupingExpr(Grouping* expr) {
+    expr->expr->accept(this);
+}
+
+void RegAllocator::visitStaticDispatchExpr(StaticDispatch* expr) {
+    position++;
+    for (auto& arg: expr->args)
+        arg->accept(this);
+    expr->expr->accept(this);
+}
+
+void RegAllocator::visitDispatchExpr(Dispatch* expr) {
+    position++;
+    for (auto& arg: expr->args)
+        arg->accept(this);
+    expr->expr->accept(this);
+}
+
+void RegAllocator::visitLiteralExpr(Literal* expr) {
+    position++;
+}
+
+void RegAllocator::visitLetExpr(Let* expr) {
+    position++;
+    scope.enterScope();
+    for (auto& let: expr->vecAssigns) {
+        if (std::get<1>(let))
+            std::get<1>(let)->accept(this);
+        position++;
+        define(std::get<0>(let).get());
+        // the initialization is a write.
+        use(std::get<0>(let)->id.lexeme);
+    }
+    expr->body->accept(this);
+    scope.exitScope();
+}
+
+void RegAllocator::visitCaseExpr(Case* expr) {
+    position++;
+    expr->expr->accept(this);
+    for (auto& match: expr->matches) {
+        position++;
+        scope.enterScope();
+        define(std::get<0>(match).get());
+        use(std::get<0>(match)->id.lexeme);
+        std::get<1>(match)->accept(this);
+        scope.exitScope();
+    }
+}
+
+void RegAllocator::visitProgramStmt(Program* stmt) { }
+
+void RegAllocator::visitClassStmt(Class* stmt) { }
+
+}
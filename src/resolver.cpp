@@ -0,0 +1,187 @@
+#include "resolver.hpp"
+
+namespace cool {
+
+std::string DispatchResolver::static_type(Expr* expr, bool& exact) {
+    // the types infered by the semantic analyzer are more precise than the
+    // declarations (eg. a let variable is given the type of its initializer)
+    // which doesn't hold after an assignment, so only declared types are used.
+    exact = false;
+    switch (typeId.identify(expr)) {
+        case Type::Variable: {
+            auto var = static_cast<Variable*>(expr);
+            if (var->name == self)
+                return curr_class->name.lexeme;
+            std::string* local = scope.get(var->name.lexeme);
+            if (local)
+                return *local;
+            return cha.attribute_type(curr_class->name.lexeme, var->name.lexeme);
+        }
+        case Type::New:
+            exact = true;
+            return static_cast<New*>(expr)->type_.lexeme;
+        case Type::Literal:
+            exact = true;
+            switch (static_cast<Literal*>(expr)->object.type()) {
+                case CoolType::Bool_t: return Bool.lexeme;
+                case CoolType::Number_t: return Int.lexeme;
+                case CoolType::String_t: return Str.lexeme;
+                default: return "";
+            }
+        case Type::Binary: {
+            TokenType op = static_cast<Binary*>(expr)->op.token_type;
+            exact = true;
+            return op == LESS || op == LESS_EQUAL || op == EQUAL ? Bool.lexeme : Int.lexeme;
+        }
+        case Type::Unary:
+            exact = true;
+            return static_cast<Unary*>(expr)->op.token_type == TILDE ? Int.lexeme : Bool.lexeme;
+        case Type::Grouping:
+            return static_type(static_cast<Grouping*>(expr)->expr.get(), exact);
+        case Type::Block:
+            return static_type(static_cast<Block*>(expr)->exprs.back().get(), exact);
+        case Type::Assign:
+            return static_type(static_cast<Assign*>(expr)->expr.get(), exact);
+        case Type::Dispatch: {
+            auto dispatch = static_cast<Dispatch*>(expr);
+            bool receiver_exact;
+            std::string receiver = static_type(dispatch->expr.get(), receiver_exact);
+            if (receiver.empty())
+                return "";
+            Feature* method = cha.get_method(receiver, dispatch->callee_name.lexeme);
+            if (method->type_ == SELF_TYPE) {
+                exact = receiver_exact;
+                return receiver;
+            }
+            return method->type_.lexeme;
+        }
+        case Type::StaticDispatch: {
+            auto dispatch = static_cast<StaticDispatch*>(expr);
+            Feature* method = cha.get_method(dispatch->class_.lexeme, dispatch->callee_name.lexeme);
+            if (method->type_ == SELF_TYPE)
+                return static_type(dispatch->expr.get(), exact);
+            return method->type_.lexeme;
+        }
+        default:
+            return "";
+    }
+}
+
+void DispatchResolver::visitFeatureExpr(Feature* expr) {
+    scope.enterScope();
+    for (auto& f: expr->formals)
+        scope.insert(f->id.lexeme, f->type_.lexeme);
+    if (expr->expr)
+        expr->expr->accept(this);
+    scope.exitScope();
+}
+
+void DispatchResolver::visitFormalExpr(Formal* expr) { }
+
+void DispatchResolver::visitAssignExpr(Assign* expr) {
+    expr->expr->accept(this);
+}
+
+void DispatchResolver::visitIfExpr(If* expr) {
+    expr->cond->accept(this);
+    expr->thenBranch->accept(this);
+    expr->elseBranch->accept(this);
+}
+
+void DispatchResolver::visitWhileExpr(While* expr) {
+    expr->cond->accept(this);
+    expr->expr->accept(this);
+}
+
+void DispatchResolver::visitBinaryExpr(Binary* expr) {
+    expr->lhs->accept(this);
+    expr->rhs->accept(this);
+}
+
+void DispatchResolver::visitUnaryExpr(Unary* expr) {
+    expr->expr->accept(this);
+}
+
+void DispatchResolver::visitVariableExpr(Variable* expr) { }
+
+void DispatchResolver::visitNewExpr(New* expr) { }
+
+void DispatchResolver::visitBlockExpr(Block* expr) {
+    for (auto& e: expr->exprs)
+        e->accept(this);
+}
+
+void DispatchResolver::visitGroupingExpr(Grouping* expr) {
+    expr->expr->accept(this);
+}
+
+void DispatchResolver::visitStaticDispatchExpr(StaticDispatch* expr) {
+    for (auto& arg: expr->args)
+        arg->accept(this);
+    expr->expr->accept(this);
+    site_count++;
+    targets[expr] = cha.implementation(expr->class_.lexeme, expr->callee_name.lexeme);
+}
+
+void DispatchResolver::visitDispatchExpr(Dispatch* expr) {
+    for (auto& arg: expr->args)
+        arg->accept(this);
+    expr->expr->accept(this);
+    site_count++;
+
+    bool exact = false;
+    std::string receiver_type = static_type(expr->expr.get(), exact);
+    if (receiver_type.empty()) {
+        const Token& inferred = expr->expr->expr_type;
+        receiver_types[expr] = cha.introducing_class(inferred == SELF_TYPE ? curr_class->name.lexeme : inferred.lexeme,
+                                                     expr->callee_name.lexeme);
+        return;
+    }
+    receiver_types[expr] = receiver_type == SELF_TYPE.lexeme ? curr_class->name.lexeme : receiver_type;
+    const std::string& target = exact ? cha.implementation(receiver_type, expr->callee_name.lexeme)
+                                      : cha.unique_implementation(receiver_type, expr->callee_name.lexeme);
+    if (!target.empty())
+        targets[expr] = target;
+}
+
+void DispatchResolver::visitLiteralExpr(Literal* expr) { }
+
+void DispatchResolver::visitLetExpr(Let* expr) {
+    scope.enterScope();
+    for (auto& let: expr->vecAssigns) {
+        if (std::get<1>(let))
+            std::get<1>(let)->accept(this);
+        scope.insert(std::get<0>(let)->id.lexeme, std::get<0>(let)->type_.lexeme);
+    }
+    expr->body->accept(this);
+    scope.exitScope();
+}
+
+void DispatchResolver::visitCaseExpr(Case* expr) {
+    expr->expr->accept(this);
+    bool exact;
+    std::string type = static_type(expr->expr.get(), exact);
+    if (type == SELF_TYPE.lexeme)
+        type = curr_class->name.lexeme;
+    if (!type.empty())
+        case_types[expr] = type;
+    for (auto& match: expr->matches) {
+        scope.enterScope();
+        scope.insert(std::get<0>(match)->id.lexeme, std::get<0>(match)->type_.lexeme);
+        std::get<1>(match)->accept(this);
+        scope.exitScope();
+    }
+}
+
+void DispatchResolver::visitProgramStmt(Program* stmt) {
+    for (auto& class_: stmt->classes)
+        class_->accept(this);
+}
+
+void DispatchResolver::visitClassStmt(Class* stmt) {
+    curr_class = stmt;
+    for (auto& f: stmt->features)
+        f->accept(this);
+}
+
+}
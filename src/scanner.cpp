@@ -97,7 +97,8 @@ void Scanner::string() {
     std::string lexeme = source.substr(start+1, current-start-2);
     addToken(STRING, lexeme, line);
     stringtable().insert(lexeme, Token{STRING, lexeme, line});
-    inttable().insert(std::to_string(lexeme.size()), Token{NUMBER, std::to_string(lexeme.size()), line});
+    std::string length = std::to_string(unescape(lexeme).size());
+    inttable().insert(length, Token{NUMBER, length, line});
 }
 
 bool Scanner::match(char expected) {
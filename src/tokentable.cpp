@@ -4,6 +4,25 @@ namespace cool {
 
 TokenTable::TokenTable(): idx{0} {}
 
+std::string unescape(const std::string& text) {
+    std::string chars;
+    for (std::size_t i = 0; i < text.size(); i++) {
+        if (text[i] != '\\' || i + 1 == text.size()) {
+            chars += text[i];
+            continue;
+        }
+        switch (text[++i]) {
+            case 'n': chars += '\n'; break;
+            case 't': chars += '\t'; break;
+            case 'b': chars += '\b'; break;
+            case 'f': chars += '\f'; break;
+            case 'r': chars += '\r'; break;
+            default: chars += text[i]; break;
+        }
+    }
+    return chars;
+}
+
 void TokenTable::insert(std::string id, Token token) {
     if (table_idx.find(id) != table_idx.end()) {
         return;
@@ -24,4 +43,10 @@ std::map<std::string, Token>& TokenTable::get_elements() {
     return table_elements;
 }
 
+void TokenTable::clear() {
+    table_elements.clear();
+    table_idx.clear();
+    idx = 0;
+}
+
 }; // namespace cool
\ No newline at end of file
@@ -0,0 +1,386 @@
+#include "vm.hpp"
+#include "runtime.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// The handlers of the instructions are labels of execute, which keeps the
+// state of the current frame in locals: its function, the registers and the
+// instruction being run. Int arithmetic wraps around as with the 32 bits
+// instructions of the native code.
+
+namespace cool {
+
+using coolrt::Object;
+using coolrt::Int;
+using coolrt::String;
+
+namespace {
+
+constexpr std::size_t stack_objects = 1 << 23;
+constexpr std::size_t stack_raws = 1 << 23;
+constexpr std::size_t max_frames = 1 << 20;
+
+inline int32_t wrap(uint32_t value) {
+    return static_cast<int32_t>(value);
+}
+
+// the quotient as the div instruction of MIPS gives it: the lowest Int
+// divided by -1 is itself.
+inline int32_t divide(int32_t a, int32_t b) {
+    if (b == 0)
+        _divide_abort();
+    if (b == -1)
+        return wrap(0u - static_cast<uint32_t>(a));
+    return a / b;
+}
+
+inline Object** fields(Object* object) {
+    return reinterpret_cast<Object**>(object);
+}
+
+inline int32_t value_of(Object* object) {
+    return static_cast<Int*>(object)->val;
+}
+
+}
+
+VM::VM(const BCProgram& program_): program(program_), image(program_) {
+    std::size_t max_params = 0;
+    functions.resize(program.functions.size());
+    code.resize(program.functions.size());
+    for (std::size_t i = 0; i < program.functions.size(); i++) {
+        const BCFunction& function = program.functions[i];
+        code[i] = function.code;
+        functions[i] = {code[i].data(), static_cast<uint32_t>(function.nparams), static_cast<uint32_t>(function.nobjects),
+                        static_cast<uint32_t>(function.nraws), function.native};
+        max_params = std::max(max_params, function.nparams);
+        image.set_entry(i, &functions[i]);
+    }
+    arguments.resize(max_params);
+
+    // the stacks are reserved, their pages being used as the calls get
+    // deeper.
+    objects = static_cast<Object**>(std::calloc(stack_objects, sizeof(Object*)));
+    raws = static_cast<int32_t*>(std::calloc(stack_raws, sizeof(int32_t)));
+    if (!objects || !raws)
+        coolrt::fail("VM: can't allocate the stacks.\n");
+    objects_top = objects;
+    objects_end = objects + stack_objects;
+    raws_end = raws + stack_raws;
+    coolrt::add_root_range(objects, &objects_top);
+    frames.reserve(max_frames);
+}
+
+void VM::thread(const int32_t* offsets) {
+    for (std::size_t i = 0; i < code.size(); i++) {
+        const std::vector<uint32_t>& original = program.functions[i].code;
+        for (std::size_t pc = 0; pc < original.size(); pc += bc_length(&original[pc]))
+            code[i][pc] = offsets[original[pc]];
+    }
+}
+
+void VM::run() {
+    execute(&functions[program.start]);
+}
+
+void VM::execute(const Function* start) {
+    const int32_t offsets[] = {
+#define BC_OFFSET(name, operands) static_cast<int32_t>(static_cast<char*>(&&op_##name) - static_cast<char*>(&&op_LoadK)),
+        BC_OPCODES(BC_OFFSET)
+#undef BC_OFFSET
+    };
+    thread(offsets);
+
+    Object* const* constants = image.constants.data();
+    Object* const* protos = image.protos.data();
+    Object* const* bools = image.bools;
+    String* filename = static_cast<String*>(image.filename);
+
+    const Function* function = start;
+    const uint32_t* pc = function->code;
+    Object** O = objects;
+    int32_t* R = raws;
+    objects_top = O + function->nobjects;
+
+    // state of a call between the instruction and the code shared by all.
+    const Function* callee;
+    const uint32_t* args;
+    uint32_t nargs, result;
+    Object* receiver;
+    Object* value;
+    Object* argv[3];
+
+#define NEXT() goto *(static_cast<char*>(&&op_LoadK) + static_cast<int32_t>(*pc))
+
+    NEXT();
+
+op_LoadK:
+    O[pc[1]] = constants[pc[2]];
+    pc += 3;
+    NEXT();
+op_LoadVoid:
+    O[pc[1]] = nullptr;
+    pc += 2;
+    NEXT();
+op_LoadI:
+    R[pc[1]] = static_cast<int32_t>(pc[2]);
+    pc += 3;
+    NEXT();
+op_MovO:
+    O[pc[1]] = O[pc[2]];
+    pc += 3;
+    NEXT();
+op_MovR:
+    R[pc[1]] = R[pc[2]];
+    pc += 3;
+    NEXT();
+op_Add:
+    R[pc[1]] = wrap(static_cast<uint32_t>(R[pc[2]]) + static_cast<uint32_t>(R[pc[3]]));
+    pc += 4;
+    NEXT();
+op_AddI:
+    R[pc[1]] = wrap(static_cast<uint32_t>(R[pc[2]]) + pc[3]);
+    pc += 4;
+    NEXT();
+op_Sub:
+    R[pc[1]] = wrap(static_cast<uint32_t>(R[pc[2]]) - static_cast<uint32_t>(R[pc[3]]));
+    pc += 4;
+    NEXT();
+op_Mul:
+    R[pc[1]] = wrap(static_cast<uint32_t>(R[pc[2]]) * static_cast<uint32_t>(R[pc[3]]));
+    pc += 4;
+    NEXT();
+op_Div:
+    R[pc[1]] = divide(R[pc[2]], R[pc[3]]);
+    pc += 4;
+    NEXT();
+op_Neg:
+    R[pc[1]] = wrap(0u - static_cast<uint32_t>(R[pc[2]]));
+    pc += 3;
+    NEXT();
+op_Lt:
+    R[pc[1]] = R[pc[2]] < R[pc[3]];
+    pc += 4;
+    NEXT();
+op_Le:
+    R[pc[1]] = R[pc[2]] <= R[pc[3]];
+    pc += 4;
+    NEXT();
+op_Eq:
+    R[pc[1]] = R[pc[2]] == R[pc[3]];
+    pc += 4;
+    NEXT();
+op_Not:
+    R[pc[1]] = !R[pc[2]];
+    pc += 3;
+    NEXT();
+
+op_BoxInt:
+    value = coolrt::new_int(R[pc[2]]);
+    O[pc[1]] = value;
+    pc += 3;
+    NEXT();
+op_BoxBool:
+    O[pc[1]] = bools[R[pc[2]] != 0];
+    pc += 3;
+    NEXT();
+op_Unbox:
+    R[pc[1]] = value_of(O[pc[2]]);
+    pc += 3;
+    NEXT();
+op_AddBoxed:
+    value = coolrt::new_int(wrap(static_cast<uint32_t>(value_of(O[pc[2]])) + static_cast<uint32_t>(value_of(O[pc[3]]))));
+    O[pc[1]] = value;
+    pc += 4;
+    NEXT();
+op_AddIBoxed:
+    value = coolrt::new_int(wrap(static_cast<uint32_t>(value_of(O[pc[2]])) + pc[3]));
+    O[pc[1]] = value;
+    pc += 4;
+    NEXT();
+op_ObjEq:
+    R[pc[1]] = equality_test(O[pc[2]], O[pc[3]]);
+    pc += 4;
+    NEXT();
+op_IsVoid:
+    R[pc[1]] = O[pc[2]] == nullptr;
+    pc += 3;
+    NEXT();
+
+op_New:
+    value = coolrt::copy(protos[pc[2]]);
+    O[pc[1]] = value;
+    pc += 3;
+    NEXT();
+op_GetAttr:
+    O[pc[1]] = fields(O[pc[2]])[pc[3]];
+    pc += 4;
+    NEXT();
+op_SetAttr:
+    receiver = O[pc[1]];
+    fields(receiver)[pc[2]] = O[pc[3]];
+    if (receiver->gc & coolrt::GC_BARRIER)
+        _gc_remember(receiver);
+    pc += 4;
+    NEXT();
+op_GetAttrSelf:
+    O[pc[1]] = fields(O[0])[pc[2]];
+    pc += 3;
+    NEXT();
+op_SetAttrSelf:
+    receiver = O[0];
+    fields(receiver)[pc[1]] = O[pc[2]];
+    if (receiver->gc & coolrt::GC_BARRIER)
+        _gc_remember(receiver);
+    pc += 3;
+    NEXT();
+
+op_Call:
+    result = pc[1];
+    callee = &functions[pc[2]];
+    nargs = pc[3];
+    args = pc + 4;
+    receiver = nullptr;
+    goto call;
+op_Dispatch:
+    result = pc[1];
+    nargs = pc[3];
+    args = pc + 4;
+    callee = static_cast<const Function*>(O[args[0]]->disp[pc[2]]);
+    receiver = nullptr;
+    goto call;
+op_DispatchSelf:
+    result = pc[1];
+    nargs = pc[3];
+    args = pc + 4;
+    receiver = O[0];
+    callee = static_cast<const Function*>(receiver->disp[pc[2]]);
+    goto call;
+
+call: {
+    // self, when the instruction leaves it out, then the arguments.
+    const uint32_t* resume = args + nargs;
+    if (callee->native != BCNative::None) {
+        std::size_t n = 0;
+        if (receiver)
+            argv[n++] = receiver;
+        for (uint32_t i = 0; i < nargs; i++)
+            argv[n++] = O[args[i]];
+        value = BCImage::call_native(callee->native, argv);
+        O[result] = value;
+        pc = resume;
+        NEXT();
+    }
+    Object** callee_objects = O + function->nobjects;
+    int32_t* callee_raws = R + function->nraws;
+    if (callee_objects + callee->nobjects > objects_end || callee_raws + callee->nraws > raws_end ||
+        frames.size() == max_frames)
+        coolrt::fail("Stack overflow.\n");
+    std::size_t n = 0;
+    if (receiver)
+        callee_objects[n++] = receiver;
+    for (uint32_t i = 0; i < nargs; i++)
+        callee_objects[n++] = O[args[i]];
+    std::fill(callee_objects + n, callee_objects + callee->nobjects, nullptr);
+    frames.push_back({function, resume, O, R, result});
+    function = callee;
+    O = callee_objects;
+    R = callee_raws;
+    objects_top = O + function->nobjects;
+    pc = function->code;
+    NEXT();
+}
+
+op_TailCall:
+    callee = &functions[pc[1]];
+    nargs = pc[2];
+    args = pc + 3;
+    goto tail_call;
+op_TailDispatch:
+    nargs = pc[2];
+    args = pc + 3;
+    callee = static_cast<const Function*>(O[args[0]]->disp[pc[1]]);
+    goto tail_call;
+
+tail_call: {
+    // the callee takes the frame, its arguments read before any is written.
+    if (callee->native != BCNative::None) {
+        for (uint32_t i = 0; i < nargs; i++)
+            argv[i] = O[args[i]];
+        value = BCImage::call_native(callee->native, argv);
+        goto ret;
+    }
+    if (O + callee->nobjects > objects_end || R + callee->nraws > raws_end)
+        coolrt::fail("Stack overflow.\n");
+    for (uint32_t i = 0; i < nargs; i++)
+        arguments[i] = O[args[i]];
+    std::copy(arguments.begin(), arguments.begin() + nargs, O);
+    std::fill(O + nargs, O + std::max(callee->nobjects, function->nobjects), nullptr);
+    function = callee;
+    objects_top = O + function->nobjects;
+    pc = function->code;
+    NEXT();
+}
+
+op_CheckDispatch:
+    if (!O[pc[1]])
+        _dispatch_abort(filename, pc[2]);
+    pc += 3;
+    NEXT();
+op_CheckCase:
+    if (!O[pc[1]])
+        _case_abort2(filename, pc[2]);
+    pc += 3;
+    NEXT();
+
+op_Jump:
+    pc = function->code + pc[1];
+    NEXT();
+op_Branch:
+    pc = function->code + (R[pc[1]] ? pc[2] : pc[3]);
+    NEXT();
+op_BranchLt:
+    pc = function->code + (R[pc[1]] < R[pc[2]] ? pc[3] : pc[4]);
+    NEXT();
+op_BranchLe:
+    pc = function->code + (R[pc[1]] <= R[pc[2]] ? pc[3] : pc[4]);
+    NEXT();
+op_BranchEq:
+    pc = function->code + (R[pc[1]] == R[pc[2]] ? pc[3] : pc[4]);
+    NEXT();
+op_TypeCase: {
+    Object* object = O[pc[1]];
+    uint32_t tag = object->tag;
+    const uint32_t* interval = pc + 3;
+    for (uint32_t i = 0; i < pc[2]; i++, interval += 3) {
+        if (tag - interval[0] <= interval[1] - interval[0]) {
+            pc = function->code + interval[2];
+            NEXT();
+        }
+    }
+    _case_abort(object);
+    NEXT();
+}
+
+op_Return:
+    value = O[pc[1]];
+ret: {
+    Frame& caller = frames.back();
+    function = caller.function;
+    pc = caller.pc;
+    O = caller.objects;
+    R = caller.raws;
+    O[caller.result] = value;
+    frames.pop_back();
+    objects_top = O + function->nobjects;
+    NEXT();
+}
+
+op_Halt:
+    coolrt::finish("COOL program successfully executed\n");
+
+#undef NEXT
+}
+
+}
@@ -0,0 +1,291 @@
+#include "x86asm.hpp"
+#include <cstring>
+
+namespace cool {
+
+static unsigned number(X86Reg reg) {
+    return static_cast<unsigned>(reg);
+}
+
+void X86Assembler::imm32(int32_t imm) {
+    uint32_t value = static_cast<uint32_t>(imm);
+    for (int i = 0; i < 4; i++)
+        byte(value >> (8 * i));
+}
+
+void X86Assembler::rex(bool w, unsigned reg, unsigned rm, bool force) {
+    uint8_t prefix = 0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3);
+    if (prefix != 0x40 || force)
+        byte(prefix);
+}
+
+void X86Assembler::op(bool w, std::initializer_list<uint8_t> opcode, unsigned reg, X86Reg rm) {
+    rex(w, reg, number(rm));
+    for (uint8_t b: opcode)
+        byte(b);
+    byte(0xc0 | ((reg & 7) << 3) | (number(rm) & 7));
+}
+
+void X86Assembler::op(bool w, std::initializer_list<uint8_t> opcode, unsigned reg, X86Mem rm) {
+    unsigned base = number(rm.base);
+    rex(w, reg, base);
+    for (uint8_t b: opcode)
+        byte(b);
+    // rbp and r13 as base always take a displacement, rsp and r12 a SIB byte.
+    unsigned mod = rm.disp == 0 && (base & 7) != 5 ? 0 : rm.disp >= -128 && rm.disp < 128 ? 1 : 2;
+    byte((mod << 6) | ((reg & 7) << 3) | (base & 7));
+    if ((base & 7) == 4)
+        byte(0x24);
+    if (mod == 1)
+        byte(static_cast<uint8_t>(rm.disp));
+    else if (mod == 2)
+        imm32(rm.disp);
+}
+
+void X86Assembler::rel32(const void* target) {
+    const char* next = base + bytes.size() + 4;
+    imm32(static_cast<int32_t>(static_cast<const char*>(target) - next));
+}
+
+void X86Assembler::rel32(X86Label& label) {
+    if (label.bound()) {
+        imm32(static_cast<int32_t>(label.position - (bytes.size() + 4)));
+        return;
+    }
+    label.uses.push_back(bytes.size());
+    imm32(0);
+}
+
+void X86Assembler::bind(X86Label& label) {
+    label.position = bytes.size();
+    for (std::size_t use: label.uses) {
+        int32_t offset = static_cast<int32_t>(label.position - (use + 4));
+        std::memcpy(&bytes[use], &offset, 4);
+    }
+    label.uses.clear();
+}
+
+void X86Assembler::mov(X86Reg dst, X86Reg src) {
+    op(true, {0x8b}, number(dst), src);
+}
+
+void X86Assembler::mov(X86Reg dst, X86Mem src) {
+    op(true, {0x8b}, number(dst), src);
+}
+
+void X86Assembler::mov(X86Mem dst, X86Reg src) {
+    op(true, {0x89}, number(src), dst);
+}
+
+void X86Assembler::mov(X86Mem dst, int32_t imm) {
+    op(true, {0xc7}, 0, dst);
+    imm32(imm);
+}
+
+void X86Assembler::mov(X86Reg dst, uint64_t imm) {
+    if (imm <= UINT32_MAX) {
+        mov32(dst, static_cast<int32_t>(imm));
+        return;
+    }
+    rex(true, 0, number(dst));
+    byte(0xb8 | (number(dst) & 7));
+    for (int i = 0; i < 8; i++)
+        byte(imm >> (8 * i));
+}
+
+void X86Assembler::mov32(X86Reg dst, X86Reg src) {
+    op(false, {0x8b}, number(dst), src);
+}
+
+void X86Assembler::mov32(X86Reg dst, X86Mem src) {
+    op(false, {0x8b}, number(dst), src);
+}
+
+void X86Assembler::mov32(X86Mem dst, X86Reg src) {
+    op(false, {0x89}, number(src), dst);
+}
+
+void X86Assembler::mov32(X86Mem dst, int32_t imm) {
+    op(false, {0xc7}, 0, dst);
+    imm32(imm);
+}
+
+void X86Assembler::mov32(X86Reg dst, int32_t imm) {
+    rex(false, 0, number(dst));
+    byte(0xb8 | (number(dst) & 7));
+    imm32(imm);
+}
+
+void X86Assembler::lea(X86Reg dst, X86Mem src) {
+    op(true, {0x8d}, number(dst), src);
+}
+
+void X86Assembler::add(X86Reg dst, int32_t imm) {
+    op(true, {0x81}, 0, dst);
+    imm32(imm);
+}
+
+void X86Assembler::add(X86Mem dst, int32_t imm) {
+    op(true, {0x81}, 0, dst);
+    imm32(imm);
+}
+
+void X86Assembler::sub(X86Reg dst, int32_t imm) {
+    op(true, {0x81}, 5, dst);
+    imm32(imm);
+}
+
+void X86Assembler::cmp(X86Reg a, X86Reg b) {
+    op(true, {0x3b}, number(a), b);
+}
+
+void X86Assembler::cmp(X86Reg a, X86Mem b) {
+    op(true, {0x3b}, number(a), b);
+}
+
+void X86Assembler::cmp(X86Mem a, int32_t imm) {
+    op(true, {0x81}, 7, a);
+    imm32(imm);
+}
+
+void X86Assembler::add32(X86Reg dst, X86Mem src) {
+    op(false, {0x03}, number(dst), src);
+}
+
+void X86Assembler::add32(X86Reg dst, int32_t imm) {
+    op(false, {0x81}, 0, dst);
+    imm32(imm);
+}
+
+void X86Assembler::sub32(X86Reg dst, X86Mem src) {
+    op(false, {0x2b}, number(dst), src);
+}
+
+void X86Assembler::sub32(X86Reg dst, int32_t imm) {
+    op(false, {0x81}, 5, dst);
+    imm32(imm);
+}
+
+void X86Assembler::imul32(X86Reg dst, X86Mem src) {
+    op(false, {0x0f, 0xaf}, number(dst), src);
+}
+
+void X86Assembler::cmp32(X86Reg a, X86Mem b) {
+    op(false, {0x3b}, number(a), b);
+}
+
+void X86Assembler::cmp32(X86Reg a, int32_t imm) {
+    op(false, {0x81}, 7, a);
+    imm32(imm);
+}
+
+void X86Assembler::cmp32(X86Mem a, int32_t imm) {
+    op(false, {0x81}, 7, a);
+    imm32(imm);
+}
+
+void X86Assembler::test32(X86Reg a, X86Reg b) {
+    op(false, {0x85}, number(b), a);
+}
+
+void X86Assembler::test32(X86Mem a, int32_t imm) {
+    op(false, {0xf7}, 0, a);
+    imm32(imm);
+}
+
+void X86Assembler::xor32(X86Reg dst, X86Reg src) {
+    op(false, {0x33}, number(dst), src);
+}
+
+void X86Assembler::neg32(X86Reg dst) {
+    op(false, {0xf7}, 3, dst);
+}
+
+void X86Assembler::cdq() {
+    byte(0x99);
+}
+
+void X86Assembler::idiv32(X86Mem divisor) {
+    op(false, {0xf7}, 7, divisor);
+}
+
+void X86Assembler::set32(X86Cond cond, X86Reg dst) {
+    // the low byte of rsi, rdi... takes a REX prefix.
+    rex(false, 0, number(dst), number(dst) >= 4);
+    byte(0x0f);
+    byte(0x90 | static_cast<uint8_t>(cond));
+    byte(0xc0 | (number(dst) & 7));
+    rex(false, number(dst), number(dst), number(dst) >= 4);
+    byte(0x0f);
+    byte(0xb6);
+    byte(0xc0 | ((number(dst) & 7) << 3) | (number(dst) & 7));
+}
+
+void X86Assembler::cmov(X86Cond cond, X86Reg dst, X86Reg src) {
+    op(true, {0x0f, static_cast<uint8_t>(0x40 | static_cast<uint8_t>(cond))}, number(dst), src);
+}
+
+void X86Assembler::rep_stosq() {
+    byte(0xf3);
+    byte(0x48);
+    byte(0xab);
+}
+
+void X86Assembler::push(X86Reg reg) {
+    rex(false, 0, number(reg));
+    byte(0x50 | (number(reg) & 7));
+}
+
+void X86Assembler::pop(X86Reg reg) {
+    rex(false, 0, number(reg));
+    byte(0x58 | (number(reg) & 7));
+}
+
+void X86Assembler::call(X86Reg target) {
+    op(false, {0xff}, 2, target);
+}
+
+void X86Assembler::call(X86Mem target) {
+    op(false, {0xff}, 2, target);
+}
+
+void X86Assembler::call(const void* target) {
+    byte(0xe8);
+    rel32(target);
+}
+
+void X86Assembler::jmp(X86Reg target) {
+    op(false, {0xff}, 4, target);
+}
+
+void X86Assembler::jmp(X86Mem target) {
+    op(false, {0xff}, 4, target);
+}
+
+void X86Assembler::jmp(const void* target) {
+    byte(0xe9);
+    rel32(target);
+}
+
+void X86Assembler::jmp(X86Label& label) {
+    byte(0xe9);
+    rel32(label);
+}
+
+void X86Assembler::jcc(X86Cond cond, const void* target) {
+    byte(0x0f);
+    byte(0x80 | static_cast<uint8_t>(cond));
+    rel32(target);
+}
+
+void X86Assembler::jcc(X86Cond cond, X86Label& label) {
+    byte(0x0f);
+    byte(0x80 | static_cast<uint8_t>(cond));
+    rel32(label);
+}
+
+void X86Assembler::ret() {
+    byte(0xc3);
+}
+
+}
@@ -0,0 +1,530 @@
+#include "cgen.hpp"
+#include "emit.hpp"
+#include <algorithm>
+
+// x86-64 code generation from the IR (--target=x86_64), for the GNU assembler
+// and the native runtime (lib/runtime).
+// Methods follow the System V calling convention: self and the first five
+// arguments are passed in rdi, rsi, rdx, rcx, r8 and r9, the others on the
+// stack, and the result is returned in rax. Every value lives in a slot of
+// the frame below rbp, except the constants which are rematerialized where
+// they are used; Int values are computed with the 32 bits instructions. The
+// data (prototypes, dispatch tables, constants) is the same as for MIPS with
+// 8 bytes words, addressed relative to rip so the executable can be
+// position independent. The calls whose result is only returned, with all
+// their arguments in registers, jump to the method called instead of calling
+// it, so tail recursion runs in constant stack as with the MIPS code. The
+// prologue compares rsp with the limit the runtime sets (_stack_limit), so a
+// recursion too deep stops with "Stack overflow." instead of a crash.
+//
+// The collector of the runtime (lib/runtime/gc.cpp) finds its roots with
+// the frame table emitted after the code: the address range of every
+// function and the number of its slots holding objects, which come first
+// below rbp and are cleared by the prologue. Storing an object in an
+// attribute goes through the write barrier when the object has been
+// promoted to the old generation.
+
+namespace cool {
+
+static const char* x86_arg_regs[X86_ARG_REGS] = {"%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9"};
+
+// the low 32 bits of a 64 bits register.
+static std::string low32(const std::string& reg) {
+    if (reg == "%r8" || reg == "%r9")
+        return reg + "d";
+    return "%e" + reg.substr(2);
+}
+
+void Cgen::x86_code_text(Program* program) {
+    for (auto& name: {"Object", "IO", "String", "Int", "Bool"})
+        x86_class(class_table_ptr->get(name));
+    for (auto& class_: program->classes)
+        x86_class(class_.get());
+
+    os << "\t.data" << std::endl;
+    os << X86_ALIGN;
+    os << GLOBAL << X86_FRAME_TABLE << std::endl;
+    os << X86_FRAME_TABLE << LABEL;
+    os << QUAD << x86_frame_table.size() << std::endl;
+    for (auto& frame: x86_frame_table)
+        os << QUAD << frame.start << ", " << frame.end << ", " << frame.roots << std::endl;
+    os << "\t.section\t.note.GNU-stack,\"\",@progbits" << std::endl;
+}
+
+void Cgen::x86_class(Class* class_) {
+    const std::string& name = class_->name.lexeme;
+    if (is_base_class(class_) || reachability.is_instantiated(name)) {
+        emit_label(name + CLASSINIT_SUFFIX);
+        IRFunction* init = noop_inits.count(name) ? nullptr : ir_module.get(name + CLASSINIT_SUFFIX);
+        if (init) {
+            x86_function(*init);
+        } else {
+            os << "\tmovq\t%rdi, %rax" << std::endl;
+            os << "\tret" << std::endl;
+        }
+    }
+
+    // the methods of the basic classes are in the runtime.
+    if (is_base_class(class_))
+        return;
+    for (auto& feature: class_->features) {
+        if (feature->featuretype != FeatureType::METHOD || !reachability.is_reachable(feature.get()))
+            continue;
+        std::string label = name + METHOD_SEP + feature->id.lexeme;
+        emit_label(label);
+        x86_function(*ir_module.get(label));
+    }
+}
+
+void Cgen::x86_function(IRFunction& function) {
+    split_critical_edges(function);
+    verify_or_die(function, "after splitting the critical edges");
+
+    std::unordered_map<IRInstr*, std::size_t> uses;
+    for (auto& block: function.blocks) {
+        for (auto& instr: block->instrs) {
+            for (IRInstr* operand: instr->operands)
+                uses[operand]++;
+        }
+    }
+
+    // the slots are below the saved rbp, the ones of objects first, the frame
+    // keeping rsp 16 bytes aligned at the calls.
+    ir_slots.clear();
+    ir_labels.clear();
+    ir_fused.clear();
+    ir_tail_calls.clear();
+    std::vector<IRInstr*> values;
+    for (auto& block: function.blocks) {
+        ir_labels[block.get()] = "ir_block" + std::to_string(ir_label_count++);
+        for (std::size_t i = 0; i < block->instrs.size(); i++) {
+            IRInstr* instr = block->instrs[i].get();
+            if (x86_is_tail_call(instr)) {
+                ir_tail_calls.insert(instr);
+                continue;
+            }
+            if (instr->type == IRType::None || (instr->op != IROp::Param && ir_rematerialized(instr)))
+                continue;
+            bool compare = instr->op == IROp::Lt || instr->op == IROp::Le || instr->op == IROp::Eq || instr->op == IROp::Not;
+            if (compare && i + 2 == block->instrs.size() && block->terminator()->op == IROp::Branch &&
+                uses[instr] == 1 && block->terminator()->operands[0] == instr) {
+                ir_fused.insert(instr);
+                continue;
+            }
+            values.push_back(instr);
+        }
+    }
+    std::stable_partition(values.begin(), values.end(), [](IRInstr* value) { return value->type == IRType::Obj; });
+    std::size_t nslots = 0, nroots = 0;
+    for (IRInstr* value: values) {
+        ir_slots[value] = ++nslots;
+        if (value->type == IRType::Obj)
+            nroots = nslots;
+    }
+    ir_frame_size = nslots + nslots % 2;
+
+    os << "\tpushq\t%rbp" << std::endl;
+    os << "\tmovq\t%rsp, %rbp" << std::endl;
+    if (ir_frame_size)
+        os << "\tsubq\t$" << ir_frame_size * X86_WORD_SIZE << ", %rsp" << std::endl;
+    std::string stack_label = "ir_stack" + std::to_string(ir_label_count++);
+    os << "\tcmpq\t_stack_limit(%rip), %rsp" << std::endl;
+    os << "\tjae\t" << stack_label << std::endl;
+    os << "\tcall\t_stack_overflow" << std::endl;
+    emit_label(stack_label);
+    // the parameters are stored before anything is allocated.
+    bool cleared = false;
+    for (IRInstr* value: values) {
+        if (value->type != IRType::Obj || value->op == IROp::Param)
+            continue;
+        if (!cleared)
+            os << "\txorl\t%eax, %eax" << std::endl;
+        cleared = true;
+        os << "\tmovq\t%rax, -" << ir_slots[value] * X86_WORD_SIZE << "(%rbp)" << std::endl;
+    }
+
+    for (std::size_t i = 0; i < function.blocks.size(); i++) {
+        IRBlock* block = function.blocks[i].get();
+        IRBlock* next = i + 1 < function.blocks.size() ? function.blocks[i + 1].get() : nullptr;
+        if (i > 0)
+            emit_label(ir_labels[block]);
+        for (auto& instr: block->instrs) {
+            x86_instr(instr.get(), next);
+            // the rest of the block is the return of the result.
+            if (ir_tail_calls.count(instr.get()))
+                break;
+        }
+    }
+    std::string end = "ir_end" + std::to_string(ir_label_count++);
+    emit_label(end);
+    x86_frame_table.push_back({function.name, end, nroots});
+    std::size_t nformals = function.nparams > X86_ARG_REGS ? function.nparams - X86_ARG_REGS : 0;
+    frames.push_back({function.name, ir_frame_size + 2 + nformals, 0, true, true, true});
+}
+
+bool Cgen::x86_is_tail_call(IRInstr* instr) {
+    return instr->operands.size() <= X86_ARG_REGS && ir_is_tail_call(instr);
+}
+
+void Cgen::x86_load(IRInstr* value, const char* reg) {
+    auto slot = ir_slots.find(value);
+    if (slot != ir_slots.end()) {
+        os << "\tmovq\t-" << slot->second * X86_WORD_SIZE << "(%rbp), " << reg << std::endl;
+        return;
+    }
+    switch (value->op) {
+        case IROp::Const:
+            os << "\tmovl\t$" << value->value << ", " << low32(reg) << std::endl;
+            break;
+        case IROp::String:
+            os << "\tleaq\t" << STRCONST_PREFIX << stringtable().get_index(value->name) << "(%rip), " << reg << std::endl;
+            break;
+        case IROp::Void:
+            os << "\txorl\t" << low32(reg) << ", " << low32(reg) << std::endl;
+            break;
+        case IROp::Box: {
+            IRInstr* raw = value->operands[0];
+            std::string label = raw->type == IRType::Bool ? (raw->value ? BOOLCONST_TRUE : BOOLCONST_FALSE)
+                                : INTCONST_PREFIX + std::to_string(inttable().get_index(std::to_string(raw->value)));
+            os << "\tleaq\t" << label << "(%rip), " << reg << std::endl;
+            break;
+        }
+        default:
+            std::cerr << "IR value %" << value->id << " isn't available.\n";
+            exit(EXIT_FAILURE);
+    }
+}
+
+void Cgen::x86_store(IRInstr* value) {
+    auto slot = ir_slots.find(value);
+    if (slot != ir_slots.end())
+        os << "\tmovq\t%rax, -" << slot->second * X86_WORD_SIZE << "(%rbp)" << std::endl;
+}
+
+void Cgen::x86_instr(IRInstr* instr, IRBlock* next) {
+    auto& ops = instr->operands;
+    const int object_field = DEFAULT_OBJFIELDS * X86_WORD_SIZE;
+
+    switch (instr->op) {
+        case IROp::Param: {
+            std::size_t index = instr->value;
+            if (!ir_slots.count(instr))
+                break;
+            if (index < X86_ARG_REGS) {
+                os << "\tmovq\t" << x86_arg_regs[index] << ", %rax" << std::endl;
+            } else {
+                // above the return address and the saved rbp.
+                os << "\tmovq\t" << (index - X86_ARG_REGS + 2) * X86_WORD_SIZE << "(%rbp), %rax" << std::endl;
+            }
+            x86_store(instr);
+            break;
+        }
+        case IROp::Const:
+        case IROp::String:
+        case IROp::Void:
+        case IROp::Phi:
+            break;
+
+        case IROp::Add:
+        case IROp::Sub:
+        case IROp::Mul: {
+            const char* op = instr->op == IROp::Add ? "addl" : instr->op == IROp::Sub ? "subl" : "imull";
+            x86_load(ops[0], "%rax");
+            if (ops[1]->op == IROp::Const) {
+                os << "\t" << op << "\t$" << ops[1]->value << ", %eax" << std::endl;
+            } else {
+                x86_load(ops[1], "%rcx");
+                os << "\t" << op << "\t%ecx, %eax" << std::endl;
+            }
+            x86_store(instr);
+            break;
+        }
+        case IROp::Div: {
+            std::string ok_label = "ir_div" + std::to_string(ir_label_count++);
+            x86_load(ops[1], "%rcx");
+            os << "\ttestl\t%ecx, %ecx" << std::endl;
+            os << "\tjne\t" << ok_label << std::endl;
+            os << "\tcall\t_divide_abort" << std::endl;
+            emit_label(ok_label);
+            x86_load(ops[0], "%rax");
+            // idivl faults on the lowest Int divided by -1, which gives
+            // itself as with MIPS.
+            std::string divide_label = "ir_div" + std::to_string(ir_label_count++);
+            std::string done_label = "ir_div" + std::to_string(ir_label_count++);
+            os << "\tcmpl\t$-1, %ecx" << std::endl;
+            os << "\tjne\t" << divide_label << std::endl;
+            os << "\tnegl\t%eax" << std::endl;
+            os << "\tjmp\t" << done_label << std::endl;
+            emit_label(divide_label);
+            os << "\tcltd" << std::endl;
+            os << "\tidivl\t%ecx" << std::endl;
+            emit_label(done_label);
+            x86_store(instr);
+            break;
+        }
+        case IROp::Neg:
+            x86_load(ops[0], "%rax");
+            os << "\tnegl\t%eax" << std::endl;
+            x86_store(instr);
+            break;
+        case IROp::Lt:
+        case IROp::Le:
+        case IROp::Eq: {
+            if (ir_fused.count(instr))
+                break;
+            const char* set = instr->op == IROp::Lt ? "setl" : instr->op == IROp::Le ? "setle" : "sete";
+            x86_load(ops[0], "%rax");
+            x86_load(ops[1], "%rcx");
+            os << "\tcmpl\t%ecx, %eax" << std::endl;
+            os << "\t" << set << "\t%al" << std::endl;
+            os << "\tmovzbl\t%al, %eax" << std::endl;
+            x86_store(instr);
+            break;
+        }
+        case IROp::Not:
+            if (ir_fused.count(instr))
+                break;
+            x86_load(ops[0], "%rax");
+            os << "\txorl\t$1, %eax" << std::endl;
+            x86_store(instr);
+            break;
+
+        case IROp::Box:
+            if (ir_rematerialized(instr))
+                break;
+            if (ops[0]->type == IRType::Bool) {
+                // bool_const1 follows bool_const0.
+                x86_load(ops[0], "%rax");
+                os << "\tshlq\t$5, %rax" << std::endl;
+                os << "\tleaq\t" << BOOLCONST_FALSE << "(%rip), %rcx" << std::endl;
+                os << "\taddq\t%rcx, %rax" << std::endl;
+            } else {
+                os << "\tleaq\tInt" << PROTOBJ_SUFFIX << "(%rip), %rdi" << std::endl;
+                os << "\tcall\tObject.copy" << std::endl;
+                x86_load(ops[0], "%rcx");
+                os << "\tmovl\t%ecx, " << object_field << "(%rax)" << std::endl;
+            }
+            x86_store(instr);
+            break;
+        case IROp::Unbox:
+            x86_load(ops[0], "%rax");
+            os << "\tmovl\t" << object_field << "(%rax), %eax" << std::endl;
+            x86_store(instr);
+            break;
+        case IROp::ObjEq:
+            x86_load(ops[0], "%rdi");
+            x86_load(ops[1], "%rsi");
+            os << "\tcall\tequality_test" << std::endl;
+            x86_store(instr);
+            break;
+        case IROp::IsVoid:
+            x86_load(ops[0], "%rax");
+            os << "\ttestq\t%rax, %rax" << std::endl;
+            os << "\tsete\t%al" << std::endl;
+            os << "\tmovzbl\t%al, %eax" << std::endl;
+            x86_store(instr);
+            break;
+
+        case IROp::New:
+            os << "\tleaq\t" << instr->class_name << PROTOBJ_SUFFIX << "(%rip), %rdi" << std::endl;
+            os << "\tcall\tObject.copy" << std::endl;
+            if (!noop_inits.count(instr->class_name)) {
+                os << "\tmovq\t%rax, %rdi" << std::endl;
+                os << "\tcall\t" << instr->class_name << CLASSINIT_SUFFIX << std::endl;
+            }
+            x86_store(instr);
+            break;
+        case IROp::GetAttr:
+            x86_load(ops[0], "%rcx");
+            os << "\tmovq\t" << (attr_table[instr->class_name][instr->name] + 2) * X86_WORD_SIZE << "(%rcx), %rax" << std::endl;
+            x86_store(instr);
+            break;
+        case IROp::SetAttr:
+            x86_load(ops[0], "%rcx");
+            x86_load(ops[1], "%rax");
+            os << "\tmovq\t%rax, " << (attr_table[instr->class_name][instr->name] + 2) * X86_WORD_SIZE << "(%rcx)" << std::endl;
+            // the constants aren't in the heap.
+            if (ir_slots.count(ops[1])) {
+                std::string done = "ir_barrier" + std::to_string(ir_label_count++);
+                os << "\ttestb\t$" << X86_GC_BARRIER << ", " << X86_GC_BITS << "(%rcx)" << std::endl;
+                os << "\tje\t" << done << std::endl;
+                os << "\tmovq\t%rcx, %rdi" << std::endl;
+                os << "\tcall\t_gc_remember" << std::endl;
+                emit_label(done);
+            }
+            break;
+        case IROp::Dispatch:
+        case IROp::Call:
+            x86_call(instr);
+            break;
+        case IROp::CheckDispatch:
+        case IROp::CheckCase: {
+            std::string ok_label = "ir_check" + std::to_string(ir_label_count++);
+            x86_load(ops[0], "%rax");
+            os << "\ttestq\t%rax, %rax" << std::endl;
+            os << "\tjne\t" << ok_label << std::endl;
+            os << "\tleaq\t" << FILENAME << "(%rip), %rdi" << std::endl;
+            os << "\tmovl\t$" << instr->value << ", %esi" << std::endl;
+            os << "\tcall\t" << (instr->op == IROp::CheckDispatch ? "_dispatch_abort" : "_case_abort2") << std::endl;
+            emit_label(ok_label);
+            break;
+        }
+
+        case IROp::Jump:
+            x86_phi_moves(instr->block, instr->targets[0]);
+            if (instr->targets[0] != next)
+                os << "\tjmp\t" << ir_labels[instr->targets[0]] << std::endl;
+            break;
+        case IROp::Branch:
+            x86_branch(instr, next);
+            break;
+        case IROp::TypeCase:
+            x86_type_case(instr);
+            break;
+        case IROp::Return:
+            x86_load(ops[0], "%rax");
+            os << "\tleave" << std::endl;
+            os << "\tret" << std::endl;
+            break;
+    }
+}
+
+void Cgen::x86_call(IRInstr* instr) {
+    auto& ops = instr->operands;
+
+    // the arguments past the registers are pushed from the last one, with
+    // some padding to keep rsp aligned, and popped by the caller.
+    std::size_t nstack = ops.size() > X86_ARG_REGS ? ops.size() - X86_ARG_REGS : 0;
+    std::size_t pushed = nstack + nstack % 2;
+    if (nstack % 2)
+        os << "\tsubq\t$" << X86_WORD_SIZE << ", %rsp" << std::endl;
+    for (std::size_t i = ops.size(); i-- > X86_ARG_REGS; ) {
+        x86_load(ops[i], "%rax");
+        os << "\tpushq\t%rax" << std::endl;
+    }
+    for (std::size_t i = 0; i < ops.size() && i < X86_ARG_REGS; i++)
+        x86_load(ops[i], x86_arg_regs[i]);
+
+    if (ir_tail_calls.count(instr)) {
+        if (instr->op == IROp::Dispatch) {
+            os << "\tmovq\t" << DISPTABLE_OFFSET * X86_WORD_SIZE << "(%rdi), %rax" << std::endl;
+            os << "\tmovq\t" << method_table[instr->class_name][instr->name] * X86_WORD_SIZE << "(%rax), %rax" << std::endl;
+        }
+        os << "\tleave" << std::endl;
+        if (instr->op == IROp::Call)
+            os << "\tjmp\t" << instr->class_name << METHOD_SEP << instr->name << std::endl;
+        else
+            os << "\tjmp\t*%rax" << std::endl;
+        return;
+    }
+    if (instr->op == IROp::Call) {
+        os << "\tcall\t" << instr->class_name << METHOD_SEP << instr->name << std::endl;
+    } else {
+        os << "\tmovq\t" << DISPTABLE_OFFSET * X86_WORD_SIZE << "(%rdi), %rax" << std::endl;
+        os << "\tcall\t*" << method_table[instr->class_name][instr->name] * X86_WORD_SIZE << "(%rax)" << std::endl;
+    }
+    if (pushed)
+        os << "\taddq\t$" << pushed * X86_WORD_SIZE << ", %rsp" << std::endl;
+    x86_store(instr);
+}
+
+void Cgen::x86_branch(IRInstr* instr, IRBlock* next) {
+    IRInstr* cond = instr->operands[0];
+    IRBlock* if_true = instr->targets[0];
+    IRBlock* if_false = instr->targets[1];
+    if (ir_fused.count(cond) && cond->op == IROp::Not) {
+        std::swap(if_true, if_false);
+        cond = cond->operands[0];
+    }
+
+    // jump to `target` when the condition is `jump_if`, fall through to
+    // the next block if possible.
+    bool jump_if = true;
+    IRBlock* target = if_true;
+    IRBlock* other = if_false;
+    if (if_true == next) {
+        jump_if = false;
+        std::swap(target, other);
+    }
+
+    const char* jump = jump_if ? "jne" : "je";
+    if (ir_fused.count(cond)) {
+        if (cond->op == IROp::Lt)
+            jump = jump_if ? "jl" : "jge";
+        else if (cond->op == IROp::Le)
+            jump = jump_if ? "jle" : "jg";
+        else
+            jump = jump_if ? "je" : "jne";
+        x86_load(cond->operands[0], "%rax");
+        IRInstr* rhs = cond->operands[1];
+        if (rhs->op == IROp::Const) {
+            os << "\tcmpl\t$" << rhs->value << ", %eax" << std::endl;
+        } else {
+            x86_load(rhs, "%rcx");
+            os << "\tcmpl\t%ecx, %eax" << std::endl;
+        }
+    } else {
+        x86_load(cond, "%rax");
+        os << "\ttestl\t%eax, %eax" << std::endl;
+    }
+    os << "\t" << jump << "\t" << ir_labels[target] << std::endl;
+    if (other != next)
+        os << "\tjmp\t" << ir_labels[other] << std::endl;
+}
+
+void Cgen::x86_type_case(IRInstr* instr) {
+    x86_load(instr->operands[0], "%rax");
+    os << "\tmovl\t" << TAG_OFFSET << "(%rax), %ecx" << std::endl;
+
+    // a tag is in [lo, hi] when tag - lo is at most hi - lo unsigned.
+    for (auto& interval: case_intervals(instr->class_name, instr->cases)) {
+        if (interval.branch < 0)
+            continue;
+        const std::string& label = ir_labels[instr->targets[interval.branch]];
+        if (interval.lo == interval.hi) {
+            os << "\tcmpl\t$" << interval.lo << ", %ecx" << std::endl;
+            os << "\tje\t" << label << std::endl;
+        } else {
+            os << "\tleal\t-" << interval.lo << "(%rcx), %edx" << std::endl;
+            os << "\tcmpl\t$" << interval.hi - interval.lo << ", %edx" << std::endl;
+            os << "\tjbe\t" << label << std::endl;
+        }
+    }
+    os << "\tmovq\t%rax, %rdi" << std::endl;
+    os << "\tcall\t_case_abort" << std::endl;
+}
+
+void Cgen::x86_phi_moves(IRBlock* from, IRBlock* to) {
+    std::size_t index = std::find(to->preds.begin(), to->preds.end(), from) - to->preds.begin();
+    std::vector<std::pair<IRInstr*, IRInstr*>> moves;
+    bool overlap = false;
+    for (auto& instr: to->instrs) {
+        if (instr->op != IROp::Phi)
+            break;
+        IRInstr* source = instr->operands[index];
+        if (source == instr.get())
+            continue;
+        moves.push_back({instr.get(), source});
+        overlap = overlap || (source->op == IROp::Phi && source->block == to);
+    }
+
+    // when a phi takes the value of another, all the values are read before
+    // any is written.
+    if (overlap) {
+        for (auto& move: moves) {
+            x86_load(move.second, "%rax");
+            os << "\tpushq\t%rax" << std::endl;
+        }
+        for (std::size_t i = moves.size(); i-- > 0; ) {
+            os << "\tpopq\t%rax" << std::endl;
+            x86_store(moves[i].first);
+        }
+        return;
+    }
+    for (auto& move: moves) {
+        x86_load(move.second, "%rax");
+        x86_store(move.first);
+    }
+}
+
+}
@@ -0,0 +1,100 @@
+#include "simulator.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// runtime loaded before the programs, set by the build.
+#ifndef COOLSIM_RUNTIME
+#define COOLSIM_RUNTIME "lib/trap.handler.s"
+#endif
+
+static void usage() {
+    std::cerr << "Usage: coolsim [options] file.s...\n"
+              << "Runs the MIPS code generated by coolc with the runtime.\n"
+              << "  --runtime=FILE      runtime to load first (default " COOLSIM_RUNTIME ")\n"
+              << "  --no-runtime        only load the files given\n"
+              << "  --stats             print the counts of instructions and cycles on stderr\n"
+              << "  --stats-file=FILE   print them in FILE\n"
+              << "  --routines=N        number of routines in the counts, the busiest first (default 20, 0 for all)\n"
+              << "  --limit=N           stop after N instructions\n"
+              << "  --load-use=N, --mul=N, --div=N, --taken-branch=N\n"
+              << "                      cycles of the load-use stalls, extra cycles of the multiplications,\n"
+              << "                      divisions and of the branches taken (default 1, 3, 34, 1)\n";
+    exit(64);
+}
+
+int main(int argc, char* argv[]) {
+    std::string runtime = COOLSIM_RUNTIME;
+    bool stats = false;
+    std::string stats_file;
+    std::size_t nroutines = 20;
+    uint64_t limit = 0;
+    coolsim::CostModel costs;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value;
+        // whether arg is `option`VALUE.
+        auto is = [&](const std::string& option) {
+            if (arg.compare(0, option.size(), option) != 0)
+                return false;
+            value = arg.substr(option.size());
+            return true;
+        };
+        auto number = [&]() {
+            char* end;
+            unsigned long long n = std::strtoull(value.c_str(), &end, 10);
+            if (value.empty() || *end)
+                usage();
+            return n;
+        };
+        if (arg == "--no-runtime")
+            runtime.clear();
+        else if (is("--runtime="))
+            runtime = value;
+        else if (arg == "--stats")
+            stats = true;
+        else if (is("--stats-file="))
+            stats = true, stats_file = value;
+        else if (is("--routines="))
+            nroutines = number();
+        else if (is("--limit="))
+            limit = number();
+        else if (is("--load-use="))
+            costs.load_use_stall = number();
+        else if (is("--mul="))
+            costs.mul_latency = number();
+        else if (is("--div="))
+            costs.div_latency = number();
+        else if (is("--taken-branch="))
+            costs.taken_branch = number();
+        else if (arg[0] == '-')
+            usage();
+        else
+            files.push_back(arg);
+    }
+    if (files.empty())
+        usage();
+
+    coolsim::Simulator simulator;
+    simulator.set_costs(costs);
+    if (!runtime.empty())
+        simulator.load(runtime);
+    for (auto& file: files)
+        simulator.load(file);
+    simulator.link();
+    int status = simulator.run(limit);
+
+    if (stats) {
+        if (stats_file.empty()) {
+            simulator.print_stats(std::cerr, nroutines);
+        } else {
+            std::ofstream out{stats_file};
+            simulator.print_stats(out, nroutines);
+        }
+    }
+    return status;
+}
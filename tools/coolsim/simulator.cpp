@@ -0,0 +1,756 @@
+#include "simulator.hpp"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+namespace coolsim {
+
+namespace {
+
+constexpr uint32_t TEXT_BASE = 0x00400000;
+constexpr uint32_t DATA_BASE = 0x10010000;
+constexpr uint32_t KDATA_BASE = 0x90000000;
+constexpr uint32_t STACK_TOP = 0x80000000;
+constexpr uint32_t STACK_SIZE = 64 << 20;
+constexpr uint32_t INITIAL_SP = 0x7fffeffc;
+constexpr uint32_t INITIAL_GP = 0x10008000;
+// as SPIM, the heap starts some room above the static data.
+constexpr uint32_t INITIAL_DATA_SIZE = 1 << 20;
+
+const std::unordered_map<std::string, Op> opcodes = {
+    {"add", Op::Add}, {"addi", Op::Add}, {"addu", Op::Addu}, {"addiu", Op::Addu},
+    {"sub", Op::Sub}, {"subu", Op::Subu}, {"and", Op::And}, {"andi", Op::And},
+    {"or", Op::Or}, {"ori", Op::Or}, {"xor", Op::Xor}, {"xori", Op::Xor}, {"nor", Op::Nor},
+    {"mul", Op::Mul}, {"div", Op::Div}, {"divu", Op::Divu}, {"rem", Op::Rem},
+    {"sll", Op::Sll}, {"srl", Op::Srl}, {"sra", Op::Sra}, {"sllv", Op::Sllv}, {"srlv", Op::Srlv}, {"srav", Op::Srav},
+    {"slt", Op::Slt}, {"slti", Op::Slt}, {"sltu", Op::Sltu}, {"sltiu", Op::Sltu},
+    {"seq", Op::Seq}, {"sne", Op::Sne}, {"sge", Op::Sge}, {"sgt", Op::Sgt}, {"sle", Op::Sle},
+    {"neg", Op::Neg}, {"negu", Op::Neg}, {"not", Op::Not}, {"move", Op::Move},
+    {"li", Op::Li}, {"la", Op::La}, {"lui", Op::Lui},
+    {"lw", Op::Lw}, {"lb", Op::Lb}, {"lbu", Op::Lbu}, {"lh", Op::Lh}, {"lhu", Op::Lhu},
+    {"sw", Op::Sw}, {"sb", Op::Sb}, {"sh", Op::Sh},
+    {"beq", Op::Beq}, {"bne", Op::Bne}, {"blt", Op::Blt}, {"bgt", Op::Bgt}, {"ble", Op::Ble}, {"bge", Op::Bge},
+    {"bltu", Op::Bltu}, {"bgtu", Op::Bgtu}, {"bleu", Op::Bleu}, {"bgeu", Op::Bgeu},
+    {"beqz", Op::Beqz}, {"bnez", Op::Bnez}, {"blez", Op::Blez}, {"bgtz", Op::Bgtz}, {"bltz", Op::Bltz}, {"bgez", Op::Bgez},
+    {"b", Op::B}, {"j", Op::J}, {"jal", Op::Jal}, {"jr", Op::Jr}, {"jalr", Op::Jalr},
+    {"syscall", Op::Syscall}, {"mfc0", Op::Mfc0}, {"rfe", Op::Rfe}, {"nop", Op::Nop}, {"break", Op::Break},
+};
+
+const std::unordered_map<std::string, int> register_names = {
+    {"zero", 0}, {"at", 1}, {"v0", 2}, {"v1", 3}, {"a0", 4}, {"a1", 5}, {"a2", 6}, {"a3", 7},
+    {"t0", 8}, {"t1", 9}, {"t2", 10}, {"t3", 11}, {"t4", 12}, {"t5", 13}, {"t6", 14}, {"t7", 15},
+    {"s0", 16}, {"s1", 17}, {"s2", 18}, {"s3", 19}, {"s4", 20}, {"s5", 21}, {"s6", 22}, {"s7", 23},
+    {"t8", 24}, {"t9", 25}, {"k0", 26}, {"k1", 27}, {"gp", 28}, {"sp", 29}, {"fp", 30}, {"s8", 30}, {"ra", 31},
+};
+
+enum Reg { V0 = 2, A0 = 4, A1 = 5, RA = 31 };
+
+std::string trim(const std::string& s) {
+    std::size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+        return "";
+    return s.substr(first, s.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+std::string strip_comment(const std::string& line) {
+    bool in_string = false;
+    for (std::size_t i = 0; i < line.size(); i++) {
+        if (line[i] == '\\' && in_string)
+            i++;
+        else if (line[i] == '"')
+            in_string = !in_string;
+        else if (line[i] == '#' && !in_string)
+            return line.substr(0, i);
+    }
+    return line;
+}
+
+// the operands separated by commas or blanks, "off ($reg)" being one.
+std::vector<std::string> split_operands(const std::string& s) {
+    std::vector<std::string> operands;
+    std::string current;
+    int depth = 0;
+    for (char c: s) {
+        depth += c == '(' ? 1 : c == ')' ? -1 : 0;
+        if ((c == ',' || c == ' ' || c == '\t') && depth == 0) {
+            if (!current.empty())
+                operands.push_back(current);
+            current.clear();
+        } else if (c == '(' && depth == 1 && current.empty() && !operands.empty() && operands.back()[0] != '$') {
+            current = operands.back() + c;
+            operands.pop_back();
+        } else {
+            current += c;
+        }
+    }
+    if (!current.empty())
+        operands.push_back(current);
+    return operands;
+}
+
+std::string unescape(const std::string& s) {
+    std::string result;
+    for (std::size_t i = 0; i < s.size(); i++) {
+        if (s[i] != '\\' || i + 1 == s.size()) {
+            result += s[i];
+            continue;
+        }
+        switch (char c = s[++i]) {
+            case 'n': result += '\n'; break;
+            case 't': result += '\t'; break;
+            case '"': result += '"'; break;
+            case '\\': result += '\\'; break;
+            case '0': result += '\0'; break;
+            default: result += '\\'; result += c; break;
+        }
+    }
+    return result;
+}
+
+bool parse_int(const std::string& s, int64_t& value) {
+    if (s.size() == 3 && s[0] == '\'' && s[2] == '\'') {
+        value = s[1];
+        return true;
+    }
+    if (s.empty())
+        return false;
+    char* end;
+    value = std::strtoll(s.c_str(), &end, 0);
+    return *end == '\0';
+}
+
+bool is_routine(const std::string& label, const std::unordered_set<std::string>& globals) {
+    const std::string init = "_init";
+    return label.find('.') != std::string::npos || globals.count(label) ||
+           (label.size() > init.size() && label.compare(label.size() - init.size(), init.size(), init) == 0);
+}
+
+uint32_t bit(int reg) {
+    return reg ? 1u << reg : 0;
+}
+
+}
+
+OpClass op_class(Op op) {
+    switch (op) {
+        case Op::Mul: case Op::Div: case Op::Divu: case Op::Rem:
+            return OpClass::MulDiv;
+        case Op::Lw: case Op::Lb: case Op::Lbu: case Op::Lh: case Op::Lhu:
+            return OpClass::Load;
+        case Op::Sw: case Op::Sb: case Op::Sh:
+            return OpClass::Store;
+        case Op::Beq: case Op::Bne: case Op::Blt: case Op::Bgt: case Op::Ble: case Op::Bge:
+        case Op::Bltu: case Op::Bgtu: case Op::Bleu: case Op::Bgeu:
+        case Op::Beqz: case Op::Bnez: case Op::Blez: case Op::Bgtz: case Op::Bltz: case Op::Bgez:
+            return OpClass::Branch;
+        case Op::B: case Op::J: case Op::Jal: case Op::Jr: case Op::Jalr:
+            return OpClass::Jump;
+        case Op::Syscall:
+            return OpClass::Syscall;
+        case Op::Mfc0: case Op::Rfe: case Op::Nop: case Op::Break:
+            return OpClass::Other;
+        default:
+            return OpClass::Alu;
+    }
+}
+
+const char* op_class_name(OpClass c) {
+    static const char* names[] = {"alu", "mul/div", "load", "store", "branch", "jump", "syscall", "other"};
+    return names[static_cast<int>(c)];
+}
+
+Simulator::Simulator(): data{DATA_BASE, {}}, kdata{KDATA_BASE, {}}, stack{STACK_TOP - STACK_SIZE, {}} {}
+
+void Simulator::error(const std::string& message) {
+    flush();
+    std::fprintf(stderr, "coolsim: %s\n", message.c_str());
+    std::exit(2);
+}
+
+// the program did something the machine can't do: report it as the
+// exception handler of SPIM and stop.
+void Simulator::exception(const std::string& message) {
+    flush();
+    std::printf("Exception occurred at PC=0x%08x (%s)\n  %s\n", TEXT_BASE + 4 * pc, text[pc].text.c_str(), message.c_str());
+    std::fflush(stdout);
+    throw Halt{1};
+}
+
+void Simulator::flush() {
+    std::fwrite(output.data(), 1, output.size(), stdout);
+    std::fflush(stdout);
+    output.clear();
+}
+
+bool Simulator::value_of(const std::string& s, int64_t& value) {
+    if (parse_int(s, value))
+        return true;
+    auto symbol = symbols.find(s);
+    if (symbol != symbols.end()) {
+        value = static_cast<int32_t>(symbol->second);
+        return true;
+    }
+    // label+offset or label-offset.
+    std::size_t sign = s.find_first_of("+-", 1);
+    int64_t base, offset;
+    if (sign != std::string::npos && value_of(s.substr(0, sign), base) &&
+        parse_int(s.substr(sign + (s[sign] == '+')), offset)) {
+        value = base + offset;
+        return true;
+    }
+    return false;
+}
+
+int Simulator::register_of(const std::string& s) {
+    if (s.size() < 2 || s[0] != '$')
+        return -1;
+    std::string name = s.substr(1);
+    auto reg = register_names.find(name);
+    if (reg != register_names.end())
+        return reg->second;
+    if (std::isdigit(static_cast<unsigned char>(name[0]))) {
+        int n = std::atoi(name.c_str());
+        return n < 32 ? n : -1;
+    }
+    return -1;
+}
+
+void Simulator::load(const std::string& path) {
+    std::ifstream file{path};
+    if (!file)
+        error("can't open " + path);
+    enum { TEXT, DATA, KTEXT, KDATA } segment = TEXT;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        std::string rest = trim(strip_comment(line));
+        auto where = [&]() { return path + ":" + std::to_string(line_number) + ": "; };
+
+        // the labels at the start of the line.
+        while (!rest.empty()) {
+            std::size_t colon = std::string::npos;
+            for (std::size_t i = 0; i < rest.size() && rest[i] != ' ' && rest[i] != '\t' && rest[i] != '"'; i++) {
+                if (rest[i] == ':') {
+                    colon = i;
+                    break;
+                }
+            }
+            if (colon == std::string::npos)
+                break;
+            std::string label = rest.substr(0, colon);
+            switch (segment) {
+                case TEXT:
+                    symbols[label] = TEXT_BASE + 4 * text.size();
+                    text_labels.push_back({text.size(), label});
+                    break;
+                case DATA: symbols[label] = data.base + data.bytes.size(); break;
+                case KDATA: symbols[label] = kdata.base + kdata.bytes.size(); break;
+                case KTEXT: break;
+            }
+            rest = trim(rest.substr(colon + 1));
+        }
+        if (rest.empty())
+            continue;
+
+        // name = value
+        std::size_t equal = rest.find('=');
+        if (rest[0] != '.' && equal != std::string::npos && rest.find('"') == std::string::npos) {
+            int64_t value;
+            if (!value_of(trim(rest.substr(equal + 1)), value))
+                error(where() + "bad constant " + rest);
+            symbols[trim(rest.substr(0, equal))] = static_cast<uint32_t>(value);
+            continue;
+        }
+
+        std::size_t blank = rest.find_first_of(" \t");
+        std::string head = rest.substr(0, blank);
+        std::string args = blank == std::string::npos ? "" : trim(rest.substr(blank));
+        if (head[0] == '.') {
+            Segment* s = segment == DATA ? &data : segment == KDATA ? &kdata : nullptr;
+            if (head == ".data")
+                segment = DATA;
+            else if (head == ".text")
+                segment = TEXT;
+            else if (head == ".kdata")
+                segment = KDATA;
+            else if (head == ".ktext")
+                segment = KTEXT;
+            else if (head == ".globl")
+                globals.insert(args);
+            else if (!s || head == ".set" || head == ".extern")
+                ;   // the exception handler isn't run, errors stop the program.
+            else if (head == ".align") {
+                while (s->bytes.size() % (1u << std::atoi(args.c_str())))
+                    s->bytes.push_back(0);
+            } else if (head == ".word") {
+                while (s->bytes.size() % 4)
+                    s->bytes.push_back(0);
+                for (auto& word: split_operands(args)) {
+                    int64_t value = 0;
+                    if (!parse_int(word, value))
+                        data_fixups.push_back({s->base + static_cast<uint32_t>(s->bytes.size()), word});
+                    for (int i = 0; i < 4; i++)
+                        s->bytes.push_back(static_cast<uint32_t>(value) >> (8 * i));
+                }
+            } else if (head == ".byte") {
+                for (auto& byte: split_operands(args)) {
+                    int64_t value;
+                    if (!value_of(byte, value))
+                        error(where() + "bad byte " + byte);
+                    s->bytes.push_back(static_cast<uint8_t>(value));
+                }
+            } else if (head == ".space") {
+                int64_t size;
+                if (!value_of(args, size))
+                    error(where() + "bad size " + args);
+                s->bytes.resize(s->bytes.size() + size, 0);
+            } else if (head == ".ascii" || head == ".asciiz") {
+                std::size_t open = args.find('"'), close = args.rfind('"');
+                if (open == std::string::npos || open == close)
+                    error(where() + "bad string " + args);
+                for (char c: unescape(args.substr(open + 1, close - open - 1)))
+                    s->bytes.push_back(static_cast<uint8_t>(c));
+                if (head == ".asciiz")
+                    s->bytes.push_back(0);
+            } else {
+                error(where() + "unknown directive " + head);
+            }
+            continue;
+        }
+
+        auto opcode = opcodes.find(head);
+        if (opcode == opcodes.end())
+            error(where() + "unknown instruction " + head);
+        if (segment != TEXT)
+            continue;
+        Instr instr;
+        instr.op = opcode->second;
+        instr.operands = split_operands(args);
+        instr.text = rest;
+        text.push_back(instr);
+    }
+}
+
+void Simulator::resolve_address(Instr& instr, const std::string& operand) {
+    // off($reg), ($reg), label, label($reg) or an address.
+    std::size_t open = operand.find('(');
+    int64_t offset = 0;
+    std::string base = open == std::string::npos ? operand : operand.substr(0, open);
+    if (!base.empty() && !value_of(base, offset))
+        error("bad address " + operand + " in " + instr.text);
+    instr.imm = static_cast<int32_t>(offset);
+    instr.rs = 0;
+    if (open != std::string::npos) {
+        instr.rs = register_of(operand.substr(open + 1, operand.find(')') - open - 1));
+        if (instr.rs < 0)
+            error("bad register in " + instr.text);
+    }
+}
+
+uint32_t Simulator::text_index(const std::string& label, const Instr& instr) {
+    auto symbol = symbols.find(label);
+    if (symbol == symbols.end())
+        error("undefined label " + label + " in " + instr.text);
+    uint32_t address = symbol->second;
+    if (address < TEXT_BASE || address > TEXT_BASE + 4 * text.size())
+        error("branch out of the text in " + instr.text);
+    return (address - TEXT_BASE) / 4;
+}
+
+void Simulator::resolve(Instr& instr) {
+    auto& ops = instr.operands;
+    auto need = [&](std::size_t n) {
+        if (ops.size() < n)
+            error("missing operands in " + instr.text);
+    };
+    auto reg = [&](std::size_t i) {
+        int r = register_of(ops[i]);
+        if (r < 0)
+            error("bad register " + ops[i] + " in " + instr.text);
+        return r;
+    };
+    // a register or an immediate as the last operand.
+    auto source = [&](std::size_t i) {
+        int r = register_of(ops[i]);
+        if (r >= 0) {
+            instr.rt = r;
+            instr.uses |= bit(r);
+            return;
+        }
+        int64_t value;
+        if (!value_of(ops[i], value))
+            error("bad operand " + ops[i] + " in " + instr.text);
+        instr.has_imm = true;
+        instr.imm = static_cast<int32_t>(value);
+    };
+
+    switch (op_class(instr.op)) {
+        case OpClass::Alu:
+        case OpClass::MulDiv:
+            need(2);
+            instr.rd = reg(0);
+            if (instr.op == Op::Li || instr.op == Op::Lui || instr.op == Op::La) {
+                int64_t value;
+                if (instr.op == Op::La && ops[1].find('(') != std::string::npos)
+                    resolve_address(instr, ops[1]);
+                else if (value_of(ops[1], value))
+                    instr.imm = static_cast<int32_t>(value);
+                else
+                    error("bad immediate in " + instr.text);
+                instr.uses = bit(instr.rs);
+            } else if (instr.op == Op::Neg || instr.op == Op::Not || instr.op == Op::Move) {
+                instr.rs = reg(1);
+                instr.uses = bit(instr.rs);
+            } else {
+                // rd, rs, src or rd, src for rd, rd, src.
+                instr.rs = ops.size() == 2 ? instr.rd : reg(1);
+                instr.uses = bit(instr.rs);
+                source(ops.size() == 2 ? 1 : 2);
+            }
+            break;
+        case OpClass::Load:
+        case OpClass::Store:
+            need(2);
+            instr.rt = reg(0);
+            resolve_address(instr, ops[1]);
+            instr.uses = bit(instr.rs) | (op_class(instr.op) == OpClass::Store ? bit(instr.rt) : 0);
+            break;
+        case OpClass::Branch:
+            if (instr.op >= Op::Beqz) {
+                need(2);
+                instr.rs = reg(0);
+                instr.uses = bit(instr.rs);
+                instr.target = text_index(ops[1], instr);
+            } else {
+                need(3);
+                instr.rs = reg(0);
+                instr.uses = bit(instr.rs);
+                source(1);
+                instr.target = text_index(ops[2], instr);
+            }
+            break;
+        case OpClass::Jump:
+            need(1);
+            if (instr.op == Op::Jr || instr.op == Op::Jalr) {
+                instr.rs = reg(0);
+                instr.uses = bit(instr.rs);
+            } else {
+                instr.target = text_index(ops[0], instr);
+            }
+            break;
+        case OpClass::Syscall:
+            instr.uses = bit(V0) | bit(A0) | bit(A1);
+            break;
+        default:
+            if (instr.op == Op::Mfc0) {
+                need(1);
+                instr.rt = reg(0);
+            }
+            break;
+    }
+    ops.clear();
+}
+
+void Simulator::link() {
+    for (auto& fixup: data_fixups) {
+        int64_t value;
+        if (!value_of(fixup.second, value))
+            error("undefined symbol " + fixup.second + " in a .word");
+        write32(fixup.first, static_cast<uint32_t>(value));
+    }
+    for (auto& instr: text)
+        resolve(instr);
+
+    // the routines start at the labels of the methods, of the _init and
+    // at the global labels.
+    for (auto& label: text_labels) {
+        if (!is_routine(label.second, globals) || (!routines.empty() && routine_start.back() == label.first))
+            continue;
+        routines.push_back(label.second);
+        routine_start.push_back(label.first);
+    }
+    for (std::size_t r = 0; r < routines.size(); r++) {
+        uint32_t end = r + 1 < routines.size() ? routine_start[r + 1] : text.size();
+        for (uint32_t i = routine_start[r]; i < end; i++)
+            text[i].routine = r;
+    }
+    routine_instructions.assign(routines.size() + 1, 0);
+    routine_cycles.assign(routines.size() + 1, 0);
+
+    brk = std::max<uint32_t>((data.base + data.bytes.size() + 3) & ~3u, data.base + INITIAL_DATA_SIZE);
+    data.bytes.resize(brk - data.base, 0);
+    stack.bytes.assign(STACK_SIZE, 0);
+}
+
+uint8_t* Simulator::memory(uint32_t address, unsigned size) {
+    if (address % size)
+        exception("Unaligned address in data/stack access: " + std::to_string(address));
+    if (address >= data.base && address - data.base + size <= data.bytes.size())
+        return &data.bytes[address - data.base];
+    if (address >= stack.base && address - stack.base + size <= stack.bytes.size())
+        return &stack.bytes[address - stack.base];
+    if (address >= kdata.base && address - kdata.base + size <= kdata.bytes.size())
+        return &kdata.bytes[address - kdata.base];
+    exception("Bad address in data/stack read: " + std::to_string(address));
+}
+
+uint32_t Simulator::read32(uint32_t address) {
+    uint32_t value;
+    std::memcpy(&value, memory(address, 4), 4);
+    return value;
+}
+
+void Simulator::write32(uint32_t address, uint32_t value) {
+    std::memcpy(memory(address, 4), &value, 4);
+}
+
+uint32_t Simulator::jump_target(uint32_t address) {
+    if (address < TEXT_BASE || address >= TEXT_BASE + 4 * text.size() || address % 4)
+        exception("Bad address in text read: " + std::to_string(address));
+    return (address - TEXT_BASE) / 4;
+}
+
+bool Simulator::syscall() {
+    switch (regs[V0]) {
+        case 1:
+            output += std::to_string(regs[A0]);
+            break;
+        case 4:
+            for (uint32_t address = regs[A0]; char c = *memory(address, 1); address++)
+                output += c;
+            break;
+        case 5: {
+            flush();
+            char line[256];
+            regs[V0] = std::fgets(line, sizeof line, stdin) ? static_cast<int32_t>(std::strtol(line, nullptr, 10)) : 0;
+            break;
+        }
+        case 8: {
+            // at most a1 - 1 characters, with the '\n'.
+            flush();
+            int32_t size = regs[A1];
+            std::vector<char> line(size > 0 ? size : 1, 0);
+            if (size <= 0 || !std::fgets(line.data(), size, stdin))
+                line[0] = 0;
+            for (int32_t i = 0; i < size; i++) {
+                *memory(regs[A0] + i, 1) = line[i];
+                if (!line[i])
+                    break;
+            }
+            break;
+        }
+        case 9: {
+            uint32_t old = brk;
+            brk += (static_cast<uint32_t>(regs[A0]) + 3) & ~3u;
+            data.bytes.resize(brk - data.base, 0);
+            regs[V0] = old;
+            break;
+        }
+        case 10:
+            flush();
+            return false;
+        case 11:
+            output += static_cast<char>(regs[A0]);
+            break;
+        case 100:
+            regs[V0] = static_cast<int32_t>(stats.instructions);
+            break;
+        default:
+            exception("Unsupported syscall " + std::to_string(regs[V0]));
+    }
+    if (output.size() > (1 << 16))
+        flush();
+    return true;
+}
+
+int Simulator::run(uint64_t limit) {
+    try {
+        execute(limit);
+    } catch (const Halt& halt) {
+        return halt.status;
+    }
+    return 0;
+}
+
+void Simulator::execute(uint64_t limit) {
+    auto start = symbols.find("__start");
+    if (start == symbols.end())
+        error("no __start label, is the runtime loaded?");
+    if (start->second < TEXT_BASE || start->second >= TEXT_BASE + 4 * text.size())
+        error("__start isn't in the text");
+    pc = (start->second - TEXT_BASE) / 4;
+    regs[29] = INITIAL_SP;
+    regs[28] = INITIAL_GP;
+
+    int loaded = 0;     // register loaded by the previous instruction.
+    while (true) {
+        if (pc >= text.size()) {
+            pc = text.size() - 1;
+            exception("Bad address in text read: " + std::to_string(TEXT_BASE + 4 * (pc + 1)));
+        }
+        const Instr& instr = text[pc];
+        if (limit && stats.instructions == limit)
+            error("more than " + std::to_string(limit) + " instructions executed");
+
+        uint64_t cycles = 1;
+        if (loaded && (instr.uses & bit(loaded)))
+            cycles += costs.load_use_stall;
+        loaded = 0;
+
+        uint32_t next = pc + 1;
+        int32_t a = regs[instr.rs];
+        int32_t b = instr.has_imm ? instr.imm : regs[instr.rt];
+        uint32_t ua = a, ub = b;
+        switch (instr.op) {
+            case Op::Add: case Op::Addu: regs[instr.rd] = ua + ub; break;
+            case Op::Sub: case Op::Subu: regs[instr.rd] = ua - ub; break;
+            case Op::And: regs[instr.rd] = a & b; break;
+            case Op::Or: regs[instr.rd] = a | b; break;
+            case Op::Xor: regs[instr.rd] = a ^ b; break;
+            case Op::Nor: regs[instr.rd] = ~(a | b); break;
+            case Op::Mul: regs[instr.rd] = ua * ub; cycles += costs.mul_latency; break;
+            case Op::Div:
+            case Op::Rem:
+                if (b == 0)
+                    exception("Division by 0");
+                if (a == INT32_MIN && b == -1)
+                    regs[instr.rd] = instr.op == Op::Div ? a : 0;
+                else
+                    regs[instr.rd] = instr.op == Op::Div ? a / b : a % b;
+                cycles += costs.div_latency;
+                break;
+            case Op::Divu:
+                if (b == 0)
+                    exception("Division by 0");
+                regs[instr.rd] = ua / ub;
+                cycles += costs.div_latency;
+                break;
+            case Op::Sll: case Op::Sllv: regs[instr.rd] = ua << (ub & 31); break;
+            case Op::Srl: case Op::Srlv: regs[instr.rd] = ua >> (ub & 31); break;
+            case Op::Sra: case Op::Srav: regs[instr.rd] = a >> (ub & 31); break;
+            case Op::Slt: regs[instr.rd] = a < b; break;
+            case Op::Sltu: regs[instr.rd] = ua < ub; break;
+            case Op::Seq: regs[instr.rd] = a == b; break;
+            case Op::Sne: regs[instr.rd] = a != b; break;
+            case Op::Sge: regs[instr.rd] = a >= b; break;
+            case Op::Sgt: regs[instr.rd] = a > b; break;
+            case Op::Sle: regs[instr.rd] = a <= b; break;
+            case Op::Neg: regs[instr.rd] = 0u - ua; break;
+            case Op::Not: regs[instr.rd] = ~a; break;
+            case Op::Move: regs[instr.rd] = a; break;
+            case Op::Li: regs[instr.rd] = instr.imm; break;
+            case Op::La: regs[instr.rd] = instr.imm + (instr.rs ? a : 0); break;
+            case Op::Lui: regs[instr.rd] = static_cast<uint32_t>(instr.imm) << 16; break;
+            case Op::Lw: regs[instr.rt] = read32(a + instr.imm); break;
+            case Op::Lb: regs[instr.rt] = static_cast<int8_t>(*memory(a + instr.imm, 1)); break;
+            case Op::Lbu: regs[instr.rt] = *memory(a + instr.imm, 1); break;
+            case Op::Lh: {
+                int16_t half;
+                std::memcpy(&half, memory(a + instr.imm, 2), 2);
+                regs[instr.rt] = half;
+                break;
+            }
+            case Op::Lhu: {
+                uint16_t half;
+                std::memcpy(&half, memory(a + instr.imm, 2), 2);
+                regs[instr.rt] = half;
+                break;
+            }
+            case Op::Sw: write32(a + instr.imm, regs[instr.rt]); break;
+            case Op::Sb: *memory(a + instr.imm, 1) = static_cast<uint8_t>(regs[instr.rt]); break;
+            case Op::Sh: {
+                uint16_t half = static_cast<uint16_t>(regs[instr.rt]);
+                std::memcpy(memory(a + instr.imm, 2), &half, 2);
+                break;
+            }
+            case Op::Beq: if (a == b) next = instr.target; break;
+            case Op::Bne: if (a != b) next = instr.target; break;
+            case Op::Blt: if (a < b) next = instr.target; break;
+            case Op::Bgt: if (a > b) next = instr.target; break;
+            case Op::Ble: if (a <= b) next = instr.target; break;
+            case Op::Bge: if (a >= b) next = instr.target; break;
+            case Op::Bltu: if (ua < ub) next = instr.target; break;
+            case Op::Bgtu: if (ua > ub) next = instr.target; break;
+            case Op::Bleu: if (ua <= ub) next = instr.target; break;
+            case Op::Bgeu: if (ua >= ub) next = instr.target; break;
+            case Op::Beqz: if (a == 0) next = instr.target; break;
+            case Op::Bnez: if (a != 0) next = instr.target; break;
+            case Op::Blez: if (a <= 0) next = instr.target; break;
+            case Op::Bgtz: if (a > 0) next = instr.target; break;
+            case Op::Bltz: if (a < 0) next = instr.target; break;
+            case Op::Bgez: if (a >= 0) next = instr.target; break;
+            case Op::B: case Op::J: next = instr.target; break;
+            case Op::Jal: regs[RA] = TEXT_BASE + 4 * (pc + 1); next = instr.target; break;
+            case Op::Jalr: next = jump_target(ua); regs[RA] = TEXT_BASE + 4 * (pc + 1); break;
+            case Op::Jr: next = jump_target(ua); break;
+            case Op::Syscall:
+                if (!syscall()) {
+                    account(instr, cycles);
+                    return;
+                }
+                break;
+            case Op::Mfc0: regs[instr.rt] = 0; break;
+            case Op::Rfe: case Op::Nop: break;
+            case Op::Break: exception("Breakpoint"); break;
+        }
+        regs[0] = 0;
+
+        OpClass c = op_class(instr.op);
+        if (c == OpClass::Load)
+            loaded = instr.rt;
+        if (c == OpClass::Jump || (c == OpClass::Branch && next != pc + 1)) {
+            cycles += costs.taken_branch;
+            stats.taken_branches += c == OpClass::Branch;
+        }
+        account(instr, cycles);
+        pc = next;
+    }
+}
+
+void Simulator::account(const Instr& instr, uint64_t cycles) {
+    OpClass c = op_class(instr.op);
+    stats.instructions++;
+    stats.cycles += cycles;
+    stats.by_class[static_cast<int>(c)]++;
+    stats.loads += c == OpClass::Load;
+    stats.stores += c == OpClass::Store;
+    std::size_t r = instr.routine >= 0 ? instr.routine : routines.size();
+    routine_instructions[r]++;
+    routine_cycles[r] += cycles;
+}
+
+void Simulator::print_stats(std::ostream& out, std::size_t nroutines) {
+    out << "instructions: " << stats.instructions << "\n";
+    out << "cycles: " << stats.cycles << "\n";
+    out << "loads: " << stats.loads << "\n";
+    out << "stores: " << stats.stores << "\n";
+    out << "taken branches: " << stats.taken_branches << "\n";
+    out << "by class:\n";
+    for (int c = 0; c < static_cast<int>(OpClass::Count); c++) {
+        out << "  " << std::setw(8) << std::left << op_class_name(static_cast<OpClass>(c)) << std::right
+            << std::setw(14) << stats.by_class[c] << "\n";
+    }
+
+    std::vector<std::size_t> order;
+    for (std::size_t r = 0; r < routine_instructions.size(); r++) {
+        if (routine_instructions[r])
+            order.push_back(r);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t a, std::size_t b) { return routine_instructions[a] > routine_instructions[b]; });
+    if (nroutines && order.size() > nroutines)
+        order.resize(nroutines);
+    out << "by routine (instructions, cycles):\n";
+    for (std::size_t r: order) {
+        out << "  " << std::setw(14) << routine_instructions[r] << std::setw(14) << routine_cycles[r] << "  "
+            << (r < routines.size() ? routines[r] : "(no routine)") << "\n";
+    }
+}
+
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace coolsim {
+
+// MIPS simulator for the code generated by coolc and the runtime of
+// lib/trap.handler.s.
+// The assembly files are loaded as SPIM does: the text and the data of
+// all of them are laid out one after the other, then the labels are
+// resolved and the program runs from __start. Pseudo instructions (li, la,
+// blt, mul, ...) count as one instruction, and there are no delay slots.
+// The syscalls of SPIM used by the runtime are supported: print_int (1),
+// print_string (4), read_int (5), read_string (8), sbrk (9), exit (10) and
+// print_char (11). The syscall 100, which SPIM lacks, gives the number of
+// instructions executed so far (its low 32 bits), timing the collections
+// for the statistics of the runtime.
+//
+// Besides running the program, the simulator counts the instructions
+// executed by class of opcode and by routine (the methods, the _init of
+// the classes and the global labels of the runtime), and their cycles on
+// a simple in-order pipeline: one cycle per instruction, plus
+//   - a stall when an instruction uses the register loaded by the one
+//     before it,
+//   - the extra latency of the multiplications and divisions,
+//   - a bubble after the branches taken and the jumps.
+
+enum class Op {
+    Add, Addu, Sub, Subu, And, Or, Xor, Nor, Mul, Div, Divu, Rem, Sll, Srl, Sra, Sllv, Srlv, Srav,
+    Slt, Sltu, Seq, Sne, Sge, Sgt, Sle,
+    Neg, Not, Move, Li, La, Lui,
+    Lw, Lb, Lbu, Lh, Lhu, Sw, Sb, Sh,
+    Beq, Bne, Blt, Bgt, Ble, Bge, Bltu, Bgtu, Bleu, Bgeu, Beqz, Bnez, Blez, Bgtz, Bltz, Bgez,
+    B, J, Jal, Jr, Jalr,
+    Syscall, Mfc0, Rfe, Nop, Break,
+};
+
+enum class OpClass { Alu, MulDiv, Load, Store, Branch, Jump, Syscall, Other, Count };
+
+struct CostModel {
+    unsigned load_use_stall = 1;
+    unsigned mul_latency = 3;
+    unsigned div_latency = 34;
+    unsigned taken_branch = 1;
+};
+
+struct Instr {
+    Op op;
+    int rd{0};
+    int rs{0};
+    int rt{0};
+    bool has_imm{false};
+    int32_t imm{0};
+    uint32_t target{0};     // index of the instruction branched to.
+    uint32_t uses{0};       // registers read.
+    int routine{-1};
+    std::string text;
+    std::vector<std::string> operands;  // until the labels are resolved.
+};
+
+struct Stats {
+    uint64_t instructions{0};
+    uint64_t cycles{0};
+    uint64_t loads{0};
+    uint64_t stores{0};
+    uint64_t taken_branches{0};
+    uint64_t by_class[static_cast<int>(OpClass::Count)]{};
+};
+
+class Simulator {
+    public:
+        Simulator();
+
+        // assemble the file at `path` after the ones loaded so far.
+        void load(const std::string& path);
+
+        // resolve the labels and lay out the memory, once all the files
+        // are loaded.
+        void link();
+
+        // run the program from __start until it exits, returning its exit
+        // status. It stops with an error after `limit` instructions if
+        // `limit` isn't 0.
+        int run(uint64_t limit = 0);
+
+        void set_costs(const CostModel& costs_) { costs = costs_; }
+
+        const Stats& get_stats() { return stats; }
+
+        // the totals, the counts by class of opcode and the `nroutines`
+        // routines running the most instructions (all of them if 0).
+        void print_stats(std::ostream& out, std::size_t nroutines);
+
+    private:
+        struct Segment {
+            uint32_t base;
+            std::vector<uint8_t> bytes;
+        };
+
+        std::vector<Instr> text;
+        Segment data;
+        Segment kdata;
+        Segment stack;
+        std::unordered_map<std::string, uint32_t> symbols;
+        std::unordered_set<std::string> globals;
+        std::vector<std::pair<uint32_t, std::string>> data_fixups;   // address of a .word, its label.
+        std::vector<std::pair<uint32_t, std::string>> text_labels;   // index of the instruction, label.
+        std::vector<std::string> routines;
+        std::vector<uint32_t> routine_start;
+        std::vector<uint64_t> routine_instructions;
+        std::vector<uint64_t> routine_cycles;
+
+        int32_t regs[32]{};
+        uint32_t pc{0};
+        uint32_t brk{0};
+        CostModel costs;
+        Stats stats;
+        std::string output;
+
+        [[noreturn]] void error(const std::string& message);
+        [[noreturn]] void exception(const std::string& message);
+        void flush();
+
+        bool value_of(const std::string& s, int64_t& value);
+        int register_of(const std::string& s);
+        void resolve(Instr& instr);
+        void resolve_address(Instr& instr, const std::string& operand);
+        uint32_t text_index(const std::string& label, const Instr& instr);
+        uint32_t jump_target(uint32_t address);
+
+        uint8_t* memory(uint32_t address, unsigned size);
+        uint32_t read32(uint32_t address);
+        void write32(uint32_t address, uint32_t value);
+
+        // thrown when the program stops on an exception.
+        struct Halt {
+            int status;
+        };
+
+        void execute(uint64_t limit);
+
+        // false when the program exits.
+        bool syscall();
+        void account(const Instr& instr, uint64_t cycles);
+};
+
+OpClass op_class(Op op);
+const char* op_class_name(OpClass c);
+
+}